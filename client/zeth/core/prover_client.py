@@ -15,7 +15,7 @@ from os.path import exists
 from os import unlink
 import json
 from google.protobuf import empty_pb2
-from typing import Dict, Optional, Any
+from typing import Callable, Dict, List, Optional, Any
 
 
 class ProverConfiguration:
@@ -98,14 +98,16 @@ class ProverClient:
 
         return self.prover_config
 
-    def get_verification_key(self) -> VerificationKey:
+    def get_verification_key(self, circuit_id: str = "") -> VerificationKey:
         """
-        Fetch the verification key from the proving service
+        Fetch the verification key from the proving service, for the given
+        circuit (or the default circuit if empty)
         """
         with grpc.insecure_channel(self.endpoint) as channel:
             stub = prover_pb2_grpc.ProverStub(channel)  # type: ignore
             print("-------------- Get the verification key --------------")
-            verificationkey = stub.GetVerificationKey(_make_empty_message())
+            verificationkey = stub.GetVerificationKey(
+                prover_pb2.VerificationKeyRequest(circuit_id=circuit_id))
             return verificationkey
 
     def get_balance_verification_key(self) -> VerificationKey:
@@ -130,6 +132,60 @@ class ProverClient:
             proof = stub.Prove(proof_inputs)
             return proof
 
+    def get_proof_with_progress(
+            self,
+            proof_inputs: ProofInputs,
+            on_stage: Callable[[Any], None]) -> ExtendedProof:
+        """
+        Request a proof generation to the proving service, calling `on_stage`
+        with each ProofStageEvent as the stages of proof generation complete.
+        """
+        with grpc.insecure_channel(self.endpoint) as channel:
+            stub = prover_pb2_grpc.ProverStub(channel)  # type: ignore
+            print("-------------- Get the proof (with progress) --------------")
+            for progress in stub.ProveWithProgress(proof_inputs):
+                if progress.HasField("proof"):
+                    return progress.proof
+                on_stage(progress.stage)
+        raise Exception("prover stream ended without a proof")
+
+    def get_status(self) -> prover_pb2.ProverStatus:
+        """
+        Get the current state of the proving service (memory budget and proofs
+        in progress)
+        """
+        with grpc.insecure_channel(self.endpoint) as channel:
+            stub = prover_pb2_grpc.ProverStub(channel)  # type: ignore
+            return stub.GetStatus(_make_empty_message())
+
+    def verify_proof(
+            self,
+            extended_proof: ExtendedProof,
+            circuit_id: str = "") -> bool:
+        """
+        Check a proof with the verification key of the proving service, for the
+        given circuit (or the default circuit if empty)
+        """
+        with grpc.insecure_channel(self.endpoint) as channel:
+            stub = prover_pb2_grpc.ProverStub(channel)  # type: ignore
+            response = stub.Verify(prover_pb2.VerifyRequest(
+                circuit_id=circuit_id, extended_proof=extended_proof))
+            return response.valid
+
+    def verify_proofs(
+            self,
+            extended_proofs: List[ExtendedProof],
+            circuit_id: str = "") -> List[bool]:
+        """
+        Check a batch of proofs for the same circuit with the verification key
+        of the proving service, returning the validity of each proof
+        """
+        with grpc.insecure_channel(self.endpoint) as channel:
+            stub = prover_pb2_grpc.ProverStub(channel)  # type: ignore
+            response = stub.VerifyBatch(prover_pb2.VerifyBatchRequest(
+                circuit_id=circuit_id, extended_proofs=extended_proofs))
+            return list(response.valid)
+
     def get_balance_proof(
             self,
             proof_inputs: BalanceProofInputs) -> ExtendedProof:
@@ -8,6 +8,8 @@ import json
 import os
 import re
 
+from r1cs_bytes import load_r1cs_bytes
+
 def get_index(annotation_set, annotation):
     """
     Finds the index corresponding to `annotation`
@@ -108,15 +110,17 @@ def is_in_lin_comb(linear_combination, annotation_index):
 
 if __name__ == "__main__":
     path_zeth = os.environ["ZETH_DEBUG_DIR"]
-    filename = "r1cs.json"
-
-    # Read file
-    file_path = os.path.join(path_zeth, filename)
-    with open(file_path, 'r') as r1cs_file:
-        data=r1cs_file.read()
 
-    # Parse file
-    r1cs_obj = json.loads(data)
+    # Read and parse the file, using the binary export (`r1cs.r1cs`) if
+    # present, and the json export (`r1cs.json`) otherwise.
+    bytes_file_path = os.path.join(path_zeth, "r1cs.r1cs")
+    if os.path.exists(bytes_file_path):
+        r1cs_obj = load_r1cs_bytes(bytes_file_path)
+    else:
+        file_path = os.path.join(path_zeth, "r1cs.json")
+        with open(file_path, 'r') as r1cs_file:
+            data=r1cs_file.read()
+        r1cs_obj = json.loads(data)
     r1cs_variables_nb = r1cs_obj["num_variables"]
     r1cs_constraints_nb = r1cs_obj["num_constraints"]
 
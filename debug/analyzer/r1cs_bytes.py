@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+
+# Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+#
+# SPDX-License-Identifier: LGPL-3.0+
+
+import struct
+
+# Section types of the binary r1cs format, see:
+#   https://github.com/iden3/r1csfile/blob/master/doc/r1cs_bin_format.md
+SECTION_HEADER = 1
+SECTION_CONSTRAINTS = 2
+
+
+def _read_linear_combination(data, offset, field_size):
+    """
+    Reads a linear combination starting at `offset`, and returns it (in the
+    format of the json export) along with the offset of the following data.
+    """
+    (num_terms,) = struct.unpack_from("<I", data, offset)
+    offset += 4
+    terms = []
+    for _ in range(num_terms):
+        (index,) = struct.unpack_from("<I", data, offset)
+        offset += 4
+        value = int.from_bytes(data[offset:offset + field_size], "little")
+        offset += field_size
+        terms.append({"index": index, "value": hex(value)})
+    return terms, offset
+
+
+def load_r1cs_bytes(file_path):
+    """
+    Loads an r1cs exported in the binary format (`prover_server --r1cs-format
+    bytes`), and returns an object with the same structure as the json export,
+    so that the same queries can be used on both. The binary format does not
+    contain annotations, so the wire indices are used in their place.
+    """
+    with open(file_path, 'rb') as r1cs_file:
+        data = r1cs_file.read()
+
+    if data[0:4] != b"r1cs":
+        raise Exception("invalid r1cs magic")
+    (version, num_sections) = struct.unpack_from("<II", data, 4)
+    if version != 1:
+        raise Exception("unsupported r1cs version {}".format(version))
+
+    offset = 12
+    header = None
+    constraints = []
+    for _ in range(num_sections):
+        (section_type, section_size) = struct.unpack_from("<IQ", data, offset)
+        offset += 12
+        section_end = offset + section_size
+
+        if section_type == SECTION_HEADER:
+            (field_size,) = struct.unpack_from("<I", data, offset)
+            prime = int.from_bytes(
+                data[offset + 4:offset + 4 + field_size], "little")
+            (num_wires, num_pub_out, num_pub_in, _num_prv_in, _num_labels,
+             num_constraints) = struct.unpack_from(
+                 "<IIIIQI", data, offset + 4 + field_size)
+            header = {
+                "field_size": field_size,
+                "prime": prime,
+                "num_wires": num_wires,
+                "num_inputs": num_pub_out + num_pub_in,
+                "num_constraints": num_constraints,
+            }
+        elif section_type == SECTION_CONSTRAINTS:
+            if header is None:
+                raise Exception("r1cs header must come first")
+            lc_offset = offset
+            for constraint_id in range(header["num_constraints"]):
+                lin_comb = {}
+                for name in ["A", "B", "C"]:
+                    lin_comb[name], lc_offset = _read_linear_combination(
+                        data, lc_offset, header["field_size"])
+                constraints.append({
+                    "constraint_id": constraint_id,
+                    "constraint_annotation": str(constraint_id),
+                    "linear_combination": lin_comb,
+                })
+
+        offset = section_end
+
+    if header is None:
+        raise Exception("r1cs header missing")
+
+    return {
+        "scalar_field_characteristic": hex(header["prime"]),
+        # As for the json export, the number of variables does not include
+        # the constant wire ONE.
+        "num_variables": header["num_wires"] - 1,
+        "num_constraints": header["num_constraints"],
+        "num_inputs": header["num_inputs"],
+        "variables_annotations": [
+            {"index": i, "annotation": str(i)}
+            for i in range(header["num_wires"])],
+        "constraints": constraints,
+    }
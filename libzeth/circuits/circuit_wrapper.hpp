@@ -6,10 +6,15 @@
 #define __ZETH_CIRCUITS_CIRCUIT_WRAPPER_HPP__
 
 #include "libzeth/circuits/joinsplit.tcc"
+#include "libzeth/core/cancellation.hpp"
 #include "libzeth/core/extended_proof.hpp"
 #include "libzeth/core/note.hpp"
+#include "libzeth/core/proof_progress.hpp"
 #include "libzeth/zeth_constants.hpp"
 
+#include <memory>
+#include <mutex>
+
 namespace libzeth
 {
 
@@ -35,6 +40,30 @@ private:
         TreeDepth>>
         joinsplit_g;
 
+    // Data shared by all proofs (such as the precomputed evaluation domain),
+    // created by the first proof from the sizes of the constraint system held
+    // by its proving key.
+    mutable std::mutex prover_context_mutex;
+    mutable std::unique_ptr<typename snarkT::prover_context> prover_context;
+
+    typename snarkT::prover_context &get_prover_context(
+        const typename snarkT::proving_key &proving_key) const;
+
+    // Generate the constraints and witness of the joinsplit gadget in `pb`
+    // (see `prove`).
+    void generate_witness(
+        libsnark::protoboard<libff::Fr<ppT>> &pb,
+        const libff::Fr<ppT> &root,
+        const std::array<joinsplit_input<libff::Fr<ppT>, TreeDepth>, NumInputs>
+            &inputs,
+        const std::array<zeth_note, NumOutputs> &outputs,
+        const bits64 &vpub_in,
+        const bits64 &vpub_out,
+        const bits256 &h_sig_in,
+        const bits256 &phi_in,
+        const cancellation_token *cancel,
+        proof_progress_listener *progress) const;
+
 public:
     using Field = libff::Fr<ppT>;
 
@@ -46,7 +75,27 @@ public:
     // Retrieve the constraint system (intended for debugging purposes).
     libsnark::protoboard<Field> get_constraint_system() const;
 
-    // Generate a proof and returns an extended proof
+    // Generate the constraint system (with its annotations). The protoboard
+    // only gives access to a copy of its constraint system, so two copies are
+    // held while it is generated, but unlike `get_constraint_system`, the
+    // protoboard is released before returning.
+    libsnark::r1cs_constraint_system<Field> generate_constraint_system() const;
+
+    // Estimate of the peak memory (in bytes) allocated by `prove`: the
+    // protoboard (constraint system and assignment), and the allocations of
+    // the snark prover. The constraint system is generated to compute it, so
+    // the result should be kept by the caller.
+    size_t proof_memory_estimate() const;
+
+    // Estimate as above, for the constraint system `cs` of the circuit (for
+    // callers which already hold it).
+    static size_t proof_memory_estimate(
+        const libsnark::r1cs_constraint_system<Field> &cs);
+
+    // Generate a proof and returns an extended proof. If `cancel` is not null,
+    // it is checked between the stages of proof generation, and
+    // `operation_cancelled` is thrown if it has been cancelled. If `progress`
+    // is not null, it is notified as each stage completes.
     extended_proof<ppT, snarkT> prove(
         const Field &root,
         const std::array<joinsplit_input<Field, TreeDepth>, NumInputs> &inputs,
@@ -55,7 +104,27 @@ public:
         const bits64 &vpub_out,
         const bits256 &h_sig_in,
         const bits256 &phi_in,
-        const typename snarkT::proving_key &proving_key) const;
+        const typename snarkT::proving_key &proving_key,
+        const cancellation_token *cancel = nullptr,
+        proof_progress_listener *progress = nullptr) const;
+
+    // Generate a proof as above, using the low-memory prover of the snark
+    // (see groth16_snark::generate_proof_low_memory), which releases the
+    // protoboard after witness generation and streams the proving key from
+    // its file. Only available for snarks with a `streaming_proving_key`
+    // type, which `streamingProvingKeyT` must be.
+    template<typename streamingProvingKeyT>
+    extended_proof<ppT, snarkT> prove_low_memory(
+        const Field &root,
+        const std::array<joinsplit_input<Field, TreeDepth>, NumInputs> &inputs,
+        const std::array<zeth_note, NumOutputs> &outputs,
+        const bits64 &vpub_in,
+        const bits64 &vpub_out,
+        const bits256 &h_sig_in,
+        const bits256 &phi_in,
+        const streamingProvingKeyT &proving_key,
+        const cancellation_token *cancel = nullptr,
+        proof_progress_listener *progress = nullptr) const;
 };
 
 } // namespace libzeth
@@ -80,6 +80,77 @@ libsnark::protoboard<libff::Fr<ppT>> circuit_wrapper<
     return pb;
 }
 
+template<
+    typename HashT,
+    typename HashTreeT,
+    typename ppT,
+    typename snarkT,
+    size_t NumInputs,
+    size_t NumOutputs,
+    size_t TreeDepth>
+libsnark::r1cs_constraint_system<libff::Fr<ppT>> circuit_wrapper<
+    HashT,
+    HashTreeT,
+    ppT,
+    snarkT,
+    NumInputs,
+    NumOutputs,
+    TreeDepth>::generate_constraint_system() const
+{
+    // The protoboard only gives access to a copy of its constraint system.
+    return get_constraint_system().get_constraint_system();
+}
+
+template<
+    typename HashT,
+    typename HashTreeT,
+    typename ppT,
+    typename snarkT,
+    size_t NumInputs,
+    size_t NumOutputs,
+    size_t TreeDepth>
+size_t circuit_wrapper<
+    HashT,
+    HashTreeT,
+    ppT,
+    snarkT,
+    NumInputs,
+    NumOutputs,
+    TreeDepth>::proof_memory_estimate() const
+{
+    return proof_memory_estimate(generate_constraint_system());
+}
+
+template<
+    typename HashT,
+    typename HashTreeT,
+    typename ppT,
+    typename snarkT,
+    size_t NumInputs,
+    size_t NumOutputs,
+    size_t TreeDepth>
+size_t circuit_wrapper<
+    HashT,
+    HashTreeT,
+    ppT,
+    snarkT,
+    NumInputs,
+    NumOutputs,
+    TreeDepth>::
+    proof_memory_estimate(const libsnark::r1cs_constraint_system<Field> &cs)
+{
+    size_t protoboard_size = (cs.num_variables() + 1) * sizeof(Field);
+    for (const libsnark::r1cs_constraint<Field> &constraint : cs.constraints) {
+        protoboard_size += sizeof(constraint) +
+                           (constraint.a.terms.size() +
+                            constraint.b.terms.size() +
+                            constraint.c.terms.size()) *
+                               sizeof(libsnark::linear_term<Field>);
+    }
+
+    return protoboard_size + snarkT::proof_memory_estimate(cs);
+}
+
 template<
     typename HashT,
     typename HashTreeT,
@@ -104,7 +175,112 @@ extended_proof<ppT, snarkT> circuit_wrapper<
         const bits64 &vpub_out,
         const bits256 &h_sig_in,
         const bits256 &phi_in,
-        const typename snarkT::proving_key &proving_key) const
+        const typename snarkT::proving_key &proving_key,
+        const cancellation_token *cancel,
+        proof_progress_listener *progress) const
+{
+    libsnark::protoboard<Field> pb;
+    generate_witness(
+        pb,
+        root,
+        inputs,
+        outputs,
+        vpub_in,
+        vpub_out,
+        h_sig_in,
+        phi_in,
+        cancel,
+        progress);
+
+    // Instantiate an extended_proof from the proof we generated and the given
+    // primary_input
+    return extended_proof<ppT, snarkT>(
+        snarkT::generate_proof(
+            pb,
+            proving_key,
+            get_prover_context(proving_key),
+            cancel,
+            progress),
+        pb.primary_input());
+}
+
+template<
+    typename HashT,
+    typename HashTreeT,
+    typename ppT,
+    typename snarkT,
+    size_t NumInputs,
+    size_t NumOutputs,
+    size_t TreeDepth>
+template<typename streamingProvingKeyT>
+extended_proof<ppT, snarkT> circuit_wrapper<
+    HashT,
+    HashTreeT,
+    ppT,
+    snarkT,
+    NumInputs,
+    NumOutputs,
+    TreeDepth>::
+    prove_low_memory(
+        const Field &root,
+        const std::array<joinsplit_input<Field, TreeDepth>, NumInputs> &inputs,
+        const std::array<zeth_note, NumOutputs> &outputs,
+        const bits64 &vpub_in,
+        const bits64 &vpub_out,
+        const bits256 &h_sig_in,
+        const bits256 &phi_in,
+        const streamingProvingKeyT &proving_key,
+        const cancellation_token *cancel,
+        proof_progress_listener *progress) const
+{
+    libsnark::protoboard<Field> pb;
+    generate_witness(
+        pb,
+        root,
+        inputs,
+        outputs,
+        vpub_in,
+        vpub_out,
+        h_sig_in,
+        phi_in,
+        cancel,
+        progress);
+
+    // The protoboard is released by the prover once it is no longer needed.
+    libsnark::r1cs_primary_input<Field> primary_input = pb.primary_input();
+    return extended_proof<ppT, snarkT>(
+        snarkT::generate_proof_low_memory(
+            std::move(pb), proving_key, cancel, progress),
+        std::move(primary_input));
+}
+
+template<
+    typename HashT,
+    typename HashTreeT,
+    typename ppT,
+    typename snarkT,
+    size_t NumInputs,
+    size_t NumOutputs,
+    size_t TreeDepth>
+void circuit_wrapper<
+    HashT,
+    HashTreeT,
+    ppT,
+    snarkT,
+    NumInputs,
+    NumOutputs,
+    TreeDepth>::
+    generate_witness(
+        libsnark::protoboard<Field> &pb,
+        const Field &root,
+        const std::array<joinsplit_input<Field, TreeDepth>, NumInputs> &inputs,
+        const std::array<zeth_note, NumOutputs> &outputs,
+        const bits64 &vpub_in,
+        const bits64 &vpub_out,
+        const bits256 &h_sig_in,
+        const bits256 &phi_in,
+        const cancellation_token *cancel,
+        proof_progress_listener *progress) const
 {
     // left hand side and right hand side of the joinsplit
     bits64 lhs_value = vpub_in;
@@ -128,22 +304,49 @@ extended_proof<ppT, snarkT> circuit_wrapper<
         throw std::invalid_argument("invalid joinsplit balance");
     }
 
-    libsnark::protoboard<Field> pb;
+    check_cancelled(cancel, "witness generation");
 
+    // The gadget is only needed to generate the constraints and witness, and
+    // is released on return.
     joinsplit_gadget<Field, HashT, HashTreeT, NumInputs, NumOutputs, TreeDepth>
         g(pb);
     g.generate_r1cs_constraints();
     g.generate_r1cs_witness(
         root, inputs, outputs, vpub_in, vpub_out, h_sig_in, phi_in);
+    notify_stage_completed(progress, proof_stage_witness_generated);
 
+    check_cancelled(cancel, "satisfiability check");
     bool is_valid_witness = pb.is_satisfied();
     std::cout << "******* [DEBUG] Satisfiability result: " << is_valid_witness
               << " *******" << std::endl;
+    notify_stage_completed(progress, proof_stage_satisfiability_checked);
+}
 
-    // Instantiate an extended_proof from the proof we generated and the given
-    // primary_input
-    return extended_proof<ppT, snarkT>(
-        snarkT::generate_proof(pb, proving_key), pb.primary_input());
+template<
+    typename HashT,
+    typename HashTreeT,
+    typename ppT,
+    typename snarkT,
+    size_t NumInputs,
+    size_t NumOutputs,
+    size_t TreeDepth>
+typename snarkT::prover_context &circuit_wrapper<
+    HashT,
+    HashTreeT,
+    ppT,
+    snarkT,
+    NumInputs,
+    NumOutputs,
+    TreeDepth>::
+    get_prover_context(const typename snarkT::proving_key &proving_key) const
+{
+    std::lock_guard<std::mutex> lock(prover_context_mutex);
+    if (!prover_context) {
+        prover_context.reset(new typename snarkT::prover_context(
+            proving_key.constraint_system.num_constraints(),
+            proving_key.constraint_system.num_inputs()));
+    }
+    return *prover_context;
 }
 
 } // namespace libzeth
@@ -0,0 +1,24 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#include "libzeth/core/cancellation.hpp"
+
+namespace libzeth
+{
+
+operation_cancelled::operation_cancelled(const std::string &what)
+    : std::runtime_error(what)
+{
+}
+
+cancellation_token::~cancellation_token() {}
+
+void check_cancelled(const cancellation_token *token, const char *stage)
+{
+    if (token != nullptr && token->is_cancelled()) {
+        throw operation_cancelled(std::string("cancelled before: ") + stage);
+    }
+}
+
+} // namespace libzeth
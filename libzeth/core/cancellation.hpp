@@ -0,0 +1,38 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#ifndef __ZETH_CORE_CANCELLATION_HPP__
+#define __ZETH_CORE_CANCELLATION_HPP__
+
+#include <stdexcept>
+#include <string>
+
+namespace libzeth
+{
+
+/// Exception thrown by long-running operations which have been abandoned
+/// because their cancellation_token was cancelled.
+class operation_cancelled : public std::runtime_error
+{
+public:
+    explicit operation_cancelled(const std::string &what);
+};
+
+/// Interface queried by long-running operations (such as proof generation)
+/// between their stages, to determine whether the result is still required.
+/// Implementations must be safe to call from any thread.
+class cancellation_token
+{
+public:
+    virtual ~cancellation_token();
+    virtual bool is_cancelled() const = 0;
+};
+
+/// Throw operation_cancelled if `token` is not null and has been cancelled.
+/// `stage` describes the point at which the operation was interrupted.
+void check_cancelled(const cancellation_token *token, const char *stage);
+
+} // namespace libzeth
+
+#endif // __ZETH_CORE_CANCELLATION_HPP__
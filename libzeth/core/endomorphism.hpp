@@ -0,0 +1,93 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#ifndef __ZETH_CORE_ENDOMORPHISM_HPP__
+#define __ZETH_CORE_ENDOMORPHISM_HPP__
+
+#include "libzeth/core/include_libff.hpp"
+
+#include <gmp.h>
+#include <libff/algebra/curves/alt_bn128/alt_bn128_pp.hpp>
+#include <libff/algebra/curves/bls12_377/bls12_377_pp.hpp>
+#include <libff/algebra/scalar_multiplication/multiexp.hpp>
+#include <vector>
+
+/// Scalar multiplication and subgroup checks using efficiently computable
+/// endomorphisms of the pairing groups. For curves y^2 = x^3 + b over Fq
+/// (with q = 1 mod 3), such as alt_bn128 and bls12_377:
+///
+/// - on G1, phi(x, y) = (beta * x, y), where beta is a primitive cube root of
+///   unity in Fq, acts as multiplication by a cube root of unity lambda in Fr.
+///   Scalars are decomposed as k = k_0 + k_1 * lambda with |k_i| ~ sqrt(r)
+///   (GLV).
+///
+/// - on G2, psi (untwist, Frobenius, twist, implemented by libff as
+///   `mul_by_q`) acts as multiplication by q mod r. Scalars are decomposed in
+///   base (q mod r), which is 127 bits for alt_bn128, and 64 bits for
+///   bls12_377 (GLS).
+///
+/// k * P is then computed as sum_i(k_i * endo^i(P)), sharing the doublings
+/// between the terms, which roughly halves the cost. The constants are derived
+/// from the curve parameters on first use (after the public parameters have
+/// been initialized). Groups without a known endomorphism fall back to the
+/// libff implementations.
+
+namespace libzeth
+{
+
+/// Term k_i * endo^i(P) (negated if `negative`) of a decomposed scalar
+/// multiplication.
+template<typename GroupT> class endomorphism_component
+{
+public:
+    using bigint = libff::bigint<GroupT::scalar_field::num_limbs>;
+
+    bigint magnitude;
+    bool negative;
+    size_t power;
+};
+
+/// Scalar k, decomposed for multiplication of elements of GroupT.
+template<typename GroupT> class endomorphism_scalar
+{
+public:
+    using scalar_field = typename GroupT::scalar_field;
+
+    explicit endomorphism_scalar(const scalar_field &k);
+
+    const std::vector<endomorphism_component<GroupT>> &get_components() const;
+
+    /// k * P, interleaving the wNAF forms of the components.
+    GroupT mul(const GroupT &P) const;
+
+    /// k * P, where `table` was generated by libff::get_window_table for P,
+    /// with scalar size `endomorphism_component_bits<GroupT>()` and window
+    /// size `window`.
+    GroupT windowed_exp(
+        const size_t window, const libff::window_table<GroupT> &table) const;
+
+private:
+    std::vector<endomorphism_component<GroupT>> components;
+};
+
+/// Upper bound on the bit length of the components of decomposed scalars.
+template<typename GroupT> size_t endomorphism_component_bits();
+
+/// k * P, using the endomorphism of GroupT if available.
+template<typename GroupT>
+GroupT endomorphism_mul(
+    const typename GroupT::scalar_field &k, const GroupT &P);
+
+/// Check that a point P (assumed to be on the curve) is in the subgroup of
+/// order r, by checking that endo(P) == lambda * P, where lambda is the
+/// eigenvalue of the endomorphism. This is a valid membership test for the
+/// G1 and G2 groups of BN and BLS12 curves, and costs a multiplication by
+/// the shortest representative of lambda (or -lambda) instead of by r.
+template<typename GroupT> bool endomorphism_is_in_subgroup(const GroupT &P);
+
+} // namespace libzeth
+
+#include "libzeth/core/endomorphism.tcc"
+
+#endif // __ZETH_CORE_ENDOMORPHISM_HPP__
@@ -0,0 +1,473 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#ifndef __ZETH_CORE_ENDOMORPHISM_TCC__
+#define __ZETH_CORE_ENDOMORPHISM_TCC__
+
+#include "libzeth/core/endomorphism.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <libff/algebra/scalar_multiplication/wnaf.hpp>
+
+namespace libzeth
+{
+
+namespace internal
+{
+
+// Window size of the wNAF forms used by endomorphism_scalar::mul.
+static const size_t ENDOMORPHISM_WNAF_WINDOW = 4;
+
+// Minimal owner of an mpz_t.
+class mpz_value
+{
+public:
+    mpz_t value;
+
+    mpz_value() { mpz_init(value); }
+    mpz_value(const mpz_value &) = delete;
+    ~mpz_value() { mpz_clear(value); }
+
+    mpz_value &operator=(const mpz_value &) = delete;
+};
+
+template<typename GroupT>
+endomorphism_component<GroupT> endomorphism_component_from_mpz(
+    const mpz_t k, const size_t power)
+{
+    mpz_value magnitude;
+    mpz_abs(magnitude.value, k);
+    return endomorphism_component<GroupT>{
+        typename endomorphism_component<GroupT>::bigint(magnitude.value),
+        mpz_sgn(k) < 0,
+        power};
+}
+
+// round(n / d), for d > 0.
+inline void mpz_div_round(mpz_t result, const mpz_t n, const mpz_t d)
+{
+    mpz_value twice_n_plus_d;
+    mpz_value twice_d;
+    mpz_mul_2exp(twice_n_plus_d.value, n, 1);
+    mpz_add(twice_n_plus_d.value, twice_n_plus_d.value, d);
+    mpz_mul_2exp(twice_d.value, d, 1);
+    mpz_fdiv_q(result, twice_n_plus_d.value, twice_d.value);
+}
+
+// Groups with no known endomorphism: scalars have a single component.
+template<typename GroupT> class no_endomorphism
+{
+public:
+    using scalar_field = typename GroupT::scalar_field;
+
+    static size_t component_bits() { return scalar_field::size_in_bits(); }
+
+    static void decompose(
+        const scalar_field &k,
+        std::vector<endomorphism_component<GroupT>> &components)
+    {
+        components.push_back(
+            endomorphism_component<GroupT>{k.as_bigint(), false, 0});
+    }
+
+    // Never called, since all components have power 0.
+    static GroupT apply(const GroupT &P) { return P; }
+
+    static bool is_in_subgroup(const GroupT &P)
+    {
+        return (scalar_field::mod * P).is_zero();
+    }
+};
+
+// GLV endomorphism (x, y) -> (beta * x, y) of G1 (see endomorphism.hpp).
+template<typename GroupT> class glv_endomorphism
+{
+public:
+    using scalar_field = typename GroupT::scalar_field;
+    using base_field = typename GroupT::base_field;
+
+    static size_t component_bits() { return get_params().component_bits; }
+
+    // Babai rounding in the lattice of (a, b) such that a + b * lambda = 0
+    // mod r, with the short basis (a1, b1), (a2, b2).
+    static void decompose(
+        const scalar_field &k,
+        std::vector<endomorphism_component<GroupT>> &components)
+    {
+        const params &p = get_params();
+        mpz_value k_mpz;
+        mpz_value c1;
+        mpz_value c2;
+        mpz_value tmp;
+        mpz_value k1;
+        mpz_value k2;
+        k.as_bigint().to_mpz(k_mpz.value);
+
+        mpz_mul(tmp.value, p.b2.value, k_mpz.value);
+        mpz_div_round(c1.value, tmp.value, p.det.value);
+        mpz_mul(tmp.value, p.b1.value, k_mpz.value);
+        mpz_neg(tmp.value, tmp.value);
+        mpz_div_round(c2.value, tmp.value, p.det.value);
+
+        // k1 = k - c1 * a1 - c2 * a2, k2 = - c1 * b1 - c2 * b2
+        mpz_set(k1.value, k_mpz.value);
+        mpz_submul(k1.value, c1.value, p.a1.value);
+        mpz_submul(k1.value, c2.value, p.a2.value);
+        mpz_set_ui(k2.value, 0);
+        mpz_submul(k2.value, c1.value, p.b1.value);
+        mpz_submul(k2.value, c2.value, p.b2.value);
+
+        components.push_back(
+            endomorphism_component_from_mpz<GroupT>(k1.value, 0));
+        components.push_back(
+            endomorphism_component_from_mpz<GroupT>(k2.value, 1));
+    }
+
+    // In Jacobian coordinates, x = X / Z^2, so that only X is scaled.
+    static GroupT apply(const GroupT &P)
+    {
+        return GroupT(get_params().beta * P.X, P.Y, P.Z);
+    }
+
+    static bool is_in_subgroup(const GroupT &P)
+    {
+        const params &p = get_params();
+        const GroupT lambda_P = p.lambda_magnitude * P;
+        return apply(P) == (p.lambda_negative ? -lambda_P : lambda_P);
+    }
+
+private:
+    class params
+    {
+    public:
+        params();
+
+        base_field beta;
+        // Shortest representative of +/- lambda.
+        libff::bigint<scalar_field::num_limbs> lambda_magnitude;
+        bool lambda_negative;
+        // Short basis of the decomposition lattice, with det > 0.
+        mpz_value a1;
+        mpz_value b1;
+        mpz_value a2;
+        mpz_value b2;
+        mpz_value det;
+        size_t component_bits;
+    };
+
+    static const params &get_params()
+    {
+        static const params p;
+        return p;
+    }
+};
+
+template<typename GroupT> glv_endomorphism<GroupT>::params::params()
+{
+    // beta = g^((q - 1) / 3) for the first g which is not a cube.
+    mpz_value exponent;
+    base_field::mod.to_mpz(exponent.value);
+    mpz_sub_ui(exponent.value, exponent.value, 1);
+    mpz_divexact_ui(exponent.value, exponent.value, 3);
+    const libff::bigint<base_field::num_limbs> exponent_bigint(exponent.value);
+    beta = base_field::one();
+    for (long g = 2; beta == base_field::one(); ++g) {
+        beta = base_field(g) ^ exponent_bigint;
+    }
+
+    // lambda is one of the roots (-1 +/- sqrt(-3)) / 2 of x^2 + x + 1, and
+    // is determined by the action of phi on the generator.
+    const scalar_field sqrt_minus_3 = (-scalar_field(3)).sqrt();
+    scalar_field lambda =
+        (sqrt_minus_3 - scalar_field::one()) * scalar_field(2).inverse();
+    const GroupT g = GroupT::one();
+    if (GroupT(beta * g.X, g.Y, g.Z) != lambda * g) {
+        lambda = -lambda - scalar_field::one();
+    }
+    const scalar_field minus_lambda = -lambda;
+    lambda_negative =
+        minus_lambda.as_bigint().num_bits() < lambda.as_bigint().num_bits();
+    lambda_magnitude =
+        lambda_negative ? minus_lambda.as_bigint() : lambda.as_bigint();
+
+    // Extended Euclidean algorithm on (r, lambda), keeping the remainders
+    // r_i = s_i * r + t_i * lambda, so that (r_i, -t_i) is in the lattice.
+    // Stop at the first remainder below sqrt(r) (see [GLV01], section 4).
+    mpz_value r;
+    mpz_value sqrt_r;
+    scalar_field::mod.to_mpz(r.value);
+    mpz_sqrt(sqrt_r.value, r.value);
+
+    mpz_value r_prev;
+    mpz_value r_cur;
+    mpz_value r_next;
+    mpz_value t_prev;
+    mpz_value t_cur;
+    mpz_value t_next;
+    mpz_value quotient;
+    mpz_set(r_prev.value, r.value);
+    lambda.as_bigint().to_mpz(r_cur.value);
+    mpz_set_ui(t_prev.value, 0);
+    mpz_set_ui(t_cur.value, 1);
+    while (mpz_cmp(r_cur.value, sqrt_r.value) >= 0) {
+        mpz_fdiv_qr(quotient.value, r_next.value, r_prev.value, r_cur.value);
+        mpz_set(t_next.value, t_prev.value);
+        mpz_submul(t_next.value, quotient.value, t_cur.value);
+        mpz_swap(r_prev.value, r_cur.value);
+        mpz_swap(r_cur.value, r_next.value);
+        mpz_swap(t_prev.value, t_cur.value);
+        mpz_swap(t_cur.value, t_next.value);
+    }
+
+    // (r_prev, t_prev) is the last remainder above sqrt(r), and (r_cur,
+    // t_cur) the first below it. v1 = (r_cur, -t_cur), and v2 is the shorter
+    // of (r_prev, -t_prev) and the next vector.
+    mpz_set(a1.value, r_cur.value);
+    mpz_neg(b1.value, t_cur.value);
+    mpz_fdiv_qr(quotient.value, r_next.value, r_prev.value, r_cur.value);
+    mpz_set(t_next.value, t_prev.value);
+    mpz_submul(t_next.value, quotient.value, t_cur.value);
+
+    mpz_value norm_prev;
+    mpz_value norm_next;
+    mpz_mul(norm_prev.value, r_prev.value, r_prev.value);
+    mpz_addmul(norm_prev.value, t_prev.value, t_prev.value);
+    mpz_mul(norm_next.value, r_next.value, r_next.value);
+    mpz_addmul(norm_next.value, t_next.value, t_next.value);
+    if (mpz_cmp(norm_prev.value, norm_next.value) <= 0) {
+        mpz_set(a2.value, r_prev.value);
+        mpz_neg(b2.value, t_prev.value);
+    } else {
+        mpz_set(a2.value, r_next.value);
+        mpz_neg(b2.value, t_next.value);
+    }
+
+    mpz_mul(det.value, a1.value, b2.value);
+    mpz_submul(det.value, a2.value, b1.value);
+    if (mpz_sgn(det.value) < 0) {
+        mpz_neg(a2.value, a2.value);
+        mpz_neg(b2.value, b2.value);
+        mpz_neg(det.value, det.value);
+    }
+
+    // Babai rounding gives |k_i| <= (|a1| + |a2|) or (|b1| + |b2|).
+    mpz_value bound_a;
+    mpz_value bound_b;
+    mpz_value abs_value;
+    mpz_abs(bound_a.value, a1.value);
+    mpz_abs(abs_value.value, a2.value);
+    mpz_add(bound_a.value, bound_a.value, abs_value.value);
+    mpz_abs(bound_b.value, b1.value);
+    mpz_abs(abs_value.value, b2.value);
+    mpz_add(bound_b.value, bound_b.value, abs_value.value);
+    component_bits = std::max(
+        mpz_sizeinbase(bound_a.value, 2), mpz_sizeinbase(bound_b.value, 2));
+}
+
+// GLS endomorphism psi of G2 (see endomorphism.hpp).
+template<typename GroupT> class gls_endomorphism
+{
+public:
+    using scalar_field = typename GroupT::scalar_field;
+    using base_field = typename GroupT::base_field;
+
+    static size_t component_bits() { return get_params().component_bits; }
+
+    // Digits of k in base mu = q mod r.
+    static void decompose(
+        const scalar_field &k,
+        std::vector<endomorphism_component<GroupT>> &components)
+    {
+        const params &p = get_params();
+        mpz_value remaining;
+        mpz_value digit;
+        k.as_bigint().to_mpz(remaining.value);
+        for (size_t power = 0; mpz_sgn(remaining.value) != 0; ++power) {
+            mpz_fdiv_qr(
+                remaining.value, digit.value, remaining.value, p.mu.value);
+            if (mpz_sgn(digit.value) != 0) {
+                components.push_back(
+                    endomorphism_component_from_mpz<GroupT>(
+                        digit.value, power));
+            }
+        }
+    }
+
+    static GroupT apply(const GroupT &P) { return P.mul_by_q(); }
+
+    static bool is_in_subgroup(const GroupT &P)
+    {
+        return apply(P) == get_params().mu_bigint * P;
+    }
+
+private:
+    class params
+    {
+    public:
+        params()
+        {
+            mpz_value r;
+            base_field::mod.to_mpz(mu.value);
+            scalar_field::mod.to_mpz(r.value);
+            mpz_mod(mu.value, mu.value, r.value);
+            mu_bigint = libff::bigint<scalar_field::num_limbs>(mu.value);
+            component_bits = mpz_sizeinbase(mu.value, 2);
+        }
+
+        mpz_value mu;
+        libff::bigint<scalar_field::num_limbs> mu_bigint;
+        size_t component_bits;
+    };
+
+    static const params &get_params()
+    {
+        static const params p;
+        return p;
+    }
+};
+
+// Selection of the endomorphism for each group.
+template<typename GroupT>
+class group_endomorphism : public no_endomorphism<GroupT>
+{
+};
+
+template<>
+class group_endomorphism<libff::alt_bn128_G1>
+    : public glv_endomorphism<libff::alt_bn128_G1>
+{
+};
+
+template<>
+class group_endomorphism<libff::alt_bn128_G2>
+    : public gls_endomorphism<libff::alt_bn128_G2>
+{
+};
+
+template<>
+class group_endomorphism<libff::bls12_377_G1>
+    : public glv_endomorphism<libff::bls12_377_G1>
+{
+};
+
+template<>
+class group_endomorphism<libff::bls12_377_G2>
+    : public gls_endomorphism<libff::bls12_377_G2>
+{
+};
+
+} // namespace internal
+
+template<typename GroupT>
+endomorphism_scalar<GroupT>::endomorphism_scalar(const scalar_field &k)
+{
+    internal::group_endomorphism<GroupT>::decompose(k, components);
+}
+
+template<typename GroupT>
+const std::vector<endomorphism_component<GroupT>> &endomorphism_scalar<
+    GroupT>::get_components() const
+{
+    return components;
+}
+
+template<typename GroupT>
+GroupT endomorphism_scalar<GroupT>::mul(const GroupT &P) const
+{
+    using endomorphism = internal::group_endomorphism<GroupT>;
+    const size_t window = internal::ENDOMORPHISM_WNAF_WINDOW;
+
+    // Odd multiples P, 3P, ..., (2^window - 1)P, and their images under each
+    // power of the endomorphism used by the components.
+    size_t max_power = 0;
+    for (const endomorphism_component<GroupT> &c : components) {
+        max_power = std::max(max_power, c.power);
+    }
+    std::vector<std::vector<GroupT>> tables(max_power + 1);
+    tables[0].reserve(size_t(1) << (window - 1));
+    tables[0].push_back(P);
+    const GroupT P2 = P.dbl();
+    for (size_t j = 1; j < (size_t(1) << (window - 1)); ++j) {
+        tables[0].push_back(tables[0].back() + P2);
+    }
+    for (size_t power = 1; power <= max_power; ++power) {
+        tables[power].reserve(tables[0].size());
+        for (const GroupT &multiple : tables[power - 1]) {
+            tables[power].push_back(endomorphism::apply(multiple));
+        }
+    }
+
+    std::vector<std::vector<long>> wnafs;
+    size_t length = 0;
+    for (const endomorphism_component<GroupT> &c : components) {
+        wnafs.push_back(libff::find_wnaf(window, c.magnitude));
+        const std::vector<long> &wnaf = wnafs.back();
+        size_t wnaf_length = wnaf.size();
+        while (wnaf_length > 0 && wnaf[wnaf_length - 1] == 0) {
+            --wnaf_length;
+        }
+        length = std::max(length, wnaf_length);
+    }
+
+    GroupT result = GroupT::zero();
+    for (size_t i = length; i-- > 0;) {
+        result = result.dbl();
+        for (size_t c = 0; c < components.size(); ++c) {
+            const long digit = wnafs[c][i];
+            if (digit == 0) {
+                continue;
+            }
+            const GroupT &term =
+                tables[components[c].power][std::abs(digit) / 2];
+            if ((digit > 0) != components[c].negative) {
+                result = result + term;
+            } else {
+                result = result - term;
+            }
+        }
+    }
+
+    return result;
+}
+
+template<typename GroupT>
+GroupT endomorphism_scalar<GroupT>::windowed_exp(
+    const size_t window, const libff::window_table<GroupT> &table) const
+{
+    using endomorphism = internal::group_endomorphism<GroupT>;
+    const size_t component_bits = endomorphism::component_bits();
+
+    GroupT result = GroupT::zero();
+    for (const endomorphism_component<GroupT> &c : components) {
+        GroupT term = libff::windowed_exp(
+            component_bits, window, table, scalar_field(c.magnitude));
+        for (size_t power = 0; power < c.power; ++power) {
+            term = endomorphism::apply(term);
+        }
+        result = c.negative ? result - term : result + term;
+    }
+
+    return result;
+}
+
+template<typename GroupT> size_t endomorphism_component_bits()
+{
+    return internal::group_endomorphism<GroupT>::component_bits();
+}
+
+template<typename GroupT>
+GroupT endomorphism_mul(const typename GroupT::scalar_field &k, const GroupT &P)
+{
+    return endomorphism_scalar<GroupT>(k).mul(P);
+}
+
+template<typename GroupT> bool endomorphism_is_in_subgroup(const GroupT &P)
+{
+    return internal::group_endomorphism<GroupT>::is_in_subgroup(P);
+}
+
+} // namespace libzeth
+
+#endif // __ZETH_CORE_ENDOMORPHISM_TCC__
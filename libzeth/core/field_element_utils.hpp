@@ -58,6 +58,23 @@ template<typename FieldT> std::string field_element_to_json(const FieldT &el);
 template<typename FieldT>
 FieldT field_element_from_json(const std::string &json);
 
+/// Size in bytes of the `bytes` encoding of elements of FieldT.
+template<typename FieldT> size_t field_element_bytes_size();
+
+/// Write the `bytes` encoding of a field element to `dest`, which must have
+/// space for `field_element_bytes_size<FieldT>()` bytes. Each base field
+/// component is written as a fixed-size little-endian integer (not in
+/// Montgomery form), and components of extension fields are written
+/// lowest-order-first. The same platform assumptions as `bigint_to_hex`
+/// apply.
+template<typename FieldT>
+void field_element_to_bytes(const FieldT &el, void *dest);
+
+/// Parse the `bytes` encoding of a field element (as written by
+/// `field_element_to_bytes`) from `src`, without intermediate copies. Throws
+/// `std::invalid_argument` if a component is not a reduced field element.
+template<typename FieldT> FieldT field_element_from_bytes(const void *src);
+
 } // namespace libzeth
 
 #include "libzeth/core/field_element_utils.tcc"
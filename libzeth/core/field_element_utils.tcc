@@ -9,7 +9,10 @@
 #include "libzeth/core/utils.hpp"
 
 #include <boost/assert.hpp>
+#include <cstring>
 #include <iomanip>
+#include <type_traits>
+#include <utility>
 
 /// This file uses types and preprocessor variables defined in the `gmp.h`
 /// header:
@@ -100,6 +103,63 @@ public:
     }
 };
 
+template<typename FieldT> class field_element_bytes
+{
+public:
+    using CoeffT = typename std::remove_reference<decltype(
+        std::declval<FieldT>().coeffs[0])>::type;
+
+    static size_t size()
+    {
+        return FieldT::tower_extension_degree *
+               field_element_bytes_size<CoeffT>();
+    }
+
+    static void write(const FieldT &field_el, uint8_t *dest)
+    {
+        const size_t coeff_size = field_element_bytes_size<CoeffT>();
+        for (size_t i = 0; i < FieldT::tower_extension_degree; ++i) {
+            field_element_to_bytes(field_el.coeffs[i], dest + i * coeff_size);
+        }
+    }
+
+    static void read(FieldT &field_el, const uint8_t *src)
+    {
+        const size_t coeff_size = field_element_bytes_size<CoeffT>();
+        for (size_t i = 0; i < FieldT::tower_extension_degree; ++i) {
+            field_el.coeffs[i] =
+                field_element_from_bytes<CoeffT>(src + i * coeff_size);
+        }
+    }
+};
+
+/// Implementation of field_element_bytes for the base-case of Fp_model
+/// types.
+template<mp_size_t n, const libff::bigint<n> &modulus>
+class field_element_bytes<libff::Fp_model<n, modulus>>
+{
+public:
+    using Field = libff::Fp_model<n, modulus>;
+
+    static size_t size() { return sizeof(libff::bigint<n>::data); }
+
+    static void write(const Field &field_el, uint8_t *dest)
+    {
+        const libff::bigint<n> value = field_el.as_bigint();
+        memcpy(dest, &value.data[0], sizeof(value.data));
+    }
+
+    static void read(Field &field_el, const uint8_t *src)
+    {
+        libff::bigint<n> value;
+        memcpy(&value.data[0], src, sizeof(value.data));
+        if (mpn_cmp(value.data, modulus.data, n) >= 0) {
+            throw std::invalid_argument("field element not reduced");
+        }
+        field_el = Field(value);
+    }
+};
+
 } // namespace internal
 
 template<typename FieldT>
@@ -161,6 +221,24 @@ FieldT field_element_from_json(const std::string &json)
     return result;
 }
 
+template<typename FieldT> size_t field_element_bytes_size()
+{
+    return internal::field_element_bytes<FieldT>::size();
+}
+
+template<typename FieldT>
+void field_element_to_bytes(const FieldT &el, void *dest)
+{
+    internal::field_element_bytes<FieldT>::write(el, (uint8_t *)dest);
+}
+
+template<typename FieldT> FieldT field_element_from_bytes(const void *src)
+{
+    FieldT result;
+    internal::field_element_bytes<FieldT>::read(result, (const uint8_t *)src);
+    return result;
+}
+
 } // namespace libzeth
 
 #endif // __ZETH_FIELD_ELEMENT_UTILS_TCC__
@@ -25,6 +25,19 @@ template<typename GroupT> std::string point_affine_to_json(const GroupT &point);
 template<typename GroupT>
 GroupT point_affine_from_json(const std::string &json);
 
+/// Size in bytes of the `bytes` encoding of elements of GroupT.
+template<typename GroupT> size_t point_affine_bytes_size();
+
+/// Write the `bytes` encoding of a group element to `dest`, which must have
+/// space for `point_affine_bytes_size<GroupT>()` bytes. The encoding is the
+/// concatenation of the affine coordinates X and Y, each in the `bytes`
+/// encoding of field_element_utils.
+template<typename GroupT>
+void point_affine_to_bytes(const GroupT &point, void *dest);
+
+/// Parse the `bytes` encoding of a group element from `src`.
+template<typename GroupT> GroupT point_affine_from_bytes(const void *src);
+
 } // namespace libzeth
 
 #include "libzeth/core/group_element_utils.tcc"
@@ -7,6 +7,9 @@
 
 #include "libzeth/core/field_element_utils.hpp"
 
+#include <type_traits>
+#include <utility>
+
 namespace libzeth
 {
 
@@ -27,6 +30,12 @@ template<typename FieldT> static bool coordinate_equals_one(const FieldT &f)
     return f == FieldT::one();
 }
 
+// Type of the coordinates of GroupT.
+template<typename GroupT>
+using coordinate_type = typename std::remove_const<
+    typename std::remove_reference<decltype(std::declval<GroupT>().X)>::type>::
+    type;
+
 } // namespace internal
 
 template<typename GroupT>
@@ -88,6 +97,42 @@ template<typename GroupT> GroupT point_affine_from_json(const std::string &json)
     return result;
 }
 
+template<typename GroupT> size_t point_affine_bytes_size()
+{
+    return 2 * field_element_bytes_size<internal::coordinate_type<GroupT>>();
+}
+
+template<typename GroupT>
+void point_affine_to_bytes(const GroupT &point, void *dest)
+{
+    using CoordinateT = internal::coordinate_type<GroupT>;
+    GroupT affine_p = point;
+    affine_p.to_affine_coordinates();
+    uint8_t *dest_bytes = (uint8_t *)dest;
+    field_element_to_bytes(affine_p.X, dest_bytes);
+    field_element_to_bytes(
+        affine_p.Y, dest_bytes + field_element_bytes_size<CoordinateT>());
+}
+
+template<typename GroupT> GroupT point_affine_from_bytes(const void *src)
+{
+    using CoordinateT = internal::coordinate_type<GroupT>;
+    const uint8_t *src_bytes = (const uint8_t *)src;
+    GroupT result;
+    result.X = field_element_from_bytes<CoordinateT>(src_bytes);
+    result.Y = field_element_from_bytes<CoordinateT>(
+        src_bytes + field_element_bytes_size<CoordinateT>());
+
+    // As for point_affine_read_json, (0, 1) is the encoding of zero.
+    if (internal::coordinate_equals_zero(result.X) &&
+        internal::coordinate_equals_one(result.Y)) {
+        result.Z = CoordinateT::zero();
+    } else {
+        result.Z = CoordinateT::one();
+    }
+    return result;
+}
+
 } // namespace libzeth
 
 #endif // __ZETH_CORE_GROUP_ELEMENT_UTILS_TCC__
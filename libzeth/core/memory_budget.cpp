@@ -0,0 +1,122 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#include "libzeth/core/memory_budget.hpp"
+
+#include <chrono>
+#include <stdexcept>
+#include <sys/resource.h>
+
+namespace libzeth
+{
+
+// Interval at which waiting operations poll their cancellation token.
+static const std::chrono::milliseconds CANCELLATION_POLL_INTERVAL(100);
+
+memory_budget_exhausted::memory_budget_exhausted(const std::string &what)
+    : std::runtime_error(what)
+{
+}
+
+memory_budget::reservation::reservation(memory_budget *budget, size_t size)
+    : budget(budget), size(size)
+{
+}
+
+memory_budget::reservation::reservation(reservation &&other)
+    : budget(other.budget), size(other.size)
+{
+    other.budget = nullptr;
+}
+
+memory_budget::reservation::~reservation()
+{
+    if (budget != nullptr) {
+        budget->release(size);
+    }
+}
+
+memory_budget::memory_budget(size_t capacity, size_t max_waiting)
+    : capacity(capacity)
+    , max_waiting(max_waiting)
+    , in_use(0)
+    , num_active(0)
+    , num_rejected(0)
+{
+}
+
+memory_budget::reservation memory_budget::acquire(
+    size_t size, const cancellation_token *cancel)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (size > capacity) {
+        ++num_rejected;
+        throw memory_budget_exhausted(
+            "operation requires more memory than the budget");
+    }
+
+    // Operations are admitted in order, so that large operations are not
+    // starved by smaller ones.
+    if (waiting.empty() && in_use + size <= capacity) {
+        in_use += size;
+        ++num_active;
+        return reservation(this, size);
+    }
+    if (waiting.size() >= max_waiting) {
+        ++num_rejected;
+        throw memory_budget_exhausted("too many operations waiting for memory");
+    }
+
+    const std::list<size_t>::iterator position =
+        waiting.insert(waiting.end(), size);
+    while (position != waiting.begin() || in_use + size > capacity) {
+        released.wait_for(lock, CANCELLATION_POLL_INTERVAL);
+        if (cancel != nullptr && cancel->is_cancelled()) {
+            waiting.erase(position);
+            // The next operation may now be at the front, and fit.
+            released.notify_all();
+            throw operation_cancelled("cancelled while waiting for memory");
+        }
+    }
+
+    waiting.erase(position);
+    in_use += size;
+    ++num_active;
+    released.notify_all();
+    return reservation(this, size);
+}
+
+memory_budget_status memory_budget::get_status() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    memory_budget_status status;
+    status.capacity = capacity;
+    status.in_use = in_use;
+    status.num_active = num_active;
+    status.num_waiting = waiting.size();
+    status.num_rejected = num_rejected;
+    return status;
+}
+
+void memory_budget::release(size_t size)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        in_use -= size;
+        --num_active;
+    }
+    released.notify_all();
+}
+
+size_t peak_resident_memory()
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        throw std::runtime_error("getrusage failed");
+    }
+    // ru_maxrss is given in KiB (on Linux).
+    return (size_t)usage.ru_maxrss * 1024;
+}
+
+} // namespace libzeth
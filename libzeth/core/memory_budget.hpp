@@ -0,0 +1,100 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#ifndef __ZETH_CORE_MEMORY_BUDGET_HPP__
+#define __ZETH_CORE_MEMORY_BUDGET_HPP__
+
+#include "libzeth/core/cancellation.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+
+namespace libzeth
+{
+
+/// Thrown by memory_budget::acquire when a request cannot be admitted.
+class memory_budget_exhausted : public std::runtime_error
+{
+public:
+    explicit memory_budget_exhausted(const std::string &what);
+};
+
+/// State of a memory_budget, for monitoring.
+class memory_budget_status
+{
+public:
+    size_t capacity;
+    size_t in_use;
+    size_t num_active;
+    size_t num_waiting;
+    size_t num_rejected;
+};
+
+/// Admission control for operations with a known (estimated) peak memory
+/// usage. Each operation reserves its estimate before starting and releases it
+/// when complete, so that the memory of the operations in progress never
+/// exceeds the capacity of the budget. Operations which do not fit wait, in
+/// the order in which they arrived, up to a maximum number of waiting
+/// operations beyond which they are rejected.
+class memory_budget
+{
+public:
+    /// Memory reserved by an operation, released on destruction.
+    class reservation
+    {
+    public:
+        reservation(reservation &&other);
+        reservation(const reservation &) = delete;
+        ~reservation();
+
+        reservation &operator=(const reservation &) = delete;
+
+    private:
+        friend class memory_budget;
+        reservation(memory_budget *budget, size_t size);
+
+        memory_budget *budget;
+        size_t size;
+    };
+
+    memory_budget(size_t capacity, size_t max_waiting);
+    memory_budget(const memory_budget &) = delete;
+
+    memory_budget &operator=(const memory_budget &) = delete;
+
+    /// Reserve `size` bytes, waiting until they are available. Throws
+    /// memory_budget_exhausted if `size` exceeds the capacity, or if
+    /// `max_waiting` operations are already waiting. While waiting, `cancel`
+    /// (which may be null) is polled, and operation_cancelled is thrown if it
+    /// is cancelled.
+    reservation acquire(size_t size, const cancellation_token *cancel);
+
+    memory_budget_status get_status() const;
+
+private:
+    void release(size_t size);
+
+    const size_t capacity;
+    const size_t max_waiting;
+
+    mutable std::mutex mutex;
+    std::condition_variable released;
+    size_t in_use;
+    size_t num_active;
+    size_t num_rejected;
+    // Sizes requested by the waiting operations, in order of arrival.
+    std::list<size_t> waiting;
+};
+
+/// Peak resident memory (in bytes) of the process since it started, as
+/// reported by getrusage. This is a process-wide figure, which includes all
+/// proofs generated (possibly concurrently) since the server started.
+size_t peak_resident_memory();
+
+} // namespace libzeth
+
+#endif // __ZETH_CORE_MEMORY_BUDGET_HPP__
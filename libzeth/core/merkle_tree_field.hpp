@@ -14,6 +14,12 @@
 namespace libzeth
 {
 
+/// Default values of the nodes of a Merkle tree of depth `depth`, ie the
+/// recursive hashes of the zero valued leaves: element l is the value of an
+/// empty node in layer l (layer 0 being the root).
+template<typename FieldT, typename HashTreeT>
+std::vector<FieldT> merkle_tree_field_hash_defaults(const size_t depth);
+
 /// Merkle Tree whose nodes are field elements
 ///
 /// A Merkle tree is maintained as two maps:
@@ -44,6 +50,13 @@ public:
     FieldT get_value(const size_t address) const;
     void set_value(const size_t address, const FieldT &value);
 
+    /// Set the values of `new_values.size()` consecutive leaves, starting at
+    /// `first_address`. The internal nodes above the updated leaves are
+    /// recomputed once each, layer by layer, and the hashes within a layer are
+    /// computed in parallel (when built with MULTICORE).
+    void set_values(
+        const size_t first_address, const std::vector<FieldT> &new_values);
+
     FieldT get_root() const;
     std::vector<FieldT> get_path(const size_t address) const;
 
@@ -15,17 +15,13 @@ namespace libzeth
 {
 
 template<typename FieldT, typename HashTreeT>
-merkle_tree_field<FieldT, HashTreeT>::merkle_tree_field(const size_t depth)
-    : depth(depth)
+std::vector<FieldT> merkle_tree_field_hash_defaults(const size_t depth)
 {
-    assert(depth < sizeof(size_t) * 8);
-
     // Value of the leaves when initializing the merkle tree
     FieldT last = FieldT::zero();
 
     // Length of a merkle path = depth + 1
-    // `hash_defaults` contains the default value of a merkle path
-    // ie: The recursive hash of the zero valued leaves
+    std::vector<FieldT> hash_defaults;
     hash_defaults.reserve(depth + 1);
     hash_defaults.emplace_back(last);
     for (size_t i = 0; i < depth; ++i) {
@@ -34,6 +30,18 @@ merkle_tree_field<FieldT, HashTreeT>::merkle_tree_field(const size_t depth)
     }
 
     std::reverse(hash_defaults.begin(), hash_defaults.end());
+    return hash_defaults;
+}
+
+template<typename FieldT, typename HashTreeT>
+merkle_tree_field<FieldT, HashTreeT>::merkle_tree_field(const size_t depth)
+    : depth(depth)
+{
+    assert(depth < sizeof(size_t) * 8);
+
+    // `hash_defaults` contains the default value of a merkle path
+    // ie: The recursive hash of the zero valued leaves
+    hash_defaults = merkle_tree_field_hash_defaults<FieldT, HashTreeT>(depth);
 }
 
 template<typename FieldT, typename HashTreeT>
@@ -159,6 +167,66 @@ void merkle_tree_field<FieldT, HashTreeT>::set_value(
     }
 }
 
+template<typename FieldT, typename HashTreeT>
+void merkle_tree_field<FieldT, HashTreeT>::set_values(
+    const size_t first_address, const std::vector<FieldT> &new_values)
+{
+    if (new_values.empty()) {
+        return;
+    }
+
+    assert(first_address + new_values.size() <= (1ul << depth));
+
+    // Write the leaves. The range [idx_begin, idx_end) holds the indices of
+    // the updated nodes in the current layer.
+    size_t idx_begin = first_address + (1ul << depth) - 1;
+    size_t idx_end = idx_begin + new_values.size();
+    for (size_t i = 0; i < new_values.size(); ++i) {
+        values[first_address + i] = new_values[i];
+        hashes[idx_begin + i] = new_values[i];
+    }
+
+    // Recompute each parent of the updated range exactly once per layer. The
+    // hashes of a layer are computed into a temporary buffer (the `hashes` map
+    // is only read inside the parallel loop), and then written back
+    // sequentially.
+    //
+    // Note that the MiMC round constants are lazily initialized on the first
+    // call to `get_hash`, which has already happened (in the constructor,
+    // when computing `hash_defaults`) by the time we reach the parallel loop.
+    std::vector<FieldT> layer_hashes;
+    for (size_t layer = depth; layer > 0; --layer) {
+        const size_t parent_begin = (idx_begin - 1) / 2;
+        const size_t parent_end = (idx_end - 2) / 2 + 1;
+        const size_t num_parents = parent_end - parent_begin;
+        layer_hashes.resize(num_parents);
+
+#ifdef MULTICORE
+#pragma omp parallel for
+#endif
+        for (size_t i = 0; i < num_parents; ++i) {
+            const size_t left_idx = 2 * (parent_begin + i) + 1;
+
+            auto it = hashes.find(left_idx);
+            const FieldT &l =
+                (it == hashes.end() ? hash_defaults[layer] : it->second);
+
+            it = hashes.find(left_idx + 1);
+            const FieldT &r =
+                (it == hashes.end() ? hash_defaults[layer] : it->second);
+
+            layer_hashes[i] = HashTreeT::get_hash(l, r);
+        }
+
+        for (size_t i = 0; i < num_parents; ++i) {
+            hashes[parent_begin + i] = layer_hashes[i];
+        }
+
+        idx_begin = parent_begin;
+        idx_end = parent_end;
+    }
+}
+
 template<typename FieldT, typename HashTreeT>
 FieldT merkle_tree_field<FieldT, HashTreeT>::get_root() const
 {
@@ -0,0 +1,129 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#ifndef __ZETH_CORE_MERKLE_TREE_FIELD_PERSISTENT_HPP__
+#define __ZETH_CORE_MERKLE_TREE_FIELD_PERSISTENT_HPP__
+
+#include "libzeth/core/include_libff.hpp"
+#include "libzeth/serialization/mapped_file.hpp"
+
+#include <string>
+#include <vector>
+
+namespace libzeth
+{
+
+/// Merkle Tree whose nodes are field elements, stored on disk. It offers the
+/// same interface as `merkle_tree_field`, but can be reopened in constant time
+/// and is not limited by the available memory.
+///
+/// The tree is held in a directory containing:
+/// - `level_<l>` (for 0 <= l <= depth): a memory-mapped file holding the nodes
+///   of layer `l` (layer 0 contains the root and layer `depth` the leaves).
+///   Each file covers the nodes up to the right-most leaf written so far.
+/// - `leaves.log`: an append-only log of every (address, value) leaf update.
+/// - `header`: the depth, the number of leaves, the number of log records
+///   applied and the root. It is replaced atomically after each update.
+///
+/// An update is first appended to the log and flushed, then applied to the
+/// level files, which are flushed, and finally committed by writing the
+/// header. On opening, any log record which is not covered by the header (the
+/// process stopped during an update) is replayed, so the tree is always
+/// consistent with its log.
+///
+/// Field elements are stored using their in-memory representation, so the
+/// files are not portable across builds with different field
+/// representations.
+template<typename FieldT, typename HashTreeT>
+class merkle_tree_field_persistent
+{
+public:
+    /// Open the tree stored in `directory`, creating it if it does not exist.
+    /// Throws if an existing tree has a different depth.
+    merkle_tree_field_persistent(
+        const std::string &directory, const size_t depth);
+    merkle_tree_field_persistent(const merkle_tree_field_persistent &) = delete;
+    ~merkle_tree_field_persistent();
+
+    merkle_tree_field_persistent &operator=(
+        const merkle_tree_field_persistent &) = delete;
+
+    FieldT get_value(const size_t address) const;
+    void set_value(const size_t address, const FieldT &value);
+    void set_values(
+        const size_t first_address, const std::vector<FieldT> &new_values);
+
+    FieldT get_root() const;
+    std::vector<FieldT> get_path(const size_t address) const;
+
+    /// Number of leaves up to the right-most leaf written so far.
+    size_t get_num_leaves() const;
+
+    size_t get_depth() const;
+
+private:
+    class header
+    {
+    public:
+        uint64_t magic;
+        uint64_t depth;
+        uint64_t num_leaves;
+        uint64_t num_log_records;
+        FieldT root;
+    };
+
+    class log_record
+    {
+    public:
+        uint64_t address;
+        FieldT value;
+    };
+
+    std::string level_file_path(const size_t layer) const;
+    std::string log_file_path() const;
+    std::string header_file_path() const;
+
+    /// Number of nodes of the given layer covering the first `leaves` leaves.
+    size_t layer_size(const size_t layer, const size_t leaves) const;
+
+    FieldT *layer_nodes(const size_t layer);
+    const FieldT *layer_nodes(const size_t layer) const;
+
+    /// Read node `idx` (within its layer) of the given layer, returning the
+    /// default value if it is beyond the right-most leaf.
+    FieldT get_node(const size_t layer, const size_t idx) const;
+
+    /// Extend the tree to cover `new_num_leaves` leaves, growing the level
+    /// files as required and initializing the new nodes to their default
+    /// value.
+    void grow(const size_t new_num_leaves);
+
+    /// Write the leaves to the level files and recompute the nodes above them.
+    /// The modified level file ranges are flushed to disk.
+    void apply(const size_t first_address, const std::vector<FieldT> &values);
+
+    void log_append(
+        const size_t first_address, const std::vector<FieldT> &values);
+    void replay_log(const size_t num_records);
+    void commit();
+
+    const std::string directory;
+    const size_t depth;
+    std::vector<FieldT> hash_defaults;
+    std::vector<mapped_file> levels;
+    int log_fd;
+
+    // State of the tree, including any uncommitted update.
+    size_t num_leaves;
+    size_t num_log_records;
+
+    // State of the tree as recorded in the header file.
+    header committed;
+};
+
+} // namespace libzeth
+
+#include "libzeth/core/merkle_tree_field_persistent.tcc"
+
+#endif // __ZETH_CORE_MERKLE_TREE_FIELD_PERSISTENT_HPP__
@@ -0,0 +1,378 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#ifndef __ZETH_CORE_MERKLE_TREE_FIELD_PERSISTENT_TCC__
+#define __ZETH_CORE_MERKLE_TREE_FIELD_PERSISTENT_TCC__
+
+#include "libzeth/core/merkle_tree_field.hpp"
+#include "libzeth/core/merkle_tree_field_persistent.hpp"
+
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <cassert>
+#include <cerrno>
+#include <fcntl.h>
+#include <fstream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace libzeth
+{
+
+/// Identifies header files of persistent Merkle trees ("zethmkt1").
+static const uint64_t MERKLE_TREE_FIELD_PERSISTENT_MAGIC =
+    0x31746b6d6874657aull;
+
+template<typename FieldT, typename HashTreeT>
+merkle_tree_field_persistent<FieldT, HashTreeT>::merkle_tree_field_persistent(
+    const std::string &directory, const size_t depth)
+    : directory(directory)
+    , depth(depth)
+    , log_fd(-1)
+    , num_leaves(0)
+    , num_log_records(0)
+{
+    assert(depth < sizeof(size_t) * 8);
+
+    hash_defaults = merkle_tree_field_hash_defaults<FieldT, HashTreeT>(depth);
+
+    boost::filesystem::create_directories(directory);
+
+    // Read the committed state, or initialize the state of an empty tree.
+    const bool is_new_tree = !boost::filesystem::exists(header_file_path());
+    if (is_new_tree) {
+        committed.magic = MERKLE_TREE_FIELD_PERSISTENT_MAGIC;
+        committed.depth = depth;
+        committed.num_leaves = 0;
+        committed.num_log_records = 0;
+        committed.root = hash_defaults[0];
+    } else {
+        std::ifstream in_s(
+            header_file_path(), std::ios_base::in | std::ios_base::binary);
+        in_s.exceptions(
+            std::ios_base::eofbit | std::ios_base::badbit |
+            std::ios_base::failbit);
+        in_s.read((char *)&committed, sizeof(committed));
+        if (committed.magic != MERKLE_TREE_FIELD_PERSISTENT_MAGIC) {
+            throw std::invalid_argument("invalid merkle tree header");
+        }
+        if (committed.depth != depth) {
+            throw std::invalid_argument("merkle tree depth mismatch");
+        }
+    }
+
+    num_leaves = committed.num_leaves;
+    num_log_records = committed.num_log_records;
+
+    levels.reserve(depth + 1);
+    for (size_t layer = 0; layer <= depth; ++layer) {
+        levels.emplace_back(level_file_path(layer));
+    }
+
+    // Open the log and discard any partially written record at the end.
+    log_fd = ::open(log_file_path().c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (log_fd < 0) {
+        throw std::runtime_error("failed to open merkle tree log");
+    }
+    struct stat log_stat;
+    if (fstat(log_fd, &log_stat) != 0) {
+        throw std::runtime_error("failed to stat merkle tree log");
+    }
+    const size_t num_records = (size_t)log_stat.st_size / sizeof(log_record);
+    if (num_records * sizeof(log_record) != (size_t)log_stat.st_size) {
+        if (ftruncate(log_fd, (off_t)(num_records * sizeof(log_record))) !=
+            0) {
+            throw std::runtime_error("failed to truncate merkle tree log");
+        }
+        file_descriptor_sync(log_fd);
+    }
+
+    if (num_records < num_log_records) {
+        throw std::runtime_error("merkle tree log is missing records");
+    }
+
+    if (num_records > num_log_records) {
+        // An update was interrupted before being committed.
+        replay_log(num_records);
+    } else if (is_new_tree) {
+        commit();
+    }
+}
+
+template<typename FieldT, typename HashTreeT>
+merkle_tree_field_persistent<FieldT, HashTreeT>::~merkle_tree_field_persistent()
+{
+    if (log_fd >= 0) {
+        ::close(log_fd);
+    }
+}
+
+template<typename FieldT, typename HashTreeT>
+FieldT merkle_tree_field_persistent<FieldT, HashTreeT>::get_value(
+    const size_t address) const
+{
+    assert(libff::log2(address) <= depth);
+    return get_node(depth, address);
+}
+
+template<typename FieldT, typename HashTreeT>
+void merkle_tree_field_persistent<FieldT, HashTreeT>::set_value(
+    const size_t address, const FieldT &value)
+{
+    set_values(address, std::vector<FieldT>(1, value));
+}
+
+template<typename FieldT, typename HashTreeT>
+void merkle_tree_field_persistent<FieldT, HashTreeT>::set_values(
+    const size_t first_address, const std::vector<FieldT> &new_values)
+{
+    if (new_values.empty()) {
+        return;
+    }
+
+    assert(first_address + new_values.size() <= (1ul << depth));
+
+    log_append(first_address, new_values);
+    apply(first_address, new_values);
+    num_log_records += new_values.size();
+    commit();
+}
+
+template<typename FieldT, typename HashTreeT>
+FieldT merkle_tree_field_persistent<FieldT, HashTreeT>::get_root() const
+{
+    return committed.root;
+}
+
+template<typename FieldT, typename HashTreeT>
+std::vector<FieldT> merkle_tree_field_persistent<FieldT, HashTreeT>::get_path(
+    const size_t address) const
+{
+    assert(libff::log2(address) <= depth);
+
+    // As for `merkle_tree_field`, the path is ordered from the leaf layer to
+    // the layer below the root.
+    std::vector<FieldT> result;
+    result.reserve(depth);
+    size_t idx = address;
+    for (size_t layer = depth; layer > 0; --layer) {
+        result.push_back(get_node(layer, idx ^ 1));
+        idx = idx / 2;
+    }
+
+    return result;
+}
+
+template<typename FieldT, typename HashTreeT>
+size_t merkle_tree_field_persistent<FieldT, HashTreeT>::get_num_leaves() const
+{
+    return num_leaves;
+}
+
+template<typename FieldT, typename HashTreeT>
+size_t merkle_tree_field_persistent<FieldT, HashTreeT>::get_depth() const
+{
+    return depth;
+}
+
+template<typename FieldT, typename HashTreeT>
+std::string merkle_tree_field_persistent<FieldT, HashTreeT>::level_file_path(
+    const size_t layer) const
+{
+    return (boost::filesystem::path(directory) /
+            ("level_" + std::to_string(layer)))
+        .string();
+}
+
+template<typename FieldT, typename HashTreeT>
+std::string merkle_tree_field_persistent<FieldT, HashTreeT>::log_file_path()
+    const
+{
+    return (boost::filesystem::path(directory) / "leaves.log").string();
+}
+
+template<typename FieldT, typename HashTreeT>
+std::string merkle_tree_field_persistent<FieldT, HashTreeT>::header_file_path()
+    const
+{
+    return (boost::filesystem::path(directory) / "header").string();
+}
+
+template<typename FieldT, typename HashTreeT>
+size_t merkle_tree_field_persistent<FieldT, HashTreeT>::layer_size(
+    const size_t layer, const size_t leaves) const
+{
+    const size_t shift = depth - layer;
+    return (leaves + (1ul << shift) - 1) >> shift;
+}
+
+template<typename FieldT, typename HashTreeT>
+FieldT *merkle_tree_field_persistent<FieldT, HashTreeT>::layer_nodes(
+    const size_t layer)
+{
+    return (FieldT *)levels[layer].data();
+}
+
+template<typename FieldT, typename HashTreeT>
+const FieldT *merkle_tree_field_persistent<FieldT, HashTreeT>::layer_nodes(
+    const size_t layer) const
+{
+    return (const FieldT *)levels[layer].data();
+}
+
+template<typename FieldT, typename HashTreeT>
+FieldT merkle_tree_field_persistent<FieldT, HashTreeT>::get_node(
+    const size_t layer, const size_t idx) const
+{
+    // The contents of the level files beyond the right-most leaf are not
+    // meaningful (they may not have been initialized, or flushed).
+    if (idx >= layer_size(layer, num_leaves)) {
+        return hash_defaults[layer];
+    }
+    return layer_nodes(layer)[idx];
+}
+
+template<typename FieldT, typename HashTreeT>
+void merkle_tree_field_persistent<FieldT, HashTreeT>::grow(
+    const size_t new_num_leaves)
+{
+    if (new_num_leaves <= num_leaves) {
+        return;
+    }
+
+    for (size_t layer = 0; layer <= depth; ++layer) {
+        const size_t old_size = layer_size(layer, num_leaves);
+        const size_t new_size = layer_size(layer, new_num_leaves);
+        if (new_size == old_size) {
+            continue;
+        }
+
+        // Grow the files geometrically to avoid remapping on every append.
+        mapped_file &level = levels[layer];
+        if (new_size * sizeof(FieldT) > level.size()) {
+            const size_t capacity = std::max(
+                new_size, std::min(2 * old_size, (size_t)1 << layer));
+            level.resize(capacity * sizeof(FieldT));
+        }
+
+        FieldT *nodes = layer_nodes(layer);
+        std::fill(nodes + old_size, nodes + new_size, hash_defaults[layer]);
+        level.sync(
+            old_size * sizeof(FieldT), (new_size - old_size) * sizeof(FieldT));
+    }
+
+    num_leaves = new_num_leaves;
+}
+
+template<typename FieldT, typename HashTreeT>
+void merkle_tree_field_persistent<FieldT, HashTreeT>::apply(
+    const size_t first_address, const std::vector<FieldT> &values)
+{
+    size_t idx_begin = first_address;
+    size_t idx_end = first_address + values.size();
+    grow(idx_end);
+
+    std::copy(values.begin(), values.end(), layer_nodes(depth) + idx_begin);
+    levels[depth].sync(
+        idx_begin * sizeof(FieldT), values.size() * sizeof(FieldT));
+
+    // As in `merkle_tree_field::set_values`, recompute each parent of the
+    // updated range once per layer. Each iteration writes a distinct node of
+    // the mapped parent layer, so the loop can run in parallel.
+    for (size_t layer = depth; layer > 0; --layer) {
+        const size_t parent_begin = idx_begin / 2;
+        const size_t parent_end = (idx_end - 1) / 2 + 1;
+        FieldT *parents = layer_nodes(layer - 1);
+
+#ifdef MULTICORE
+#pragma omp parallel for
+#endif
+        for (size_t parent = parent_begin; parent < parent_end; ++parent) {
+            parents[parent] = HashTreeT::get_hash(
+                get_node(layer, 2 * parent), get_node(layer, 2 * parent + 1));
+        }
+
+        levels[layer - 1].sync(
+            parent_begin * sizeof(FieldT),
+            (parent_end - parent_begin) * sizeof(FieldT));
+
+        idx_begin = parent_begin;
+        idx_end = parent_end;
+    }
+}
+
+template<typename FieldT, typename HashTreeT>
+void merkle_tree_field_persistent<FieldT, HashTreeT>::log_append(
+    const size_t first_address, const std::vector<FieldT> &values)
+{
+    std::vector<log_record> records(values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+        records[i].address = first_address + i;
+        records[i].value = values[i];
+    }
+
+    const uint8_t *data = (const uint8_t *)records.data();
+    size_t remaining = records.size() * sizeof(log_record);
+    while (remaining > 0) {
+        const ssize_t written = ::write(log_fd, data, remaining);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("failed to write merkle tree log");
+        }
+        data += written;
+        remaining -= (size_t)written;
+    }
+
+    file_descriptor_sync(log_fd);
+}
+
+template<typename FieldT, typename HashTreeT>
+void merkle_tree_field_persistent<FieldT, HashTreeT>::replay_log(
+    const size_t num_records)
+{
+    // Reapply the uncommitted records, grouping runs of consecutive addresses.
+    std::vector<FieldT> run;
+    size_t run_address = 0;
+    log_record record;
+    for (size_t i = num_log_records; i < num_records; ++i) {
+        const off_t offset = (off_t)(i * sizeof(log_record));
+        if (pread(log_fd, &record, sizeof(record), offset) !=
+            (ssize_t)sizeof(record)) {
+            throw std::runtime_error("failed to read merkle tree log");
+        }
+
+        if (!run.empty() && record.address != run_address + run.size()) {
+            apply(run_address, run);
+            run.clear();
+        }
+        if (run.empty()) {
+            run_address = record.address;
+        }
+        run.push_back(record.value);
+    }
+    if (!run.empty()) {
+        apply(run_address, run);
+    }
+
+    num_log_records = num_records;
+    commit();
+}
+
+template<typename FieldT, typename HashTreeT>
+void merkle_tree_field_persistent<FieldT, HashTreeT>::commit()
+{
+    header new_header = committed;
+    new_header.num_leaves = num_leaves;
+    new_header.num_log_records = num_log_records;
+    new_header.root = get_node(0, 0);
+    file_write_atomic(header_file_path(), &new_header, sizeof(new_header));
+    committed = new_header;
+}
+
+} // namespace libzeth
+
+#endif // __ZETH_CORE_MERKLE_TREE_FIELD_PERSISTENT_TCC__
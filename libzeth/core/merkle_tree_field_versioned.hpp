@@ -0,0 +1,103 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#ifndef __ZETH_CORE_MERKLE_TREE_FIELD_VERSIONED_HPP__
+#define __ZETH_CORE_MERKLE_TREE_FIELD_VERSIONED_HPP__
+
+#include "libzeth/core/include_libff.hpp"
+
+#include <deque>
+#include <map>
+#include <vector>
+
+namespace libzeth
+{
+
+/// Merkle Tree whose nodes are field elements, which can serve values, roots
+/// and authentication paths for any of its `max_versions` most recent states.
+///
+/// The tree starts at version 0 (empty tree), and each call to `set_value` or
+/// `set_values` creates a new version. Every node holds a log of its values,
+/// tagged with the version in which they were written, so that a node can be
+/// read at any retained version by a binary search in its log. Reading a
+/// path or root at a given version is therefore O(depth) lookups.
+///
+/// When a version is no longer retained, the log entries which are only
+/// visible in older versions are dropped, so that memory use is bounded by
+/// the number of nodes in the tree plus the nodes modified by the retained
+/// versions.
+template<typename FieldT, typename HashTreeT> class merkle_tree_field_versioned
+{
+public:
+    merkle_tree_field_versioned(const size_t depth, const size_t max_versions);
+
+    FieldT get_value(const size_t address) const;
+    FieldT get_value(const size_t address, const size_t version) const;
+    void set_value(const size_t address, const FieldT &value);
+
+    /// Set the values of `new_values.size()` consecutive leaves, starting at
+    /// `first_address`, as a single new version. (See
+    /// `merkle_tree_field::set_values`.)
+    void set_values(
+        const size_t first_address, const std::vector<FieldT> &new_values);
+
+    FieldT get_root() const;
+    FieldT get_root(const size_t version) const;
+
+    std::vector<FieldT> get_path(const size_t address) const;
+    std::vector<FieldT> get_path(
+        const size_t address, const size_t version) const;
+
+    /// The current (most recent) version.
+    size_t get_version() const;
+
+    /// The oldest version which can still be queried.
+    size_t get_oldest_version() const;
+
+    /// Find the most recent retained version with the given root. Throws
+    /// `std::invalid_argument` if no retained version has this root.
+    size_t get_version_of_root(const FieldT &root) const;
+
+private:
+    class node_version
+    {
+    public:
+        size_t version;
+        FieldT value;
+    };
+
+    /// Throw if `version` is not retained.
+    void check_version(const size_t version) const;
+
+    /// Value of node `idx` (in layer `layer`) at the given version.
+    FieldT get_node(
+        const size_t idx, const size_t layer, const size_t version) const;
+
+    void set_node(const size_t idx, const size_t version, const FieldT &value);
+
+    /// Drop the oldest version, and any node log entries which are no longer
+    /// visible.
+    void drop_oldest_version();
+
+    const size_t depth;
+    const size_t max_versions;
+    std::vector<FieldT> hash_defaults;
+
+    /// Log of values for each node which has been written, ordered by version.
+    std::map<size_t, std::vector<node_version>> nodes;
+
+    /// Root of each retained version, oldest first.
+    std::deque<FieldT> roots;
+
+    /// Indices of the nodes written by each retained version, oldest first.
+    std::deque<std::vector<size_t>> changes;
+
+    size_t first_version;
+};
+
+} // namespace libzeth
+
+#include "libzeth/core/merkle_tree_field_versioned.tcc"
+
+#endif // __ZETH_CORE_MERKLE_TREE_FIELD_VERSIONED_HPP__
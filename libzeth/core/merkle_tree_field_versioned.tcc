@@ -0,0 +1,248 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#ifndef __ZETH_CORE_MERKLE_TREE_FIELD_VERSIONED_TCC__
+#define __ZETH_CORE_MERKLE_TREE_FIELD_VERSIONED_TCC__
+
+#include "libzeth/core/merkle_tree_field.hpp"
+#include "libzeth/core/merkle_tree_field_versioned.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace libzeth
+{
+
+template<typename FieldT, typename HashTreeT>
+merkle_tree_field_versioned<FieldT, HashTreeT>::merkle_tree_field_versioned(
+    const size_t depth, const size_t max_versions)
+    : depth(depth), max_versions(max_versions), first_version(0)
+{
+    assert(depth < sizeof(size_t) * 8);
+    if (max_versions == 0) {
+        throw std::invalid_argument("max_versions must be at least 1");
+    }
+
+    hash_defaults = merkle_tree_field_hash_defaults<FieldT, HashTreeT>(depth);
+
+    // Version 0 is the empty tree.
+    roots.push_back(hash_defaults[0]);
+    changes.emplace_back();
+}
+
+template<typename FieldT, typename HashTreeT>
+FieldT merkle_tree_field_versioned<FieldT, HashTreeT>::get_value(
+    const size_t address) const
+{
+    return get_value(address, get_version());
+}
+
+template<typename FieldT, typename HashTreeT>
+FieldT merkle_tree_field_versioned<FieldT, HashTreeT>::get_value(
+    const size_t address, const size_t version) const
+{
+    assert(libff::log2(address) <= depth);
+    check_version(version);
+    return get_node(address + (1ul << depth) - 1, depth, version);
+}
+
+template<typename FieldT, typename HashTreeT>
+void merkle_tree_field_versioned<FieldT, HashTreeT>::set_value(
+    const size_t address, const FieldT &value)
+{
+    set_values(address, std::vector<FieldT>(1, value));
+}
+
+template<typename FieldT, typename HashTreeT>
+void merkle_tree_field_versioned<FieldT, HashTreeT>::set_values(
+    const size_t first_address, const std::vector<FieldT> &new_values)
+{
+    if (new_values.empty()) {
+        return;
+    }
+
+    assert(first_address + new_values.size() <= (1ul << depth));
+
+    const size_t version = get_version() + 1;
+    std::vector<size_t> written;
+
+    // Write the leaves, then recompute each parent of the updated range once
+    // per layer (see `merkle_tree_field::set_values`).
+    size_t idx_begin = first_address + (1ul << depth) - 1;
+    size_t idx_end = idx_begin + new_values.size();
+    for (size_t i = 0; i < new_values.size(); ++i) {
+        set_node(idx_begin + i, version, new_values[i]);
+        written.push_back(idx_begin + i);
+    }
+
+    std::vector<FieldT> layer_hashes;
+    for (size_t layer = depth; layer > 0; --layer) {
+        const size_t parent_begin = (idx_begin - 1) / 2;
+        const size_t parent_end = (idx_end - 2) / 2 + 1;
+        const size_t num_parents = parent_end - parent_begin;
+        layer_hashes.resize(num_parents);
+
+#ifdef MULTICORE
+#pragma omp parallel for
+#endif
+        for (size_t i = 0; i < num_parents; ++i) {
+            const size_t left_idx = 2 * (parent_begin + i) + 1;
+            layer_hashes[i] = HashTreeT::get_hash(
+                get_node(left_idx, layer, version),
+                get_node(left_idx + 1, layer, version));
+        }
+
+        for (size_t i = 0; i < num_parents; ++i) {
+            set_node(parent_begin + i, version, layer_hashes[i]);
+            written.push_back(parent_begin + i);
+        }
+
+        idx_begin = parent_begin;
+        idx_end = parent_end;
+    }
+
+    roots.push_back(get_node(0, 0, version));
+    changes.push_back(std::move(written));
+    while (roots.size() > max_versions) {
+        drop_oldest_version();
+    }
+}
+
+template<typename FieldT, typename HashTreeT>
+FieldT merkle_tree_field_versioned<FieldT, HashTreeT>::get_root() const
+{
+    return roots.back();
+}
+
+template<typename FieldT, typename HashTreeT>
+FieldT merkle_tree_field_versioned<FieldT, HashTreeT>::get_root(
+    const size_t version) const
+{
+    check_version(version);
+    return roots[version - first_version];
+}
+
+template<typename FieldT, typename HashTreeT>
+std::vector<FieldT> merkle_tree_field_versioned<FieldT, HashTreeT>::get_path(
+    const size_t address) const
+{
+    return get_path(address, get_version());
+}
+
+template<typename FieldT, typename HashTreeT>
+std::vector<FieldT> merkle_tree_field_versioned<FieldT, HashTreeT>::get_path(
+    const size_t address, const size_t version) const
+{
+    assert(libff::log2(address) <= depth);
+    check_version(version);
+
+    // As for `merkle_tree_field`, the path is ordered from the leaf layer to
+    // the layer below the root.
+    std::vector<FieldT> result;
+    result.reserve(depth);
+    size_t idx = address + (1ul << depth) - 1;
+    for (size_t layer = depth; layer > 0; --layer) {
+        const size_t sibling_idx = ((idx + 1) ^ 1) - 1;
+        result.push_back(get_node(sibling_idx, layer, version));
+        idx = (idx - 1) / 2;
+    }
+
+    return result;
+}
+
+template<typename FieldT, typename HashTreeT>
+size_t merkle_tree_field_versioned<FieldT, HashTreeT>::get_version() const
+{
+    return first_version + roots.size() - 1;
+}
+
+template<typename FieldT, typename HashTreeT>
+size_t merkle_tree_field_versioned<FieldT, HashTreeT>::get_oldest_version()
+    const
+{
+    return first_version;
+}
+
+template<typename FieldT, typename HashTreeT>
+size_t merkle_tree_field_versioned<FieldT, HashTreeT>::get_version_of_root(
+    const FieldT &root) const
+{
+    for (size_t i = roots.size(); i > 0; --i) {
+        if (roots[i - 1] == root) {
+            return first_version + i - 1;
+        }
+    }
+    throw std::invalid_argument("root is not in the retained versions");
+}
+
+template<typename FieldT, typename HashTreeT>
+void merkle_tree_field_versioned<FieldT, HashTreeT>::check_version(
+    const size_t version) const
+{
+    if (version < first_version || version > get_version()) {
+        throw std::invalid_argument("merkle tree version not retained");
+    }
+}
+
+template<typename FieldT, typename HashTreeT>
+FieldT merkle_tree_field_versioned<FieldT, HashTreeT>::get_node(
+    const size_t idx, const size_t layer, const size_t version) const
+{
+    auto it = nodes.find(idx);
+    if (it == nodes.end()) {
+        return hash_defaults[layer];
+    }
+
+    // Find the last entry written at or before `version`.
+    const std::vector<node_version> &log = it->second;
+    auto entry_it = std::upper_bound(
+        log.begin(),
+        log.end(),
+        version,
+        [](const size_t v, const node_version &entry) {
+            return v < entry.version;
+        });
+    if (entry_it == log.begin()) {
+        return hash_defaults[layer];
+    }
+    return (--entry_it)->value;
+}
+
+template<typename FieldT, typename HashTreeT>
+void merkle_tree_field_versioned<FieldT, HashTreeT>::set_node(
+    const size_t idx, const size_t version, const FieldT &value)
+{
+    std::vector<node_version> &log = nodes[idx];
+    if (!log.empty() && log.back().version == version) {
+        log.back().value = value;
+    } else {
+        log.push_back(node_version{version, value});
+    }
+}
+
+template<typename FieldT, typename HashTreeT>
+void merkle_tree_field_versioned<FieldT, HashTreeT>::drop_oldest_version()
+{
+    roots.pop_front();
+    changes.pop_front();
+    ++first_version;
+
+    // Each node log holds at most one entry older than `first_version` (the
+    // value visible at `first_version`), unless the node was written by
+    // `first_version` itself, in which case older entries are no longer
+    // visible.
+    for (const size_t idx : changes.front()) {
+        std::vector<node_version> &log = nodes[idx];
+        auto it = log.begin();
+        while (it != log.end() && it->version < first_version) {
+            ++it;
+        }
+        log.erase(log.begin(), it);
+    }
+}
+
+} // namespace libzeth
+
+#endif // __ZETH_CORE_MERKLE_TREE_FIELD_VERSIONED_TCC__
@@ -7,9 +7,16 @@
 
 #include "libzeth/core/include_libff.hpp"
 
+#include <libsnark/knowledge_commitment/knowledge_commitment.hpp>
+
 namespace libzeth
 {
 
+/// Multi-exponentiation sum_i(fs[i] * gs[i]), using the libff BDLO12
+/// implementation. Bases are not required to be in affine form (callers such
+/// as evaluator_from_lagrange pass bases in Jacobian form), so no mixed
+/// additions are used. Multi-exponentiations over proving key queries (which
+/// are in affine form) should use multi_exp_affine or multi_exp_classified.
 template<typename FieldT, typename GroupT>
 GroupT multi_exp(
     typename std::vector<GroupT>::const_iterator gs_start,
@@ -21,6 +28,93 @@ template<typename ppT, typename GroupT>
 GroupT multi_exp(
     const std::vector<GroupT> &gs, const libff::Fr_vector<ppT> &fs);
 
+/// Minimum number of terms for which multi_exp_affine uses
+/// multi_exp_batch_affine.
+const size_t MULTI_EXP_BATCH_AFFINE_MIN_SIZE = 1 << 14;
+
+/// Pippenger multi-exponentiation in which the buckets are held in affine
+/// coordinates. Additions to distinct buckets are grouped into batches which
+/// share a single field inversion (Montgomery's trick), so that each addition
+/// costs around 6 field multiplications, instead of 11 for the mixed addition
+/// of an affine point to a Jacobian bucket. Bases are expected to be in affine
+/// form (see libff::batch_to_special, as in the proving keys) on a short
+/// Weierstrass curve with a = 0 (as are the G1 and G2 groups of all supported
+/// curves). Bases which are not in affine form are detected (by is_special)
+/// and accumulated in Jacobian coordinates, giving a correct but slower
+/// result. The terms are split into `chunks` ranges which are processed in
+/// parallel.
+template<typename GroupT, typename FieldT>
+GroupT multi_exp_batch_affine(
+    typename std::vector<GroupT>::const_iterator gs_start,
+    typename std::vector<GroupT>::const_iterator gs_end,
+    typename std::vector<FieldT>::const_iterator fs_start,
+    typename std::vector<FieldT>::const_iterator fs_end,
+    const size_t chunks);
+
+/// Multi-exponentiation with bases (expected to be) in affine form, using
+/// multi_exp_batch_affine for at least MULTI_EXP_BATCH_AFFINE_MIN_SIZE terms,
+/// and the libff BDLO12 implementation for fewer terms (whose batches would be
+/// too small to amortize the inversions).
+template<typename GroupT, typename FieldT>
+GroupT multi_exp_affine(
+    typename std::vector<GroupT>::const_iterator gs_start,
+    typename std::vector<GroupT>::const_iterator gs_end,
+    typename std::vector<FieldT>::const_iterator fs_start,
+    typename std::vector<FieldT>::const_iterator fs_end,
+    const size_t chunks);
+
+/// Scalars of at most this number of bits are treated as small by
+/// multi_exp_classified.
+const size_t MULTI_EXP_SMALL_SCALAR_BITS = 64;
+
+/// Number of scalars in each of the classes used by multi_exp_classified.
+class multi_exp_scalar_classes
+{
+public:
+    size_t num_zero;
+    size_t num_one;
+    size_t num_small;
+    size_t num_full;
+};
+
+/// Classify the scalars in [fs_start, fs_end) (see multi_exp_classified).
+template<typename FieldT>
+multi_exp_scalar_classes multi_exp_classify_scalars(
+    typename std::vector<FieldT>::const_iterator fs_start,
+    typename std::vector<FieldT>::const_iterator fs_end);
+
+/// Multi-exponentiation sum_i(fs[i] * gs[i]) for scalars which are mostly
+/// small, such as circuit witnesses (in which most variables are bits).
+/// Scalars are classified as:
+/// - zero: the term is skipped,
+/// - one: the base is added with a mixed addition if it is in affine form (as
+///   in the proving keys), and with a full addition otherwise,
+/// - small (at most MULTI_EXP_SMALL_SCALAR_BITS bits): the terms are passed
+///   to a separate Pippenger multi-exponentiation (see multi_exp_affine),
+///   whose number of rounds is determined by the bit length of these scalars,
+/// - full: the terms are passed to a Pippenger multi-exponentiation.
+/// The terms are split into `chunks` ranges which are processed in parallel.
+template<typename GroupT, typename FieldT>
+GroupT multi_exp_classified(
+    typename std::vector<GroupT>::const_iterator gs_start,
+    typename std::vector<GroupT>::const_iterator gs_end,
+    typename std::vector<FieldT>::const_iterator fs_start,
+    typename std::vector<FieldT>::const_iterator fs_end,
+    const size_t chunks);
+
+/// Equivalent of libsnark::kc_multi_exp_with_mixed_addition, evaluating the
+/// terms of the sparse vector `vec` with indices in [min_idx, max_idx) using
+/// multi_exp_classified (the scalar of the term with index i being
+/// `*(fs_start + i - min_idx)`).
+template<typename T1, typename T2, typename FieldT>
+libsnark::knowledge_commitment<T1, T2> kc_multi_exp_classified(
+    const libsnark::knowledge_commitment_vector<T1, T2> &vec,
+    const size_t min_idx,
+    const size_t max_idx,
+    typename std::vector<FieldT>::const_iterator fs_start,
+    typename std::vector<FieldT>::const_iterator fs_end,
+    const size_t chunks);
+
 } // namespace libzeth
 
 #include "libzeth/core/multi_exp.tcc"
@@ -7,6 +7,12 @@
 
 #include "libzeth/core/multi_exp.hpp"
 
+#include <algorithm>
+#include <utility>
+#ifdef MULTICORE
+#include <omp.h>
+#endif
+
 namespace libzeth
 {
 
@@ -18,7 +24,7 @@ GroupT multi_exp(
     typename std::vector<FieldT>::const_iterator fs_end)
 {
     const libff::multi_exp_method Method = libff::multi_exp_method_BDLO12;
-    return libff::multi_exp_with_mixed_addition<GroupT, FieldT, Method>(
+    return libff::multi_exp<GroupT, FieldT, Method>(
         gs_start, gs_end, fs_start, fs_end, 1);
 }
 
@@ -30,10 +36,512 @@ GroupT multi_exp(const std::vector<GroupT> &gs, const libff::Fr_vector<ppT> &fs)
 
     using Fr = libff::Fr<ppT>;
     const libff::multi_exp_method Method = libff::multi_exp_method_BDLO12;
-    return libff::multi_exp_with_mixed_addition<GroupT, Fr, Method>(
+    return libff::multi_exp<GroupT, Fr, Method>(
         gs.begin(), gs.begin() + fs.size(), fs.begin(), fs.end(), 1);
 }
 
+namespace internal
+{
+
+enum multi_exp_scalar_class {
+    multi_exp_scalar_zero,
+    multi_exp_scalar_one,
+    multi_exp_scalar_small,
+    multi_exp_scalar_full,
+};
+
+template<typename FieldT>
+multi_exp_scalar_class multi_exp_classify_scalar(const FieldT &scalar)
+{
+    if (scalar.is_zero()) {
+        return multi_exp_scalar_zero;
+    }
+    if (scalar == FieldT::one()) {
+        return multi_exp_scalar_one;
+    }
+    if (scalar.as_bigint().num_bits() <= MULTI_EXP_SMALL_SCALAR_BITS) {
+        return multi_exp_scalar_small;
+    }
+    return multi_exp_scalar_full;
+}
+
+// Terms of (part of) a multi-exponentiation, grouped by class of scalar.
+template<typename GroupT, typename FieldT> class multi_exp_terms
+{
+public:
+    multi_exp_terms() : ones_sum(GroupT::zero()) {}
+
+    void add(const GroupT &base, const FieldT &scalar)
+    {
+        switch (multi_exp_classify_scalar(scalar)) {
+        case multi_exp_scalar_zero:
+            break;
+        case multi_exp_scalar_one:
+#ifdef USE_MIXED_ADDITION
+            ones_sum = base.is_special() ? ones_sum.mixed_add(base)
+                                         : ones_sum + base;
+#else
+            ones_sum = ones_sum + base;
+#endif
+            break;
+        case multi_exp_scalar_small:
+            small_bases.push_back(base);
+            small_scalars.push_back(scalar);
+            break;
+        case multi_exp_scalar_full:
+            full_bases.push_back(base);
+            full_scalars.push_back(scalar);
+            break;
+        }
+    }
+
+    GroupT evaluate() const
+    {
+        GroupT result = ones_sum;
+        if (!small_bases.empty()) {
+            result = result + multi_exp_affine<GroupT, FieldT>(
+                                  small_bases.begin(),
+                                  small_bases.end(),
+                                  small_scalars.begin(),
+                                  small_scalars.end(),
+                                  1);
+        }
+        if (!full_bases.empty()) {
+            result = result + multi_exp_affine<GroupT, FieldT>(
+                                  full_bases.begin(),
+                                  full_bases.end(),
+                                  full_scalars.begin(),
+                                  full_scalars.end(),
+                                  1);
+        }
+        return result;
+    }
+
+private:
+    GroupT ones_sum;
+    std::vector<GroupT> small_bases;
+    std::vector<FieldT> small_scalars;
+    std::vector<GroupT> full_bases;
+    std::vector<FieldT> full_scalars;
+};
+
+// Buckets of a Pippenger multi-exponentiation (for one window), held in affine
+// coordinates, to which points are added in batches sharing a single
+// inversion. A point added to a bucket which already has an addition in the
+// current batch is deferred to the next batch. If too many points are
+// deferred (when many digits are equal), the excess is accumulated in
+// Jacobian coordinates.
+template<typename GroupT> class batch_affine_buckets
+{
+public:
+    using coordinate = decltype(std::declval<GroupT>().X);
+
+    batch_affine_buckets(size_t num_buckets, size_t max_batch_size)
+        : max_batch_size(max_batch_size)
+        , xs(num_buckets)
+        , ys(num_buckets)
+        , overflow(num_buckets, GroupT::zero())
+        , state(num_buckets, bucket_empty)
+    {
+    }
+
+    // Add the affine point (x, y) to a bucket.
+    void add(size_t bucket, const coordinate &x, const coordinate &y)
+    {
+        schedule(bucket, x, y);
+        while (batch.size() >= max_batch_size) {
+            apply_batch();
+            retry_deferred();
+        }
+    }
+
+    // Add a point which is not in affine form to a bucket. It is accumulated
+    // in Jacobian coordinates, as normalizing it would cost an inversion.
+    void add_jacobian(size_t bucket, const GroupT &point)
+    {
+        overflow[bucket] = overflow[bucket] + point;
+    }
+
+    // Return sum_i((i + 1) * bucket_i) and empty the buckets.
+    GroupT sum_and_reset()
+    {
+        while (!batch.empty() || !deferred.empty()) {
+            apply_batch();
+            retry_deferred();
+        }
+
+        GroupT running_sum = GroupT::zero();
+        GroupT result = GroupT::zero();
+        for (size_t i = state.size(); i-- > 0;) {
+            if (state[i] != bucket_empty) {
+                running_sum =
+                    running_sum.mixed_add(GroupT(xs[i], ys[i], one));
+                state[i] = bucket_empty;
+            }
+            if (!overflow[i].is_zero()) {
+                running_sum = running_sum + overflow[i];
+                overflow[i] = GroupT::zero();
+            }
+            result = result + running_sum;
+        }
+        return result;
+    }
+
+private:
+    enum bucket_state {
+        bucket_empty,
+        bucket_set,
+        // The bucket is set, and an addition to it is in the batch.
+        bucket_in_batch,
+    };
+
+    class pending_addition
+    {
+    public:
+        size_t bucket;
+        coordinate x;
+        coordinate y;
+    };
+
+    void schedule(size_t bucket, const coordinate &x, const coordinate &y)
+    {
+        switch (state[bucket]) {
+        case bucket_empty:
+            xs[bucket] = x;
+            ys[bucket] = y;
+            state[bucket] = bucket_set;
+            break;
+        case bucket_set:
+            batch.push_back(pending_addition{bucket, x, y});
+            state[bucket] = bucket_in_batch;
+            break;
+        case bucket_in_batch:
+            if (deferred.size() < max_batch_size) {
+                deferred.push_back(pending_addition{bucket, x, y});
+            } else {
+                overflow[bucket] =
+                    overflow[bucket].mixed_add(GroupT(x, y, one));
+            }
+            break;
+        }
+    }
+
+    void retry_deferred()
+    {
+        retried.swap(deferred);
+        for (const pending_addition &addition : retried) {
+            schedule(addition.bucket, addition.x, addition.y);
+        }
+        retried.clear();
+    }
+
+    // Perform all additions in the batch, using a single inversion of the
+    // product of the denominators of the slopes.
+    void apply_batch()
+    {
+        const size_t n = batch.size();
+        if (n == 0) {
+            return;
+        }
+
+        denominators.resize(n);
+        products.resize(n);
+        slopes.resize(n);
+        cancellations.resize(n);
+        coordinate product = one;
+        for (size_t k = 0; k < n; ++k) {
+            const pending_addition &addition = batch[k];
+            const coordinate &x1 = xs[addition.bucket];
+            const coordinate &y1 = ys[addition.bucket];
+            cancellations[k] = false;
+            if (x1 != addition.x) {
+                denominators[k] = addition.x - x1;
+                slopes[k] = addition.y - y1;
+            } else if (y1 == addition.y && !y1.is_zero()) {
+                // Doubling: the slope is 3 * x1^2 / (2 * y1).
+                const coordinate x1_squared = x1.squared();
+                denominators[k] = y1 + y1;
+                slopes[k] = x1_squared + x1_squared + x1_squared;
+            } else {
+                // P + (-P): the bucket becomes empty.
+                denominators[k] = one;
+                cancellations[k] = true;
+            }
+            product = product * denominators[k];
+            products[k] = product;
+        }
+
+        // `inverse` is the inverse of products[k] at each iteration.
+        coordinate inverse = product.inverse();
+        for (size_t k = n; k-- > 0;) {
+            const pending_addition &addition = batch[k];
+            const size_t bucket = addition.bucket;
+            const coordinate inverse_denominator =
+                (k > 0) ? inverse * products[k - 1] : inverse;
+            inverse = inverse * denominators[k];
+
+            if (cancellations[k]) {
+                state[bucket] = bucket_empty;
+                continue;
+            }
+            const coordinate &x1 = xs[bucket];
+            const coordinate slope = slopes[k] * inverse_denominator;
+            const coordinate x3 = slope.squared() - x1 - addition.x;
+            ys[bucket] = slope * (x1 - x3) - ys[bucket];
+            xs[bucket] = x3;
+            state[bucket] = bucket_set;
+        }
+        batch.clear();
+    }
+
+    const size_t max_batch_size;
+    const coordinate one = coordinate::one();
+
+    std::vector<coordinate> xs;
+    std::vector<coordinate> ys;
+    std::vector<GroupT> overflow;
+    std::vector<bucket_state> state;
+
+    std::vector<pending_addition> batch;
+    std::vector<pending_addition> deferred;
+    std::vector<pending_addition> retried;
+    std::vector<coordinate> denominators;
+    std::vector<coordinate> products;
+    std::vector<coordinate> slopes;
+    std::vector<bool> cancellations;
+};
+
+// Pippenger multi-exponentiation with batch affine buckets, for one range of
+// terms.
+template<typename GroupT, typename FieldT>
+GroupT multi_exp_batch_affine_range(
+    typename std::vector<GroupT>::const_iterator gs_start,
+    typename std::vector<FieldT>::const_iterator fs_start,
+    const size_t size)
+{
+    using bigint = decltype(std::declval<FieldT>().as_bigint());
+
+    // Scalars in non-Montgomery form, and the bit length of the largest.
+    std::vector<bigint> scalars;
+    scalars.reserve(size);
+    size_t num_bits = 0;
+    for (size_t i = 0; i < size; ++i) {
+        scalars.push_back((fs_start + i)->as_bigint());
+        num_bits = std::max(num_bits, scalars.back().num_bits());
+    }
+    if (num_bits == 0) {
+        return GroupT::zero();
+    }
+
+    // Window size as in the libff BDLO12 implementation. The batches hold up
+    // to a quarter of the buckets, keeping deferred additions infrequent.
+    const size_t log2_size = libff::log2(size);
+    const size_t c = std::max<size_t>(
+        1, (log2_size > 6) ? log2_size - (log2_size / 3 - 2) : log2_size);
+    const size_t num_buckets = (size_t(1) << c) - 1;
+    const size_t num_windows = (num_bits + c - 1) / c;
+    batch_affine_buckets<GroupT> buckets(
+        num_buckets, std::max<size_t>(1, num_buckets / 4));
+
+    GroupT result = GroupT::zero();
+    for (size_t window = num_windows; window-- > 0;) {
+        for (size_t j = 0; j < c; ++j) {
+            result = result.dbl();
+        }
+
+        for (size_t i = 0; i < size; ++i) {
+            size_t digit = 0;
+            for (size_t j = 0; j < c; ++j) {
+                if (scalars[i].test_bit(window * c + j)) {
+                    digit |= size_t(1) << j;
+                }
+            }
+            const GroupT &base = *(gs_start + i);
+            if (digit == 0 || base.is_zero()) {
+                continue;
+            }
+            if (base.is_special()) {
+                buckets.add(digit - 1, base.X, base.Y);
+            } else {
+                buckets.add_jacobian(digit - 1, base);
+            }
+        }
+        result = result + buckets.sum_and_reset();
+    }
+
+    return result;
+}
+
+// Start of the i-th of `chunks` (almost) equal ranges covering [0, size).
+inline size_t multi_exp_chunk_start(size_t size, size_t chunks, size_t i)
+{
+    return (size * i) / chunks;
+}
+
+} // namespace internal
+
+template<typename GroupT, typename FieldT>
+GroupT multi_exp_batch_affine(
+    typename std::vector<GroupT>::const_iterator gs_start,
+    typename std::vector<GroupT>::const_iterator gs_end,
+    typename std::vector<FieldT>::const_iterator fs_start,
+    typename std::vector<FieldT>::const_iterator fs_end,
+    const size_t chunks)
+{
+    const size_t size = fs_end - fs_start;
+    assert((size_t)(gs_end - gs_start) == size);
+    (void)gs_end;
+    assert(chunks > 0);
+
+    std::vector<GroupT> partial_results(chunks, GroupT::zero());
+#ifdef MULTICORE
+#pragma omp parallel for
+#endif
+    for (size_t i = 0; i < chunks; ++i) {
+        const size_t start = internal::multi_exp_chunk_start(size, chunks, i);
+        const size_t end = internal::multi_exp_chunk_start(size, chunks, i + 1);
+        partial_results[i] =
+            internal::multi_exp_batch_affine_range<GroupT, FieldT>(
+                gs_start + start, fs_start + start, end - start);
+    }
+
+    GroupT result = GroupT::zero();
+    for (const GroupT &partial_result : partial_results) {
+        result = result + partial_result;
+    }
+    return result;
+}
+
+template<typename GroupT, typename FieldT>
+GroupT multi_exp_affine(
+    typename std::vector<GroupT>::const_iterator gs_start,
+    typename std::vector<GroupT>::const_iterator gs_end,
+    typename std::vector<FieldT>::const_iterator fs_start,
+    typename std::vector<FieldT>::const_iterator fs_end,
+    const size_t chunks)
+{
+    if ((size_t)(fs_end - fs_start) >= MULTI_EXP_BATCH_AFFINE_MIN_SIZE) {
+        return multi_exp_batch_affine<GroupT, FieldT>(
+            gs_start, gs_end, fs_start, fs_end, chunks);
+    }
+
+    const libff::multi_exp_method Method = libff::multi_exp_method_BDLO12;
+    return libff::multi_exp<GroupT, FieldT, Method>(
+        gs_start, gs_end, fs_start, fs_end, chunks);
+}
+
+template<typename FieldT>
+multi_exp_scalar_classes multi_exp_classify_scalars(
+    typename std::vector<FieldT>::const_iterator fs_start,
+    typename std::vector<FieldT>::const_iterator fs_end)
+{
+    multi_exp_scalar_classes classes{0, 0, 0, 0};
+    for (auto it = fs_start; it != fs_end; ++it) {
+        switch (internal::multi_exp_classify_scalar(*it)) {
+        case internal::multi_exp_scalar_zero:
+            ++classes.num_zero;
+            break;
+        case internal::multi_exp_scalar_one:
+            ++classes.num_one;
+            break;
+        case internal::multi_exp_scalar_small:
+            ++classes.num_small;
+            break;
+        case internal::multi_exp_scalar_full:
+            ++classes.num_full;
+            break;
+        }
+    }
+    return classes;
+}
+
+template<typename GroupT, typename FieldT>
+GroupT multi_exp_classified(
+    typename std::vector<GroupT>::const_iterator gs_start,
+    typename std::vector<GroupT>::const_iterator gs_end,
+    typename std::vector<FieldT>::const_iterator fs_start,
+    typename std::vector<FieldT>::const_iterator fs_end,
+    const size_t chunks)
+{
+    const size_t size = fs_end - fs_start;
+    assert((size_t)(gs_end - gs_start) == size);
+    (void)gs_end;
+    assert(chunks > 0);
+
+    std::vector<GroupT> partial_results(chunks, GroupT::zero());
+#ifdef MULTICORE
+#pragma omp parallel for
+#endif
+    for (size_t i = 0; i < chunks; ++i) {
+        const size_t start = internal::multi_exp_chunk_start(size, chunks, i);
+        const size_t end = internal::multi_exp_chunk_start(size, chunks, i + 1);
+        internal::multi_exp_terms<GroupT, FieldT> terms;
+        for (size_t j = start; j < end; ++j) {
+            terms.add(*(gs_start + j), *(fs_start + j));
+        }
+        partial_results[i] = terms.evaluate();
+    }
+
+    GroupT result = GroupT::zero();
+    for (const GroupT &partial_result : partial_results) {
+        result = result + partial_result;
+    }
+    return result;
+}
+
+template<typename T1, typename T2, typename FieldT>
+libsnark::knowledge_commitment<T1, T2> kc_multi_exp_classified(
+    const libsnark::knowledge_commitment_vector<T1, T2> &vec,
+    const size_t min_idx,
+    const size_t max_idx,
+    typename std::vector<FieldT>::const_iterator fs_start,
+    typename std::vector<FieldT>::const_iterator fs_end,
+    const size_t chunks)
+{
+    assert((size_t)(fs_end - fs_start) == max_idx - min_idx);
+    (void)fs_end;
+    assert(chunks > 0);
+
+    // Positions in the sparse vector of the terms with indices in
+    // [min_idx, max_idx) (indices are sorted).
+    const size_t begin_pos =
+        std::lower_bound(vec.indices.begin(), vec.indices.end(), min_idx) -
+        vec.indices.begin();
+    const size_t end_pos =
+        std::lower_bound(vec.indices.begin(), vec.indices.end(), max_idx) -
+        vec.indices.begin();
+    const size_t size = end_pos - begin_pos;
+
+    std::vector<libsnark::knowledge_commitment<T1, T2>> partial_results(
+        chunks,
+        libsnark::knowledge_commitment<T1, T2>(T1::zero(), T2::zero()));
+#ifdef MULTICORE
+#pragma omp parallel for
+#endif
+    for (size_t i = 0; i < chunks; ++i) {
+        const size_t start =
+            begin_pos + internal::multi_exp_chunk_start(size, chunks, i);
+        const size_t end =
+            begin_pos + internal::multi_exp_chunk_start(size, chunks, i + 1);
+        internal::multi_exp_terms<T1, FieldT> g_terms;
+        internal::multi_exp_terms<T2, FieldT> h_terms;
+        for (size_t pos = start; pos < end; ++pos) {
+            const FieldT &scalar = *(fs_start + (vec.indices[pos] - min_idx));
+            g_terms.add(vec.values[pos].g, scalar);
+            h_terms.add(vec.values[pos].h, scalar);
+        }
+        partial_results[i] = libsnark::knowledge_commitment<T1, T2>(
+            g_terms.evaluate(), h_terms.evaluate());
+    }
+
+    using kc = libsnark::knowledge_commitment<T1, T2>;
+    kc result(T1::zero(), T2::zero());
+    for (const kc &partial_result : partial_results) {
+        result = result + partial_result;
+    }
+    return result;
+}
+
 } // namespace libzeth
 
 #endif // __ZETH_CORE_MULTI_EXP_TCC__
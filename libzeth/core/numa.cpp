@@ -0,0 +1,122 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#include "libzeth/core/numa.hpp"
+
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <cstring>
+#include <fstream>
+#include <pthread.h>
+#include <sched.h>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace libzeth
+{
+
+static size_t parse_cpu_index(const std::string &s)
+{
+    if (s.empty() || s.find_first_not_of("0123456789") != std::string::npos) {
+        throw std::invalid_argument("invalid cpu list entry: " + s);
+    }
+    return (size_t)std::stoul(s);
+}
+
+std::vector<size_t> parse_cpu_list(const std::string &cpu_list)
+{
+    std::vector<size_t> cpus;
+    std::istringstream in_s(cpu_list);
+    std::string range;
+    while (std::getline(in_s, range, ',')) {
+        // Ignore the trailing newline of sysfs files.
+        range.erase(range.find_last_not_of(" \n") + 1);
+        if (range.empty()) {
+            continue;
+        }
+
+        const size_t dash = range.find('-');
+        if (dash == std::string::npos) {
+            cpus.push_back(parse_cpu_index(range));
+            continue;
+        }
+
+        const size_t first = parse_cpu_index(range.substr(0, dash));
+        const size_t last = parse_cpu_index(range.substr(dash + 1));
+        if (last < first) {
+            throw std::invalid_argument("invalid cpu range: " + range);
+        }
+        for (size_t cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+std::vector<numa_node> get_numa_nodes()
+{
+    std::vector<numa_node> nodes;
+    const boost::filesystem::path nodes_dir("/sys/devices/system/node");
+    boost::system::error_code ec;
+    for (boost::filesystem::directory_iterator it(nodes_dir, ec), end;
+         !ec && it != end;
+         it.increment(ec)) {
+        const std::string name = it->path().filename().string();
+        if (name.compare(0, 4, "node") != 0 ||
+            name.find_first_not_of("0123456789", 4) != std::string::npos ||
+            name.size() == 4) {
+            continue;
+        }
+
+        std::ifstream cpulist_s((it->path() / "cpulist").string());
+        std::string cpulist;
+        if (!std::getline(cpulist_s, cpulist)) {
+            continue;
+        }
+
+        numa_node node;
+        node.id = (size_t)std::stoul(name.substr(4));
+        node.cpus = parse_cpu_list(cpulist);
+        if (!node.cpus.empty()) {
+            nodes.push_back(node);
+        }
+    }
+
+    if (nodes.empty()) {
+        numa_node node;
+        node.id = 0;
+        for (size_t cpu = 0; cpu < std::thread::hardware_concurrency(); ++cpu) {
+            node.cpus.push_back(cpu);
+        }
+        nodes.push_back(node);
+    }
+
+    std::sort(
+        nodes.begin(), nodes.end(), [](const numa_node &a, const numa_node &b) {
+            return a.id < b.id;
+        });
+    return nodes;
+}
+
+void pin_current_thread(const std::vector<size_t> &cpus)
+{
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (const size_t cpu : cpus) {
+        if (cpu >= CPU_SETSIZE) {
+            throw std::invalid_argument("cpu index out of range");
+        }
+        CPU_SET(cpu, &cpu_set);
+    }
+
+    const int error =
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+    if (error != 0) {
+        throw std::runtime_error(
+            std::string("failed to set thread affinity: ") + strerror(error));
+    }
+}
+
+} // namespace libzeth
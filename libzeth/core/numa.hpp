@@ -0,0 +1,41 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#ifndef __ZETH_CORE_NUMA_HPP__
+#define __ZETH_CORE_NUMA_HPP__
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace libzeth
+{
+
+/// A NUMA node of the host, and the CPUs attached to it.
+class numa_node
+{
+public:
+    size_t id;
+    std::vector<size_t> cpus;
+};
+
+/// Parse a list of CPUs in the format used by the kernel (e.g. "0-3,8,10-11",
+/// as in /sys/devices/system/node/node<N>/cpulist). Throws
+/// `std::invalid_argument` if the list is malformed.
+std::vector<size_t> parse_cpu_list(const std::string &cpu_list);
+
+/// The NUMA nodes of the host which have CPUs, read from sysfs (Linux). If
+/// the topology is not available, a single node with all CPUs is returned.
+std::vector<numa_node> get_numa_nodes();
+
+/// Restrict the calling thread to the given CPUs. Threads subsequently
+/// created by the calling thread (including OpenMP threads) inherit the
+/// restriction, and memory first touched by them is allocated on the local
+/// node under the default kernel policy. Throws `std::runtime_error` on
+/// failure.
+void pin_current_thread(const std::vector<size_t> &cpus);
+
+} // namespace libzeth
+
+#endif // __ZETH_CORE_NUMA_HPP__
@@ -0,0 +1,20 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#include "libzeth/core/proof_progress.hpp"
+
+namespace libzeth
+{
+
+proof_progress_listener::~proof_progress_listener() {}
+
+void notify_stage_completed(
+    proof_progress_listener *listener, const proof_stage stage)
+{
+    if (listener != nullptr) {
+        listener->stage_completed(stage);
+    }
+}
+
+} // namespace libzeth
@@ -0,0 +1,39 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#ifndef __ZETH_CORE_PROOF_PROGRESS_HPP__
+#define __ZETH_CORE_PROOF_PROGRESS_HPP__
+
+namespace libzeth
+{
+
+/// Stages of proof generation reported to a proof_progress_listener. Stages
+/// which a snark scheme does not expose individually are not reported.
+enum proof_stage {
+    proof_stage_inputs_parsed,
+    proof_stage_witness_generated,
+    proof_stage_satisfiability_checked,
+    proof_stage_h_computed,
+    proof_stage_multi_exp_a,
+    proof_stage_multi_exp_b,
+    proof_stage_multi_exp_h,
+    proof_stage_multi_exp_l,
+};
+
+/// Interface notified as the stages of proof generation complete. Methods are
+/// called on the thread generating the proof, between stages.
+class proof_progress_listener
+{
+public:
+    virtual ~proof_progress_listener();
+    virtual void stage_completed(const proof_stage stage) = 0;
+};
+
+/// Notify `listener` (if not null) that `stage` has completed.
+void notify_stage_completed(
+    proof_progress_listener *listener, const proof_stage stage);
+
+} // namespace libzeth
+
+#endif // __ZETH_CORE_PROOF_PROGRESS_HPP__
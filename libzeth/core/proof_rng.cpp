@@ -0,0 +1,29 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#include "libzeth/core/proof_rng.hpp"
+
+#include <array>
+#include <cstdint>
+#include <sodium/randombytes.h>
+
+namespace libzeth
+{
+
+// Seed from the operating system RNG (through libsodium, which is
+// thread-safe).
+static std::array<uint8_t, proof_rng::SEED_SIZE> os_seed()
+{
+    std::array<uint8_t, proof_rng::SEED_SIZE> seed;
+    randombytes_buf(seed.data(), seed.size());
+    return seed;
+}
+
+proof_rng::proof_rng() : proof_rng(os_seed().data(), SEED_SIZE) {}
+
+proof_rng::proof_rng(const void *seed, size_t seed_size) : rng(seed, seed_size)
+{
+}
+
+} // namespace libzeth
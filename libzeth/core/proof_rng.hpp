@@ -0,0 +1,47 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#ifndef __ZETH_CORE_PROOF_RNG_HPP__
+#define __ZETH_CORE_PROOF_RNG_HPP__
+
+#include "libzeth/core/chacha_rng.hpp"
+
+#include <cstddef>
+
+namespace libzeth
+{
+
+/// Source of the randomness used by a single proof (such as the Groth16
+/// blinding factors r and s), so that concurrent proofs do not share the state
+/// of the global libff RNG. Field elements are sampled from a chacha_rng
+/// stream, seeded either from the operating system (for real proofs) or with
+/// an explicit seed (for tests and benchmarks, which then generate identical
+/// proofs). Not thread-safe: each proof uses its own instance.
+class proof_rng
+{
+public:
+    /// Size in bytes of the seeds used by chacha_rng (longer seeds are
+    /// truncated, shorter seeds are padded with zeroes).
+    static const size_t SEED_SIZE = 32;
+
+    /// Seeded from the operating system RNG.
+    proof_rng();
+
+    /// Seeded with `seed` (deterministic).
+    proof_rng(const void *seed, size_t seed_size);
+
+    /// Uniformly random element of FieldT (up to a negligible bias), obtained
+    /// by reducing twice the number of limbs of FieldT from the stream modulo
+    /// the field characteristic.
+    template<typename FieldT> FieldT random_element();
+
+private:
+    chacha_rng rng;
+};
+
+} // namespace libzeth
+
+#include "libzeth/core/proof_rng.tcc"
+
+#endif // __ZETH_CORE_PROOF_RNG_HPP__
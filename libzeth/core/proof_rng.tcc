@@ -0,0 +1,39 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#ifndef __ZETH_CORE_PROOF_RNG_TCC__
+#define __ZETH_CORE_PROOF_RNG_TCC__
+
+#include "libzeth/core/proof_rng.hpp"
+
+#include "libzeth/core/include_libff.hpp"
+
+#include <gmp.h>
+
+namespace libzeth
+{
+
+template<typename FieldT> FieldT proof_rng::random_element()
+{
+    // As in srs_mpc_digest_to_fp, fill a value of twice the size of the
+    // modulus, and take its remainder.
+    const mp_size_t n = FieldT::num_limbs;
+    libff::bigint<2 * n> random;
+    libff::bigint<n + 1> quotient;
+    libff::bigint<n> remainder;
+    rng.random(random.data, sizeof(random.data));
+    mpn_tdiv_qr(
+        quotient.data,
+        remainder.data,
+        0,
+        random.data,
+        2 * n,
+        FieldT::mod.data,
+        n);
+    return FieldT(remainder);
+}
+
+} // namespace libzeth
+
+#endif // __ZETH_CORE_PROOF_RNG_TCC__
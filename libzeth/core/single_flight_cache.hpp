@@ -0,0 +1,98 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#ifndef __ZETH_CORE_SINGLE_FLIGHT_CACHE_HPP__
+#define __ZETH_CORE_SINGLE_FLIGHT_CACHE_HPP__
+
+#include "libzeth/core/cancellation.hpp"
+
+#include <functional>
+#include <future>
+#include <list>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace libzeth
+{
+
+/// Bounded cache of values which are expensive to compute. Concurrent requests
+/// for a key which is not cached share a single computation: the first caller
+/// runs it and the others wait for its result.
+///
+/// Once `capacity` values are held, the least-recently-used value is evicted.
+/// If a `spill` function is given, evicted values are passed to it, and a
+/// `load` function (returning false if the key is not found) is queried before
+/// computing a value which is not held in memory. This can be used to keep
+/// evicted values in a secondary store, such as files on disk. `spill` is
+/// called without holding the lock of the cache (evicted values are served
+/// from memory until it returns), so that a slow store does not delay other
+/// requests. Errors thrown by `spill` are ignored (the value is still returned
+/// to the caller, and is only missing from the secondary store), so `spill`
+/// should report its own errors.
+template<typename KeyT, typename ValueT> class single_flight_cache
+{
+public:
+    using compute_function = std::function<ValueT()>;
+    using spill_function = std::function<void(const KeyT &, const ValueT &)>;
+    using load_function = std::function<bool(const KeyT &, ValueT &)>;
+
+    explicit single_flight_cache(
+        const size_t capacity,
+        const spill_function &spill = spill_function(),
+        const load_function &load = load_function());
+    single_flight_cache(const single_flight_cache &) = delete;
+    single_flight_cache &operator=(const single_flight_cache &) = delete;
+
+    /// Return the value for `key`, calling `compute` if it is not cached and
+    /// not already being computed. If the computation throws, the exception is
+    /// propagated to the caller and to all waiting callers, and nothing is
+    /// cached. A caller waiting for the computation of another caller throws
+    /// operation_cancelled if `cancel` (if not null) is cancelled while it
+    /// waits (the computation itself carries on).
+    ValueT get(
+        const KeyT &key,
+        const compute_function &compute,
+        const cancellation_token *cancel = nullptr);
+
+    /// Number of values held in memory.
+    size_t size() const;
+
+private:
+    class entry
+    {
+    public:
+        ValueT value;
+        typename std::list<KeyT>::iterator lru_position;
+    };
+
+    using evicted_values = std::vector<std::pair<KeyT, ValueT>>;
+
+    // Insert a value (the lock must be held), evicting as required. Values to
+    // be spilled are moved to `spilling` and appended to `evicted`.
+    void insert(const KeyT &key, const ValueT &value, evicted_values &evicted);
+
+    // Spill the values evicted by `insert` (the lock must not be held), and
+    // remove them from `spilling`. Errors thrown by `spill` are ignored.
+    void spill_evicted(const evicted_values &evicted);
+
+    const size_t capacity;
+    const spill_function spill;
+    const load_function load;
+
+    mutable std::mutex mutex;
+    std::map<KeyT, entry> entries;
+    // Keys of `entries`, most-recently-used first.
+    std::list<KeyT> lru;
+    std::map<KeyT, std::shared_future<ValueT>> in_flight;
+    // Evicted values which are being spilled.
+    std::map<KeyT, ValueT> spilling;
+};
+
+} // namespace libzeth
+
+#include "libzeth/core/single_flight_cache.tcc"
+
+#endif // __ZETH_CORE_SINGLE_FLIGHT_CACHE_HPP__
@@ -0,0 +1,157 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#ifndef __ZETH_CORE_SINGLE_FLIGHT_CACHE_TCC__
+#define __ZETH_CORE_SINGLE_FLIGHT_CACHE_TCC__
+
+#include "libzeth/core/single_flight_cache.hpp"
+
+#include <chrono>
+
+namespace libzeth
+{
+
+namespace internal
+{
+
+// Interval at which callers waiting for the computation of another caller
+// poll their cancellation token.
+const std::chrono::milliseconds SINGLE_FLIGHT_CACHE_POLL_INTERVAL(100);
+
+} // namespace internal
+
+template<typename KeyT, typename ValueT>
+single_flight_cache<KeyT, ValueT>::single_flight_cache(
+    const size_t capacity,
+    const spill_function &spill,
+    const load_function &load)
+    : capacity(capacity), spill(spill), load(load)
+{
+}
+
+template<typename KeyT, typename ValueT>
+ValueT single_flight_cache<KeyT, ValueT>::get(
+    const KeyT &key,
+    const compute_function &compute,
+    const cancellation_token *cancel)
+{
+    std::promise<ValueT> promise;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        auto entry_it = entries.find(key);
+        if (entry_it != entries.end()) {
+            lru.splice(lru.begin(), lru, entry_it->second.lru_position);
+            return entry_it->second.value;
+        }
+
+        auto spilling_it = spilling.find(key);
+        if (spilling_it != spilling.end()) {
+            return spilling_it->second;
+        }
+
+        auto in_flight_it = in_flight.find(key);
+        if (in_flight_it != in_flight.end()) {
+            std::shared_future<ValueT> result = in_flight_it->second;
+            lock.unlock();
+            while (result.wait_for(
+                       internal::SINGLE_FLIGHT_CACHE_POLL_INTERVAL) !=
+                   std::future_status::ready) {
+                if (cancel != nullptr && cancel->is_cancelled()) {
+                    throw operation_cancelled(
+                        "cancelled while waiting for another request");
+                }
+            }
+            return result.get();
+        }
+
+        in_flight[key] = promise.get_future().share();
+    }
+
+    // This caller is responsible for producing the value. Other callers
+    // requesting the same key wait on `promise`.
+    ValueT value;
+    evicted_values evicted;
+    try {
+        if (!load || !load(key, value)) {
+            value = compute();
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        insert(key, value, evicted);
+        in_flight.erase(key);
+    } catch (...) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            in_flight.erase(key);
+        }
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+
+    promise.set_value(value);
+    spill_evicted(evicted);
+    return value;
+}
+
+template<typename KeyT, typename ValueT>
+size_t single_flight_cache<KeyT, ValueT>::size() const
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+template<typename KeyT, typename ValueT>
+void single_flight_cache<KeyT, ValueT>::insert(
+    const KeyT &key, const ValueT &value, evicted_values &evicted)
+{
+    if (capacity == 0) {
+        if (spill) {
+            spilling[key] = value;
+            evicted.emplace_back(key, value);
+        }
+        return;
+    }
+
+    while (entries.size() >= capacity) {
+        const KeyT &evicted_key = lru.back();
+        auto evicted_it = entries.find(evicted_key);
+        if (spill) {
+            spilling[evicted_key] = evicted_it->second.value;
+            evicted.emplace_back(evicted_key, evicted_it->second.value);
+        }
+        entries.erase(evicted_it);
+        lru.pop_back();
+    }
+
+    lru.push_front(key);
+    entry &new_entry = entries[key];
+    new_entry.value = value;
+    new_entry.lru_position = lru.begin();
+}
+
+template<typename KeyT, typename ValueT>
+void single_flight_cache<KeyT, ValueT>::spill_evicted(
+    const evicted_values &evicted)
+{
+    // Errors are ignored, since the values have already been returned to the
+    // callers. All values are removed from `spilling`.
+    for (const std::pair<KeyT, ValueT> &evicted_value : evicted) {
+        try {
+            spill(evicted_value.first, evicted_value.second);
+        } catch (...) {
+        }
+    }
+
+    if (!evicted.empty()) {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (const std::pair<KeyT, ValueT> &evicted_value : evicted) {
+            spilling.erase(evicted_value.first);
+        }
+    }
+}
+
+} // namespace libzeth
+
+#endif // __ZETH_CORE_SINGLE_FLIGHT_CACHE_TCC__
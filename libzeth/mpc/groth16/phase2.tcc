@@ -6,6 +6,7 @@
 #define __ZETH_MPC_GROTH16_PHASE2_TCC__
 
 #include "libzeth/core/chacha_rng.hpp"
+#include "libzeth/core/endomorphism.hpp"
 #include "libzeth/core/hash_stream.hpp"
 #include "libzeth/core/utils.hpp"
 #include "libzeth/mpc/groth16/mpc_utils.hpp"
@@ -42,6 +43,8 @@ template<typename ppT>
 bool srs_mpc_phase2_accumulator<ppT>::is_well_formed() const
 {
     return delta_g1.is_well_formed() && delta_g2.is_well_formed() &&
+           endomorphism_is_in_subgroup(delta_g1) &&
+           endomorphism_is_in_subgroup(delta_g2) &&
            container_is_well_formed(H_g1) && container_is_well_formed(L_g1);
 }
 
@@ -192,7 +195,11 @@ template<typename ppT>
 bool srs_mpc_phase2_publickey<ppT>::is_well_formed() const
 {
     return new_delta_g1.is_well_formed() && s_g1.is_well_formed() &&
-           s_delta_j_g1.is_well_formed() && r_delta_j_g2.is_well_formed();
+           s_delta_j_g1.is_well_formed() && r_delta_j_g2.is_well_formed() &&
+           endomorphism_is_in_subgroup(new_delta_g1) &&
+           endomorphism_is_in_subgroup(s_g1) &&
+           endomorphism_is_in_subgroup(s_delta_j_g1) &&
+           endomorphism_is_in_subgroup(r_delta_j_g2);
 }
 
 template<typename ppT>
@@ -430,11 +437,16 @@ srs_mpc_phase2_accumulator<ppT> srs_mpc_phase2_update_accumulator(
     const libff::Fr<ppT> &delta_j)
 {
     libff::enter_block("call to srs_mpc_phase2_update_accumulator");
-    const libff::Fr<ppT> delta_j_inverse = delta_j.inverse();
+    // $\delta_j^{-1}$ is decomposed once, and applied to each $L_i$ and $H_i$
+    // using the endomorphism of G1.
+    const endomorphism_scalar<libff::G1<ppT>> delta_j_inverse(
+        delta_j.inverse());
 
     // Step 3 (from [BoweGM17]): Update accumulated $\delta$
-    const libff::G1<ppT> new_delta_g1 = delta_j * last_accum.delta_g1;
-    const libff::G2<ppT> new_delta_g2 = delta_j * last_accum.delta_g2;
+    const libff::G1<ppT> new_delta_g1 =
+        endomorphism_mul(delta_j, last_accum.delta_g1);
+    const libff::G2<ppT> new_delta_g2 =
+        endomorphism_mul(delta_j, last_accum.delta_g2);
 
     // Step 3: Update $L_i$ by dividing by $\delta$ ('K' in the paper, but we
     // use L here to be consistent with the final keypair in libsnark).
@@ -449,7 +461,7 @@ srs_mpc_phase2_accumulator<ppT> srs_mpc_phase2_update_accumulator(
 #pragma omp parallel for
 #endif
     for (size_t i = 0; i < num_L_elements; ++i) {
-        L_g1[i] = delta_j_inverse * last_accum.L_g1[i];
+        L_g1[i] = delta_j_inverse.mul(last_accum.L_g1[i]);
     }
     putchar('\n');
     libff::leave_block("updating L_g1");
@@ -466,7 +478,7 @@ srs_mpc_phase2_accumulator<ppT> srs_mpc_phase2_update_accumulator(
 #pragma omp parallel for
 #endif
     for (size_t i = 0; i < H_size; ++i) {
-        H_g1[i] = delta_j_inverse * last_accum.H_g1[i];
+        H_g1[i] = delta_j_inverse.mul(last_accum.H_g1[i]);
     }
     libff::leave_block("updating H_g1");
 
@@ -5,6 +5,7 @@
 #ifndef __ZETH_MPC_GROTH16_POWERSOFTAU_UTILS_TCC__
 #define __ZETH_MPC_GROTH16_POWERSOFTAU_UTILS_TCC__
 
+#include "libzeth/core/endomorphism.hpp"
 #include "libzeth/core/utils.hpp"
 #include "libzeth/mpc/groth16/powersoftau_utils.hpp"
 
@@ -160,18 +161,14 @@ void random_linear_combination(
         G a_thread_accum = G::zero();
         G b_thread_accum = G::zero();
 
-        const size_t scalar_bits = libff::Fr<ppT>::num_bits;
-        const size_t window_size = libff::wnaf_opt_window_size<G>(scalar_bits);
-        std::vector<long> wnaf;
-
 #ifdef MULTICORE
 #pragma omp for
 #endif
         for (size_t i = 0; i < as.size(); ++i) {
             const libff::Fr<ppT> r = libff::Fr<ppT>::random_element();
-            update_wnaf(wnaf, window_size, r.as_bigint());
-            G r_ai = fixed_window_wnaf_exp(window_size, as[i], wnaf);
-            G r_bi = fixed_window_wnaf_exp(window_size, bs[i], wnaf);
+            const endomorphism_scalar<G> r_decomposed(r);
+            G r_ai = r_decomposed.mul(as[i]);
+            G r_bi = r_decomposed.mul(bs[i]);
 
             a_thread_accum = a_thread_accum + r_ai;
             b_thread_accum = b_thread_accum + r_bi;
@@ -207,18 +204,14 @@ void random_linear_combination_consecutive(
         G a_thread_accum = G::zero();
         G b_thread_accum = G::zero();
 
-        const size_t scalar_bits = libff::Fr<ppT>::num_bits;
-        const size_t window_size = libff::wnaf_opt_window_size<G>(scalar_bits);
-        std::vector<long> wnaf;
-
 #ifdef MULTICORE
 #pragma omp for
 #endif
         for (size_t i = 0; i < num_entries; ++i) {
             const libff::Fr<ppT> r = libff::Fr<ppT>::random_element();
-            update_wnaf(wnaf, window_size, r.as_bigint());
-            G r_ai = fixed_window_wnaf_exp(window_size, as[i], wnaf);
-            G r_bi = fixed_window_wnaf_exp(window_size, as[i + 1], wnaf);
+            const endomorphism_scalar<G> r_decomposed(r);
+            G r_ai = r_decomposed.mul(as[i]);
+            G r_bi = r_decomposed.mul(as[i + 1]);
 
             a_thread_accum = a_thread_accum + r_ai;
             b_thread_accum = b_thread_accum + r_bi;
@@ -234,6 +227,30 @@ void random_linear_combination_consecutive(
     }
 }
 
+// Compute scalars[i] * P for i < num_entries, where `table` is the window
+// table for P (with scalar size endomorphism_component_bits<G>()). Equivalent
+// to libff::batch_exp, with scalars decomposed using the endomorphism of G, so
+// that the table and the number of additions per entry are roughly halved.
+template<typename G, typename FieldT>
+std::vector<G> endomorphism_batch_exp(
+    const size_t window_size,
+    const libff::window_table<G> &table,
+    const std::vector<FieldT> &scalars,
+    const size_t num_entries)
+{
+    std::vector<G> result(num_entries);
+
+#ifdef MULTICORE
+#pragma omp parallel for
+#endif
+    for (size_t i = 0; i < num_entries; ++i) {
+        result[i] = endomorphism_scalar<G>(scalars[i]).windowed_exp(
+            window_size, table);
+    }
+
+    return result;
+}
+
 } // namespace
 
 // -----------------------------------------------------------------------------
@@ -385,14 +402,14 @@ srs_powersoftau<ppT> dummy_powersoftau_from_secrets(
     {
         std::thread tau_g1_table_thread([&tau_g1_table, window_size_tau_g1]() {
             tau_g1_table = libff::get_window_table(
-                libff::G1<ppT>::size_in_bits(),
+                endomorphism_component_bits<libff::G1<ppT>>(),
                 window_size_tau_g1,
                 libff::G1<ppT>::one());
         });
 
         std::thread tau_g2_table_thread([&tau_g2_table, window_size]() {
             tau_g2_table = libff::get_window_table(
-                libff::G2<ppT>::size_in_bits(),
+                endomorphism_component_bits<libff::G2<ppT>>(),
                 window_size,
                 libff::G2<ppT>::one());
         });
@@ -400,7 +417,7 @@ srs_powersoftau<ppT> dummy_powersoftau_from_secrets(
         std::thread alpha_tau_g1_table_thread(
             [&alpha_tau_g1_table, window_size, alpha]() {
                 alpha_tau_g1_table = libff::get_window_table(
-                    libff::G1<ppT>::size_in_bits(),
+                    endomorphism_component_bits<libff::G1<ppT>>(),
                     window_size,
                     alpha * libff::G1<ppT>::one());
             });
@@ -408,7 +425,7 @@ srs_powersoftau<ppT> dummy_powersoftau_from_secrets(
         std::thread beta_tau_g1_table_thread(
             [&beta_tau_g1_table, window_size, beta]() {
                 beta_tau_g1_table = libff::get_window_table(
-                    libff::G1<ppT>::size_in_bits(),
+                    endomorphism_component_bits<libff::G1<ppT>>(),
                     window_size,
                     beta * libff::G1<ppT>::one());
             });
@@ -421,38 +438,23 @@ srs_powersoftau<ppT> dummy_powersoftau_from_secrets(
     libff::leave_block("window tables");
 
     libff::enter_block("tau_g1 powers");
-    tau_powers_g1 = libff::batch_exp(
-        libff::G1<ppT>::size_in_bits(),
-        window_size_tau_g1,
-        tau_g1_table,
-        tau_powers);
+    tau_powers_g1 = endomorphism_batch_exp(
+        window_size_tau_g1, tau_g1_table, tau_powers, num_tau_powers_g1);
     libff::leave_block("tau_g1 powers");
 
     libff::enter_block("tau_g2 powers");
-    tau_powers_g2 = libff::batch_exp(
-        libff::G2<ppT>::size_in_bits(),
-        window_size,
-        tau_g2_table,
-        tau_powers,
-        n);
+    tau_powers_g2 =
+        endomorphism_batch_exp(window_size, tau_g2_table, tau_powers, n);
     libff::leave_block("tau_g2 powers");
 
     libff::enter_block("alpha_tau_g1 powers");
-    alpha_tau_powers_g1 = libff::batch_exp(
-        libff::G1<ppT>::size_in_bits(),
-        window_size,
-        alpha_tau_g1_table,
-        tau_powers,
-        n);
+    alpha_tau_powers_g1 =
+        endomorphism_batch_exp(window_size, alpha_tau_g1_table, tau_powers, n);
     libff::leave_block("alpha_tau_g1 powers");
 
     libff::enter_block("beta_tau_g1 powers");
-    beta_tau_powers_g1 = libff::batch_exp(
-        libff::G1<ppT>::size_in_bits(),
-        window_size,
-        beta_tau_g1_table,
-        tau_powers,
-        n);
+    beta_tau_powers_g1 =
+        endomorphism_batch_exp(window_size, beta_tau_g1_table, tau_powers, n);
     libff::leave_block("beta_tau_g1 powers");
 
     libff::leave_block("dummy_phase1_from_secrets");
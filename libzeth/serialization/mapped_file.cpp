@@ -0,0 +1,213 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#include "libzeth/serialization/mapped_file.hpp"
+
+#include <boost/filesystem.hpp>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace libzeth
+{
+
+static std::runtime_error system_error(const std::string &what)
+{
+    return std::runtime_error(what + ": " + strerror(errno));
+}
+
+mapped_file::mapped_file()
+    : fd(-1), read_only(false), mapping(nullptr), mapping_size(0)
+{
+}
+
+mapped_file::mapped_file(const std::string &path, bool read_only)
+    : fd(-1), read_only(read_only), mapping(nullptr), mapping_size(0)
+{
+    fd = read_only ? ::open(path.c_str(), O_RDONLY)
+                   : ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        throw system_error("failed to open " + path);
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+        ::close(fd);
+        throw system_error("failed to stat " + path);
+    }
+
+    mapping_size = (size_t)file_stat.st_size;
+    map();
+}
+
+mapped_file::mapped_file(mapped_file &&other)
+    : fd(other.fd)
+    , read_only(other.read_only)
+    , mapping(other.mapping)
+    , mapping_size(other.mapping_size)
+{
+    other.fd = -1;
+    other.mapping = nullptr;
+    other.mapping_size = 0;
+}
+
+mapped_file::~mapped_file() { close(); }
+
+mapped_file &mapped_file::operator=(mapped_file &&other)
+{
+    if (this != &other) {
+        close();
+        fd = other.fd;
+        read_only = other.read_only;
+        mapping = other.mapping;
+        mapping_size = other.mapping_size;
+        other.fd = -1;
+        other.mapping = nullptr;
+        other.mapping_size = 0;
+    }
+    return *this;
+}
+
+size_t mapped_file::size() const { return mapping_size; }
+
+uint8_t *mapped_file::data() { return mapping; }
+
+const uint8_t *mapped_file::data() const { return mapping; }
+
+void mapped_file::resize(size_t new_size)
+{
+    if (read_only) {
+        throw std::runtime_error("cannot resize read-only mapped file");
+    }
+    unmap();
+    if (ftruncate(fd, (off_t)new_size) != 0) {
+        throw system_error("failed to resize mapped file");
+    }
+    mapping_size = new_size;
+    map();
+}
+
+void mapped_file::sync(size_t offset, size_t length) const
+{
+    if (length == 0) {
+        return;
+    }
+
+    // msync requires a page-aligned start address.
+    const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    const size_t aligned_offset = offset - (offset % page_size);
+    if (msync(
+            mapping + aligned_offset,
+            length + (offset - aligned_offset),
+            MS_SYNC) != 0) {
+        throw system_error("failed to sync mapped file");
+    }
+}
+
+void mapped_file::release(size_t offset, size_t length) const
+{
+    if (length == 0) {
+        return;
+    }
+
+    // As for msync, the start address must be page-aligned.
+    const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    const size_t aligned_offset = offset - (offset % page_size);
+    if (madvise(
+            mapping + aligned_offset,
+            length + (offset - aligned_offset),
+            MADV_DONTNEED) != 0) {
+        throw system_error("failed to release mapped file range");
+    }
+}
+
+void mapped_file::close()
+{
+    unmap();
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    mapping_size = 0;
+}
+
+void mapped_file::map()
+{
+    // Empty files cannot be mapped. `mapping` remains null until the file is
+    // resized.
+    if (mapping_size == 0) {
+        return;
+    }
+
+    const int protection = read_only ? PROT_READ : (PROT_READ | PROT_WRITE);
+    void *addr = mmap(nullptr, mapping_size, protection, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        throw system_error("failed to map file");
+    }
+    mapping = (uint8_t *)addr;
+}
+
+void mapped_file::unmap()
+{
+    if (mapping != nullptr) {
+        munmap(mapping, mapping_size);
+        mapping = nullptr;
+    }
+}
+
+void file_write_atomic(const std::string &path, const void *data, size_t size)
+{
+    const std::string tmp_path = path + ".tmp";
+    const int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw system_error("failed to open " + tmp_path);
+    }
+
+    const uint8_t *bytes = (const uint8_t *)data;
+    while (size > 0) {
+        const ssize_t written = ::write(fd, bytes, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ::close(fd);
+            throw system_error("failed to write " + tmp_path);
+        }
+        bytes += written;
+        size -= (size_t)written;
+    }
+
+    file_descriptor_sync(fd);
+    ::close(fd);
+
+    if (::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        throw system_error("failed to rename " + tmp_path);
+    }
+
+    // Flush the directory entry, so that the rename itself is durable.
+    std::string dir_path =
+        boost::filesystem::path(path).parent_path().string();
+    if (dir_path.empty()) {
+        dir_path = ".";
+    }
+    const int dir_fd = ::open(dir_path.c_str(), O_RDONLY);
+    if (dir_fd < 0) {
+        throw system_error("failed to open directory " + dir_path);
+    }
+    file_descriptor_sync(dir_fd);
+    ::close(dir_fd);
+}
+
+void file_descriptor_sync(int fd)
+{
+    if (fsync(fd) != 0) {
+        throw system_error("failed to sync file");
+    }
+}
+
+} // namespace libzeth
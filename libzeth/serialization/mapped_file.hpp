@@ -0,0 +1,76 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#ifndef __ZETH_SERIALIZATION_MAPPED_FILE_HPP__
+#define __ZETH_SERIALIZATION_MAPPED_FILE_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace libzeth
+{
+
+/// A file mapped read-write into memory (POSIX mmap). The file is created if
+/// it does not exist, and can be grown with `resize`, in which case the
+/// mapping (and therefore any pointer obtained from `data`) is invalidated.
+/// Files opened with `read_only` must exist, and are mapped read-only (they
+/// cannot be resized). Errors are reported by throwing `std::runtime_error`.
+class mapped_file
+{
+public:
+    mapped_file();
+    explicit mapped_file(const std::string &path, bool read_only = false);
+    mapped_file(const mapped_file &) = delete;
+    mapped_file(mapped_file &&other);
+    ~mapped_file();
+
+    mapped_file &operator=(const mapped_file &) = delete;
+    mapped_file &operator=(mapped_file &&other);
+
+    /// Size of the file (and of the mapping) in bytes.
+    size_t size() const;
+
+    uint8_t *data();
+    const uint8_t *data() const;
+
+    /// Change the size of the file, and remap it. New bytes are zero.
+    void resize(size_t new_size);
+
+    /// Flush the given byte range of the mapping to disk, returning only once
+    /// the data has been written (msync with MS_SYNC).
+    void sync(size_t offset, size_t length) const;
+
+    /// Indicate that the given byte range of the mapping is not needed in the
+    /// near future, releasing its pages from the resident memory of the
+    /// process (madvise with MADV_DONTNEED). The pages are read from the file
+    /// again if accessed. Must only be used on read-only mappings, or on
+    /// ranges which have been synced.
+    void release(size_t offset, size_t length) const;
+
+    /// Unmap and close the file.
+    void close();
+
+private:
+    void map();
+    void unmap();
+
+    int fd;
+    bool read_only;
+    uint8_t *mapping;
+    size_t mapping_size;
+};
+
+/// Write `size` bytes to `path` such that, after a crash, the file contains
+/// either its old or its new contents. The data is written to a temporary
+/// file which is flushed and renamed over `path`, then the parent directory is
+/// flushed.
+void file_write_atomic(const std::string &path, const void *data, size_t size);
+
+/// Flush the contents of an open file descriptor to disk (fsync).
+void file_descriptor_sync(int fd);
+
+} // namespace libzeth
+
+#endif // __ZETH_SERIALIZATION_MAPPED_FILE_HPP__
@@ -26,18 +26,39 @@ namespace libzeth
 
 zeth_note zeth_note_from_proto(const zeth_proto::ZethNote &note);
 
+/// Encode a G1 point. In the `BYTES` encoding, only the `encoded` field of
+/// the message is set.
 template<typename ppT>
-zeth_proto::Group1Point point_g1_affine_to_proto(const libff::G1<ppT> &point);
+zeth_proto::Group1Point point_g1_affine_to_proto(
+    const libff::G1<ppT> &point,
+    const zeth_proto::ElementEncoding encoding =
+        zeth_proto::ELEMENT_ENCODING_JSON);
 
+/// Decode a G1 point, in whichever encoding the message uses.
 template<typename ppT>
 libff::G1<ppT> point_g1_affine_from_proto(const zeth_proto::Group1Point &point);
 
+/// Encode a G2 point. In the `BYTES` encoding, only the `encoded` field of
+/// the message is set.
 template<typename ppT>
-zeth_proto::Group2Point point_g2_affine_to_proto(const libff::G2<ppT> &point);
+zeth_proto::Group2Point point_g2_affine_to_proto(
+    const libff::G2<ppT> &point,
+    const zeth_proto::ElementEncoding encoding =
+        zeth_proto::ELEMENT_ENCODING_JSON);
 
+/// Decode a G2 point, in whichever encoding the message uses.
 template<typename ppT>
 libff::G2<ppT> point_g2_affine_from_proto(const zeth_proto::Group2Point &point);
 
+/// Concatenate the `bytes` encodings of a vector of field elements.
+template<typename FieldT>
+std::string field_elements_to_bytes(const std::vector<FieldT> &elements);
+
+/// Parse a concatenation of `bytes` encoded field elements. Throws if the
+/// size of `bytes` is not a multiple of the element size.
+template<typename FieldT>
+std::vector<FieldT> field_elements_from_bytes(const std::string &bytes);
+
 template<typename FieldT, size_t TreeDepth>
 joinsplit_input<FieldT, TreeDepth> joinsplit_input_from_proto(
     const zeth_proto::JoinsplitInput &input);
@@ -14,13 +14,20 @@ namespace libzeth
 {
 
 template<typename ppT>
-zeth_proto::Group1Point point_g1_affine_to_proto(const libff::G1<ppT> &point)
+zeth_proto::Group1Point point_g1_affine_to_proto(
+    const libff::G1<ppT> &point, const zeth_proto::ElementEncoding encoding)
 {
     assert(!point.is_zero());
+    zeth_proto::Group1Point res;
+    if (encoding == zeth_proto::ELEMENT_ENCODING_BYTES) {
+        std::string *encoded = res.mutable_encoded();
+        encoded->resize(point_affine_bytes_size<libff::G1<ppT>>());
+        point_affine_to_bytes(point, &(*encoded)[0]);
+        return res;
+    }
+
     libff::G1<ppT> aff = point;
     aff.to_affine_coordinates();
-
-    zeth_proto::Group1Point res;
     res.set_x_coord(field_element_to_json(aff.X));
     res.set_y_coord(field_element_to_json(aff.Y));
     return res;
@@ -30,19 +37,34 @@ template<typename ppT>
 libff::G1<ppT> point_g1_affine_from_proto(const zeth_proto::Group1Point &point)
 {
     using Fq = libff::Fq<ppT>;
+    if (!point.encoded().empty()) {
+        if (point.encoded().size() !=
+            point_affine_bytes_size<libff::G1<ppT>>()) {
+            throw std::invalid_argument("invalid encoded G1 point size");
+        }
+        return point_affine_from_bytes<libff::G1<ppT>>(point.encoded().data());
+    }
+
     Fq x_coordinate = field_element_from_json<Fq>(point.x_coord());
     Fq y_coordinate = field_element_from_json<Fq>(point.y_coord());
     return libff::G1<ppT>(x_coordinate, y_coordinate, Fq::one());
 }
 
 template<typename ppT>
-zeth_proto::Group2Point point_g2_affine_to_proto(const libff::G2<ppT> &point)
+zeth_proto::Group2Point point_g2_affine_to_proto(
+    const libff::G2<ppT> &point, const zeth_proto::ElementEncoding encoding)
 {
     assert(!point.is_zero());
+    zeth_proto::Group2Point res;
+    if (encoding == zeth_proto::ELEMENT_ENCODING_BYTES) {
+        std::string *encoded = res.mutable_encoded();
+        encoded->resize(point_affine_bytes_size<libff::G2<ppT>>());
+        point_affine_to_bytes(point, &(*encoded)[0]);
+        return res;
+    }
+
     libff::G2<ppT> aff = point;
     aff.to_affine_coordinates();
-
-    zeth_proto::Group2Point res;
     res.set_x_coord(field_element_to_json(aff.X));
     res.set_y_coord(field_element_to_json(aff.Y));
     return res;
@@ -52,24 +74,67 @@ template<typename ppT>
 libff::G2<ppT> point_g2_affine_from_proto(const zeth_proto::Group2Point &point)
 {
     using TwistField = typename libff::G2<ppT>::twist_field;
+    if (!point.encoded().empty()) {
+        if (point.encoded().size() !=
+            point_affine_bytes_size<libff::G2<ppT>>()) {
+            throw std::invalid_argument("invalid encoded G2 point size");
+        }
+        return point_affine_from_bytes<libff::G2<ppT>>(point.encoded().data());
+    }
+
     const TwistField X = field_element_from_json<TwistField>(point.x_coord());
     const TwistField Y = field_element_from_json<TwistField>(point.y_coord());
     return libff::G2<ppT>(X, Y, TwistField::one());
 }
 
+template<typename FieldT>
+std::string field_elements_to_bytes(const std::vector<FieldT> &elements)
+{
+    const size_t element_size = field_element_bytes_size<FieldT>();
+    std::string bytes;
+    bytes.resize(elements.size() * element_size);
+    for (size_t i = 0; i < elements.size(); ++i) {
+        field_element_to_bytes(elements[i], &bytes[i * element_size]);
+    }
+    return bytes;
+}
+
+template<typename FieldT>
+std::vector<FieldT> field_elements_from_bytes(const std::string &bytes)
+{
+    const size_t element_size = field_element_bytes_size<FieldT>();
+    if (bytes.size() % element_size != 0) {
+        throw std::invalid_argument("invalid encoded field elements size");
+    }
+
+    const size_t num_elements = bytes.size() / element_size;
+    std::vector<FieldT> elements;
+    elements.reserve(num_elements);
+    for (size_t i = 0; i < num_elements; ++i) {
+        elements.push_back(
+            field_element_from_bytes<FieldT>(bytes.data() + i * element_size));
+    }
+    return elements;
+}
+
 template<typename FieldT, size_t TreeDepth>
 joinsplit_input<FieldT, TreeDepth> joinsplit_input_from_proto(
     const zeth_proto::JoinsplitInput &input)
 {
-    if (TreeDepth != input.merkle_path_size()) {
-        throw std::invalid_argument("Invalid merkle path length");
+    std::vector<FieldT> input_merkle_path;
+    if (!input.encoded_merkle_path().empty()) {
+        input_merkle_path =
+            field_elements_from_bytes<FieldT>(input.encoded_merkle_path());
+    } else {
+        for (int i = 0; i < input.merkle_path_size(); i++) {
+            FieldT mk_node =
+                base_field_element_from_hex<FieldT>(input.merkle_path(i));
+            input_merkle_path.push_back(mk_node);
+        }
     }
 
-    std::vector<FieldT> input_merkle_path;
-    for (size_t i = 0; i < TreeDepth; i++) {
-        FieldT mk_node =
-            base_field_element_from_hex<FieldT>(input.merkle_path(i));
-        input_merkle_path.push_back(mk_node);
+    if (TreeDepth != input_merkle_path.size()) {
+        throw std::invalid_argument("Invalid merkle path length");
     }
 
     return joinsplit_input<FieldT, TreeDepth>(
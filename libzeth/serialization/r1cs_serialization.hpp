@@ -35,10 +35,59 @@ template<typename ppT>
 libsnark::accumulation_vector<libff::G1<ppT>> accumulation_vector_from_json(
     const std::string &acc_vector_str);
 
+/// Concatenate the `bytes` encodings (see group_element_utils) of the points
+/// of an accumulation vector, starting with `first`.
+template<typename ppT>
+std::string accumulation_vector_to_bytes(
+    const libsnark::accumulation_vector<libff::G1<ppT>> &acc_vector);
+
+/// Parse an accumulation vector written by `accumulation_vector_to_bytes`.
+template<typename ppT>
+libsnark::accumulation_vector<libff::G1<ppT>> accumulation_vector_from_bytes(
+    const std::string &acc_vector_bytes);
+
+/// Write the constraint system of a protoboard in JSON. As for
+/// `r1cs_write_bytes`, prefer the `r1cs_constraint_system` overload where
+/// possible, since the protoboard only gives access to a copy.
 template<typename ppT>
 std::ostream &r1cs_write_json(
     const libsnark::protoboard<libff::Fr<ppT>> &pb, std::ostream &out_s);
 
+template<typename ppT>
+std::ostream &r1cs_write_json(
+    const libsnark::r1cs_constraint_system<libff::Fr<ppT>> &constraints,
+    std::ostream &out_s);
+
+/// Write a constraint system in the binary `.r1cs` format of iden3:
+///   https://github.com/iden3/r1csfile/blob/master/doc/r1cs_bin_format.md
+/// Wire `i` corresponds to variable index `i` (wire 0 being the constant
+/// `ONE`), primary inputs are written as public inputs, and auxiliary inputs
+/// as internal wires. Coefficients are written as little-endian integers (not
+/// in Montgomery form). Constraints are streamed to `out_s` without building
+/// an intermediate representation, and the stream need not be seekable.
+template<typename ppT>
+std::ostream &r1cs_write_bytes(
+    const libsnark::r1cs_constraint_system<libff::Fr<ppT>> &r1cs,
+    std::ostream &out_s);
+
+/// Write the constraint system of a protoboard in the binary `.r1cs` format.
+/// Note that the protoboard only gives access to a copy of its constraint
+/// system. Where possible, use the `r1cs_constraint_system` overload.
+template<typename ppT>
+std::ostream &r1cs_write_bytes(
+    const libsnark::protoboard<libff::Fr<ppT>> &pb, std::ostream &out_s);
+
+/// Read a constraint system in the binary `.r1cs` format, as written by
+/// `r1cs_write_bytes` (or any tool producing the iden3 format, in which the
+/// sections may appear in any order). Throws if the file is malformed or uses
+/// a different scalar field. Unknown sections are skipped. The stream must be
+/// seekable, and all counts are checked against the size of the data before
+/// any memory is reserved.
+template<typename ppT>
+std::istream &r1cs_read_bytes(
+    libsnark::r1cs_constraint_system<libff::Fr<ppT>> &r1cs,
+    std::istream &in_s);
+
 } // namespace libzeth
 
 #include "libzeth/serialization/r1cs_serialization.tcc"
@@ -9,12 +9,101 @@
 #include "libzeth/core/group_element_utils.hpp"
 #include "libzeth/serialization/r1cs_serialization.hpp"
 
+#include <cstring>
+#include <gmp.h>
+#include <limits>
+#include <map>
+#include <string>
+
 namespace libzeth
 {
 
 namespace internal
 {
 
+// Section types of the binary r1cs format.
+static const uint32_t R1CS_BYTES_SECTION_HEADER = 1;
+static const uint32_t R1CS_BYTES_SECTION_CONSTRAINTS = 2;
+static const uint32_t R1CS_BYTES_SECTION_WIRE_TO_LABEL = 3;
+
+// Note that, as for the field element encodings in field_element_utils, the
+// following assume a little-endian platform.
+template<typename UIntT> void uint_write_bytes(UIntT v, std::ostream &out_s)
+{
+    out_s.write((const char *)&v, sizeof(v));
+}
+
+template<typename UIntT> UIntT uint_read_bytes(std::istream &in_s)
+{
+    UIntT v;
+    in_s.read((char *)&v, sizeof(v));
+    return v;
+}
+
+template<typename FieldT>
+uint64_t linear_combination_bytes_size(
+    const libsnark::linear_combination<FieldT> &lc)
+{
+    return sizeof(uint32_t) +
+           lc.terms.size() *
+               (sizeof(uint32_t) + sizeof(libff::bigint<FieldT::num_limbs>));
+}
+
+template<typename FieldT>
+void linear_combination_write_bytes(
+    const libsnark::linear_combination<FieldT> &lc, std::ostream &out_s)
+{
+    uint_write_bytes<uint32_t>((uint32_t)lc.terms.size(), out_s);
+    for (const libsnark::linear_term<FieldT> &lt : lc.terms) {
+        uint_write_bytes<uint32_t>((uint32_t)lt.index, out_s);
+        const libff::bigint<FieldT::num_limbs> coeff = lt.coeff.as_bigint();
+        out_s.write((const char *)&coeff.data[0], sizeof(coeff.data));
+    }
+}
+
+// `max_terms` bounds the number of terms (read from the untrusted data) for
+// which memory is reserved.
+template<typename FieldT>
+void linear_combination_read_bytes(
+    libsnark::linear_combination<FieldT> &lc,
+    const size_t num_wires,
+    const size_t max_terms,
+    std::istream &in_s)
+{
+    const uint32_t num_terms = uint_read_bytes<uint32_t>(in_s);
+    if (!in_s) {
+        throw std::runtime_error("unexpected end of r1cs data");
+    }
+    if (num_terms > max_terms) {
+        throw std::invalid_argument("invalid number of terms in r1cs data");
+    }
+    lc.terms.clear();
+    lc.terms.reserve(num_terms);
+    for (uint32_t i = 0; i < num_terms; ++i) {
+        const uint32_t index = uint_read_bytes<uint32_t>(in_s);
+        libff::bigint<FieldT::num_limbs> coeff;
+        in_s.read((char *)&coeff.data[0], sizeof(coeff.data));
+        if (!in_s) {
+            throw std::runtime_error("unexpected end of r1cs data");
+        }
+        if (index >= num_wires) {
+            throw std::invalid_argument("invalid wire index in r1cs data");
+        }
+        if (mpn_cmp(coeff.data, FieldT::mod.data, FieldT::num_limbs) >= 0) {
+            throw std::invalid_argument("invalid coefficient in r1cs data");
+        }
+        lc.terms.emplace_back(libsnark::variable<FieldT>(index), FieldT(coeff));
+    }
+}
+
+// Annotation of a variable or constraint, or an empty string if it has none.
+inline std::string r1cs_annotation(
+    const std::map<size_t, std::string> &annotations, const size_t index)
+{
+    const auto it = annotations.find(index);
+    return (it == annotations.end()) ? std::string() : it->second;
+}
+
 template<typename ppT>
 void constraints_write_json(
     const libsnark::linear_combination<libff::Fr<ppT>> &constraints,
@@ -141,29 +230,76 @@ libsnark::accumulation_vector<libff::G1<ppT>> accumulation_vector_from_json(
         std::move(front), std::move(rest));
 }
 
+template<typename ppT>
+std::string accumulation_vector_to_bytes(
+    const libsnark::accumulation_vector<libff::G1<ppT>> &acc_vector)
+{
+    const size_t point_size = point_affine_bytes_size<libff::G1<ppT>>();
+    const size_t vect_length = acc_vector.rest.indices.size() + 1;
+    std::string bytes;
+    bytes.resize(vect_length * point_size);
+    point_affine_to_bytes(acc_vector.first, &bytes[0]);
+    for (size_t i = 0; i < vect_length - 1; ++i) {
+        point_affine_to_bytes(
+            acc_vector.rest.values[i], &bytes[(i + 1) * point_size]);
+    }
+    return bytes;
+}
+
+template<typename ppT>
+libsnark::accumulation_vector<libff::G1<ppT>> accumulation_vector_from_bytes(
+    const std::string &acc_vector_bytes)
+{
+    const size_t point_size = point_affine_bytes_size<libff::G1<ppT>>();
+    if (acc_vector_bytes.empty() ||
+        acc_vector_bytes.size() % point_size != 0) {
+        throw std::invalid_argument("invalid accumulation vector bytes");
+    }
+
+    const size_t vect_length = acc_vector_bytes.size() / point_size;
+    libff::G1<ppT> front =
+        point_affine_from_bytes<libff::G1<ppT>>(acc_vector_bytes.data());
+    std::vector<libff::G1<ppT>> rest;
+    rest.reserve(vect_length - 1);
+    for (size_t i = 1; i < vect_length; ++i) {
+        rest.push_back(point_affine_from_bytes<libff::G1<ppT>>(
+            acc_vector_bytes.data() + i * point_size));
+    }
+
+    return libsnark::accumulation_vector<libff::G1<ppT>>(
+        std::move(front), std::move(rest));
+}
+
 template<typename ppT>
 std::ostream &r1cs_write_json(
     const libsnark::protoboard<libff::Fr<ppT>> &pb, std::ostream &out_s)
+{
+    return r1cs_write_json<ppT>(pb.get_constraint_system(), out_s);
+}
+
+template<typename ppT>
+std::ostream &r1cs_write_json(
+    const libsnark::r1cs_constraint_system<libff::Fr<ppT>> &constraints,
+    std::ostream &out_s)
 {
     // output inputs, right now need to compile with debug flag so that the
     // `variable_annotations` exists. Having trouble setting that up so will
     // leave for now.
-    libsnark::r1cs_constraint_system<libff::Fr<ppT>> constraints =
-        pb.get_constraint_system();
-
     out_s << "{\n";
     out_s << "\"scalar_field_characteristic\":"
           << "\"Not yet supported. Should be bigint in hexadecimal\""
           << ",\n";
-    out_s << "\"num_variables\":" << pb.num_variables() << ",\n";
-    out_s << "\"num_constraints\":" << pb.num_constraints() << ",\n";
-    out_s << "\"num_inputs\": " << pb.num_inputs() << ",\n";
+    out_s << "\"num_variables\":" << constraints.num_variables() << ",\n";
+    out_s << "\"num_constraints\":" << constraints.num_constraints() << ",\n";
+    out_s << "\"num_inputs\": " << constraints.num_inputs() << ",\n";
     out_s << "\"variables_annotations\":[";
     for (size_t i = 0; i < constraints.num_variables(); ++i) {
         out_s << "{";
         out_s << "\"index\":" << i << ",";
         out_s << "\"annotation\":"
-              << "\"" << constraints.variable_annotations[i].c_str() << "\"";
+              << "\""
+              << internal::r1cs_annotation(constraints.variable_annotations, i)
+              << "\"";
         if (i == constraints.num_variables() - 1) {
             out_s << "}";
         } else {
@@ -176,7 +312,10 @@ std::ostream &r1cs_write_json(
         out_s << "{";
         out_s << "\"constraint_id\": " << c << ",";
         out_s << "\"constraint_annotation\": "
-              << "\"" << constraints.constraint_annotations[c].c_str() << "\",";
+              << "\""
+              << internal::r1cs_annotation(
+                     constraints.constraint_annotations, c)
+              << "\",";
         out_s << "\"linear_combination\":";
         out_s << "{";
         out_s << "\"A\":";
@@ -202,6 +341,208 @@ std::ostream &r1cs_write_json(
     return out_s;
 }
 
+template<typename ppT>
+std::ostream &r1cs_write_bytes(
+    const libsnark::r1cs_constraint_system<libff::Fr<ppT>> &r1cs,
+    std::ostream &out_s)
+{
+    using Field = libff::Fr<ppT>;
+    const uint32_t field_bytes = sizeof(libff::bigint<Field::num_limbs>);
+    const size_t num_wires = r1cs.num_variables() + 1;
+    const size_t num_constraints = r1cs.num_constraints();
+    if (num_wires > std::numeric_limits<uint32_t>::max() ||
+        num_constraints > std::numeric_limits<uint32_t>::max()) {
+        throw std::invalid_argument("constraint system too large for r1cs");
+    }
+
+    out_s.write("r1cs", 4);
+    // Version and number of sections
+    internal::uint_write_bytes<uint32_t>(1, out_s);
+    internal::uint_write_bytes<uint32_t>(3, out_s);
+
+    // Header section
+    internal::uint_write_bytes<uint32_t>(
+        internal::R1CS_BYTES_SECTION_HEADER, out_s);
+    internal::uint_write_bytes<uint64_t>(
+        field_bytes + 5 * sizeof(uint32_t) + sizeof(uint64_t) +
+            sizeof(uint32_t),
+        out_s);
+    internal::uint_write_bytes<uint32_t>(field_bytes, out_s);
+    out_s.write((const char *)&Field::mod.data[0], field_bytes);
+    internal::uint_write_bytes<uint32_t>((uint32_t)num_wires, out_s);
+    // Public outputs, public inputs, private inputs
+    internal::uint_write_bytes<uint32_t>(0, out_s);
+    internal::uint_write_bytes<uint32_t>(
+        (uint32_t)r1cs.primary_input_size, out_s);
+    internal::uint_write_bytes<uint32_t>(0, out_s);
+    // Labels, constraints
+    internal::uint_write_bytes<uint64_t>(num_wires, out_s);
+    internal::uint_write_bytes<uint32_t>((uint32_t)num_constraints, out_s);
+
+    // Constraints section. The section size is computed in a first pass, so
+    // that the constraints can then be streamed directly.
+    uint64_t constraints_size = 0;
+    for (const libsnark::r1cs_constraint<Field> &c : r1cs.constraints) {
+        constraints_size += internal::linear_combination_bytes_size(c.a) +
+                            internal::linear_combination_bytes_size(c.b) +
+                            internal::linear_combination_bytes_size(c.c);
+    }
+    internal::uint_write_bytes<uint32_t>(
+        internal::R1CS_BYTES_SECTION_CONSTRAINTS, out_s);
+    internal::uint_write_bytes<uint64_t>(constraints_size, out_s);
+    for (const libsnark::r1cs_constraint<Field> &c : r1cs.constraints) {
+        internal::linear_combination_write_bytes(c.a, out_s);
+        internal::linear_combination_write_bytes(c.b, out_s);
+        internal::linear_combination_write_bytes(c.c, out_s);
+    }
+
+    // Wire-to-label section (identity map)
+    internal::uint_write_bytes<uint32_t>(
+        internal::R1CS_BYTES_SECTION_WIRE_TO_LABEL, out_s);
+    internal::uint_write_bytes<uint64_t>(num_wires * sizeof(uint64_t), out_s);
+    for (uint64_t wire = 0; wire < num_wires; ++wire) {
+        internal::uint_write_bytes<uint64_t>(wire, out_s);
+    }
+
+    return out_s;
+}
+
+template<typename ppT>
+std::ostream &r1cs_write_bytes(
+    const libsnark::protoboard<libff::Fr<ppT>> &pb, std::ostream &out_s)
+{
+    return r1cs_write_bytes<ppT>(pb.get_constraint_system(), out_s);
+}
+
+template<typename ppT>
+std::istream &r1cs_read_bytes(
+    libsnark::r1cs_constraint_system<libff::Fr<ppT>> &r1cs, std::istream &in_s)
+{
+    using Field = libff::Fr<ppT>;
+    const uint32_t field_bytes = sizeof(libff::bigint<Field::num_limbs>);
+
+    char magic[4];
+    in_s.read(magic, sizeof(magic));
+    if (!in_s || memcmp(magic, "r1cs", sizeof(magic)) != 0) {
+        throw std::invalid_argument("invalid r1cs magic");
+    }
+    if (internal::uint_read_bytes<uint32_t>(in_s) != 1) {
+        throw std::invalid_argument("unsupported r1cs version");
+    }
+    const uint32_t num_sections = internal::uint_read_bytes<uint32_t>(in_s);
+    if (!in_s) {
+        throw std::runtime_error("unexpected end of r1cs data");
+    }
+
+    // Sections may appear in any order, so they are located (and their sizes
+    // checked against the data available) before the header is read. The
+    // stream must therefore be seekable.
+    const std::streamoff sections_begin = in_s.tellg();
+    in_s.seekg(0, std::ios_base::end);
+    const std::streamoff data_end = in_s.tellg();
+    if (sections_begin < 0 || data_end < 0) {
+        throw std::invalid_argument("r1cs data stream must be seekable");
+    }
+    in_s.seekg(sections_begin);
+
+    std::streamoff header_begin = -1;
+    std::streamoff constraints_begin = -1;
+    uint64_t constraints_size = 0;
+    for (uint32_t section = 0; section < num_sections; ++section) {
+        const uint32_t section_type = internal::uint_read_bytes<uint32_t>(in_s);
+        const uint64_t section_size = internal::uint_read_bytes<uint64_t>(in_s);
+        if (!in_s) {
+            throw std::runtime_error("unexpected end of r1cs data");
+        }
+
+        const std::streamoff section_begin = in_s.tellg();
+        if (section_size > (uint64_t)(data_end - section_begin)) {
+            throw std::invalid_argument("invalid r1cs section size");
+        }
+        if (section_type == internal::R1CS_BYTES_SECTION_HEADER) {
+            header_begin = section_begin;
+        } else if (section_type == internal::R1CS_BYTES_SECTION_CONSTRAINTS) {
+            constraints_begin = section_begin;
+            constraints_size = section_size;
+        }
+        // Unknown sections are skipped.
+        in_s.seekg(section_begin + (std::streamoff)section_size);
+    }
+    const std::streamoff sections_end = in_s.tellg();
+
+    if (header_begin < 0) {
+        throw std::invalid_argument("r1cs header missing");
+    }
+    in_s.seekg(header_begin);
+    if (internal::uint_read_bytes<uint32_t>(in_s) != field_bytes) {
+        throw std::invalid_argument("r1cs field size mismatch");
+    }
+    libff::bigint<Field::num_limbs> prime;
+    in_s.read((char *)&prime.data[0], field_bytes);
+    if (prime != Field::mod) {
+        throw std::invalid_argument("r1cs field mismatch");
+    }
+
+    const size_t num_wires = internal::uint_read_bytes<uint32_t>(in_s);
+    const uint32_t num_public_outputs =
+        internal::uint_read_bytes<uint32_t>(in_s);
+    const uint32_t num_public_inputs =
+        internal::uint_read_bytes<uint32_t>(in_s);
+    // Private inputs and labels are not distinguished from other auxiliary
+    // inputs.
+    internal::uint_read_bytes<uint32_t>(in_s);
+    internal::uint_read_bytes<uint64_t>(in_s);
+    const size_t num_constraints = internal::uint_read_bytes<uint32_t>(in_s);
+    if (!in_s) {
+        throw std::runtime_error("unexpected end of r1cs data");
+    }
+
+    const size_t num_primary =
+        (size_t)num_public_outputs + (size_t)num_public_inputs;
+    if (num_wires < num_primary + 1) {
+        throw std::invalid_argument("invalid r1cs header");
+    }
+    r1cs.primary_input_size = num_primary;
+    r1cs.auxiliary_input_size = num_wires - num_primary - 1;
+
+    // Each constraint holds at least the term counts of its 3 linear
+    // combinations, and each term an index and a coefficient, which bounds
+    // the memory reserved for the counts in the (untrusted) data.
+    r1cs.constraints.clear();
+    if (num_constraints != 0) {
+        const size_t min_constraint_size = 3 * sizeof(uint32_t);
+        const size_t term_size = sizeof(uint32_t) + field_bytes;
+        if (constraints_begin < 0 ||
+            num_constraints > constraints_size / min_constraint_size) {
+            throw std::invalid_argument("invalid r1cs constraints section");
+        }
+        const size_t max_terms = constraints_size / term_size;
+
+        in_s.seekg(constraints_begin);
+        r1cs.constraints.reserve(num_constraints);
+        libsnark::linear_combination<Field> a;
+        libsnark::linear_combination<Field> b;
+        libsnark::linear_combination<Field> c;
+        for (size_t i = 0; i < num_constraints; ++i) {
+            internal::linear_combination_read_bytes(
+                a, num_wires, max_terms, in_s);
+            internal::linear_combination_read_bytes(
+                b, num_wires, max_terms, in_s);
+            internal::linear_combination_read_bytes(
+                c, num_wires, max_terms, in_s);
+            r1cs.constraints.emplace_back(a, b, c);
+        }
+        const std::streamoff constraints_end =
+            constraints_begin + (std::streamoff)constraints_size;
+        if (in_s.tellg() > constraints_end) {
+            throw std::invalid_argument("invalid r1cs constraints section");
+        }
+    }
+
+    in_s.seekg(sections_end);
+    return in_s;
+}
+
 } // namespace libzeth
 
 #endif // __ZETH_SERIALIZATION_R1CS_SERIALIZATION_TCC__
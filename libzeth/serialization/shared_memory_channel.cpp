@@ -0,0 +1,119 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#include "libzeth/serialization/shared_memory_channel.hpp"
+
+#include <stdexcept>
+
+namespace libzeth
+{
+
+namespace
+{
+
+/// Header preceding the payload of each response.
+class response_header
+{
+public:
+    uint32_t status;
+    uint32_t reserved;
+};
+
+std::string requests_ring_name(const std::string &name)
+{
+    return name + "_requests";
+}
+
+std::string responses_ring_name(const std::string &name)
+{
+    return name + "_responses";
+}
+
+} // namespace
+
+shared_memory_channel_server::shared_memory_channel_server(
+    const std::string &name, size_t capacity)
+    : requests(requests_ring_name(name), capacity)
+    , responses(responses_ring_name(name), capacity)
+    , reserved_response(nullptr)
+{
+}
+
+bool shared_memory_channel_server::receive_request(
+    const void *&data, size_t &size, const std::chrono::microseconds timeout)
+{
+    return requests.read(data, size, timeout);
+}
+
+void shared_memory_channel_server::release_request() { requests.release(); }
+
+size_t shared_memory_channel_server::max_response_size() const
+{
+    return responses.max_message_size() - sizeof(response_header);
+}
+
+void *shared_memory_channel_server::reserve_response(
+    size_t size, const std::chrono::microseconds timeout)
+{
+    reserved_response =
+        responses.reserve(sizeof(response_header) + size, timeout);
+    if (reserved_response == nullptr) {
+        return nullptr;
+    }
+    return (response_header *)reserved_response + 1;
+}
+
+void shared_memory_channel_server::publish_response(
+    uint32_t status, size_t size)
+{
+    // The header directly precedes the payload returned by reserve_response.
+    response_header *header = (response_header *)reserved_response;
+    header->status = status;
+    header->reserved = 0;
+    responses.publish(sizeof(response_header) + size);
+}
+
+shared_memory_channel_client::shared_memory_channel_client(
+    const std::string &name)
+    : requests(requests_ring_name(name)), responses(responses_ring_name(name))
+{
+}
+
+void *shared_memory_channel_client::reserve_request(
+    size_t size, const std::chrono::microseconds timeout)
+{
+    return requests.reserve(size, timeout);
+}
+
+void shared_memory_channel_client::publish_request(size_t size)
+{
+    requests.publish(size);
+}
+
+bool shared_memory_channel_client::receive_response(
+    uint32_t &status,
+    const void *&data,
+    size_t &size,
+    const std::chrono::microseconds timeout)
+{
+    const void *message;
+    size_t message_size;
+    if (!responses.read(message, message_size, timeout)) {
+        return false;
+    }
+    if (message_size < sizeof(response_header)) {
+        responses.release();
+        throw std::runtime_error("invalid shared memory channel response");
+    }
+
+    const response_header *header = (const response_header *)message;
+    status = header->status;
+    data = header + 1;
+    size = message_size - sizeof(response_header);
+    return true;
+}
+
+void shared_memory_channel_client::release_response() { responses.release(); }
+
+} // namespace libzeth
@@ -0,0 +1,77 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#ifndef __ZETH_SERIALIZATION_SHARED_MEMORY_CHANNEL_HPP__
+#define __ZETH_SERIALIZATION_SHARED_MEMORY_CHANNEL_HPP__
+
+#include "libzeth/serialization/shared_memory_ring.hpp"
+
+namespace libzeth
+{
+
+/// Request / response channel between a server and a single client on the
+/// same host, made of two shared_memory_rings: `<name>_requests` and
+/// `<name>_responses`. The client may send several requests before reading
+/// the responses, which are returned in the order of the requests. Each
+/// response carries a status code (0 indicating success), whose meaning is
+/// defined by the server.
+///
+/// Requests and responses are written and read in place (see
+/// shared_memory_ring).
+class shared_memory_channel_server
+{
+public:
+    /// Create the rings of the channel, each with the given capacity.
+    shared_memory_channel_server(const std::string &name, size_t capacity);
+
+    /// Wait for up to `timeout` for a request (see shared_memory_ring::read).
+    bool receive_request(
+        const void *&data,
+        size_t &size,
+        const std::chrono::microseconds timeout);
+    void release_request();
+
+    /// The largest response payload which can be sent.
+    size_t max_response_size() const;
+
+    /// Reserve space for, and publish, a response (see
+    /// shared_memory_ring::reserve).
+    void *reserve_response(
+        size_t size, const std::chrono::microseconds timeout);
+    void publish_response(uint32_t status, size_t size);
+
+private:
+    shared_memory_ring requests;
+    shared_memory_ring responses;
+    void *reserved_response;
+};
+
+class shared_memory_channel_client
+{
+public:
+    /// Open the rings of the channel created by the server.
+    explicit shared_memory_channel_client(const std::string &name);
+
+    /// Reserve space for, and publish, a request (see
+    /// shared_memory_ring::reserve).
+    void *reserve_request(size_t size, const std::chrono::microseconds timeout);
+    void publish_request(size_t size);
+
+    /// Wait for up to `timeout` for the next response (see
+    /// shared_memory_ring::read).
+    bool receive_response(
+        uint32_t &status,
+        const void *&data,
+        size_t &size,
+        const std::chrono::microseconds timeout);
+    void release_response();
+
+private:
+    shared_memory_ring requests;
+    shared_memory_ring responses;
+};
+
+} // namespace libzeth
+
+#endif // __ZETH_SERIALIZATION_SHARED_MEMORY_CHANNEL_HPP__
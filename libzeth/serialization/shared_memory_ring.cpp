@@ -0,0 +1,322 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#include "libzeth/serialization/shared_memory_ring.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+// The positions in the header are accessed by several processes, which is
+// only valid if the atomic operations do not rely on a lock.
+static_assert(
+    ATOMIC_LLONG_LOCK_FREE == 2,
+    "shared_memory_ring requires lock-free atomics");
+
+namespace libzeth
+{
+
+static const uint64_t SHARED_MEMORY_RING_MAGIC = 0x474e525f4854455aull;
+
+static const uint32_t RECORD_MESSAGE = 0;
+static const uint32_t RECORD_PADDING = 1;
+
+/// Header of the shared memory segment. The write and read positions are
+/// byte counts which only increase, and are held in separate cache lines so
+/// that the writer and reader do not contend for them.
+class shared_memory_ring::header
+{
+public:
+    uint64_t magic;
+    uint64_t capacity;
+    alignas(64) std::atomic<uint64_t> head;
+    alignas(64) std::atomic<uint64_t> tail;
+};
+
+namespace
+{
+
+/// Header of each record (message or padding) in the ring. Records start at
+/// multiples of 8 bytes.
+class record_header
+{
+public:
+    uint32_t size;
+    uint32_t type;
+};
+
+static_assert(sizeof(record_header) == 8, "unexpected record_header size");
+
+size_t record_size(const size_t message_size)
+{
+    return sizeof(record_header) + ((message_size + 7) & ~(size_t)7);
+}
+
+std::runtime_error system_error(const std::string &what)
+{
+    return std::runtime_error(what + ": " + strerror(errno));
+}
+
+/// Waits by spinning, then yielding, then sleeping, so that short waits have
+/// a low latency and long waits do not occupy a core.
+class backoff
+{
+public:
+    backoff() : iterations(0) {}
+
+    void wait()
+    {
+        ++iterations;
+        if (iterations < 64) {
+            return;
+        }
+        if (iterations < 1024) {
+            std::this_thread::yield();
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+
+private:
+    size_t iterations;
+};
+
+} // namespace
+
+shared_memory_ring::shared_memory_ring(
+    const std::string &name, size_t capacity)
+    : name(name)
+    , owner(true)
+    , fd(-1)
+    , mapping(nullptr)
+    , mapping_size(0)
+    , capacity((capacity + 7) & ~(size_t)7)
+    , reserved_position(0)
+    , read_position(0)
+    , read_size(0)
+{
+    // Record sizes are held in 32 bits.
+    if (this->capacity < 2 * sizeof(record_header) ||
+        this->capacity > UINT32_MAX) {
+        throw std::invalid_argument("invalid shared memory ring capacity");
+    }
+
+    fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        throw system_error("failed to create shared memory " + name);
+    }
+
+    const size_t size = sizeof(header) + this->capacity;
+    if (ftruncate(fd, (off_t)size) != 0) {
+        ::close(fd);
+        shm_unlink(name.c_str());
+        throw system_error("failed to resize shared memory " + name);
+    }
+    map(size);
+
+    header *h = ring_header();
+    h->capacity = this->capacity;
+    h->head.store(0, std::memory_order_relaxed);
+    h->tail.store(0, std::memory_order_relaxed);
+    h->magic = SHARED_MEMORY_RING_MAGIC;
+}
+
+shared_memory_ring::shared_memory_ring(const std::string &name)
+    : name(name)
+    , owner(false)
+    , fd(-1)
+    , mapping(nullptr)
+    , mapping_size(0)
+    , capacity(0)
+    , reserved_position(0)
+    , read_position(0)
+    , read_size(0)
+{
+    fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        throw system_error("failed to open shared memory " + name);
+    }
+
+    struct stat segment_stat;
+    if (fstat(fd, &segment_stat) != 0) {
+        ::close(fd);
+        throw system_error("failed to stat shared memory " + name);
+    }
+    if ((size_t)segment_stat.st_size < sizeof(header)) {
+        ::close(fd);
+        throw std::runtime_error("invalid shared memory ring " + name);
+    }
+    map((size_t)segment_stat.st_size);
+
+    const header *h = ring_header();
+    if (h->magic != SHARED_MEMORY_RING_MAGIC ||
+        h->capacity != mapping_size - sizeof(header)) {
+        munmap(mapping, mapping_size);
+        ::close(fd);
+        throw std::runtime_error("invalid shared memory ring " + name);
+    }
+    capacity = h->capacity;
+}
+
+shared_memory_ring::~shared_memory_ring()
+{
+    if (mapping != nullptr) {
+        munmap(mapping, mapping_size);
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    if (owner) {
+        shm_unlink(name.c_str());
+    }
+}
+
+size_t shared_memory_ring::max_message_size() const
+{
+    return capacity - sizeof(record_header);
+}
+
+void *shared_memory_ring::reserve(
+    size_t size, const std::chrono::microseconds timeout)
+{
+    if (size > max_message_size()) {
+        throw std::invalid_argument("message too large for shared memory ring");
+    }
+
+    header *h = ring_header();
+    uint64_t head = h->head.load(std::memory_order_relaxed);
+    const std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + timeout;
+    auto wait_for_space = [this, h, &head, deadline](size_t space) -> bool {
+        backoff b;
+        while (capacity - (head - h->tail.load(std::memory_order_acquire)) <
+               space) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                return false;
+            }
+            b.wait();
+        }
+        return true;
+    };
+
+    // Messages are contiguous. If the message does not fit before the end of
+    // the ring, publish a padding record covering the remaining space, so
+    // that the message starts at the beginning of the ring.
+    const size_t required = record_size(size);
+    const size_t offset = head % capacity;
+    if (offset + required > capacity) {
+        const size_t padding = capacity - offset;
+        if (!wait_for_space(padding)) {
+            return nullptr;
+        }
+        record_header *padding_record =
+            (record_header *)(ring_data() + offset);
+        padding_record->size = (uint32_t)padding;
+        padding_record->type = RECORD_PADDING;
+        head += padding;
+        h->head.store(head, std::memory_order_release);
+    }
+
+    if (!wait_for_space(required)) {
+        return nullptr;
+    }
+    reserved_position = head;
+    return ring_data() + (head % capacity) + sizeof(record_header);
+}
+
+void shared_memory_ring::publish(size_t size)
+{
+    record_header *record =
+        (record_header *)(ring_data() + (reserved_position % capacity));
+    record->size = (uint32_t)size;
+    record->type = RECORD_MESSAGE;
+    ring_header()->head.store(
+        reserved_position + record_size(size), std::memory_order_release);
+}
+
+bool shared_memory_ring::read(
+    const void *&data, size_t &size, const std::chrono::microseconds timeout)
+{
+    header *h = ring_header();
+    uint64_t tail = h->tail.load(std::memory_order_relaxed);
+    uint64_t head = tail;
+    const std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + timeout;
+    backoff b;
+    while (true) {
+        if (head == tail) {
+            head = h->head.load(std::memory_order_acquire);
+        }
+        if (head == tail) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                return false;
+            }
+            b.wait();
+            continue;
+        }
+
+        // The record is written by another process, so its header is copied
+        // and checked before use: the record must have been published, and
+        // must not extend past the end of the ring.
+        const size_t offset = tail % capacity;
+        const record_header record =
+            *(const record_header *)(ring_data() + offset);
+        const size_t record_bytes = (record.type == RECORD_PADDING)
+                                        ? record.size
+                                        : record_size(record.size);
+        if ((record.type != RECORD_MESSAGE && record.type != RECORD_PADDING) ||
+            record_bytes == 0 || (record_bytes & 7) != 0 ||
+            record_bytes > capacity - offset || record_bytes > head - tail) {
+            throw std::runtime_error("invalid record in shared memory ring");
+        }
+
+        if (record.type == RECORD_PADDING) {
+            tail += record_bytes;
+            h->tail.store(tail, std::memory_order_release);
+            continue;
+        }
+
+        data = ring_data() + offset + sizeof(record_header);
+        size = record.size;
+        read_position = tail;
+        read_size = record_bytes;
+        return true;
+    }
+}
+
+void shared_memory_ring::release()
+{
+    ring_header()->tail.store(
+        read_position + read_size, std::memory_order_release);
+}
+
+shared_memory_ring::header *shared_memory_ring::ring_header()
+{
+    return (header *)mapping;
+}
+
+uint8_t *shared_memory_ring::ring_data() { return mapping + sizeof(header); }
+
+void shared_memory_ring::map(size_t size)
+{
+    void *m = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (m == MAP_FAILED) {
+        ::close(fd);
+        fd = -1;
+        if (owner) {
+            shm_unlink(name.c_str());
+        }
+        throw system_error("failed to map shared memory " + name);
+    }
+    mapping = (uint8_t *)m;
+    mapping_size = size;
+}
+
+} // namespace libzeth
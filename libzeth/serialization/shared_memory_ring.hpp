@@ -0,0 +1,96 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#ifndef __ZETH_SERIALIZATION_SHARED_MEMORY_RING_HPP__
+#define __ZETH_SERIALIZATION_SHARED_MEMORY_RING_HPP__
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace libzeth
+{
+
+/// Queue of variable-size messages held in a POSIX shared memory segment, used
+/// by processes on the same host to exchange large messages without copying
+/// them through a socket. There must be a single writer and a single reader.
+///
+/// Messages are written and read in place. The writer reserves space for a
+/// message with `reserve`, writes the message directly into the ring and
+/// makes it visible to the reader with `publish`. The reader obtains a
+/// pointer to the next message with `read`, and frees its space with
+/// `release` once it has finished with it.
+///
+/// Waiting (for space, or for a message) is implemented by polling, with a
+/// backoff, so that neither side makes system calls while traffic is
+/// flowing. Errors are reported by throwing `std::runtime_error`.
+class shared_memory_ring
+{
+public:
+    /// Create a ring holding up to `capacity` bytes of messages (including an
+    /// 8 byte header per message), in a new shared memory segment `name` (a
+    /// name as accepted by shm_open, such as "/zeth_ring"). The segment is
+    /// removed when the ring is destroyed.
+    shared_memory_ring(const std::string &name, size_t capacity);
+
+    /// Open the ring in the existing shared memory segment `name`.
+    explicit shared_memory_ring(const std::string &name);
+
+    shared_memory_ring(const shared_memory_ring &) = delete;
+    ~shared_memory_ring();
+
+    shared_memory_ring &operator=(const shared_memory_ring &) = delete;
+
+    /// The largest message which can be written to the ring.
+    size_t max_message_size() const;
+
+    /// Wait for up to `timeout` for space for a message of up to `size`
+    /// bytes, and return a pointer to it (or nullptr if the reader did not
+    /// free enough space in time). The message is not visible to the reader
+    /// until `publish` is called. Throws `std::invalid_argument` if `size` is
+    /// greater than max_message_size().
+    void *reserve(size_t size, const std::chrono::microseconds timeout);
+
+    /// Publish the message written to the space returned by the last call to
+    /// `reserve`. `size` may be smaller than the size which was reserved.
+    void publish(size_t size);
+
+    /// Wait for up to `timeout` for a message. If one is available, point
+    /// `data` and `size` to it and return true. The message remains valid
+    /// until `release` is called. Throws `std::runtime_error` if the ring
+    /// holds an invalid record.
+    bool read(
+        const void *&data,
+        size_t &size,
+        const std::chrono::microseconds timeout);
+
+    /// Free the space of the message returned by the last call to `read`.
+    void release();
+
+private:
+    class header;
+
+    header *ring_header();
+    uint8_t *ring_data();
+
+    void map(size_t mapping_size);
+
+    const std::string name;
+    const bool owner;
+    int fd;
+    uint8_t *mapping;
+    size_t mapping_size;
+    size_t capacity;
+
+    // Position at which the reserved message starts (writer), or of the
+    // message being read (reader).
+    uint64_t reserved_position;
+    uint64_t read_position;
+    uint64_t read_size;
+};
+
+} // namespace libzeth
+
+#endif // __ZETH_SERIALIZATION_SHARED_MEMORY_RING_HPP__
@@ -16,17 +16,16 @@ namespace libzeth
 template<typename ppT>
 void groth16_api_handler<ppT>::verification_key_to_proto(
     const typename groth16_api_handler<ppT>::snark::verification_key &vk,
-    zeth_proto::VerificationKey *message)
+    zeth_proto::VerificationKey *message,
+    const zeth_proto::ElementEncoding encoding)
 {
     zeth_proto::Group1Point *alpha = new zeth_proto::Group1Point();
     zeth_proto::Group2Point *beta = new zeth_proto::Group2Point();
     zeth_proto::Group2Point *delta = new zeth_proto::Group2Point();
 
-    alpha->CopyFrom(point_g1_affine_to_proto<ppT>(vk.alpha_g1));
-    beta->CopyFrom(point_g2_affine_to_proto<ppT>(vk.beta_g2));
-    delta->CopyFrom(point_g2_affine_to_proto<ppT>(vk.delta_g2));
-
-    std::string abc_json_str = accumulation_vector_to_json<ppT>(vk.ABC_g1);
+    alpha->CopyFrom(point_g1_affine_to_proto<ppT>(vk.alpha_g1, encoding));
+    beta->CopyFrom(point_g2_affine_to_proto<ppT>(vk.beta_g2, encoding));
+    delta->CopyFrom(point_g2_affine_to_proto<ppT>(vk.delta_g2, encoding));
 
     // Note on memory safety: set_allocated deleted the allocated objects
     // See:
@@ -37,7 +36,13 @@ void groth16_api_handler<ppT>::verification_key_to_proto(
     grpc_verification_key_groth16->set_allocated_alpha_g1(alpha);
     grpc_verification_key_groth16->set_allocated_beta_g2(beta);
     grpc_verification_key_groth16->set_allocated_delta_g2(delta);
-    grpc_verification_key_groth16->set_abc_g1(abc_json_str);
+    if (encoding == zeth_proto::ELEMENT_ENCODING_BYTES) {
+        grpc_verification_key_groth16->set_encoded_abc_g1(
+            accumulation_vector_to_bytes<ppT>(vk.ABC_g1));
+    } else {
+        grpc_verification_key_groth16->set_abc_g1(
+            accumulation_vector_to_json<ppT>(vk.ABC_g1));
+    }
 }
 
 template<typename ppT>
@@ -56,7 +61,9 @@ typename groth16_snark<ppT>::verification_key groth16_api_handler<
         point_g2_affine_from_proto<ppT>(verif_key.delta_g2());
 
     libsnark::accumulation_vector<libff::G1<ppT>> abc_g1 =
-        accumulation_vector_from_json<ppT>(verif_key.abc_g1());
+        verif_key.encoded_abc_g1().empty()
+            ? accumulation_vector_from_json<ppT>(verif_key.abc_g1())
+            : accumulation_vector_from_bytes<ppT>(verif_key.encoded_abc_g1());
 
     libsnark::r1cs_gg_ppzksnark_verification_key<ppT> vk(
         alpha_g1, beta_g2, delta_g2, abc_g1);
@@ -67,7 +74,8 @@ typename groth16_snark<ppT>::verification_key groth16_api_handler<
 template<typename ppT>
 void groth16_api_handler<ppT>::extended_proof_to_proto(
     const extended_proof<ppT, groth16_api_handler<ppT>::snark> &ext_proof,
-    zeth_proto::ExtendedProof *message)
+    zeth_proto::ExtendedProof *message,
+    const zeth_proto::ElementEncoding encoding)
 {
     const libsnark::r1cs_gg_ppzksnark_proof<ppT> &proof_obj =
         ext_proof.get_proof();
@@ -76,12 +84,9 @@ void groth16_api_handler<ppT>::extended_proof_to_proto(
     zeth_proto::Group2Point *b = new zeth_proto::Group2Point();
     zeth_proto::Group1Point *c = new zeth_proto::Group1Point();
 
-    a->CopyFrom(point_g1_affine_to_proto<ppT>(proof_obj.g_A));
-    b->CopyFrom(point_g2_affine_to_proto<ppT>(proof_obj.g_B));
-    c->CopyFrom(point_g1_affine_to_proto<ppT>(proof_obj.g_C));
-
-    std::stringstream ss;
-    primary_inputs_write_json(ext_proof.get_primary_inputs(), ss);
+    a->CopyFrom(point_g1_affine_to_proto<ppT>(proof_obj.g_A, encoding));
+    b->CopyFrom(point_g2_affine_to_proto<ppT>(proof_obj.g_B, encoding));
+    c->CopyFrom(point_g1_affine_to_proto<ppT>(proof_obj.g_C, encoding));
 
     // Note on memory safety: set_allocated deleted the allocated objects.
     // See:
@@ -92,7 +97,14 @@ void groth16_api_handler<ppT>::extended_proof_to_proto(
     grpc_extended_groth16_proof_obj->set_allocated_a(a);
     grpc_extended_groth16_proof_obj->set_allocated_b(b);
     grpc_extended_groth16_proof_obj->set_allocated_c(c);
-    grpc_extended_groth16_proof_obj->set_inputs(ss.str());
+    if (encoding == zeth_proto::ELEMENT_ENCODING_BYTES) {
+        grpc_extended_groth16_proof_obj->set_encoded_inputs(
+            field_elements_to_bytes(ext_proof.get_primary_inputs()));
+    } else {
+        std::stringstream ss;
+        primary_inputs_write_json(ext_proof.get_primary_inputs(), ss);
+        grpc_extended_groth16_proof_obj->set_inputs(ss.str());
+    }
 }
 
 template<typename ppT>
@@ -106,8 +118,13 @@ libzeth::extended_proof<ppT, groth16_snark<ppT>> groth16_api_handler<
     libff::G1<ppT> c = point_g1_affine_from_proto<ppT>(e_proof.c());
 
     std::vector<libff::Fr<ppT>> inputs;
-    std::stringstream ss(e_proof.inputs());
-    primary_inputs_read_json(inputs, ss);
+    if (!e_proof.encoded_inputs().empty()) {
+        inputs = field_elements_from_bytes<libff::Fr<ppT>>(
+            e_proof.encoded_inputs());
+    } else {
+        std::stringstream ss(e_proof.inputs());
+        primary_inputs_read_json(inputs, ss);
+    }
 
     libsnark::r1cs_gg_ppzksnark_proof<ppT> proof(
         std::move(a), std::move(b), std::move(c));
@@ -0,0 +1,90 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#ifndef __ZETH_SNARKS_GROTH16_GROTH16_PROVER_HPP__
+#define __ZETH_SNARKS_GROTH16_GROTH16_PROVER_HPP__
+
+#include "libzeth/core/cancellation.hpp"
+#include "libzeth/core/include_libsnark.hpp"
+#include "libzeth/core/proof_progress.hpp"
+#include "libzeth/core/proof_rng.hpp"
+#include "libzeth/snarks/groth16/groth16_prover_context.hpp"
+
+namespace libzeth
+{
+
+/// Compute the coefficients of H = (A.B - C) / Z, where A, B and C are the
+/// QAP polynomials of `cs` (over a power-of-2 evaluation domain) evaluated at
+/// `padded_assignment` (the full variable assignment, preceded by the value 1
+/// for the constant variable). Matches the `coefficients_for_H` of
+/// `libsnark::r1cs_to_qap_witness_map` (with d1 = d2 = d3 = 0), except that
+/// only the `m` coefficients of the domain are returned.
+///
+/// The domain data (see groth16_prover_context) is computed as it is used
+/// rather than stored, so that only the two buffers of `m` elements used for
+/// the evaluations are allocated. `cancel` (which may be null) is checked
+/// before each FFT.
+template<typename FieldT>
+std::vector<FieldT> qap_compute_h_coefficients(
+    const libsnark::r1cs_constraint_system<FieldT> &cs,
+    const std::vector<FieldT> &padded_assignment,
+    const cancellation_token *cancel);
+
+/// As above, using the precomputed domain data of `context` (created for a
+/// constraint system of the same size as `cs`), and computing the
+/// coefficients in place in `buffers.a` (using `buffers.b` as scratch space),
+/// so that no memory is allocated.
+template<typename FieldT>
+void qap_compute_h_coefficients(
+    const libsnark::r1cs_constraint_system<FieldT> &cs,
+    const std::vector<FieldT> &padded_assignment,
+    const groth16_prover_context<FieldT> &context,
+    typename groth16_prover_context<FieldT>::scratch_buffers &buffers,
+    const cancellation_token *cancel);
+
+/// Groth16 prover. Generates the same proofs as
+/// `libsnark::r1cs_gg_ppzksnark_prover` (with a power-of-2 domain), but checks
+/// `cancel` (which may be null) between each expensive stage, throwing
+/// `operation_cancelled` if the proof is no longer required. If `progress` is
+/// not null, it is notified (on the calling thread) as the polynomial H and
+/// each multi-exponentiation are computed.
+///
+/// H is computed on a separate thread, using a quarter of the OpenMP threads,
+/// concurrently with the A, B and L multi-exponentiations (which only depend
+/// on the witness), which use the remaining threads. The H multi-exponentiation
+/// then runs on all threads. As a result, `proof_stage_h_computed` may be
+/// reported after some of the multi-exponentiations. The proof does not depend
+/// on the scheduling: for a given randomness, it is identical to that of the
+/// sequential prover.
+///
+/// The blinding factors r and s are sampled from `rng` or, if it is null, from
+/// a proof_rng seeded from the operating system for this proof only, so that
+/// concurrent proofs share no RNG state. Proofs generated with identically
+/// seeded sources are identical.
+template<typename ppT>
+libsnark::r1cs_gg_ppzksnark_proof<ppT> groth16_generate_proof(
+    const libsnark::r1cs_gg_ppzksnark_proving_key<ppT> &proving_key,
+    const libsnark::r1cs_primary_input<libff::Fr<ppT>> &primary_input,
+    const libsnark::r1cs_auxiliary_input<libff::Fr<ppT>> &auxiliary_input,
+    const cancellation_token *cancel,
+    proof_progress_listener *progress = nullptr,
+    proof_rng *rng = nullptr);
+
+/// As above, using `context` (created for the constraint system of
+/// `proving_key`), which should be kept for all proofs with the same key.
+template<typename ppT>
+libsnark::r1cs_gg_ppzksnark_proof<ppT> groth16_generate_proof(
+    const libsnark::r1cs_gg_ppzksnark_proving_key<ppT> &proving_key,
+    const libsnark::r1cs_primary_input<libff::Fr<ppT>> &primary_input,
+    const libsnark::r1cs_auxiliary_input<libff::Fr<ppT>> &auxiliary_input,
+    groth16_prover_context<libff::Fr<ppT>> &context,
+    const cancellation_token *cancel,
+    proof_progress_listener *progress = nullptr,
+    proof_rng *rng = nullptr);
+
+} // namespace libzeth
+
+#include "libzeth/snarks/groth16/groth16_prover.tcc"
+
+#endif // __ZETH_SNARKS_GROTH16_GROTH16_PROVER_HPP__
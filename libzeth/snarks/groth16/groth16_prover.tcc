@@ -0,0 +1,428 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#ifndef __ZETH_SNARKS_GROTH16_GROTH16_PROVER_TCC__
+#define __ZETH_SNARKS_GROTH16_GROTH16_PROVER_TCC__
+
+#include "libzeth/snarks/groth16/groth16_prover.hpp"
+
+#include "libzeth/core/multi_exp.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <memory>
+#ifdef MULTICORE
+#include <omp.h>
+#endif
+
+namespace libzeth
+{
+
+namespace internal
+{
+
+// Evaluate a linear combination on an assignment which includes the value of
+// the constant variable at index 0 (so that no copy of the assignment without
+// it is required).
+template<typename FieldT>
+FieldT linear_combination_evaluate_padded(
+    const libsnark::linear_combination<FieldT> &lc,
+    const std::vector<FieldT> &padded_assignment)
+{
+    FieldT result = FieldT::zero();
+    for (const libsnark::linear_term<FieldT> &term : lc.terms) {
+        result += padded_assignment[term.index] * term.coeff;
+    }
+    return result;
+}
+
+// Write the evaluations of one of the QAP polynomials A, B, C (selected by
+// `lc_member`) on the domain, before interpolation, to `evaluations`.
+template<typename FieldT>
+void qap_evaluations(
+    const libsnark::r1cs_constraint_system<FieldT> &cs,
+    const std::vector<FieldT> &padded_assignment,
+    libsnark::linear_combination<FieldT> libsnark::r1cs_constraint<
+        FieldT>::*lc_member,
+    std::vector<FieldT> &evaluations)
+{
+    const size_t num_constraints = cs.num_constraints();
+#ifdef MULTICORE
+#pragma omp parallel for
+#endif
+    for (size_t i = 0; i < evaluations.size(); ++i) {
+        evaluations[i] = (i < num_constraints)
+                             ? linear_combination_evaluate_padded(
+                                   cs.constraints[i].*lc_member,
+                                   padded_assignment)
+                             : FieldT::zero();
+    }
+}
+
+// Sample the blinding factors r and s of a proof from `rng` or, if it is null,
+// from a proof_rng seeded from the operating system.
+template<typename FieldT>
+void groth16_blinding_factors(proof_rng *rng, FieldT &r, FieldT &s)
+{
+    if (rng == nullptr) {
+        proof_rng os_rng;
+        groth16_blinding_factors(&os_rng, r, s);
+        return;
+    }
+
+    r = rng->random_element<FieldT>();
+    s = rng->random_element<FieldT>();
+}
+
+// Sets the number of threads of the OpenMP teams started by the calling
+// thread, restoring the previous number when destroyed.
+class omp_num_threads_scope
+{
+public:
+    explicit omp_num_threads_scope(const size_t num_threads)
+        : previous_num_threads(1)
+    {
+#ifdef MULTICORE
+        previous_num_threads = omp_get_max_threads();
+        omp_set_num_threads((int)num_threads);
+#else
+        (void)num_threads;
+#endif
+    }
+
+    omp_num_threads_scope(const omp_num_threads_scope &) = delete;
+
+    ~omp_num_threads_scope()
+    {
+#ifdef MULTICORE
+        omp_set_num_threads(previous_num_threads);
+#endif
+    }
+
+    omp_num_threads_scope &operator=(const omp_num_threads_scope &) = delete;
+
+private:
+    int previous_num_threads;
+};
+
+} // namespace internal
+
+namespace internal
+{
+
+// Compute the coefficients of H into `buffers.a` (see
+// qap_compute_h_coefficients) for a constraint system with `num_constraints`
+// constraints and `num_inputs` primary inputs, where `evaluate(lc,
+// evaluations)` writes the evaluations of the linear combinations A, B or C
+// (`lc` = 0, 1 or 2) of the constraints on `padded_assignment` to the first
+// `num_constraints` elements of `evaluations`.
+template<typename FieldT, typename EvaluateT>
+void qap_compute_h_coefficients(
+    const size_t num_constraints,
+    const size_t num_inputs,
+    const std::vector<FieldT> &padded_assignment,
+    const groth16_prover_context<FieldT> &context,
+    typename groth16_prover_context<FieldT>::scratch_buffers &buffers,
+    const EvaluateT &evaluate,
+    const cancellation_token *cancel)
+{
+    using buffer = typename groth16_prover_context<FieldT>::buffer;
+
+    if (num_constraints != context.get_num_constraints() ||
+        num_inputs != context.get_num_inputs()) {
+        throw std::invalid_argument(
+            "prover context does not match constraint system");
+    }
+    const size_t m = context.get_domain_size();
+
+    // The evaluations beyond the constraints are 0, except for the
+    // constraints `input_i * 0 = 0` added to A by the QAP reduction for the
+    // constant variable and each primary input.
+    auto evaluations = [&](const size_t lc, buffer &out) {
+        evaluate(lc, out);
+        std::fill(out.begin() + num_constraints, out.end(), FieldT::zero());
+    };
+
+    buffer &aA = buffers.a;
+    evaluations(0, aA);
+    for (size_t i = 0; i <= num_inputs; ++i) {
+        aA[num_constraints + i] = padded_assignment[i];
+    }
+    buffer &aB = buffers.b;
+    evaluations(1, aB);
+
+    check_cancelled(cancel, "FFT of A");
+    context.domain_to_coset(aA);
+    check_cancelled(cancel, "FFT of B");
+    context.domain_to_coset(aB);
+
+    // Evaluations of A.B on the coset are accumulated into aA.
+#ifdef MULTICORE
+#pragma omp parallel for
+#endif
+    for (size_t i = 0; i < m; ++i) {
+        aA[i] = aA[i] * aB[i];
+    }
+
+    // The evaluations of C replace those of B.
+    buffer &aC = buffers.b;
+    evaluations(2, aC);
+    check_cancelled(cancel, "FFT of C");
+    context.domain_to_coset(aC);
+
+#ifdef MULTICORE
+#pragma omp parallel for
+#endif
+    for (size_t i = 0; i < m; ++i) {
+        aA[i] = aA[i] - aC[i];
+    }
+
+    check_cancelled(cancel, "FFT of H");
+    context.coset_divide_by_z_to_coefficients(aA);
+}
+
+} // namespace internal
+
+template<typename FieldT>
+std::vector<FieldT> qap_compute_h_coefficients(
+    const libsnark::r1cs_constraint_system<FieldT> &cs,
+    const std::vector<FieldT> &padded_assignment,
+    const cancellation_token *cancel)
+{
+    // The context is used for this computation only, so the domain data is
+    // computed as it is used rather than stored.
+    groth16_prover_context<FieldT> context(
+        cs.num_constraints(), cs.num_inputs(), false);
+    const std::shared_ptr<
+        typename groth16_prover_context<FieldT>::scratch_buffers>
+        buffers = context.acquire_scratch_buffers();
+    qap_compute_h_coefficients(
+        cs, padded_assignment, context, *buffers, cancel);
+
+    // The context (and the buffers returned to it) is released on return, so
+    // the coefficients are moved out rather than copied.
+    return std::move(buffers->a);
+}
+
+template<typename FieldT>
+void qap_compute_h_coefficients(
+    const libsnark::r1cs_constraint_system<FieldT> &cs,
+    const std::vector<FieldT> &padded_assignment,
+    const groth16_prover_context<FieldT> &context,
+    typename groth16_prover_context<FieldT>::scratch_buffers &buffers,
+    const cancellation_token *cancel)
+{
+    using constraint = libsnark::r1cs_constraint<FieldT>;
+    using buffer = typename groth16_prover_context<FieldT>::buffer;
+
+    libsnark::linear_combination<FieldT> constraint::*const lc_members[] = {
+        &constraint::a, &constraint::b, &constraint::c};
+    internal::qap_compute_h_coefficients(
+        cs.num_constraints(),
+        cs.num_inputs(),
+        padded_assignment,
+        context,
+        buffers,
+        [&](const size_t lc, buffer &evaluations) {
+            internal::qap_evaluations(
+                cs, padded_assignment, lc_members[lc], evaluations);
+        },
+        cancel);
+}
+
+template<typename ppT>
+libsnark::r1cs_gg_ppzksnark_proof<ppT> groth16_generate_proof(
+    const libsnark::r1cs_gg_ppzksnark_proving_key<ppT> &proving_key,
+    const libsnark::r1cs_primary_input<libff::Fr<ppT>> &primary_input,
+    const libsnark::r1cs_auxiliary_input<libff::Fr<ppT>> &auxiliary_input,
+    const cancellation_token *cancel,
+    proof_progress_listener *progress,
+    proof_rng *rng)
+{
+    groth16_prover_context<libff::Fr<ppT>> context(
+        proving_key.constraint_system);
+    return groth16_generate_proof<ppT>(
+        proving_key,
+        primary_input,
+        auxiliary_input,
+        context,
+        cancel,
+        progress,
+        rng);
+}
+
+template<typename ppT>
+libsnark::r1cs_gg_ppzksnark_proof<ppT> groth16_generate_proof(
+    const libsnark::r1cs_gg_ppzksnark_proving_key<ppT> &proving_key,
+    const libsnark::r1cs_primary_input<libff::Fr<ppT>> &primary_input,
+    const libsnark::r1cs_auxiliary_input<libff::Fr<ppT>> &auxiliary_input,
+    groth16_prover_context<libff::Fr<ppT>> &context,
+    const cancellation_token *cancel,
+    proof_progress_listener *progress,
+    proof_rng *rng)
+{
+    using Fr = libff::Fr<ppT>;
+    using G1 = libff::G1<ppT>;
+    using G2 = libff::G2<ppT>;
+
+    const libsnark::r1cs_constraint_system<Fr> &cs =
+        proving_key.constraint_system;
+    const size_t num_inputs = cs.num_inputs();
+    const size_t num_variables = cs.num_variables();
+    if (primary_input.size() != num_inputs ||
+        primary_input.size() + auxiliary_input.size() != num_variables) {
+        throw std::invalid_argument("assignment does not match proving key");
+    }
+
+#ifdef MULTICORE
+    const size_t num_threads = omp_get_max_threads();
+#else
+    const size_t num_threads = 1;
+#endif
+    // H is computed concurrently with the multi-exponentiations which only
+    // depend on the witness (A, B and L). The FFTs are much cheaper than
+    // these, and are given a quarter of the threads. With a single thread,
+    // H is computed (on the calling thread) once it is needed.
+    const size_t h_threads = std::max<size_t>(1, num_threads / 4);
+    const size_t chunks = std::max<size_t>(1, num_threads - h_threads);
+    const std::launch h_launch =
+        (num_threads > 1) ? std::launch::async : std::launch::deferred;
+
+    libff::enter_block("Call to groth16_generate_proof");
+
+    // Full assignment, including the constant variable.
+    std::vector<Fr> padded_assignment;
+    padded_assignment.reserve(num_variables + 1);
+    padded_assignment.push_back(Fr::one());
+    padded_assignment.insert(
+        padded_assignment.end(), primary_input.begin(), primary_input.end());
+    padded_assignment.insert(
+        padded_assignment.end(),
+        auxiliary_input.begin(),
+        auxiliary_input.end());
+
+    // Random field elements for prover zero-knowledge, sampled before any
+    // work is started so that they do not depend on the scheduling.
+    Fr r;
+    Fr s;
+    internal::groth16_blinding_factors(rng, r, s);
+
+    // The coefficients of H are computed into buffers.a. The task must not
+    // use the (non thread-safe) libff profiling functions, or notify
+    // `progress` (which is only called from this thread).
+    std::shared_ptr<typename groth16_prover_context<Fr>::scratch_buffers>
+        buffers = context.acquire_scratch_buffers();
+    std::future<void> coefficients_for_H_future = std::async(h_launch, [&]() {
+        const internal::omp_num_threads_scope h_team(h_threads);
+        qap_compute_h_coefficients(
+            cs, padded_assignment, context, *buffers, cancel);
+    });
+    bool h_computed = false;
+    auto notify_if_h_computed = [&]() {
+        if (!h_computed && coefficients_for_H_future.wait_for(
+                               std::chrono::seconds(0)) ==
+                               std::future_status::ready) {
+            h_computed = true;
+            notify_stage_completed(progress, proof_stage_h_computed);
+        }
+    };
+
+    libff::enter_block("Compute the proof");
+
+    // The A, B and L multi-exponentiations are evaluated on the witness,
+    // whose values are mostly 0, 1 or small (see multi_exp_classified). While
+    // H is being computed, they use the threads which it does not.
+    std::unique_ptr<internal::omp_num_threads_scope> overlap_team(
+        new internal::omp_num_threads_scope(chunks));
+
+    check_cancelled(cancel, "A-query multi-exponentiation");
+    libff::enter_block("Compute evaluation to A-query", false);
+    const G1 evaluation_At = multi_exp_classified<G1, Fr>(
+        proving_key.A_query.begin(),
+        proving_key.A_query.begin() + num_variables + 1,
+        padded_assignment.begin(),
+        padded_assignment.end(),
+        chunks);
+    libff::leave_block("Compute evaluation to A-query", false);
+    notify_stage_completed(progress, proof_stage_multi_exp_a);
+    notify_if_h_computed();
+
+    check_cancelled(cancel, "B-query multi-exponentiation");
+    libff::enter_block("Compute evaluation to B-query", false);
+    const libsnark::knowledge_commitment<G2, G1> evaluation_Bt =
+        kc_multi_exp_classified<G2, G1, Fr>(
+            proving_key.B_query,
+            0,
+            num_variables + 1,
+            padded_assignment.begin(),
+            padded_assignment.end(),
+            chunks);
+    libff::leave_block("Compute evaluation to B-query", false);
+    notify_stage_completed(progress, proof_stage_multi_exp_b);
+    notify_if_h_computed();
+
+    check_cancelled(cancel, "L-query multi-exponentiation");
+    libff::enter_block("Compute evaluation to L-query", false);
+    const G1 evaluation_Lt = multi_exp_classified<G1, Fr>(
+        proving_key.L_query.begin(),
+        proving_key.L_query.end(),
+        padded_assignment.begin() + num_inputs + 1,
+        padded_assignment.end(),
+        chunks);
+    libff::leave_block("Compute evaluation to L-query", false);
+    notify_stage_completed(progress, proof_stage_multi_exp_l);
+
+    // Wait for H (rethrowing any exception from its computation).
+    libff::enter_block("Wait for the polynomial H", false);
+    coefficients_for_H_future.get();
+    libff::leave_block("Wait for the polynomial H", false);
+    if (!h_computed) {
+        notify_stage_completed(progress, proof_stage_h_computed);
+    }
+    overlap_team.reset();
+    const typename groth16_prover_context<Fr>::buffer &coefficients_for_H =
+        buffers->a;
+
+    // H has degree m - 2, and the key holds m - 1 elements of H_query.
+    if (proving_key.H_query.size() != coefficients_for_H.size() - 1) {
+        throw std::invalid_argument("domain size does not match proving key");
+    }
+
+    // The H-query multi-exponentiation uses all threads.
+    check_cancelled(cancel, "H-query multi-exponentiation");
+    libff::enter_block("Compute evaluation to H-query", false);
+    const G1 evaluation_Ht = multi_exp_affine<G1, Fr>(
+        proving_key.H_query.begin(),
+        proving_key.H_query.end(),
+        coefficients_for_H.begin(),
+        coefficients_for_H.begin() + proving_key.H_query.size(),
+        num_threads);
+    libff::leave_block("Compute evaluation to H-query", false);
+    notify_stage_completed(progress, proof_stage_multi_exp_h);
+    buffers.reset();
+
+    // A = alpha + sum_i(a_i*A_i(t)) + r*delta
+    G1 g1_A = proving_key.alpha_g1 + evaluation_At + r * proving_key.delta_g1;
+
+    // B = beta + sum_i(a_i*B_i(t)) + s*delta
+    const G1 g1_B =
+        proving_key.beta_g1 + evaluation_Bt.h + s * proving_key.delta_g1;
+    G2 g2_B = proving_key.beta_g2 + evaluation_Bt.g + s * proving_key.delta_g2;
+
+    // C = sum_i(a_i*((beta*A_i(t) + alpha*B_i(t) + C_i(t)) + H(t)*Z(t))/delta)
+    //     + A*s + r*b - r*s*delta
+    G1 g1_C = evaluation_Ht + evaluation_Lt + s * g1_A + r * g1_B -
+              (r * s) * proving_key.delta_g1;
+
+    libff::leave_block("Compute the proof");
+    libff::leave_block("Call to groth16_generate_proof");
+
+    return libsnark::r1cs_gg_ppzksnark_proof<ppT>(
+        std::move(g1_A), std::move(g2_B), std::move(g1_C));
+}
+
+} // namespace libzeth
+
+#endif // __ZETH_SNARKS_GROTH16_GROTH16_PROVER_TCC__
@@ -0,0 +1,125 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#ifndef __ZETH_SNARKS_GROTH16_GROTH16_PROVER_CONTEXT_HPP__
+#define __ZETH_SNARKS_GROTH16_GROTH16_PROVER_CONTEXT_HPP__
+
+#include "libzeth/core/include_libsnark.hpp"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace libzeth
+{
+
+/// Data used to compute the polynomial H (see qap_compute_h_coefficients)
+/// which depends only on the size of the constraint system, computed once per
+/// circuit and reused by all proofs:
+/// - the twiddle factors (powers of the root of unity, and of its inverse) of
+///   the power-of-2 evaluation domain,
+/// - the powers of the coset shift, combined with the 1/m factor of the
+///   inverse FFT,
+/// - the inverse of the vanishing polynomial Z on the coset (which is
+///   constant), combined with the powers of the inverse of the coset shift.
+///
+/// It also holds scratch buffers for the evaluations of the QAP polynomials,
+/// which are reused by successive proofs so that no memory is allocated by
+/// the FFT stages. Any number of proofs may use the context concurrently,
+/// each acquiring its own scratch buffers.
+///
+/// A context created without `precompute` holds none of the above tables
+/// (3m field elements), and computes the twiddle and coset factors as they
+/// are used, for provers which only compute a single proof and are limited
+/// by memory rather than time.
+template<typename FieldT> class groth16_prover_context
+{
+public:
+    /// Plain vectors, as expected by the libff multi-exponentiation functions.
+    using buffer = std::vector<FieldT>;
+
+    /// Buffers for the evaluations of A and H (`a`) and of B and C (`b`),
+    /// each holding `get_domain_size()` elements. Returned to the context when
+    /// the last reference is released.
+    class scratch_buffers
+    {
+    public:
+        buffer a;
+        buffer b;
+    };
+
+    /// Context for the constraint system `cs`.
+    explicit groth16_prover_context(
+        const libsnark::r1cs_constraint_system<FieldT> &cs);
+
+    /// Context for constraint systems with `num_constraints` constraints
+    /// and `num_inputs` primary inputs.
+    groth16_prover_context(
+        size_t num_constraints, size_t num_inputs, bool precompute = true);
+
+    groth16_prover_context(const groth16_prover_context &) = delete;
+    groth16_prover_context &operator=(const groth16_prover_context &) = delete;
+
+    size_t get_domain_size() const;
+
+    /// Number of constraints and primary inputs of the constraint systems
+    /// supported by the context.
+    size_t get_num_constraints() const;
+    size_t get_num_inputs() const;
+
+    /// Scratch buffers for one proof, reused from previous proofs if
+    /// possible.
+    std::shared_ptr<scratch_buffers> acquire_scratch_buffers();
+
+    /// Replace the values `a_i` with the evaluations of the polynomial whose
+    /// values on the domain are `a_i`, on the coset (i.e. an inverse FFT
+    /// followed by a coset FFT).
+    void domain_to_coset(buffer &a) const;
+
+    /// Replace the values `a_i` on the coset, with the coefficients of the
+    /// polynomial with values `a_i / Z` on the coset (i.e. division by Z,
+    /// followed by an inverse coset FFT).
+    void coset_divide_by_z_to_coefficients(buffer &a) const;
+
+private:
+    // In-place FFT, using `roots` (twiddles or inverse_twiddles) or, if they
+    // are not precomputed, the powers of `root_of_unity` (omega or its
+    // inverse).
+    void fft(buffer &a, const buffer &roots, const FieldT &root_of_unity) const;
+    // Multiply `a_i` by `factors_i` or, if they are not precomputed, by
+    // `first * ratio^i`.
+    void multiply_pointwise(
+        buffer &a,
+        const buffer &factors,
+        const FieldT &first,
+        const FieldT &ratio) const;
+
+    const size_t num_constraints;
+    const size_t num_inputs;
+    const size_t log_m;
+    const size_t m;
+
+    // Values from which the tables below are computed.
+    FieldT omega;
+    FieldT omega_inverse;
+    FieldT coset_factor_0;
+    FieldT inverse_coset_factor_0;
+
+    // omega^i and omega^-i for i in [0, m/2).
+    buffer twiddles;
+    buffer inverse_twiddles;
+    // g^i / m for i in [0, m), where g is the coset shift.
+    buffer coset_factors;
+    // g^-i / (m * Z(g)) for i in [0, m). Z(g * omega^i) = g^m - 1 for all i.
+    buffer inverse_coset_factors;
+
+    std::mutex scratch_mutex;
+    std::vector<std::unique_ptr<scratch_buffers>> free_scratch_buffers;
+};
+
+} // namespace libzeth
+
+#include "libzeth/snarks/groth16/groth16_prover_context.tcc"
+
+#endif // __ZETH_SNARKS_GROTH16_GROTH16_PROVER_CONTEXT_HPP__
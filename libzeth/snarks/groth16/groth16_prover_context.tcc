@@ -0,0 +1,240 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#ifndef __ZETH_SNARKS_GROTH16_GROTH16_PROVER_CONTEXT_TCC__
+#define __ZETH_SNARKS_GROTH16_GROTH16_PROVER_CONTEXT_TCC__
+
+#include "libzeth/snarks/groth16/groth16_prover_context.hpp"
+
+#include <libff/algebra/fields/field_utils.hpp>
+#include <libff/common/utils.hpp>
+#ifdef MULTICORE
+#include <omp.h>
+#endif
+
+namespace libzeth
+{
+
+template<typename FieldT>
+groth16_prover_context<FieldT>::groth16_prover_context(
+    const libsnark::r1cs_constraint_system<FieldT> &cs)
+    : groth16_prover_context(cs.num_constraints(), cs.num_inputs())
+{
+}
+
+template<typename FieldT>
+groth16_prover_context<FieldT>::groth16_prover_context(
+    size_t num_constraints, size_t num_inputs, bool precompute)
+    : num_constraints(num_constraints)
+    , num_inputs(num_inputs)
+    // The QAP reduction adds the constraints `input_i * 0 = 0` for the
+    // constant variable and each primary input.
+    , log_m(libff::log2(num_constraints + num_inputs + 1))
+    , m(1ull << log_m)
+{
+    omega = libff::get_root_of_unity<FieldT>(m);
+    omega_inverse = omega.inverse();
+
+    const FieldT &g = FieldT::multiplicative_generator;
+    const FieldT m_inverse = FieldT(m).inverse();
+    const FieldT z_on_coset = (g ^ m) - FieldT::one();
+    coset_factor_0 = m_inverse;
+    inverse_coset_factor_0 = m_inverse * z_on_coset.inverse();
+    if (!precompute) {
+        return;
+    }
+
+    twiddles.resize(m / 2);
+    inverse_twiddles.resize(m / 2);
+    FieldT omega_i = FieldT::one();
+    FieldT omega_inverse_i = FieldT::one();
+    for (size_t i = 0; i < m / 2; ++i) {
+        twiddles[i] = omega_i;
+        inverse_twiddles[i] = omega_inverse_i;
+        omega_i *= omega;
+        omega_inverse_i *= omega_inverse;
+    }
+
+    const FieldT g_inverse = g.inverse();
+    coset_factors.resize(m);
+    inverse_coset_factors.resize(m);
+    FieldT coset_factor = coset_factor_0;
+    FieldT inverse_coset_factor = inverse_coset_factor_0;
+    for (size_t i = 0; i < m; ++i) {
+        coset_factors[i] = coset_factor;
+        inverse_coset_factors[i] = inverse_coset_factor;
+        coset_factor *= g;
+        inverse_coset_factor *= g_inverse;
+    }
+}
+
+template<typename FieldT>
+size_t groth16_prover_context<FieldT>::get_domain_size() const
+{
+    return m;
+}
+
+template<typename FieldT>
+size_t groth16_prover_context<FieldT>::get_num_constraints() const
+{
+    return num_constraints;
+}
+
+template<typename FieldT>
+size_t groth16_prover_context<FieldT>::get_num_inputs() const
+{
+    return num_inputs;
+}
+
+template<typename FieldT>
+std::shared_ptr<typename groth16_prover_context<FieldT>::scratch_buffers>
+groth16_prover_context<FieldT>::acquire_scratch_buffers()
+{
+    std::unique_ptr<scratch_buffers> buffers;
+    {
+        std::lock_guard<std::mutex> lock(scratch_mutex);
+        if (!free_scratch_buffers.empty()) {
+            buffers = std::move(free_scratch_buffers.back());
+            free_scratch_buffers.pop_back();
+        }
+    }
+    if (!buffers) {
+        buffers.reset(new scratch_buffers());
+        buffers->a.resize(m);
+        buffers->b.resize(m);
+    }
+
+    return std::shared_ptr<scratch_buffers>(
+        buffers.release(), [this](scratch_buffers *released) {
+            std::lock_guard<std::mutex> lock(scratch_mutex);
+            free_scratch_buffers.emplace_back(released);
+        });
+}
+
+template<typename FieldT>
+void groth16_prover_context<FieldT>::domain_to_coset(buffer &a) const
+{
+    const FieldT &g = FieldT::multiplicative_generator;
+    fft(a, inverse_twiddles, omega_inverse);
+    multiply_pointwise(a, coset_factors, coset_factor_0, g);
+    fft(a, twiddles, omega);
+}
+
+template<typename FieldT>
+void groth16_prover_context<FieldT>::coset_divide_by_z_to_coefficients(
+    buffer &a) const
+{
+    const FieldT g_inverse = FieldT::multiplicative_generator.inverse();
+    fft(a, inverse_twiddles, omega_inverse);
+    multiply_pointwise(
+        a, inverse_coset_factors, inverse_coset_factor_0, g_inverse);
+}
+
+namespace internal
+{
+
+// Call `f(begin, end)` on ranges covering [0, size), one per OpenMP thread,
+// so that each thread can compute the factors of its range incrementally.
+template<typename FunctionT>
+void parallel_for_ranges(const size_t size, const FunctionT &f)
+{
+#ifdef MULTICORE
+#pragma omp parallel
+    {
+        const size_t num_threads = omp_get_num_threads();
+        const size_t thread = omp_get_thread_num();
+        f((size * thread) / num_threads, (size * (thread + 1)) / num_threads);
+    }
+#else
+    f(0, size);
+#endif
+}
+
+} // namespace internal
+
+template<typename FieldT>
+void groth16_prover_context<FieldT>::fft(
+    buffer &a, const buffer &roots, const FieldT &root_of_unity) const
+{
+    // Iterative radix-2 FFT: bit-reversal permutation, followed by log_m
+    // rounds of m/2 independent butterflies. Each round is parallelized over
+    // all of its butterflies, so that all threads are used in every round.
+#ifdef MULTICORE
+#pragma omp parallel for
+#endif
+    for (size_t i = 0; i < m; ++i) {
+        const size_t reversed = libff::bitreverse(i, log_m);
+        if (i < reversed) {
+            std::swap(a[i], a[reversed]);
+        }
+    }
+
+    for (size_t log_half = 0; log_half < log_m; ++log_half) {
+        const size_t half = 1ull << log_half;
+        const size_t twiddle_stride_log = log_m - log_half - 1;
+        if (!roots.empty()) {
+#ifdef MULTICORE
+#pragma omp parallel for
+#endif
+            for (size_t k = 0; k < m / 2; ++k) {
+                const size_t j = k & (half - 1);
+                const size_t i0 = ((k >> log_half) << (log_half + 1)) + j;
+                const size_t i1 = i0 + half;
+                const FieldT t = roots[j << twiddle_stride_log] * a[i1];
+                a[i1] = a[i0] - t;
+                a[i0] += t;
+            }
+            continue;
+        }
+
+        // The twiddle of butterfly k is root^j, where root is a primitive
+        // (2 * half)-th root of unity, computed incrementally over j.
+        const FieldT root = root_of_unity ^ ((size_t)1 << twiddle_stride_log);
+        internal::parallel_for_ranges(m / 2, [&](size_t begin, size_t end) {
+            FieldT twiddle = root ^ (begin & (half - 1));
+            for (size_t k = begin; k < end; ++k) {
+                const size_t j = k & (half - 1);
+                if (j == 0) {
+                    twiddle = FieldT::one();
+                }
+                const size_t i0 = ((k >> log_half) << (log_half + 1)) + j;
+                const size_t i1 = i0 + half;
+                const FieldT t = twiddle * a[i1];
+                a[i1] = a[i0] - t;
+                a[i0] += t;
+                twiddle *= root;
+            }
+        });
+    }
+}
+
+template<typename FieldT>
+void groth16_prover_context<FieldT>::multiply_pointwise(
+    buffer &a,
+    const buffer &factors,
+    const FieldT &first,
+    const FieldT &ratio) const
+{
+    if (!factors.empty()) {
+#ifdef MULTICORE
+#pragma omp parallel for
+#endif
+        for (size_t i = 0; i < a.size(); ++i) {
+            a[i] *= factors[i];
+        }
+        return;
+    }
+
+    internal::parallel_for_ranges(a.size(), [&](size_t begin, size_t end) {
+        FieldT factor = first * (ratio ^ begin);
+        for (size_t i = begin; i < end; ++i) {
+            a[i] *= factor;
+            factor *= ratio;
+        }
+    });
+}
+
+} // namespace libzeth
+
+#endif // __ZETH_SNARKS_GROTH16_GROTH16_PROVER_CONTEXT_TCC__
@@ -5,6 +5,13 @@
 #ifndef __ZETH_SNARKS_GROTH16_GROTH16_SNARK_HPP__
 #define __ZETH_SNARKS_GROTH16_GROTH16_SNARK_HPP__
 
+#include "libzeth/core/cancellation.hpp"
+#include "libzeth/core/extended_proof.hpp"
+#include "libzeth/core/proof_progress.hpp"
+#include "libzeth/core/proof_rng.hpp"
+#include "libzeth/snarks/groth16/groth16_prover_context.hpp"
+#include "libzeth/snarks/groth16/groth16_streaming_prover.hpp"
+
 #include <libsnark/gadgetlib1/protoboard.hpp>
 #include <libsnark/zk_proof_systems/ppzksnark/r1cs_gg_ppzksnark/r1cs_gg_ppzksnark.hpp>
 
@@ -17,8 +24,17 @@ template<typename ppT> class groth16_snark
 public:
     using proving_key = libsnark::r1cs_gg_ppzksnark_proving_key<ppT>;
     using verification_key = libsnark::r1cs_gg_ppzksnark_verification_key<ppT>;
+    /// Verification key with the precomputed G2 line coefficients for the
+    /// Miller loops (for [1]_2 and delta) and e(alpha, beta), for verifiers
+    /// which check many proofs against the same key.
+    using prepared_verification_key =
+        libsnark::r1cs_gg_ppzksnark_processed_verification_key<ppT>;
     using keypair = libsnark::r1cs_gg_ppzksnark_keypair<ppT>;
     using proof = libsnark::r1cs_gg_ppzksnark_proof<ppT>;
+    using prover_context = groth16_prover_context<libff::Fr<ppT>>;
+    /// Proving key streamed from a mapped file, used by
+    /// generate_proof_low_memory.
+    using streaming_proving_key = groth16_streaming_proving_key<ppT>;
 
     /// String name of this snark, corresponding to <SNARK> in the
     /// ZETH_SNARK_<SNARK> configuration variable.
@@ -28,10 +44,49 @@ public:
     static keypair generate_setup(
         const libsnark::protoboard<libff::Fr<ppT>> &pb);
 
-    /// Generate the proof
+    /// Generate the proof. If `cancel` is not null, it is checked during
+    /// proof generation, and `operation_cancelled` is thrown if it has been
+    /// cancelled. If `progress` is not null, it is notified of the stages
+    /// completed by the prover. The randomness of the proof is drawn from
+    /// `rng` or, if it is null, from a source seeded from the operating
+    /// system for this proof (see groth16_generate_proof). A seeded `rng`
+    /// gives reproducible proofs, for tests and benchmarks only.
     static proof generate_proof(
         const libsnark::protoboard<libff::Fr<ppT>> &pb,
-        const proving_key &proving_key);
+        const proving_key &proving_key,
+        const cancellation_token *cancel = nullptr,
+        proof_progress_listener *progress = nullptr,
+        proof_rng *rng = nullptr);
+
+    /// Generate the proof as above, using `context` (created once for the
+    /// constraint system of the circuit, and shared by all of its proofs).
+    static proof generate_proof(
+        const libsnark::protoboard<libff::Fr<ppT>> &pb,
+        const proving_key &proving_key,
+        prover_context &context,
+        const cancellation_token *cancel = nullptr,
+        proof_progress_listener *progress = nullptr,
+        proof_rng *rng = nullptr);
+
+    /// Generate the proof with a reduced peak memory, for memory-constrained
+    /// hosts. The assignment is read from `pb`, which is then released (the
+    /// protoboard is moved from). The coefficients of H are computed from the
+    /// constraints held by `proving_key` (see
+    /// groth16_streaming_h_coefficients), before the multi-exponentiations
+    /// stream its query sections (see groth16_generate_proof_streaming).
+    /// `cancel`, `progress` and `rng` are used as in generate_proof.
+    static proof generate_proof_low_memory(
+        libsnark::protoboard<libff::Fr<ppT>> &&pb,
+        const streaming_proving_key &proving_key,
+        const cancellation_token *cancel = nullptr,
+        proof_progress_listener *progress = nullptr,
+        proof_rng *rng = nullptr);
+
+    /// Estimate of the peak memory (in bytes) allocated by generate_proof for
+    /// the constraint system `cs`, excluding the protoboard and proving key
+    /// passed to it.
+    static size_t proof_memory_estimate(
+        const libsnark::r1cs_constraint_system<libff::Fr<ppT>> &cs);
 
     /// Verify proof
     static bool verify(
@@ -39,6 +94,31 @@ public:
         const proof &proof,
         const verification_key &verification_key);
 
+    /// Verify proof, using a prepared verification key
+    static bool verify(
+        const libsnark::r1cs_primary_input<libff::Fr<ppT>> &primary_inputs,
+        const proof &proof,
+        const prepared_verification_key &prepared_verification_key);
+
+    /// Verify a batch of proofs (with their primary inputs) against the same
+    /// verification key. The verification equations are combined using random
+    /// 128-bit scalars, so that the batch is checked with one Miller loop per
+    /// proof, 2 Miller loops shared by all proofs, and a single final
+    /// exponentiation. Returns true if all proofs are valid (except with
+    /// negligible probability), and false otherwise.
+    static bool verify_batch(
+        const std::vector<extended_proof<ppT, groth16_snark<ppT>>> &proofs,
+        const verification_key &verification_key);
+
+    /// Verify a batch of proofs as above, using a prepared verification key
+    static bool verify_batch(
+        const std::vector<extended_proof<ppT, groth16_snark<ppT>>> &proofs,
+        const prepared_verification_key &prepared_verification_key);
+
+    /// Compute the prepared form of a verification key
+    static prepared_verification_key prepare_verification_key(
+        const verification_key &verification_key);
+
     /// Write verification as json
     static std::ostream &verification_key_write_json(
         const verification_key &, std::ostream &);
@@ -50,6 +130,16 @@ public:
     /// Read a verification key as bytes
     static verification_key verification_key_read_bytes(std::istream &);
 
+    /// Write a prepared verification key as bytes
+    static std::ostream &prepared_verification_key_write_bytes(
+        const prepared_verification_key &, std::ostream &);
+
+    /// Read a prepared verification key as bytes. The precomputed values are
+    /// not checked against the original key, so the data must come from a
+    /// trusted source (such as prepared_verification_key_write_bytes).
+    static prepared_verification_key prepared_verification_key_read_bytes(
+        std::istream &);
+
     /// Write proving key as bytes
     static std::ostream &proving_key_write_bytes(
         const proving_key &, std::ostream &);
@@ -57,6 +147,11 @@ public:
     /// Read proving key as bytes
     static proving_key proving_key_read_bytes(std::istream &);
 
+    /// Write proving key in the format of streaming_proving_key, recording
+    /// the id of its keypair (see groth16_streaming_proving_key::write)
+    static std::ostream &streaming_proving_key_write_bytes(
+        const proving_key &, const std::string &key_id, std::ostream &);
+
     /// Write proof as json.
     static std::ostream &proof_write_json(
         const proof &proof, std::ostream &out_s);
@@ -78,6 +173,11 @@ template<typename ppT>
 static bool is_well_formed(
     const typename groth16_snark<ppT>::verification_key &vk);
 
+/// Check well-formedness of the group elements of a prepared verification key
+template<typename ppT>
+static bool is_well_formed(
+    const typename groth16_snark<ppT>::prepared_verification_key &pvk);
+
 } // namespace libzeth
 
 #include "libzeth/snarks/groth16/groth16_snark.tcc"
@@ -7,6 +7,7 @@
 
 #include "libzeth/core/group_element_utils.hpp"
 #include "libzeth/core/utils.hpp"
+#include "libzeth/snarks/groth16/groth16_prover.hpp"
 #include "libzeth/snarks/groth16/groth16_snark.hpp"
 
 namespace libzeth
@@ -26,17 +27,106 @@ typename groth16_snark<ppT>::keypair groth16_snark<ppT>::generate_setup(
 template<typename ppT>
 typename groth16_snark<ppT>::proof groth16_snark<ppT>::generate_proof(
     const libsnark::protoboard<libff::Fr<ppT>> &pb,
-    const typename groth16_snark<ppT>::proving_key &proving_key)
+    const typename groth16_snark<ppT>::proving_key &proving_key,
+    const cancellation_token *cancel,
+    proof_progress_listener *progress,
+    proof_rng *rng)
 {
     libsnark::r1cs_primary_input<libff::Fr<ppT>> primary_input =
         pb.primary_input();
     libsnark::r1cs_auxiliary_input<libff::Fr<ppT>> auxiliary_input =
         pb.auxiliary_input();
 
-    // Generate proof from public input, auxiliary input and proving key.
-    // For now, force a pow2 domain, in case the key came from the MPC.
-    return libsnark::r1cs_gg_ppzksnark_prover(
-        proving_key, primary_input, auxiliary_input, true);
+    // Generate proof from public input, auxiliary input and proving key. As
+    // for the setup, a pow2 domain is used, in case the key came from the MPC.
+    return groth16_generate_proof<ppT>(
+        proving_key, primary_input, auxiliary_input, cancel, progress, rng);
+}
+
+template<typename ppT>
+typename groth16_snark<ppT>::proof groth16_snark<ppT>::generate_proof(
+    const libsnark::protoboard<libff::Fr<ppT>> &pb,
+    const typename groth16_snark<ppT>::proving_key &proving_key,
+    typename groth16_snark<ppT>::prover_context &context,
+    const cancellation_token *cancel,
+    proof_progress_listener *progress,
+    proof_rng *rng)
+{
+    libsnark::r1cs_primary_input<libff::Fr<ppT>> primary_input =
+        pb.primary_input();
+    libsnark::r1cs_auxiliary_input<libff::Fr<ppT>> auxiliary_input =
+        pb.auxiliary_input();
+    return groth16_generate_proof<ppT>(
+        proving_key,
+        primary_input,
+        auxiliary_input,
+        context,
+        cancel,
+        progress,
+        rng);
+}
+
+template<typename ppT>
+typename groth16_snark<ppT>::proof groth16_snark<ppT>::
+    generate_proof_low_memory(
+        libsnark::protoboard<libff::Fr<ppT>> &&pb,
+        const typename groth16_snark<ppT>::streaming_proving_key &proving_key,
+        const cancellation_token *cancel,
+        proof_progress_listener *progress,
+        proof_rng *rng)
+{
+    using Fr = libff::Fr<ppT>;
+
+    const size_t num_variables = pb.num_variables();
+    if (pb.num_inputs() != proving_key.num_inputs() ||
+        num_variables != proving_key.num_variables() ||
+        pb.num_constraints() != proving_key.num_constraints()) {
+        throw std::invalid_argument(
+            "constraint system does not match proving key");
+    }
+
+    // The assignment is read from the protoboard variable by variable, since
+    // the protoboard only gives access to copies of its assignment and
+    // constraint system. The protoboard is then released, and H is computed
+    // from the constraints held by the proving key.
+    std::vector<Fr> padded_assignment;
+    padded_assignment.reserve(num_variables + 1);
+    padded_assignment.push_back(Fr::one());
+    {
+        libsnark::protoboard<Fr> released_pb(std::move(pb));
+        for (size_t i = 1; i <= num_variables; ++i) {
+            padded_assignment.push_back(
+                released_pb.val(libsnark::pb_variable<Fr>(i)));
+        }
+    }
+
+    const std::vector<Fr> coefficients_for_H =
+        groth16_streaming_h_coefficients<ppT>(
+            proving_key, padded_assignment, cancel);
+    notify_stage_completed(progress, proof_stage_h_computed);
+
+    return groth16_generate_proof_streaming<ppT>(
+        proving_key,
+        padded_assignment,
+        coefficients_for_H,
+        cancel,
+        progress,
+        rng);
+}
+
+template<typename ppT>
+size_t groth16_snark<ppT>::proof_memory_estimate(
+    const libsnark::r1cs_constraint_system<libff::Fr<ppT>> &cs)
+{
+    // The primary and auxiliary inputs, and the padded assignment (see
+    // groth16_generate_proof), and the two scratch buffers of the evaluation
+    // domain size used to compute H. When a prover_context is used, the
+    // scratch buffers are kept by the context, but one pair is held per proof
+    // in progress.
+    const size_t domain_size =
+        1ull << libff::log2(cs.num_constraints() + cs.num_inputs() + 1);
+    return (2 * (cs.num_variables() + 1) + 2 * domain_size) *
+           sizeof(libff::Fr<ppT>);
 }
 
 template<typename ppT>
@@ -49,6 +139,142 @@ bool groth16_snark<ppT>::verify(
         verification_key, primary_inputs, proof);
 }
 
+template<typename ppT>
+bool groth16_snark<ppT>::verify(
+    const libsnark::r1cs_primary_input<libff::Fr<ppT>> &primary_inputs,
+    const groth16_snark<ppT>::proof &proof,
+    const groth16_snark<ppT>::prepared_verification_key
+        &prepared_verification_key)
+{
+    return libsnark::r1cs_gg_ppzksnark_online_verifier_strong_IC<ppT>(
+        prepared_verification_key, primary_inputs, proof);
+}
+
+namespace internal
+{
+
+// Uniformly random scalar of 128 bits, used to combine the proofs in
+// groth16_snark::verify_batch.
+template<typename FieldT> FieldT groth16_batch_scalar()
+{
+    libff::bigint<FieldT::num_limbs> r = FieldT::random_element().as_bigint();
+    for (size_t i = 128 / GMP_NUMB_BITS; i < FieldT::num_limbs; ++i) {
+        r.data[i] = 0;
+    }
+    return FieldT(r);
+}
+
+} // namespace internal
+
+template<typename ppT>
+bool groth16_snark<ppT>::verify_batch(
+    const std::vector<extended_proof<ppT, groth16_snark<ppT>>> &proofs,
+    const groth16_snark<ppT>::verification_key &verification_key)
+{
+    return verify_batch(proofs, prepare_verification_key(verification_key));
+}
+
+template<typename ppT>
+bool groth16_snark<ppT>::verify_batch(
+    const std::vector<extended_proof<ppT, groth16_snark<ppT>>> &proofs,
+    const groth16_snark<ppT>::prepared_verification_key
+        &prepared_verification_key)
+{
+    using Fr = libff::Fr<ppT>;
+    using G1 = libff::G1<ppT>;
+    using Fqk = libff::Fqk<ppT>;
+
+    // Each proof (A_i, B_i, C_i) for inputs x_i satisfies:
+    //   e(A_i, B_i) * e(-acc_i, [1]_2) * e(-C_i, delta) = e(alpha, beta)
+    // where acc_i = ABC_0 + sum_j(x_ij * ABC_j). For random r_i (with
+    // r_0 = 1), the batch is valid if:
+    //   prod_i(e(r_i * A_i, B_i)) * e(-sum_i(r_i * acc_i), [1]_2) *
+    //     e(-sum_i(r_i * C_i), delta) = e(alpha, beta)^r
+    // where r = sum_i(r_i), and
+    //   sum_i(r_i * acc_i) = r * ABC_0 + sum_j(sum_i(r_i * x_ij) * ABC_j).
+    if (proofs.empty()) {
+        return true;
+    }
+
+    const prepared_verification_key &pvk = prepared_verification_key;
+    const size_t num_proofs = proofs.size();
+    const size_t num_inputs = pvk.ABC_g1.domain_size();
+    std::vector<Fr> scalars(num_proofs);
+    std::vector<G1> Cs(num_proofs);
+    std::vector<Fr> combined_inputs(num_inputs, Fr::zero());
+    Fr scalars_sum = Fr::zero();
+    for (size_t i = 0; i < num_proofs; ++i) {
+        const proof &proof = proofs[i].get_proof();
+        const libsnark::r1cs_primary_input<Fr> &inputs =
+            proofs[i].get_primary_inputs();
+        if (inputs.size() != num_inputs || !proof.is_well_formed()) {
+            return false;
+        }
+
+        scalars[i] =
+            (i == 0) ? Fr::one() : internal::groth16_batch_scalar<Fr>();
+        scalars_sum += scalars[i];
+        Cs[i] = proof.g_C;
+        for (size_t j = 0; j < num_inputs; ++j) {
+            combined_inputs[j] += scalars[i] * inputs[j];
+        }
+    }
+
+    // accumulate_chunk includes ABC_0 once. The remaining (r - 1) * ABC_0 is
+    // added explicitly.
+    const G1 acc =
+        pvk.ABC_g1
+            .template accumulate_chunk<Fr>(
+                combined_inputs.begin(), combined_inputs.end(), 0)
+            .first +
+        (scalars_sum - Fr::one()) * pvk.ABC_g1.first;
+    const G1 C = libff::multi_exp<G1, Fr, libff::multi_exp_method_BDLO12>(
+        Cs.begin(), Cs.end(), scalars.begin(), scalars.end(), 1);
+
+    Fqk miller_product = ppT::double_miller_loop(
+        ppT::precompute_G1(-acc),
+        pvk.vk_generator_g2_precomp,
+        ppT::precompute_G1(-C),
+        pvk.vk_delta_g2_precomp);
+
+#ifdef MULTICORE
+#pragma omp parallel shared(miller_product)
+#endif
+    {
+        Fqk thread_product = Fqk::one();
+
+#ifdef MULTICORE
+#pragma omp for
+#endif
+        for (size_t i = 0; i < num_proofs; ++i) {
+            const proof &proof = proofs[i].get_proof();
+            thread_product =
+                thread_product *
+                ppT::miller_loop(
+                    ppT::precompute_G1(scalars[i] * proof.g_A),
+                    ppT::precompute_G2(proof.g_B));
+        }
+
+#ifdef MULTICORE
+#pragma omp critical
+#endif
+        {
+            miller_product = miller_product * thread_product;
+        }
+    }
+
+    return ppT::final_exponentiation(miller_product) ==
+           (pvk.vk_alpha_g1_beta_g2 ^ scalars_sum.as_bigint());
+}
+
+template<typename ppT>
+typename groth16_snark<ppT>::prepared_verification_key groth16_snark<
+    ppT>::prepare_verification_key(const verification_key &verification_key)
+{
+    return libsnark::r1cs_gg_ppzksnark_verifier_process_vk<ppT>(
+        verification_key);
+}
+
 template<typename ppT>
 std::ostream &groth16_snark<ppT>::verification_key_write_json(
     const verification_key &vk, std::ostream &out_s)
@@ -99,6 +325,30 @@ typename groth16_snark<ppT>::verification_key groth16_snark<
     return vk;
 }
 
+template<typename ppT>
+std::ostream &groth16_snark<ppT>::prepared_verification_key_write_bytes(
+    const prepared_verification_key &pvk, std::ostream &out_s)
+{
+    if (!is_well_formed<ppT>(pvk)) {
+        throw std::invalid_argument(
+            "prepared verification key (write) not well-formed");
+    }
+    return out_s << pvk;
+}
+
+template<typename ppT>
+typename groth16_snark<ppT>::prepared_verification_key groth16_snark<
+    ppT>::prepared_verification_key_read_bytes(std::istream &in_s)
+{
+    prepared_verification_key pvk;
+    in_s >> pvk;
+    if (!is_well_formed<ppT>(pvk)) {
+        throw std::invalid_argument(
+            "prepared verification key (read) not well-formed");
+    }
+    return pvk;
+}
+
 template<typename ppT>
 typename groth16_snark<ppT>::proving_key groth16_snark<
     ppT>::proving_key_read_bytes(std::istream &in_s)
@@ -111,6 +361,16 @@ typename groth16_snark<ppT>::proving_key groth16_snark<
     return pk;
 }
 
+template<typename ppT>
+std::ostream &groth16_snark<ppT>::streaming_proving_key_write_bytes(
+    const proving_key &pk, const std::string &key_id, std::ostream &out_s)
+{
+    if (!is_well_formed<ppT>(pk)) {
+        throw std::invalid_argument("proving key (write) not well-formed");
+    }
+    return streaming_proving_key::write(pk, key_id, out_s);
+}
+
 template<typename ppT>
 std::ostream &groth16_snark<ppT>::keypair_write_bytes(
     const typename groth16_snark<ppT>::keypair &keypair, std::ostream &out_s)
@@ -173,6 +433,14 @@ bool is_well_formed(const typename groth16_snark<ppT>::verification_key &vk)
     return container_is_well_formed(vk.ABC_g1.rest.values);
 }
 
+template<typename ppT>
+bool is_well_formed(
+    const typename groth16_snark<ppT>::prepared_verification_key &pvk)
+{
+    return pvk.ABC_g1.first.is_well_formed() &&
+           container_is_well_formed(pvk.ABC_g1.rest.values);
+}
+
 } // namespace libzeth
 
 #endif // __ZETH_SNARKS_GROTH16_GROTH16_SNARK_TCC__
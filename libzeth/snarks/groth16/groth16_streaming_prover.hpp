@@ -0,0 +1,187 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#ifndef __ZETH_SNARKS_GROTH16_GROTH16_STREAMING_PROVER_HPP__
+#define __ZETH_SNARKS_GROTH16_GROTH16_STREAMING_PROVER_HPP__
+
+#include "libzeth/core/cancellation.hpp"
+#include "libzeth/core/include_libsnark.hpp"
+#include "libzeth/core/proof_progress.hpp"
+#include "libzeth/core/proof_rng.hpp"
+#include "libzeth/serialization/mapped_file.hpp"
+
+#include <libsnark/zk_proof_systems/ppzksnark/r1cs_gg_ppzksnark/r1cs_gg_ppzksnark.hpp>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace libzeth
+{
+
+/// Default number of proving key elements read (and held in memory) at a time
+/// by groth16_generate_proof_streaming.
+const size_t GROTH16_STREAMING_CHUNK_SIZE = 1 << 16;
+
+/// Size (in bytes) of the id of the keypair recorded in streaming proving key
+/// files.
+const size_t GROTH16_STREAMING_KEY_ID_SIZE = 32;
+
+/// Groth16 proving key held in a file mapped read-only into memory, from
+/// which the query sections are read chunk by chunk. The file holds a header,
+/// the fixed group elements, and each query section as a contiguous array of
+/// group elements in their in-memory representation (so that they can be
+/// copied without any decoding). It is followed by the terms of the linear
+/// combinations A, B and C of the constraints (all those of A, then of B, then
+/// of C), from which the coefficients of H are computed without loading the
+/// constraint system into memory.
+///
+/// Since the elements are not checked when the file is opened, the file must
+/// come from a trusted source, such as `write` (which should be passed a
+/// well-formed key), on a host with the same curve parameters and element
+/// layout (checked using the header). The header also records an id of the
+/// keypair the key was written from (such as a hash of its verification key),
+/// so that the file can be matched against its keypair.
+template<typename ppT> class groth16_streaming_proving_key
+{
+public:
+    using Fr = libff::Fr<ppT>;
+    using G1 = libff::G1<ppT>;
+    using G2 = libff::G2<ppT>;
+
+    explicit groth16_streaming_proving_key(const std::string &path);
+
+    size_t num_inputs() const;
+    size_t num_variables() const;
+    size_t num_constraints() const;
+
+    /// Id of the keypair, as passed to `write`.
+    std::string key_id() const;
+
+    const G1 &alpha_g1() const;
+    const G1 &beta_g1() const;
+    const G2 &beta_g2() const;
+    const G1 &delta_g1() const;
+    const G2 &delta_g2() const;
+
+    /// Number of elements in each query section.
+    size_t a_query_size() const;
+    size_t b_query_size() const;
+    size_t h_query_size() const;
+    size_t l_query_size() const;
+
+    /// Copy the elements [begin, end) of a query section to `out`, and release
+    /// the pages of the mapping holding them, so that only one chunk of the
+    /// key is resident at a time. The B query chunk holds the (sparse)
+    /// elements with positions [begin, end).
+    void get_a_query(size_t begin, size_t end, std::vector<G1> &out) const;
+    void get_b_query(
+        size_t begin,
+        size_t end,
+        libsnark::knowledge_commitment_vector<G2, G1> &out) const;
+    void get_h_query(size_t begin, size_t end, std::vector<G1> &out) const;
+    void get_l_query(size_t begin, size_t end, std::vector<G1> &out) const;
+
+    /// Evaluate the linear combinations A, B or C (`lc` = 0, 1 or 2) of the
+    /// constraints [begin, end) on `padded_assignment`, writing the results to
+    /// the same positions of `evaluations`, and release the pages of the
+    /// mapping holding their terms.
+    void evaluate_constraints(
+        size_t lc,
+        size_t begin,
+        size_t end,
+        const std::vector<Fr> &padded_assignment,
+        std::vector<Fr> &evaluations) const;
+
+    /// Write `proving_key` in the streaming format, with the id `key_id`
+    /// (of GROTH16_STREAMING_KEY_ID_SIZE bytes) of its keypair.
+    static std::ostream &write(
+        const libsnark::r1cs_gg_ppzksnark_proving_key<ppT> &proving_key,
+        const std::string &key_id,
+        std::ostream &out_s);
+
+private:
+    class header
+    {
+    public:
+        uint64_t magic;
+        uint64_t g1_size;
+        uint64_t g2_size;
+        uint64_t fr_size;
+        uint64_t num_inputs;
+        uint64_t num_variables;
+        uint64_t num_constraints;
+        uint64_t a_query_size;
+        uint64_t b_query_size;
+        uint64_t h_query_size;
+        uint64_t l_query_size;
+        uint64_t num_terms;
+        char key_id[GROTH16_STREAMING_KEY_ID_SIZE];
+    };
+
+    template<typename T>
+    const T *section(size_t offset, size_t begin, size_t end) const;
+    template<typename T>
+    void copy_section(
+        size_t offset, size_t begin, size_t end, std::vector<T> &out) const;
+
+    mapped_file file;
+    header hdr;
+
+    // Offsets (in bytes) of the fixed elements and sections in the file.
+    size_t fixed_offset;
+    size_t a_query_offset;
+    size_t b_query_indices_offset;
+    size_t b_query_g_offset;
+    size_t b_query_h_offset;
+    size_t h_query_offset;
+    size_t l_query_offset;
+    // Position of the first term of each linear combination (followed by the
+    // total number of terms), and the variable index and coefficient of each
+    // term.
+    size_t term_positions_offset;
+    size_t term_indices_offset;
+    size_t term_coeffs_offset;
+};
+
+/// Compute the coefficients of H (see qap_compute_h_coefficients) for the
+/// constraint system held by `proving_key`, whose terms are read from the
+/// mapped file for `chunk_size` constraints at a time. The domain data is
+/// computed as it is used, so that only the two buffers of the evaluation
+/// domain size are allocated. `cancel` (which may be null) is checked between
+/// chunks and before each FFT.
+template<typename ppT>
+std::vector<libff::Fr<ppT>> groth16_streaming_h_coefficients(
+    const groth16_streaming_proving_key<ppT> &proving_key,
+    const std::vector<libff::Fr<ppT>> &padded_assignment,
+    const cancellation_token *cancel,
+    const size_t chunk_size = GROTH16_STREAMING_CHUNK_SIZE);
+
+/// Groth16 prover with a reduced peak memory, for the full variable assignment
+/// `padded_assignment` (preceded by the value 1 for the constant variable) and
+/// the coefficients of H (see groth16_streaming_h_coefficients), which are
+/// computed by the caller so that the protoboard can be released before the
+/// multi-exponentiations start. The proving key is streamed from its mapped
+/// file in chunks of `chunk_size` elements, so that at most one chunk is
+/// resident at any time. Each chunk is evaluated on all threads, which is a
+/// little slower than a single multi-exponentiation over the whole section.
+///
+/// `cancel`, `progress` and `rng` (which may be null) are used as in
+/// groth16_generate_proof, except that `proof_stage_h_computed` is not
+/// reported. For the same source of randomness, the proof is identical to that
+/// of groth16_generate_proof.
+template<typename ppT>
+libsnark::r1cs_gg_ppzksnark_proof<ppT> groth16_generate_proof_streaming(
+    const groth16_streaming_proving_key<ppT> &proving_key,
+    const std::vector<libff::Fr<ppT>> &padded_assignment,
+    const std::vector<libff::Fr<ppT>> &coefficients_for_H,
+    const cancellation_token *cancel,
+    proof_progress_listener *progress = nullptr,
+    proof_rng *rng = nullptr,
+    const size_t chunk_size = GROTH16_STREAMING_CHUNK_SIZE);
+
+} // namespace libzeth
+
+#include "libzeth/snarks/groth16/groth16_streaming_prover.tcc"
+
+#endif // __ZETH_SNARKS_GROTH16_GROTH16_STREAMING_PROVER_HPP__
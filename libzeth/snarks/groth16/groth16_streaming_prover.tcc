@@ -0,0 +1,571 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#ifndef __ZETH_SNARKS_GROTH16_GROTH16_STREAMING_PROVER_TCC__
+#define __ZETH_SNARKS_GROTH16_GROTH16_STREAMING_PROVER_TCC__
+
+#include "libzeth/snarks/groth16/groth16_streaming_prover.hpp"
+
+#include "libzeth/core/multi_exp.hpp"
+#include "libzeth/snarks/groth16/groth16_prover.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#ifdef MULTICORE
+#include <omp.h>
+#endif
+
+namespace libzeth
+{
+
+/// Identifies streaming Groth16 proving key files ("zethgpk3").
+static const uint64_t GROTH16_STREAMING_PROVING_KEY_MAGIC =
+    0x336b70676874657aull;
+
+template<typename ppT>
+groth16_streaming_proving_key<ppT>::groth16_streaming_proving_key(
+    const std::string &path)
+    : file(path, true)
+{
+    if (file.size() < sizeof(header)) {
+        throw std::invalid_argument("streaming proving key file too small");
+    }
+    hdr = *(const header *)file.data();
+    if (hdr.magic != GROTH16_STREAMING_PROVING_KEY_MAGIC) {
+        throw std::invalid_argument("invalid streaming proving key header");
+    }
+    if (hdr.g1_size != sizeof(G1) || hdr.g2_size != sizeof(G2) ||
+        hdr.fr_size != sizeof(Fr)) {
+        throw std::invalid_argument(
+            "streaming proving key element size mismatch");
+    }
+
+    fixed_offset = sizeof(header);
+    a_query_offset = fixed_offset + 3 * sizeof(G1) + 2 * sizeof(G2);
+    b_query_indices_offset = a_query_offset + hdr.a_query_size * sizeof(G1);
+    b_query_g_offset =
+        b_query_indices_offset + hdr.b_query_size * sizeof(uint64_t);
+    b_query_h_offset = b_query_g_offset + hdr.b_query_size * sizeof(G2);
+    h_query_offset = b_query_h_offset + hdr.b_query_size * sizeof(G1);
+    l_query_offset = h_query_offset + hdr.h_query_size * sizeof(G1);
+    term_positions_offset = l_query_offset + hdr.l_query_size * sizeof(G1);
+    term_indices_offset = term_positions_offset +
+                          (3 * hdr.num_constraints + 1) * sizeof(uint64_t);
+    term_coeffs_offset = term_indices_offset + hdr.num_terms * sizeof(uint64_t);
+    if (file.size() != term_coeffs_offset + hdr.num_terms * sizeof(Fr)) {
+        throw std::invalid_argument("streaming proving key size mismatch");
+    }
+}
+
+template<typename ppT>
+size_t groth16_streaming_proving_key<ppT>::num_inputs() const
+{
+    return hdr.num_inputs;
+}
+
+template<typename ppT>
+size_t groth16_streaming_proving_key<ppT>::num_variables() const
+{
+    return hdr.num_variables;
+}
+
+template<typename ppT>
+size_t groth16_streaming_proving_key<ppT>::num_constraints() const
+{
+    return hdr.num_constraints;
+}
+
+template<typename ppT>
+std::string groth16_streaming_proving_key<ppT>::key_id() const
+{
+    return std::string(hdr.key_id, sizeof(hdr.key_id));
+}
+
+template<typename ppT>
+const libff::G1<ppT> &groth16_streaming_proving_key<ppT>::alpha_g1() const
+{
+    return *section<G1>(fixed_offset, 0, 1);
+}
+
+template<typename ppT>
+const libff::G1<ppT> &groth16_streaming_proving_key<ppT>::beta_g1() const
+{
+    return *section<G1>(fixed_offset, 1, 2);
+}
+
+template<typename ppT>
+const libff::G1<ppT> &groth16_streaming_proving_key<ppT>::delta_g1() const
+{
+    return *section<G1>(fixed_offset, 2, 3);
+}
+
+template<typename ppT>
+const libff::G2<ppT> &groth16_streaming_proving_key<ppT>::beta_g2() const
+{
+    return *section<G2>(fixed_offset + 3 * sizeof(G1), 0, 1);
+}
+
+template<typename ppT>
+const libff::G2<ppT> &groth16_streaming_proving_key<ppT>::delta_g2() const
+{
+    return *section<G2>(fixed_offset + 3 * sizeof(G1), 1, 2);
+}
+
+template<typename ppT>
+size_t groth16_streaming_proving_key<ppT>::a_query_size() const
+{
+    return hdr.a_query_size;
+}
+
+template<typename ppT>
+size_t groth16_streaming_proving_key<ppT>::b_query_size() const
+{
+    return hdr.b_query_size;
+}
+
+template<typename ppT>
+size_t groth16_streaming_proving_key<ppT>::h_query_size() const
+{
+    return hdr.h_query_size;
+}
+
+template<typename ppT>
+size_t groth16_streaming_proving_key<ppT>::l_query_size() const
+{
+    return hdr.l_query_size;
+}
+
+template<typename ppT>
+void groth16_streaming_proving_key<ppT>::get_a_query(
+    size_t begin, size_t end, std::vector<G1> &out) const
+{
+    copy_section(a_query_offset, begin, end, out);
+}
+
+template<typename ppT>
+void groth16_streaming_proving_key<ppT>::get_b_query(
+    size_t begin,
+    size_t end,
+    libsnark::knowledge_commitment_vector<G2, G1> &out) const
+{
+    const uint64_t *indices =
+        section<uint64_t>(b_query_indices_offset, begin, end);
+    const G2 *g_values = section<G2>(b_query_g_offset, begin, end);
+    const G1 *h_values = section<G1>(b_query_h_offset, begin, end);
+
+    out.domain_size_ = hdr.num_variables + 1;
+    out.indices.assign(indices, indices + (end - begin));
+    out.values.clear();
+    out.values.reserve(end - begin);
+    for (size_t i = 0; i < end - begin; ++i) {
+        out.values.emplace_back(g_values[i], h_values[i]);
+    }
+
+    file.release(
+        b_query_indices_offset + begin * sizeof(uint64_t),
+        (end - begin) * sizeof(uint64_t));
+    file.release(
+        b_query_g_offset + begin * sizeof(G2), (end - begin) * sizeof(G2));
+    file.release(
+        b_query_h_offset + begin * sizeof(G1), (end - begin) * sizeof(G1));
+}
+
+template<typename ppT>
+void groth16_streaming_proving_key<ppT>::get_h_query(
+    size_t begin, size_t end, std::vector<G1> &out) const
+{
+    copy_section(h_query_offset, begin, end, out);
+}
+
+template<typename ppT>
+void groth16_streaming_proving_key<ppT>::get_l_query(
+    size_t begin, size_t end, std::vector<G1> &out) const
+{
+    copy_section(l_query_offset, begin, end, out);
+}
+
+template<typename ppT>
+void groth16_streaming_proving_key<ppT>::evaluate_constraints(
+    size_t lc,
+    size_t begin,
+    size_t end,
+    const std::vector<Fr> &padded_assignment,
+    std::vector<Fr> &evaluations) const
+{
+    assert(lc < 3);
+    assert(end <= hdr.num_constraints);
+    assert(evaluations.size() >= end);
+    const size_t first = lc * hdr.num_constraints + begin;
+    const uint64_t *positions = section<uint64_t>(
+        term_positions_offset, first, first + end - begin + 1);
+    const uint64_t terms_begin = positions[0];
+    const uint64_t terms_end = positions[end - begin];
+    const uint64_t *indices =
+        section<uint64_t>(term_indices_offset, terms_begin, terms_end);
+    const Fr *coeffs = section<Fr>(term_coeffs_offset, terms_begin, terms_end);
+
+#ifdef MULTICORE
+#pragma omp parallel for
+#endif
+    for (size_t i = 0; i < end - begin; ++i) {
+        Fr result = Fr::zero();
+        for (uint64_t t = positions[i]; t < positions[i + 1]; ++t) {
+            assert(indices[t - terms_begin] < padded_assignment.size());
+            result += padded_assignment[indices[t - terms_begin]] *
+                      coeffs[t - terms_begin];
+        }
+        evaluations[begin + i] = result;
+    }
+
+    file.release(
+        term_positions_offset + first * sizeof(uint64_t),
+        (end - begin) * sizeof(uint64_t));
+    file.release(
+        term_indices_offset + terms_begin * sizeof(uint64_t),
+        (terms_end - terms_begin) * sizeof(uint64_t));
+    file.release(
+        term_coeffs_offset + terms_begin * sizeof(Fr),
+        (terms_end - terms_begin) * sizeof(Fr));
+}
+
+template<typename ppT>
+std::ostream &groth16_streaming_proving_key<ppT>::write(
+    const libsnark::r1cs_gg_ppzksnark_proving_key<ppT> &proving_key,
+    const std::string &key_id,
+    std::ostream &out_s)
+{
+    if (key_id.size() != GROTH16_STREAMING_KEY_ID_SIZE) {
+        throw std::invalid_argument("invalid streaming proving key id size");
+    }
+
+    using constraint = libsnark::r1cs_constraint<Fr>;
+    using linear_combination = libsnark::linear_combination<Fr>;
+    const libsnark::r1cs_constraint_system<Fr> &cs =
+        proving_key.constraint_system;
+    linear_combination constraint::*const lc_members[] = {
+        &constraint::a, &constraint::b, &constraint::c};
+
+    header file_header;
+    file_header.magic = GROTH16_STREAMING_PROVING_KEY_MAGIC;
+    file_header.g1_size = sizeof(G1);
+    file_header.g2_size = sizeof(G2);
+    file_header.fr_size = sizeof(Fr);
+    file_header.num_inputs = cs.num_inputs();
+    file_header.num_variables = cs.num_variables();
+    file_header.num_constraints = cs.num_constraints();
+    file_header.a_query_size = proving_key.A_query.size();
+    file_header.b_query_size = proving_key.B_query.values.size();
+    file_header.h_query_size = proving_key.H_query.size();
+    file_header.l_query_size = proving_key.L_query.size();
+    file_header.num_terms = 0;
+    for (linear_combination constraint::*const lc_member : lc_members) {
+        for (const constraint &c : cs.constraints) {
+            file_header.num_terms += (c.*lc_member).terms.size();
+        }
+    }
+    std::copy(key_id.begin(), key_id.end(), file_header.key_id);
+    out_s.write((const char *)&file_header, sizeof(file_header));
+
+    out_s.write((const char *)&proving_key.alpha_g1, sizeof(G1));
+    out_s.write((const char *)&proving_key.beta_g1, sizeof(G1));
+    out_s.write((const char *)&proving_key.delta_g1, sizeof(G1));
+    out_s.write((const char *)&proving_key.beta_g2, sizeof(G2));
+    out_s.write((const char *)&proving_key.delta_g2, sizeof(G2));
+
+    out_s.write(
+        (const char *)proving_key.A_query.data(),
+        proving_key.A_query.size() * sizeof(G1));
+    for (const size_t index : proving_key.B_query.indices) {
+        const uint64_t index_64 = index;
+        out_s.write((const char *)&index_64, sizeof(index_64));
+    }
+    for (const libsnark::knowledge_commitment<G2, G1> &value :
+         proving_key.B_query.values) {
+        out_s.write((const char *)&value.g, sizeof(G2));
+    }
+    for (const libsnark::knowledge_commitment<G2, G1> &value :
+         proving_key.B_query.values) {
+        out_s.write((const char *)&value.h, sizeof(G1));
+    }
+    out_s.write(
+        (const char *)proving_key.H_query.data(),
+        proving_key.H_query.size() * sizeof(G1));
+    out_s.write(
+        (const char *)proving_key.L_query.data(),
+        proving_key.L_query.size() * sizeof(G1));
+
+    uint64_t position = 0;
+    for (linear_combination constraint::*const lc_member : lc_members) {
+        for (const constraint &c : cs.constraints) {
+            out_s.write((const char *)&position, sizeof(position));
+            position += (c.*lc_member).terms.size();
+        }
+    }
+    out_s.write((const char *)&position, sizeof(position));
+    for (linear_combination constraint::*const lc_member : lc_members) {
+        for (const constraint &c : cs.constraints) {
+            for (const libsnark::linear_term<Fr> &term :
+                 (c.*lc_member).terms) {
+                const uint64_t index_64 = term.index;
+                out_s.write((const char *)&index_64, sizeof(index_64));
+            }
+        }
+    }
+    for (linear_combination constraint::*const lc_member : lc_members) {
+        for (const constraint &c : cs.constraints) {
+            for (const libsnark::linear_term<Fr> &term :
+                 (c.*lc_member).terms) {
+                out_s.write((const char *)&term.coeff, sizeof(Fr));
+            }
+        }
+    }
+    return out_s;
+}
+
+template<typename ppT>
+template<typename T>
+const T *groth16_streaming_proving_key<ppT>::section(
+    size_t offset, size_t begin, size_t end) const
+{
+    (void)end;
+    assert(begin <= end);
+    assert(offset + end * sizeof(T) <= file.size());
+    return (const T *)(file.data() + offset) + begin;
+}
+
+template<typename ppT>
+template<typename T>
+void groth16_streaming_proving_key<ppT>::copy_section(
+    size_t offset, size_t begin, size_t end, std::vector<T> &out) const
+{
+    const T *elements = section<T>(offset, begin, end);
+    out.assign(elements, elements + (end - begin));
+    file.release(offset + begin * sizeof(T), (end - begin) * sizeof(T));
+}
+
+namespace internal
+{
+
+// Multi-exponentiation of the first `size` elements of a G1 query section of
+// `proving_key` (read by `get_query`), with the scalars at `fs_start`,
+// evaluated in chunks of `chunk_size` elements. Scalars which are mostly small
+// (the witness) use multi_exp_classified, and others (the coefficients of H)
+// multi_exp_affine.
+template<typename ppT>
+libff::G1<ppT> groth16_streaming_multi_exp(
+    const groth16_streaming_proving_key<ppT> &proving_key,
+    void (groth16_streaming_proving_key<ppT>::*get_query)(
+        size_t, size_t, std::vector<libff::G1<ppT>> &) const,
+    const size_t size,
+    typename std::vector<libff::Fr<ppT>>::const_iterator fs_start,
+    const bool small_scalars,
+    const size_t chunk_size,
+    const size_t num_threads,
+    const cancellation_token *cancel,
+    const char *stage)
+{
+    using Fr = libff::Fr<ppT>;
+    using G1 = libff::G1<ppT>;
+
+    std::vector<G1> chunk;
+    chunk.reserve(std::min(size, chunk_size));
+    G1 result = G1::zero();
+    for (size_t begin = 0; begin < size; begin += chunk_size) {
+        check_cancelled(cancel, stage);
+        const size_t end = std::min(size, begin + chunk_size);
+        (proving_key.*get_query)(begin, end, chunk);
+        result = result + (small_scalars ? multi_exp_classified<G1, Fr>(
+                                               chunk.begin(),
+                                               chunk.end(),
+                                               fs_start + begin,
+                                               fs_start + end,
+                                               num_threads)
+                                         : multi_exp_affine<G1, Fr>(
+                                               chunk.begin(),
+                                               chunk.end(),
+                                               fs_start + begin,
+                                               fs_start + end,
+                                               num_threads));
+    }
+    return result;
+}
+
+} // namespace internal
+
+template<typename ppT>
+std::vector<libff::Fr<ppT>> groth16_streaming_h_coefficients(
+    const groth16_streaming_proving_key<ppT> &proving_key,
+    const std::vector<libff::Fr<ppT>> &padded_assignment,
+    const cancellation_token *cancel,
+    const size_t chunk_size)
+{
+    using Fr = libff::Fr<ppT>;
+
+    const size_t num_constraints = proving_key.num_constraints();
+    if (padded_assignment.size() != proving_key.num_variables() + 1) {
+        throw std::invalid_argument("assignment does not match proving key");
+    }
+    if (chunk_size == 0) {
+        throw std::invalid_argument("invalid chunk size");
+    }
+
+    groth16_prover_context<Fr> context(
+        num_constraints, proving_key.num_inputs(), false);
+    const std::shared_ptr<typename groth16_prover_context<Fr>::scratch_buffers>
+        buffers = context.acquire_scratch_buffers();
+    internal::qap_compute_h_coefficients(
+        num_constraints,
+        proving_key.num_inputs(),
+        padded_assignment,
+        context,
+        *buffers,
+        [&](const size_t lc, std::vector<Fr> &evaluations) {
+            for (size_t begin = 0; begin < num_constraints;
+                 begin += chunk_size) {
+                check_cancelled(cancel, "constraint evaluation");
+                proving_key.evaluate_constraints(
+                    lc,
+                    begin,
+                    std::min(num_constraints, begin + chunk_size),
+                    padded_assignment,
+                    evaluations);
+            }
+        },
+        cancel);
+
+    // As in qap_compute_h_coefficients, the buffers are returned to the
+    // context, which is released on return, so the coefficients are moved out.
+    return std::move(buffers->a);
+}
+
+template<typename ppT>
+libsnark::r1cs_gg_ppzksnark_proof<ppT> groth16_generate_proof_streaming(
+    const groth16_streaming_proving_key<ppT> &proving_key,
+    const std::vector<libff::Fr<ppT>> &padded_assignment,
+    const std::vector<libff::Fr<ppT>> &coefficients_for_H,
+    const cancellation_token *cancel,
+    proof_progress_listener *progress,
+    proof_rng *rng,
+    const size_t chunk_size)
+{
+    using Fr = libff::Fr<ppT>;
+    using G1 = libff::G1<ppT>;
+    using G2 = libff::G2<ppT>;
+    using key = groth16_streaming_proving_key<ppT>;
+
+    const size_t num_inputs = proving_key.num_inputs();
+    const size_t num_variables = proving_key.num_variables();
+    if (padded_assignment.size() != num_variables + 1 ||
+        proving_key.a_query_size() < num_variables + 1 ||
+        proving_key.l_query_size() != num_variables - num_inputs) {
+        throw std::invalid_argument("assignment does not match proving key");
+    }
+
+    // H has degree m - 2, and the key holds m - 1 elements of H_query.
+    if (proving_key.h_query_size() + 1 != coefficients_for_H.size()) {
+        throw std::invalid_argument("domain size does not match proving key");
+    }
+    if (chunk_size == 0) {
+        throw std::invalid_argument("invalid chunk size");
+    }
+
+#ifdef MULTICORE
+    const size_t num_threads = omp_get_max_threads();
+#else
+    const size_t num_threads = 1;
+#endif
+
+    libff::enter_block("Call to groth16_generate_proof_streaming");
+
+    // Random field elements for prover zero-knowledge.
+    Fr r;
+    Fr s;
+    internal::groth16_blinding_factors(rng, r, s);
+
+    libff::enter_block("Compute evaluation to A-query", false);
+    const G1 evaluation_At = internal::groth16_streaming_multi_exp<ppT>(
+        proving_key,
+        &key::get_a_query,
+        num_variables + 1,
+        padded_assignment.begin(),
+        true,
+        chunk_size,
+        num_threads,
+        cancel,
+        "A-query multi-exponentiation");
+    libff::leave_block("Compute evaluation to A-query", false);
+    notify_stage_completed(progress, proof_stage_multi_exp_a);
+
+    libff::enter_block("Compute evaluation to B-query", false);
+    libsnark::knowledge_commitment<G2, G1> evaluation_Bt(
+        G2::zero(), G1::zero());
+    {
+        libsnark::knowledge_commitment_vector<G2, G1> chunk;
+        const size_t size = proving_key.b_query_size();
+        for (size_t begin = 0; begin < size; begin += chunk_size) {
+            check_cancelled(cancel, "B-query multi-exponentiation");
+            const size_t end = std::min(size, begin + chunk_size);
+            proving_key.get_b_query(begin, end, chunk);
+            const libsnark::knowledge_commitment<G2, G1> chunk_evaluation =
+                kc_multi_exp_classified<G2, G1, Fr>(
+                    chunk,
+                    0,
+                    num_variables + 1,
+                    padded_assignment.begin(),
+                    padded_assignment.end(),
+                    num_threads);
+            evaluation_Bt = evaluation_Bt + chunk_evaluation;
+        }
+    }
+    libff::leave_block("Compute evaluation to B-query", false);
+    notify_stage_completed(progress, proof_stage_multi_exp_b);
+
+    libff::enter_block("Compute evaluation to L-query", false);
+    const G1 evaluation_Lt = internal::groth16_streaming_multi_exp<ppT>(
+        proving_key,
+        &key::get_l_query,
+        proving_key.l_query_size(),
+        padded_assignment.begin() + num_inputs + 1,
+        true,
+        chunk_size,
+        num_threads,
+        cancel,
+        "L-query multi-exponentiation");
+    libff::leave_block("Compute evaluation to L-query", false);
+    notify_stage_completed(progress, proof_stage_multi_exp_l);
+
+    libff::enter_block("Compute evaluation to H-query", false);
+    const G1 evaluation_Ht = internal::groth16_streaming_multi_exp<ppT>(
+        proving_key,
+        &key::get_h_query,
+        proving_key.h_query_size(),
+        coefficients_for_H.begin(),
+        false,
+        chunk_size,
+        num_threads,
+        cancel,
+        "H-query multi-exponentiation");
+    libff::leave_block("Compute evaluation to H-query", false);
+    notify_stage_completed(progress, proof_stage_multi_exp_h);
+
+    // The proof is assembled as in groth16_generate_proof.
+    G1 g1_A = proving_key.alpha_g1() + evaluation_At +
+              r * proving_key.delta_g1();
+    const G1 g1_B =
+        proving_key.beta_g1() + evaluation_Bt.h + s * proving_key.delta_g1();
+    G2 g2_B =
+        proving_key.beta_g2() + evaluation_Bt.g + s * proving_key.delta_g2();
+    G1 g1_C = evaluation_Ht + evaluation_Lt + s * g1_A + r * g1_B -
+              (r * s) * proving_key.delta_g1();
+
+    libff::leave_block("Call to groth16_generate_proof_streaming");
+
+    return libsnark::r1cs_gg_ppzksnark_proof<ppT>(
+        std::move(g1_A), std::move(g2_B), std::move(g1_C));
+}
+
+} // namespace libzeth
+
+#endif // __ZETH_SNARKS_GROTH16_GROTH16_STREAMING_PROVER_TCC__
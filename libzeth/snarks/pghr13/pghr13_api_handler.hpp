@@ -21,14 +21,18 @@ public:
 
     static void verification_key_to_proto(
         const typename snark::verification_key &vk,
-        zeth_proto::VerificationKey *message);
+        zeth_proto::VerificationKey *message,
+        const zeth_proto::ElementEncoding encoding =
+            zeth_proto::ELEMENT_ENCODING_JSON);
 
     static typename snark::verification_key verification_key_from_proto(
         const zeth_proto::VerificationKey &verification_key);
 
     static void extended_proof_to_proto(
         const extended_proof<ppT, snark> &ext_proof,
-        zeth_proto::ExtendedProof *message);
+        zeth_proto::ExtendedProof *message,
+        const zeth_proto::ElementEncoding encoding =
+            zeth_proto::ELEMENT_ENCODING_JSON);
 
     static libzeth::extended_proof<ppT, snark> extended_proof_from_proto(
         const zeth_proto::ExtendedProof &ext_proof);
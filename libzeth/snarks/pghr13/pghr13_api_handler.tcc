@@ -17,7 +17,8 @@ namespace libzeth
 template<typename ppT>
 void pghr13_api_handler<ppT>::verification_key_to_proto(
     const typename snark::verification_key &vk,
-    zeth_proto::VerificationKey *message)
+    zeth_proto::VerificationKey *message,
+    const zeth_proto::ElementEncoding encoding)
 {
     zeth_proto::Group2Point *a = new zeth_proto::Group2Point();
     zeth_proto::Group1Point *b = new zeth_proto::Group1Point();
@@ -27,15 +28,13 @@ void pghr13_api_handler<ppT>::verification_key_to_proto(
     zeth_proto::Group2Point *gb2 = new zeth_proto::Group2Point();
     zeth_proto::Group2Point *z = new zeth_proto::Group2Point();
 
-    a->CopyFrom(point_g2_affine_to_proto<ppT>(vk.alphaA_g2));
-    b->CopyFrom(point_g1_affine_to_proto<ppT>(vk.alphaB_g1));
-    c->CopyFrom(point_g2_affine_to_proto<ppT>(vk.alphaC_g2));
-    g->CopyFrom(point_g2_affine_to_proto<ppT>(vk.gamma_g2));
-    gb1->CopyFrom(point_g1_affine_to_proto<ppT>(vk.gamma_beta_g1));
-    gb2->CopyFrom(point_g2_affine_to_proto<ppT>(vk.gamma_beta_g2));
-    z->CopyFrom(point_g2_affine_to_proto<ppT>(vk.rC_Z_g2));
-
-    std::string ic_json = accumulation_vector_to_json<ppT>(vk.encoded_IC_query);
+    a->CopyFrom(point_g2_affine_to_proto<ppT>(vk.alphaA_g2, encoding));
+    b->CopyFrom(point_g1_affine_to_proto<ppT>(vk.alphaB_g1, encoding));
+    c->CopyFrom(point_g2_affine_to_proto<ppT>(vk.alphaC_g2, encoding));
+    g->CopyFrom(point_g2_affine_to_proto<ppT>(vk.gamma_g2, encoding));
+    gb1->CopyFrom(point_g1_affine_to_proto<ppT>(vk.gamma_beta_g1, encoding));
+    gb2->CopyFrom(point_g2_affine_to_proto<ppT>(vk.gamma_beta_g2, encoding));
+    z->CopyFrom(point_g2_affine_to_proto<ppT>(vk.rC_Z_g2, encoding));
 
     // Note on memory safety: set_allocated deleted the allocated objects
     // See:
@@ -50,7 +49,13 @@ void pghr13_api_handler<ppT>::verification_key_to_proto(
     grpc_verification_key_pghr13->set_allocated_gamma_beta_g1(gb1);
     grpc_verification_key_pghr13->set_allocated_gamma_beta_g2(gb2);
     grpc_verification_key_pghr13->set_allocated_z(z);
-    grpc_verification_key_pghr13->set_ic(ic_json);
+    if (encoding == zeth_proto::ELEMENT_ENCODING_BYTES) {
+        grpc_verification_key_pghr13->set_encoded_ic(
+            accumulation_vector_to_bytes<ppT>(vk.encoded_IC_query));
+    } else {
+        grpc_verification_key_pghr13->set_ic(
+            accumulation_vector_to_json<ppT>(vk.encoded_IC_query));
+    }
 }
 
 template<typename ppT>
@@ -71,7 +76,9 @@ typename pghr13_snark<ppT>::verification_key pghr13_api_handler<
     libff::G2<ppT> z = point_g2_affine_from_proto<ppT>(verif_key.z());
 
     libsnark::accumulation_vector<libff::G1<ppT>> ic =
-        accumulation_vector_from_json<ppT>(verif_key.ic());
+        verif_key.encoded_ic().empty()
+            ? accumulation_vector_from_json<ppT>(verif_key.ic())
+            : accumulation_vector_from_bytes<ppT>(verif_key.encoded_ic());
 
     libsnark::r1cs_ppzksnark_verification_key<ppT> vk(
         a, b, c, gamma, gamma_beta_g1, gamma_beta_g2, z, ic);
@@ -82,7 +89,8 @@ typename pghr13_snark<ppT>::verification_key pghr13_api_handler<
 template<typename ppT>
 void pghr13_api_handler<ppT>::extended_proof_to_proto(
     const extended_proof<ppT, snark> &ext_proof,
-    zeth_proto::ExtendedProof *message)
+    zeth_proto::ExtendedProof *message,
+    const zeth_proto::ElementEncoding encoding)
 {
     libsnark::r1cs_ppzksnark_proof<ppT> proofObj = ext_proof.get_proof();
 
@@ -95,21 +103,18 @@ void pghr13_api_handler<ppT>::extended_proof_to_proto(
     zeth_proto::Group1Point *h = new zeth_proto::Group1Point();
     zeth_proto::Group1Point *k = new zeth_proto::Group1Point();
 
-    a->CopyFrom(point_g1_affine_to_proto<ppT>(proofObj.g_A.g));
-    a_p->CopyFrom(point_g1_affine_to_proto<ppT>(proofObj.g_A.h));
-    b->CopyFrom(point_g2_affine_to_proto<ppT>(proofObj.g_B.g));
-    b_p->CopyFrom(point_g1_affine_to_proto<ppT>(proofObj.g_B.h));
-    c->CopyFrom(point_g1_affine_to_proto<ppT>(proofObj.g_C.g));
-    c_p->CopyFrom(point_g1_affine_to_proto<ppT>(proofObj.g_C.h));
-    h->CopyFrom(point_g1_affine_to_proto<ppT>(proofObj.g_H));
-    k->CopyFrom(point_g1_affine_to_proto<ppT>(proofObj.g_K));
+    a->CopyFrom(point_g1_affine_to_proto<ppT>(proofObj.g_A.g, encoding));
+    a_p->CopyFrom(point_g1_affine_to_proto<ppT>(proofObj.g_A.h, encoding));
+    b->CopyFrom(point_g2_affine_to_proto<ppT>(proofObj.g_B.g, encoding));
+    b_p->CopyFrom(point_g1_affine_to_proto<ppT>(proofObj.g_B.h, encoding));
+    c->CopyFrom(point_g1_affine_to_proto<ppT>(proofObj.g_C.g, encoding));
+    c_p->CopyFrom(point_g1_affine_to_proto<ppT>(proofObj.g_C.h, encoding));
+    h->CopyFrom(point_g1_affine_to_proto<ppT>(proofObj.g_H, encoding));
+    k->CopyFrom(point_g1_affine_to_proto<ppT>(proofObj.g_K, encoding));
 
     libsnark::r1cs_ppzksnark_primary_input<ppT> pub_inputs =
         ext_proof.get_primary_inputs();
 
-    std::stringstream ss;
-    primary_inputs_write_json(pub_inputs, ss);
-
     // Note on memory safety: set_allocated deleted the allocated objects
     // See:
     //   https://stackoverflow.com/questions/33960999/protobuf-will-set-allocated-delete-the-allocated-object
@@ -124,7 +129,14 @@ void pghr13_api_handler<ppT>::extended_proof_to_proto(
     grpc_extended_pghr13_proof_obj->set_allocated_c_p(c_p);
     grpc_extended_pghr13_proof_obj->set_allocated_h(h);
     grpc_extended_pghr13_proof_obj->set_allocated_k(k);
-    grpc_extended_pghr13_proof_obj->set_inputs(ss.str());
+    if (encoding == zeth_proto::ELEMENT_ENCODING_BYTES) {
+        grpc_extended_pghr13_proof_obj->set_encoded_inputs(
+            field_elements_to_bytes(pub_inputs));
+    } else {
+        std::stringstream ss;
+        primary_inputs_write_json(pub_inputs, ss);
+        grpc_extended_pghr13_proof_obj->set_inputs(ss.str());
+    }
 }
 
 template<typename ppT>
@@ -156,8 +168,13 @@ libzeth::extended_proof<ppT, pghr13_snark<ppT>> pghr13_api_handler<
         std::move(h),
         std::move(k));
     libsnark::r1cs_primary_input<libff::Fr<ppT>> inputs;
-    std::stringstream ss(e_proof.inputs());
-    primary_inputs_read_json(inputs, ss);
+    if (!e_proof.encoded_inputs().empty()) {
+        inputs = field_elements_from_bytes<libff::Fr<ppT>>(
+            e_proof.encoded_inputs());
+    } else {
+        std::stringstream ss(e_proof.inputs());
+        primary_inputs_read_json(inputs, ss);
+    }
 
     return libzeth::extended_proof<ppT, pghr13_snark<ppT>>(
         std::move(proof), std::move(inputs));
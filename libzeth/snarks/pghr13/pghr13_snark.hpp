@@ -5,6 +5,10 @@
 #ifndef __ZETH_SNARKS_PGHR13_PGHR13_SNARK_HPP__
 #define __ZETH_SNARKS_PGHR13_PGHR13_SNARK_HPP__
 
+#include "libzeth/core/cancellation.hpp"
+#include "libzeth/core/extended_proof.hpp"
+#include "libzeth/core/proof_progress.hpp"
+
 #include <boost/filesystem.hpp>
 #include <libsnark/gadgetlib1/protoboard.hpp>
 #include <libsnark/zk_proof_systems/ppzksnark/r1cs_ppzksnark/r1cs_ppzksnark.hpp>
@@ -17,9 +21,27 @@ template<typename ppT> class pghr13_snark
 public:
     using proving_key = libsnark::r1cs_ppzksnark_proving_key<ppT>;
     using verification_key = libsnark::r1cs_ppzksnark_verification_key<ppT>;
+    /// Verification key with the precomputed G1 and G2 values for the Miller
+    /// loops, for verifiers which check many proofs against the same key.
+    using prepared_verification_key =
+        libsnark::r1cs_ppzksnark_processed_verification_key<ppT>;
     using keypair = libsnark::r1cs_ppzksnark_keypair<ppT>;
     using proof = libsnark::r1cs_ppzksnark_proof<ppT>;
 
+    /// Data shared by the proofs for a circuit (see generate_proof). PGHR13
+    /// proofs are generated by the libsnark prover, which does not use any.
+    class prover_context
+    {
+    public:
+        explicit prover_context(
+            const libsnark::r1cs_constraint_system<libff::Fr<ppT>> &)
+        {
+        }
+        prover_context(size_t, size_t) {}
+        prover_context(const prover_context &) = delete;
+        prover_context &operator=(const prover_context &) = delete;
+    };
+
     /// String name of this snark, corresponding to <SNARK> in the
     /// ZETH_SNARK_<SNARK> configuration variable.
     static const std::string name;
@@ -28,10 +50,29 @@ public:
     static keypair generate_setup(
         const libsnark::protoboard<libff::Fr<ppT>> &pb);
 
-    /// Generate the proof
+    /// Generate the proof. If `cancel` is not null, it is checked during
+    /// proof generation, and `operation_cancelled` is thrown if it has been
+    /// cancelled. If `progress` is not null, it is notified of the stages
+    /// completed by the prover.
+    static proof generate_proof(
+        const libsnark::protoboard<libff::Fr<ppT>> &pb,
+        const proving_key &proving_key,
+        const cancellation_token *cancel = nullptr,
+        proof_progress_listener *progress = nullptr);
+
+    /// Generate the proof as above (the context is not used).
     static proof generate_proof(
         const libsnark::protoboard<libff::Fr<ppT>> &pb,
-        const proving_key &proving_key);
+        const proving_key &proving_key,
+        prover_context &context,
+        const cancellation_token *cancel = nullptr,
+        proof_progress_listener *progress = nullptr);
+
+    /// Estimate of the peak memory (in bytes) allocated by generate_proof for
+    /// the constraint system `cs`, excluding the protoboard and proving key
+    /// passed to it.
+    static size_t proof_memory_estimate(
+        const libsnark::r1cs_constraint_system<libff::Fr<ppT>> &cs);
 
     /// Verify proof
     static bool verify(
@@ -39,6 +80,28 @@ public:
         const proof &proof,
         const verification_key &verification_key);
 
+    /// Verify proof, using a prepared verification key
+    static bool verify(
+        const libsnark::r1cs_primary_input<libff::Fr<ppT>> &primary_inputs,
+        const proof &proof,
+        const prepared_verification_key &prepared_verification_key);
+
+    /// Verify a batch of proofs (with their primary inputs) against the same
+    /// verification key. Returns true if all proofs are valid. There is no
+    /// batched check for PGHR13, so the proofs are verified one by one.
+    static bool verify_batch(
+        const std::vector<extended_proof<ppT, pghr13_snark<ppT>>> &proofs,
+        const verification_key &verification_key);
+
+    /// Verify a batch of proofs as above, using a prepared verification key
+    static bool verify_batch(
+        const std::vector<extended_proof<ppT, pghr13_snark<ppT>>> &proofs,
+        const prepared_verification_key &prepared_verification_key);
+
+    /// Compute the prepared form of a verification key
+    static prepared_verification_key prepare_verification_key(
+        const verification_key &verification_key);
+
     /// Write verification as json
     static std::ostream &verification_key_write_json(
         const verification_key &, std::ostream &);
@@ -50,6 +113,16 @@ public:
     /// Read a verification key as bytes
     static verification_key verification_key_read_bytes(std::istream &);
 
+    /// Write a prepared verification key as bytes
+    static std::ostream &prepared_verification_key_write_bytes(
+        const prepared_verification_key &, std::ostream &);
+
+    /// Read a prepared verification key as bytes. The precomputed values are
+    /// not checked against the original key, so the data must come from a
+    /// trusted source (such as prepared_verification_key_write_bytes).
+    static prepared_verification_key prepared_verification_key_read_bytes(
+        std::istream &);
+
     /// Write proving key as bytes
     static std::ostream &proving_key_write_bytes(
         const proving_key &, std::ostream &);
@@ -67,6 +140,11 @@ public:
     static keypair keypair_read_bytes(std::istream &);
 };
 
+/// Check well-formedness of the group elements of a prepared verification key
+template<typename ppT>
+static bool is_well_formed(
+    const typename pghr13_snark<ppT>::prepared_verification_key &pvk);
+
 } // namespace libzeth
 
 #include "libzeth/snarks/pghr13/pghr13_snark.tcc"
@@ -7,6 +7,7 @@
 
 #include "libzeth/core/field_element_utils.hpp"
 #include "libzeth/core/group_element_utils.hpp"
+#include "libzeth/core/utils.hpp"
 #include "libzeth/snarks/pghr13/pghr13_snark.hpp"
 
 namespace libzeth
@@ -24,7 +25,9 @@ typename pghr13_snark<ppT>::keypair pghr13_snark<ppT>::generate_setup(
 template<typename ppT>
 typename pghr13_snark<ppT>::proof pghr13_snark<ppT>::generate_proof(
     const libsnark::protoboard<libff::Fr<ppT>> &pb,
-    const pghr13_snark<ppT>::proving_key &proving_key)
+    const pghr13_snark<ppT>::proving_key &proving_key,
+    const cancellation_token *cancel,
+    proof_progress_listener *)
 {
     // See:
     // https://github.com/scipr-lab/libsnark/blob/92a80f74727091fdc40e6021dc42e9f6b67d5176/libsnark/relations/constraint_satisfaction_problems/r1cs/r1cs.hpp#L81
@@ -35,11 +38,39 @@ typename pghr13_snark<ppT>::proof pghr13_snark<ppT>::generate_proof(
         pb.auxiliary_input();
 
     // Generate proof from public input, auxiliary input (private/secret data),
-    // and proving key
+    // and proving key. The libsnark prover runs as a single stage, so
+    // cancellation is only checked before it starts, and no progress is
+    // reported.
+    check_cancelled(cancel, "PGHR13 prover");
     return libsnark::r1cs_ppzksnark_prover(
         proving_key, primary_input, auxiliary_input);
 }
 
+template<typename ppT>
+typename pghr13_snark<ppT>::proof pghr13_snark<ppT>::generate_proof(
+    const libsnark::protoboard<libff::Fr<ppT>> &pb,
+    const pghr13_snark<ppT>::proving_key &proving_key,
+    pghr13_snark<ppT>::prover_context &,
+    const cancellation_token *cancel,
+    proof_progress_listener *progress)
+{
+    return generate_proof(pb, proving_key, cancel, progress);
+}
+
+template<typename ppT>
+size_t pghr13_snark<ppT>::proof_memory_estimate(
+    const libsnark::r1cs_constraint_system<libff::Fr<ppT>> &cs)
+{
+    // The primary and auxiliary inputs, and the full assignment built by the
+    // libsnark prover, followed by the peak of r1cs_to_qap_witness_map, which
+    // holds the evaluations of A, B and C, a temporary vector and the
+    // coefficients of H. The domain is bounded by the next power of 2.
+    const size_t domain_size =
+        1ull << libff::log2(cs.num_constraints() + cs.num_inputs() + 1);
+    return (2 * (cs.num_variables() + 1) + 5 * (domain_size + 1)) *
+           sizeof(libff::Fr<ppT>);
+}
+
 template<typename ppT>
 bool pghr13_snark<ppT>::verify(
     const libsnark::r1cs_primary_input<libff::Fr<ppT>> &primary_inputs,
@@ -50,6 +81,50 @@ bool pghr13_snark<ppT>::verify(
         verification_key, primary_inputs, proof);
 }
 
+template<typename ppT>
+bool pghr13_snark<ppT>::verify(
+    const libsnark::r1cs_primary_input<libff::Fr<ppT>> &primary_inputs,
+    const pghr13_snark<ppT>::proof &proof,
+    const pghr13_snark<ppT>::prepared_verification_key
+        &prepared_verification_key)
+{
+    return libsnark::r1cs_ppzksnark_online_verifier_strong_IC<ppT>(
+        prepared_verification_key, primary_inputs, proof);
+}
+
+template<typename ppT>
+bool pghr13_snark<ppT>::verify_batch(
+    const std::vector<extended_proof<ppT, pghr13_snark<ppT>>> &proofs,
+    const pghr13_snark<ppT>::verification_key &verification_key)
+{
+    return verify_batch(proofs, prepare_verification_key(verification_key));
+}
+
+template<typename ppT>
+bool pghr13_snark<ppT>::verify_batch(
+    const std::vector<extended_proof<ppT, pghr13_snark<ppT>>> &proofs,
+    const pghr13_snark<ppT>::prepared_verification_key
+        &prepared_verification_key)
+{
+    for (const extended_proof<ppT, pghr13_snark<ppT>> &proof : proofs) {
+        if (!verify(
+                proof.get_primary_inputs(),
+                proof.get_proof(),
+                prepared_verification_key)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template<typename ppT>
+typename pghr13_snark<ppT>::prepared_verification_key pghr13_snark<
+    ppT>::prepare_verification_key(const verification_key &verification_key)
+{
+    return libsnark::r1cs_ppzksnark_verifier_process_vk<ppT>(
+        verification_key);
+}
+
 template<typename ppT>
 std::ostream &pghr13_snark<ppT>::verification_key_write_json(
     const pghr13_snark<ppT>::verification_key &vk, std::ostream &os)
@@ -93,6 +168,30 @@ typename pghr13_snark<ppT>::verification_key pghr13_snark<
     return vk;
 }
 
+template<typename ppT>
+std::ostream &pghr13_snark<ppT>::prepared_verification_key_write_bytes(
+    const prepared_verification_key &pvk, std::ostream &os)
+{
+    if (!is_well_formed<ppT>(pvk)) {
+        throw std::invalid_argument(
+            "prepared verification key (write) not well-formed");
+    }
+    return os << pvk;
+}
+
+template<typename ppT>
+typename pghr13_snark<ppT>::prepared_verification_key pghr13_snark<
+    ppT>::prepared_verification_key_read_bytes(std::istream &in_s)
+{
+    prepared_verification_key pvk;
+    in_s >> pvk;
+    if (!is_well_formed<ppT>(pvk)) {
+        throw std::invalid_argument(
+            "prepared verification key (read) not well-formed");
+    }
+    return pvk;
+}
+
 template<typename ppT>
 std::ostream &pghr13_snark<ppT>::proving_key_write_bytes(
     const typename pghr13_snark<ppT>::proving_key &pk, std::ostream &os)
@@ -142,6 +241,14 @@ typename pghr13_snark<ppT>::keypair pghr13_snark<ppT>::keypair_read_bytes(
         proving_key_read_bytes(in_s), verification_key_read_bytes(in_s));
 }
 
+template<typename ppT>
+bool is_well_formed(
+    const typename pghr13_snark<ppT>::prepared_verification_key &pvk)
+{
+    return pvk.encoded_IC_query.first.is_well_formed() &&
+           container_is_well_formed(pvk.encoded_IC_query.rest.values);
+}
+
 } // namespace libzeth
 
 #endif // __ZETH_SNARKS_PGHR13_PGHR13_SNARK_TCC__
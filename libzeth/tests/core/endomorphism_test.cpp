@@ -0,0 +1,108 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#include "libzeth/core/endomorphism.hpp"
+
+#include <gtest/gtest.h>
+#include <libff/algebra/curves/alt_bn128/alt_bn128_pp.hpp>
+#include <libff/algebra/curves/bls12_377/bls12_377_pp.hpp>
+#include <libff/algebra/curves/curve_utils.hpp>
+
+using namespace libzeth;
+
+namespace
+{
+
+static const size_t NUM_SCALARS = 64;
+
+template<typename GroupT> std::vector<typename GroupT::scalar_field> scalars()
+{
+    using FieldT = typename GroupT::scalar_field;
+
+    // Include edge cases, and random values.
+    std::vector<FieldT> scalars{
+        FieldT::zero(), FieldT::one(), -FieldT::one(), FieldT(2), -FieldT(2)};
+    while (scalars.size() < NUM_SCALARS) {
+        scalars.push_back(FieldT::random_element());
+    }
+    return scalars;
+}
+
+template<typename GroupT> void endomorphism_mul_test()
+{
+    using FieldT = typename GroupT::scalar_field;
+
+    const size_t component_bits = endomorphism_component_bits<GroupT>();
+    const GroupT P = FieldT::random_element() * GroupT::one();
+    const size_t window = 4;
+    const libff::window_table<GroupT> table =
+        libff::get_window_table(component_bits, window, P);
+
+    for (const FieldT &k : scalars<GroupT>()) {
+        const endomorphism_scalar<GroupT> k_decomposed(k);
+        for (const endomorphism_component<GroupT> &c :
+             k_decomposed.get_components()) {
+            ASSERT_LE(c.magnitude.num_bits(), component_bits);
+        }
+
+        const GroupT expect = k * P;
+        ASSERT_EQ(expect, k_decomposed.mul(P));
+        ASSERT_EQ(expect, k_decomposed.windowed_exp(window, table));
+        ASSERT_EQ(expect, endomorphism_mul(k, P));
+        ASSERT_EQ(GroupT::zero(), endomorphism_mul(k, GroupT::zero()));
+    }
+
+    // The components are roughly half the size of the scalar field elements.
+    ASSERT_LT(component_bits, FieldT::size_in_bits());
+}
+
+template<typename GroupT> void endomorphism_subgroup_test()
+{
+    ASSERT_TRUE(endomorphism_is_in_subgroup(GroupT::zero()));
+    ASSERT_TRUE(endomorphism_is_in_subgroup(GroupT::one()));
+    for (size_t i = 0; i < 8; ++i) {
+        ASSERT_TRUE(endomorphism_is_in_subgroup(GroupT::random_element()));
+    }
+}
+
+TEST(EndomorphismTest, ALT_BN128)
+{
+    endomorphism_mul_test<libff::alt_bn128_G1>();
+    endomorphism_mul_test<libff::alt_bn128_G2>();
+    endomorphism_subgroup_test<libff::alt_bn128_G1>();
+    endomorphism_subgroup_test<libff::alt_bn128_G2>();
+}
+
+TEST(EndomorphismTest, BLS12_377)
+{
+    using G1 = libff::bls12_377_G1;
+    using G2 = libff::bls12_377_G2;
+    using Fq = typename G1::base_field;
+    using Fqe = typename G2::twist_field;
+
+    endomorphism_mul_test<G1>();
+    endomorphism_mul_test<G2>();
+    endomorphism_subgroup_test<G1>();
+    endomorphism_subgroup_test<G2>();
+
+    // Points outside the subgroup (see ec_operation_data_test).
+    const G1 g1_not_in_subgroup = libff::g1_curve_point_at_x<G1>(Fq("3"));
+    ASSERT_TRUE(g1_not_in_subgroup.is_well_formed());
+    ASSERT_FALSE(endomorphism_is_in_subgroup(g1_not_in_subgroup));
+
+    const G2 g2_not_in_subgroup =
+        libff::g2_curve_point_at_x<G2>(Fq(3) * Fqe::one());
+    ASSERT_TRUE(g2_not_in_subgroup.is_well_formed());
+    ASSERT_FALSE(endomorphism_is_in_subgroup(g2_not_in_subgroup));
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    libff::alt_bn128_pp::init_public_params();
+    libff::bls12_377_pp::init_public_params();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
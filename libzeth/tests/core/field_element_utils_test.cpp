@@ -113,6 +113,47 @@ template<typename ppT> void field_element_encode_decode_json_badstring_test()
     do_field_element_encode_decode_json_badstring_test<libff::Fqk<ppT>>();
 }
 
+template<typename FieldT> void do_field_element_encode_decode_bytes_test()
+{
+    const FieldT fe = FieldT::random_element();
+    std::vector<uint8_t> fe_bytes(libzeth::field_element_bytes_size<FieldT>());
+    libzeth::field_element_to_bytes(fe, fe_bytes.data());
+
+    const FieldT fe_decoded =
+        libzeth::field_element_from_bytes<FieldT>(fe_bytes.data());
+    ASSERT_EQ(fe, fe_decoded);
+}
+
+template<typename ppT> void field_element_encode_decode_bytes_test()
+{
+    do_field_element_encode_decode_bytes_test<libff::Fr<ppT>>();
+    do_field_element_encode_decode_bytes_test<libff::Fq<ppT>>();
+    do_field_element_encode_decode_bytes_test<libff::Fqe<ppT>>();
+    do_field_element_encode_decode_bytes_test<libff::Fqk<ppT>>();
+}
+
+template<typename ppT> void field_element_decode_bytes_unreduced_test()
+{
+    using Fq = libff::Fq<ppT>;
+
+    // The modulus itself is not a valid encoding.
+    std::vector<uint8_t> bytes(libzeth::field_element_bytes_size<Fq>());
+    memcpy(bytes.data(), &Fq::mod.data[0], bytes.size());
+    ASSERT_THROW(
+        libzeth::field_element_from_bytes<Fq>(bytes.data()),
+        std::invalid_argument);
+}
+
+TEST(FieldElementUtilsTest, BytesTestVectorAltBN128)
+{
+    using Fr = libff::Fr<libff::alt_bn128_pp>;
+    const uint8_t expected[32] = {0x01, 0x02};
+    uint8_t bytes[32];
+    ASSERT_EQ(sizeof(bytes), libzeth::field_element_bytes_size<Fr>());
+    libzeth::field_element_to_bytes(Fr(0x0201), bytes);
+    ASSERT_EQ(0, memcmp(expected, bytes, sizeof(bytes)));
+}
+
 TEST(FieldElementUtilsTest, BigIntEncodeDecodeHex)
 {
     bigint_encode_decode_hex_test<libff::alt_bn128_pp>();
@@ -158,6 +199,22 @@ TEST(FieldElementUtilsTest, FieldElementEncodeDecodeJsonBadString)
     field_element_encode_decode_json_badstring_test<libff::bw6_761_pp>();
 }
 
+TEST(FieldElementUtilsTest, FieldElementEncodeDecodeBytes)
+{
+    field_element_encode_decode_bytes_test<libff::alt_bn128_pp>();
+    field_element_encode_decode_bytes_test<libff::mnt4_pp>();
+    field_element_encode_decode_bytes_test<libff::mnt6_pp>();
+    field_element_encode_decode_bytes_test<libff::bls12_377_pp>();
+    field_element_encode_decode_bytes_test<libff::bw6_761_pp>();
+}
+
+TEST(FieldElementUtilsTest, FieldElementDecodeBytesUnreduced)
+{
+    field_element_decode_bytes_unreduced_test<libff::alt_bn128_pp>();
+    field_element_decode_bytes_unreduced_test<libff::bls12_377_pp>();
+    field_element_decode_bytes_unreduced_test<libff::bw6_761_pp>();
+}
+
 } // namespace
 
 int main(int argc, char **argv)
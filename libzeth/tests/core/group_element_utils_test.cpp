@@ -64,6 +64,13 @@ static void single_group_element_encode_decode_test(const GroupT &g)
     const GroupT g_decoded = libzeth::point_affine_from_json<GroupT>(g_json);
 
     ASSERT_EQ(g, g_decoded);
+
+    std::vector<uint8_t> g_bytes(libzeth::point_affine_bytes_size<GroupT>());
+    libzeth::point_affine_to_bytes(g, g_bytes.data());
+    const GroupT g_decoded_bytes =
+        libzeth::point_affine_from_bytes<GroupT>(g_bytes.data());
+
+    ASSERT_EQ(g, g_decoded_bytes);
 }
 
 template<typename GroupT> static void group_element_encode_decode_test()
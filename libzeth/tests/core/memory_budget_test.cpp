@@ -0,0 +1,119 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#include "libzeth/core/memory_budget.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <memory>
+#include <thread>
+
+namespace
+{
+
+class flag_cancellation_token : public libzeth::cancellation_token
+{
+public:
+    std::atomic<bool> cancelled;
+
+    flag_cancellation_token() : cancelled(false) {}
+
+    bool is_cancelled() const override { return cancelled; }
+};
+
+// Wait until `num_waiting` operations are waiting for memory.
+void wait_for_waiting(const libzeth::memory_budget &budget, size_t num_waiting)
+{
+    while (budget.get_status().num_waiting != num_waiting) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+TEST(MemoryBudgetTest, ReserveAndRelease)
+{
+    libzeth::memory_budget budget(100, 4);
+    {
+        libzeth::memory_budget::reservation r1 = budget.acquire(60, nullptr);
+        libzeth::memory_budget::reservation r2 = budget.acquire(40, nullptr);
+        const libzeth::memory_budget_status status = budget.get_status();
+        ASSERT_EQ(100, status.capacity);
+        ASSERT_EQ(100, status.in_use);
+        ASSERT_EQ(2, status.num_active);
+        ASSERT_EQ(0, status.num_waiting);
+    }
+
+    const libzeth::memory_budget_status status = budget.get_status();
+    ASSERT_EQ(0, status.in_use);
+    ASSERT_EQ(0, status.num_active);
+}
+
+TEST(MemoryBudgetTest, RejectOversizedAndExcessRequests)
+{
+    libzeth::memory_budget budget(100, 1);
+    ASSERT_THROW(
+        budget.acquire(101, nullptr), libzeth::memory_budget_exhausted);
+
+    std::unique_ptr<libzeth::memory_budget::reservation> held(
+        new libzeth::memory_budget::reservation(budget.acquire(100, nullptr)));
+    std::thread waiter([&budget]() { budget.acquire(50, nullptr); });
+    wait_for_waiting(budget, 1);
+
+    // The single waiting slot is taken.
+    ASSERT_THROW(budget.acquire(10, nullptr), libzeth::memory_budget_exhausted);
+    ASSERT_EQ(2, budget.get_status().num_rejected);
+
+    held.reset();
+    waiter.join();
+    ASSERT_EQ(0, budget.get_status().in_use);
+}
+
+TEST(MemoryBudgetTest, AdmitInOrder)
+{
+    libzeth::memory_budget budget(100, 4);
+    std::unique_ptr<libzeth::memory_budget::reservation> held(
+        new libzeth::memory_budget::reservation(budget.acquire(60, nullptr)));
+
+    // A large request waits, and a later small request (which would fit) must
+    // wait behind it.
+    std::atomic<bool> large_admitted(false);
+    std::atomic<bool> small_admitted(false);
+    std::thread large([&]() {
+        libzeth::memory_budget::reservation r = budget.acquire(80, nullptr);
+        large_admitted = true;
+        ASSERT_FALSE(small_admitted);
+    });
+    wait_for_waiting(budget, 1);
+    std::thread small([&]() {
+        libzeth::memory_budget::reservation r = budget.acquire(10, nullptr);
+        ASSERT_TRUE(large_admitted);
+        small_admitted = true;
+    });
+    wait_for_waiting(budget, 2);
+    ASSERT_FALSE(large_admitted);
+    ASSERT_FALSE(small_admitted);
+
+    held.reset();
+    large.join();
+    small.join();
+    ASSERT_TRUE(small_admitted);
+}
+
+TEST(MemoryBudgetTest, CancelWhileWaiting)
+{
+    libzeth::memory_budget budget(100, 4);
+    libzeth::memory_budget::reservation held = budget.acquire(100, nullptr);
+
+    flag_cancellation_token cancel;
+    std::thread waiter([&]() {
+        ASSERT_THROW(
+            budget.acquire(10, &cancel), libzeth::operation_cancelled);
+    });
+    wait_for_waiting(budget, 1);
+    cancel.cancelled = true;
+    waiter.join();
+    ASSERT_EQ(0, budget.get_status().num_waiting);
+}
+
+} // namespace
@@ -0,0 +1,163 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#include "libzeth/circuits/circuit_types.hpp"
+#include "libzeth/core/merkle_tree_field.hpp"
+#include "libzeth/core/merkle_tree_field_persistent.hpp"
+
+#include <boost/filesystem.hpp>
+#include <gtest/gtest.h>
+
+using pp = libff::alt_bn128_pp;
+using Field = libff::Fr<pp>;
+using HashTree = libzeth::HashTreeT<Field>;
+using merkle_tree = libzeth::merkle_tree_field<Field, HashTree>;
+using merkle_tree_persistent =
+    libzeth::merkle_tree_field_persistent<Field, HashTree>;
+
+static const size_t TreeDepth = 4;
+
+namespace
+{
+
+// Directory holding the files of a tree, in a fresh temporary directory
+// (which may also hold other files of the test) removed at the end of the
+// test. Must outlive the trees using it.
+class tree_directory
+{
+public:
+    explicit tree_directory(const std::string &name)
+        : root(
+              boost::filesystem::temp_directory_path() /
+              boost::filesystem::unique_path("zeth_merkle_tree_%%%%%%%%"))
+        , path(root / name)
+    {
+    }
+
+    tree_directory(const tree_directory &) = delete;
+    tree_directory &operator=(const tree_directory &) = delete;
+
+    ~tree_directory()
+    {
+        boost::system::error_code ec;
+        boost::filesystem::remove_all(root, ec);
+    }
+
+    const boost::filesystem::path root;
+    const boost::filesystem::path path;
+};
+
+std::vector<Field> random_values(const size_t num_values)
+{
+    std::vector<Field> values;
+    values.reserve(num_values);
+    for (size_t i = 0; i < num_values; ++i) {
+        values.push_back(Field::random_element());
+    }
+    return values;
+}
+
+void assert_trees_equal(
+    const merkle_tree &expected, const merkle_tree_persistent &actual)
+{
+    ASSERT_EQ(expected.get_root(), actual.get_root());
+    for (size_t address = 0; address < (1ul << TreeDepth); ++address) {
+        ASSERT_EQ(expected.get_value(address), actual.get_value(address));
+        ASSERT_EQ(expected.get_path(address), actual.get_path(address));
+    }
+}
+
+TEST(MerkleTreeFieldPersistentTest, EmptyTree)
+{
+    const tree_directory dir("empty");
+    const merkle_tree expected(TreeDepth);
+    const merkle_tree_persistent actual(dir.path.string(), TreeDepth);
+    assert_trees_equal(expected, actual);
+    ASSERT_EQ(0, actual.get_num_leaves());
+}
+
+TEST(MerkleTreeFieldPersistentTest, MatchesInMemoryTree)
+{
+    const tree_directory dir("in_memory");
+    const std::vector<Field> values = random_values(7);
+
+    merkle_tree expected(TreeDepth);
+    merkle_tree_persistent actual(dir.path.string(), TreeDepth);
+
+    expected.set_value(0, values[0]);
+    actual.set_value(0, values[0]);
+    assert_trees_equal(expected, actual);
+
+    expected.set_values(1, {values[1], values[2], values[3]});
+    actual.set_values(1, {values[1], values[2], values[3]});
+    assert_trees_equal(expected, actual);
+
+    // Leave a gap of unset leaves, then overwrite an existing leaf.
+    expected.set_values(9, {values[4], values[5]});
+    actual.set_values(9, {values[4], values[5]});
+    expected.set_value(2, values[6]);
+    actual.set_value(2, values[6]);
+    assert_trees_equal(expected, actual);
+    ASSERT_EQ(11, actual.get_num_leaves());
+}
+
+TEST(MerkleTreeFieldPersistentTest, Reopen)
+{
+    const tree_directory dir("reopen");
+    const std::vector<Field> values = random_values(6);
+
+    merkle_tree expected(TreeDepth);
+    expected.set_values(0, values);
+    {
+        merkle_tree_persistent tree(dir.path.string(), TreeDepth);
+        tree.set_values(0, values);
+    }
+
+    merkle_tree_persistent reopened(dir.path.string(), TreeDepth);
+    assert_trees_equal(expected, reopened);
+
+    // The reopened tree can be extended.
+    const std::vector<Field> more_values = random_values(3);
+    expected.set_values(values.size(), more_values);
+    reopened.set_values(values.size(), more_values);
+    assert_trees_equal(expected, reopened);
+
+    ASSERT_THROW(
+        merkle_tree_persistent(dir.path.string(), TreeDepth + 1),
+        std::invalid_argument);
+}
+
+TEST(MerkleTreeFieldPersistentTest, ReplayUncommittedUpdate)
+{
+    // Simulate a crash after an update has been written to the log (and
+    // possibly partially applied), but before the header was replaced, by
+    // restoring an old copy of the header.
+    const tree_directory dir("replay");
+    const boost::filesystem::path header_copy = dir.root / "header";
+    const std::vector<Field> values = random_values(5);
+
+    merkle_tree expected(TreeDepth);
+    expected.set_values(0, values);
+    {
+        merkle_tree_persistent tree(dir.path.string(), TreeDepth);
+        tree.set_values(0, {values[0], values[1]});
+        boost::filesystem::copy_file(dir.path / "header", header_copy);
+        tree.set_values(2, {values[2], values[3], values[4]});
+    }
+    boost::filesystem::remove(dir.path / "header");
+    boost::filesystem::copy_file(header_copy, dir.path / "header");
+
+    const merkle_tree_persistent reopened(dir.path.string(), TreeDepth);
+    assert_trees_equal(expected, reopened);
+    ASSERT_EQ(values.size(), reopened.get_num_leaves());
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    pp::init_public_params();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
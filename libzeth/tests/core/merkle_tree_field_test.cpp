@@ -0,0 +1,104 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#include "libzeth/circuits/circuit_types.hpp"
+#include "libzeth/core/merkle_tree_field.hpp"
+
+#include <gtest/gtest.h>
+
+using pp = libff::alt_bn128_pp;
+using Field = libff::Fr<pp>;
+using HashTree = libzeth::HashTreeT<Field>;
+using merkle_tree = libzeth::merkle_tree_field<Field, HashTree>;
+
+static const size_t TreeDepth = 4;
+
+namespace
+{
+
+std::vector<Field> random_values(const size_t num_values)
+{
+    std::vector<Field> values;
+    values.reserve(num_values);
+    for (size_t i = 0; i < num_values; ++i) {
+        values.push_back(Field::random_element());
+    }
+    return values;
+}
+
+void assert_trees_equal(const merkle_tree &expected, const merkle_tree &actual)
+{
+    ASSERT_EQ(expected.get_root(), actual.get_root());
+    for (size_t address = 0; address < (1ul << TreeDepth); ++address) {
+        ASSERT_EQ(expected.get_value(address), actual.get_value(address));
+        ASSERT_EQ(expected.get_path(address), actual.get_path(address));
+    }
+}
+
+void set_values_matches_set_value(
+    const size_t first_address, const size_t num_values)
+{
+    const std::vector<Field> values = random_values(num_values);
+
+    merkle_tree expected(TreeDepth);
+    for (size_t i = 0; i < num_values; ++i) {
+        expected.set_value(first_address + i, values[i]);
+    }
+
+    merkle_tree actual(TreeDepth);
+    actual.set_values(first_address, values);
+
+    assert_trees_equal(expected, actual);
+}
+
+TEST(MerkleTreeFieldTest, SetValuesSingleLeaf)
+{
+    set_values_matches_set_value(0, 1);
+    set_values_matches_set_value(1, 1);
+    set_values_matches_set_value(6, 1);
+    set_values_matches_set_value((1ul << TreeDepth) - 1, 1);
+}
+
+TEST(MerkleTreeFieldTest, SetValuesRange)
+{
+    set_values_matches_set_value(0, 2);
+    set_values_matches_set_value(1, 2);
+    set_values_matches_set_value(3, 6);
+    set_values_matches_set_value(5, 11);
+    set_values_matches_set_value(0, 1ul << TreeDepth);
+}
+
+TEST(MerkleTreeFieldTest, SetValuesAppend)
+{
+    // Append several blocks of leaves to a tree which already contains values,
+    // and compare against the same leaves inserted one at a time.
+    const std::vector<Field> block0 = random_values(3);
+    const std::vector<Field> block1 = random_values(5);
+    const std::vector<Field> block2 = random_values(1);
+
+    merkle_tree expected(TreeDepth);
+    size_t address = 0;
+    for (const std::vector<Field> *block : {&block0, &block1, &block2}) {
+        for (const Field &value : *block) {
+            expected.set_value(address++, value);
+        }
+    }
+
+    merkle_tree actual(TreeDepth);
+    actual.set_values(0, block0);
+    actual.set_values(block0.size(), block1);
+    actual.set_values(block0.size() + block1.size(), block2);
+    actual.set_values(address, {});
+
+    assert_trees_equal(expected, actual);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    pp::init_public_params();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,102 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#include "libzeth/circuits/circuit_types.hpp"
+#include "libzeth/core/merkle_tree_field.hpp"
+#include "libzeth/core/merkle_tree_field_versioned.hpp"
+
+#include <gtest/gtest.h>
+
+using pp = libff::alt_bn128_pp;
+using Field = libff::Fr<pp>;
+using HashTree = libzeth::HashTreeT<Field>;
+using merkle_tree = libzeth::merkle_tree_field<Field, HashTree>;
+using merkle_tree_versioned =
+    libzeth::merkle_tree_field_versioned<Field, HashTree>;
+
+static const size_t TreeDepth = 4;
+
+namespace
+{
+
+void assert_tree_matches_version(
+    const merkle_tree &expected,
+    const merkle_tree_versioned &actual,
+    const size_t version)
+{
+    ASSERT_EQ(expected.get_root(), actual.get_root(version));
+    for (size_t address = 0; address < (1ul << TreeDepth); ++address) {
+        ASSERT_EQ(
+            expected.get_value(address), actual.get_value(address, version));
+        ASSERT_EQ(
+            expected.get_path(address), actual.get_path(address, version));
+    }
+}
+
+TEST(MerkleTreeFieldVersionedTest, HistoricalPaths)
+{
+    const size_t num_updates = 6;
+    merkle_tree_versioned tree(TreeDepth, num_updates + 1);
+
+    // Keep a snapshot of an in-memory tree for each version.
+    std::vector<merkle_tree> snapshots;
+    merkle_tree current(TreeDepth);
+    snapshots.push_back(current);
+    for (size_t i = 0; i < num_updates; ++i) {
+        // Alternate between appending blocks and overwriting old leaves.
+        const size_t address = (i % 2 == 0) ? i : i / 2;
+        const std::vector<Field> values{
+            Field::random_element(), Field::random_element()};
+        current.set_values(address, values);
+        tree.set_values(address, values);
+        snapshots.push_back(current);
+        ASSERT_EQ(i + 1, tree.get_version());
+    }
+
+    for (size_t version = 0; version < snapshots.size(); ++version) {
+        assert_tree_matches_version(snapshots[version], tree, version);
+        ASSERT_EQ(
+            version, tree.get_version_of_root(snapshots[version].get_root()));
+    }
+    assert_tree_matches_version(current, tree, tree.get_version());
+    ASSERT_EQ(current.get_root(), tree.get_root());
+    ASSERT_EQ(current.get_path(3), tree.get_path(3));
+}
+
+TEST(MerkleTreeFieldVersionedTest, BoundedVersions)
+{
+    const size_t max_versions = 3;
+    merkle_tree_versioned tree(TreeDepth, max_versions);
+
+    std::vector<merkle_tree> snapshots;
+    merkle_tree current(TreeDepth);
+    snapshots.push_back(current);
+    for (size_t i = 0; i < 8; ++i) {
+        const Field value = Field::random_element();
+        current.set_value(i % 5, value);
+        tree.set_value(i % 5, value);
+        snapshots.push_back(current);
+    }
+
+    ASSERT_EQ(8, tree.get_version());
+    ASSERT_EQ(6, tree.get_oldest_version());
+    for (size_t version = 6; version <= 8; ++version) {
+        assert_tree_matches_version(snapshots[version], tree, version);
+    }
+
+    ASSERT_THROW(tree.get_root(5), std::invalid_argument);
+    ASSERT_THROW(tree.get_path(0, 9), std::invalid_argument);
+    ASSERT_THROW(
+        tree.get_version_of_root(snapshots[2].get_root()),
+        std::invalid_argument);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    pp::init_public_params();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
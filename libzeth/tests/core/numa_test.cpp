@@ -0,0 +1,58 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#include "libzeth/core/numa.hpp"
+
+#include <gtest/gtest.h>
+#include <pthread.h>
+#include <sched.h>
+#include <thread>
+
+namespace
+{
+
+TEST(NumaTest, ParseCpuList)
+{
+    ASSERT_EQ(std::vector<size_t>{}, libzeth::parse_cpu_list(""));
+    ASSERT_EQ(std::vector<size_t>{3}, libzeth::parse_cpu_list("3\n"));
+    ASSERT_EQ(
+        (std::vector<size_t>{0, 1, 2, 3, 8, 10, 11}),
+        libzeth::parse_cpu_list("0-3,8,10-11"));
+
+    ASSERT_THROW(libzeth::parse_cpu_list("0-"), std::invalid_argument);
+    ASSERT_THROW(libzeth::parse_cpu_list("3-1"), std::invalid_argument);
+    ASSERT_THROW(libzeth::parse_cpu_list("a"), std::invalid_argument);
+}
+
+TEST(NumaTest, GetNodes)
+{
+    const std::vector<libzeth::numa_node> nodes = libzeth::get_numa_nodes();
+    ASSERT_FALSE(nodes.empty());
+    for (const libzeth::numa_node &node : nodes) {
+        ASSERT_FALSE(node.cpus.empty());
+    }
+}
+
+TEST(NumaTest, PinThread)
+{
+    // Pin a thread to the first CPU of the first node, and check that
+    // threads it creates inherit the affinity.
+    const size_t cpu = libzeth::get_numa_nodes()[0].cpus[0];
+    std::thread thread([cpu]() {
+        libzeth::pin_current_thread({cpu});
+        std::thread child([cpu]() {
+            cpu_set_t cpu_set;
+            ASSERT_EQ(
+                0,
+                pthread_getaffinity_np(
+                    pthread_self(), sizeof(cpu_set), &cpu_set));
+            ASSERT_EQ(1, CPU_COUNT(&cpu_set));
+            ASSERT_TRUE(CPU_ISSET(cpu, &cpu_set));
+        });
+        child.join();
+    });
+    thread.join();
+}
+
+} // namespace
@@ -0,0 +1,67 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#include "libzeth/core/proof_rng.hpp"
+#include "libzeth/core/utils.hpp"
+
+#include <gtest/gtest.h>
+#include <libff/algebra/curves/alt_bn128/alt_bn128_pp.hpp>
+#include <libff/algebra/curves/bls12_377/bls12_377_pp.hpp>
+
+using namespace libzeth;
+
+namespace
+{
+
+static const size_t NUM_ELEMENTS = 16;
+
+template<typename FieldT> void proof_rng_test()
+{
+    const std::string seed = hex_to_bytes(
+        "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef");
+    const std::string other_seed = hex_to_bytes(
+        "fedcba9876543210fedcba9876543210fedcba9876543210fedcba9876543210");
+
+    // Identically seeded sources give the same stream of elements, and
+    // successive elements differ.
+    proof_rng rng_1(seed.data(), seed.size());
+    proof_rng rng_2(seed.data(), seed.size());
+    proof_rng rng_other(other_seed.data(), other_seed.size());
+    FieldT previous = FieldT::zero();
+    for (size_t i = 0; i < NUM_ELEMENTS; ++i) {
+        const FieldT element = rng_1.random_element<FieldT>();
+        ASSERT_EQ(element, rng_2.random_element<FieldT>());
+        ASSERT_NE(element, rng_other.random_element<FieldT>());
+        ASSERT_NE(previous, element);
+        previous = element;
+    }
+
+    // Sources seeded from the operating system are independent.
+    proof_rng os_rng_1;
+    proof_rng os_rng_2;
+    ASSERT_NE(
+        os_rng_1.random_element<FieldT>(), os_rng_2.random_element<FieldT>());
+}
+
+TEST(ProofRngTest, ALT_BN128)
+{
+    proof_rng_test<libff::alt_bn128_Fr>();
+    proof_rng_test<libff::alt_bn128_Fq>();
+}
+
+TEST(ProofRngTest, BLS12_377)
+{
+    proof_rng_test<libff::bls12_377_Fr>();
+    proof_rng_test<libff::bls12_377_Fq>();
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    libff::alt_bn128_pp::init_public_params();
+    libff::bls12_377_pp::init_public_params();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
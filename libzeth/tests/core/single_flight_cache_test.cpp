@@ -0,0 +1,205 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#include "libzeth/core/single_flight_cache.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using cache = libzeth::single_flight_cache<size_t, std::string>;
+
+namespace
+{
+
+// Compute function which counts its invocations, and takes long enough for
+// concurrent callers to overlap.
+cache::compute_function counted_compute(
+    std::atomic<size_t> &num_computations, const size_t key)
+{
+    return [&num_computations, key]() {
+        ++num_computations;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        return std::to_string(key);
+    };
+}
+
+TEST(SingleFlightCacheTest, ConcurrentRequestsShareComputation)
+{
+    cache c(4);
+    std::atomic<size_t> num_computations(0);
+
+    std::vector<std::thread> threads;
+    std::vector<std::string> results(8);
+    for (size_t i = 0; i < results.size(); ++i) {
+        threads.emplace_back([&c, &num_computations, &results, i]() {
+            results[i] = c.get(7, counted_compute(num_computations, 7));
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    ASSERT_EQ(1, num_computations);
+    for (const std::string &result : results) {
+        ASSERT_EQ("7", result);
+    }
+
+    // Subsequent requests are served from the cache.
+    ASSERT_EQ("7", c.get(7, counted_compute(num_computations, 7)));
+    ASSERT_EQ(1, num_computations);
+}
+
+TEST(SingleFlightCacheTest, EvictionAndSpill)
+{
+    std::map<size_t, std::string> spilled;
+    cache c(
+        2,
+        [&spilled](const size_t &key, const std::string &value) {
+            spilled[key] = value;
+        },
+        [&spilled](const size_t &key, std::string &value) {
+            auto it = spilled.find(key);
+            if (it == spilled.end()) {
+                return false;
+            }
+            value = it->second;
+            return true;
+        });
+    std::atomic<size_t> num_computations(0);
+
+    c.get(1, counted_compute(num_computations, 1));
+    c.get(2, counted_compute(num_computations, 2));
+    // Use 1, so that 2 is evicted by the next insertion.
+    c.get(1, counted_compute(num_computations, 1));
+    c.get(3, counted_compute(num_computations, 3));
+    ASSERT_EQ(3, num_computations);
+    ASSERT_EQ(2, c.size());
+    ASSERT_EQ(1, spilled.size());
+    ASSERT_EQ("2", spilled[2]);
+
+    // 2 is loaded from the spilled values without being recomputed.
+    ASSERT_EQ("2", c.get(2, counted_compute(num_computations, 2)));
+    ASSERT_EQ(3, num_computations);
+}
+
+TEST(SingleFlightCacheTest, SpillDoesNotBlockRequests)
+{
+    // The spill function blocks until released by the test.
+    std::promise<void> release_spill;
+    std::shared_future<void> spill_released =
+        release_spill.get_future().share();
+    std::promise<void> spill_started;
+    cache c(
+        1,
+        [&spill_started, spill_released](
+            const size_t &, const std::string &) {
+            spill_started.set_value();
+            spill_released.wait();
+        });
+    std::atomic<size_t> num_computations(0);
+
+    c.get(1, counted_compute(num_computations, 1));
+    std::thread evicting_thread([&c, &num_computations]() {
+        c.get(2, counted_compute(num_computations, 2));
+    });
+    spill_started.get_future().wait();
+
+    // While 1 is being spilled, 2 is served from the cache and 1 from the
+    // values being spilled, without waiting for the spill or recomputing.
+    ASSERT_EQ("2", c.get(2, counted_compute(num_computations, 2)));
+    ASSERT_EQ("1", c.get(1, counted_compute(num_computations, 1)));
+    ASSERT_EQ(2, num_computations);
+
+    release_spill.set_value();
+    evicting_thread.join();
+}
+
+TEST(SingleFlightCacheTest, FailedComputationIsNotCached)
+{
+    cache c(2);
+    std::atomic<size_t> num_computations(0);
+
+    ASSERT_THROW(
+        c.get(
+            1,
+            []() -> std::string { throw std::runtime_error("failed"); }),
+        std::runtime_error);
+    ASSERT_EQ(0, c.size());
+    ASSERT_EQ("1", c.get(1, counted_compute(num_computations, 1)));
+    ASSERT_EQ(1, num_computations);
+}
+
+TEST(SingleFlightCacheTest, SpillErrorIsIgnored)
+{
+    cache c(1, [](const size_t &, const std::string &) {
+        throw std::runtime_error("spill failed");
+    });
+    std::atomic<size_t> num_computations(0);
+
+    ASSERT_EQ("1", c.get(1, counted_compute(num_computations, 1)));
+    // Evicting 1 fails to spill it, but 2 is still returned.
+    ASSERT_EQ("2", c.get(2, counted_compute(num_computations, 2)));
+    ASSERT_EQ("1", c.get(1, counted_compute(num_computations, 1)));
+    ASSERT_EQ(3, num_computations);
+}
+
+class flag_cancellation_token : public libzeth::cancellation_token
+{
+public:
+    flag_cancellation_token() : cancelled(false) {}
+    bool is_cancelled() const override { return cancelled; }
+    std::atomic<bool> cancelled;
+};
+
+TEST(SingleFlightCacheTest, CancelledWaiterStopsWaiting)
+{
+    // The computation blocks until released by the test.
+    std::promise<void> release_compute;
+    std::shared_future<void> compute_released =
+        release_compute.get_future().share();
+    std::promise<void> compute_started;
+    cache c(2);
+
+    std::thread computing_thread([&]() {
+        c.get(1, [&]() {
+            compute_started.set_value();
+            compute_released.wait();
+            return std::string("1");
+        });
+    });
+    compute_started.get_future().wait();
+
+    flag_cancellation_token cancel;
+    std::thread cancelling_thread([&cancel]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        cancel.cancelled = true;
+    });
+    ASSERT_THROW(
+        c.get(
+            1,
+            []() -> std::string { throw std::runtime_error("unexpected"); },
+            &cancel),
+        libzeth::operation_cancelled);
+    cancelling_thread.join();
+
+    // The computation is unaffected, and its result is cached.
+    release_compute.set_value();
+    computing_thread.join();
+    std::atomic<size_t> num_computations(0);
+    ASSERT_EQ("1", c.get(1, counted_compute(num_computations, 1)));
+    ASSERT_EQ(0, num_computations);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
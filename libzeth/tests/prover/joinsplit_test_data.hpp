@@ -0,0 +1,62 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#ifndef __ZETH_TEST_PROVER_JOINSPLIT_TEST_DATA_HPP__
+#define __ZETH_TEST_PROVER_JOINSPLIT_TEST_DATA_HPP__
+
+#include <cstddef>
+
+namespace libzeth
+{
+namespace tests
+{
+
+/// Notes and keys of the "JS 2-2" joinsplit test case (TestValidJS2In2Case1
+/// in prover_test), for tests which need a valid joinsplit: a note of value
+/// 0x2F0000000000000F at address 1 is spent, creating a note of value
+/// 0x1800000000000008 and a public output of 0x1700000000000007. Additional
+/// inputs and outputs are zero-valued. Values are hex strings, except for the
+/// commitment which is a decimal field element.
+namespace js_2_2
+{
+
+const char *const INPUT_TRAP_R =
+    "0F000000000000FF00000000000000FF00000000000000FF00000000000000FF";
+const char *const INPUT_VALUE = "2F0000000000000F";
+const char *const INPUT_A_SK =
+    "FF0000000000000000000000000000000000000000000000000000000000000F";
+const char *const INPUT_RHO =
+    "FFFF000000000000000000000000000000000000000000000000000000009009";
+const char *const INPUT_A_PK =
+    "f172d7299ac8ac974ea59413e4a87691826df038ba24a2b52d5c5d15c2cc8c49";
+const char *const INPUT_NULLIFIER =
+    "ff2f41920346251f6e7c67062149f98bc90c915d3d3020927ca01deab5da0fd7";
+const char *const INPUT_COMMITMENT =
+    "104233707326581956155878965211552591892620143524616864409706009242461667"
+    "751082";
+const size_t INPUT_ADDRESS = 1;
+const char *const DUMMY_INPUT_RHO =
+    "AAAA00000000000000000000000000000000000000000000000000000000EEEE";
+
+const char *const OUTPUT_VALUE = "1800000000000008";
+const char *const OUTPUT_A_PK =
+    "7777f753bfe21ba2219ced74875b8dbd8c114c3c79d7e41306dd82118de1895b";
+const char *const OUTPUT_RHO =
+    "0000000000000000000000000000000000000000000000000000000000000000";
+const char *const OUTPUT_TRAP_R =
+    "11000000000000990000000000000099000000000000007700000000000000FF";
+
+const char *const ZERO_VALUE = "0000000000000000";
+const char *const VPUB_OUT = "1700000000000007";
+const char *const H_SIG =
+    "6838aac4d8247655715d3dfb9b32573da2b7d3360ba89ccdaaa7923bb24c99f7";
+const char *const PHI =
+    "403794c0e20e3bf36b820d8f7aef5505e5d1c7ac265d5efbcc3030a74a3f701b";
+
+} // namespace js_2_2
+
+} // namespace tests
+} // namespace libzeth
+
+#endif // __ZETH_TEST_PROVER_JOINSPLIT_TEST_DATA_HPP__
@@ -0,0 +1,352 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#include "libzeth/circuits/circuit_types.hpp"
+#include "libzeth/core/multi_exp.hpp"
+#include "libzeth/core/utils.hpp"
+#include "libzeth/tests/prover/joinsplit_test_data.hpp"
+#include "libzeth/zeth_constants.hpp"
+
+#include <chrono>
+#include <gtest/gtest.h>
+
+// Compare the libzeth multi-exponentiation functions with those of libff:
+// multi_exp_classified on the witness of a real joinsplit (with the depth of
+// the deployed Merkle tree), to benchmark the effect of the distribution of
+// the witness values, and multi_exp_batch_affine on the G1 and G2 groups of
+// each supported pairing.
+
+using namespace libzeth;
+using pp = defaults::pp;
+using Field = defaults::Field;
+using G1 = libff::G1<pp>;
+
+namespace js_2_2 = libzeth::tests::js_2_2;
+
+static const size_t TreeDepth = ZETH_MERKLE_TREE_DEPTH;
+
+namespace
+{
+
+// Full assignment (including the constant variable) of a valid 2-2 joinsplit,
+// spending a single note (the js_2_2 test case).
+std::vector<Field> joinsplit_padded_assignment()
+{
+    const bits256 trap_r = bits256::from_hex(js_2_2::INPUT_TRAP_R);
+    const bits256 a_sk = bits256::from_hex(js_2_2::INPUT_A_SK);
+    const bits256 a_pk = bits256::from_hex(js_2_2::INPUT_A_PK);
+    const bits256 nf = bits256::from_hex(js_2_2::INPUT_NULLIFIER);
+    const Field cm(js_2_2::INPUT_COMMITMENT);
+    const size_t address = js_2_2::INPUT_ADDRESS;
+    libff::bit_vector address_bits;
+    for (size_t i = 0; i < TreeDepth; ++i) {
+        address_bits.push_back((address >> i) & 0x1);
+    }
+
+    merkle_tree_field<Field, HashTreeT<Field>> tree(TreeDepth);
+    tree.set_value(address, cm);
+    const Field root = tree.get_root();
+    std::vector<Field> path = tree.get_path(address);
+
+    std::array<joinsplit_input<Field, TreeDepth>, 2> inputs;
+    inputs[0] = joinsplit_input<Field, TreeDepth>(
+        std::vector<Field>(path),
+        bits_addr<TreeDepth>::from_vector(address_bits),
+        zeth_note(
+            a_pk,
+            bits64::from_hex(js_2_2::INPUT_VALUE),
+            bits256::from_hex(js_2_2::INPUT_RHO),
+            trap_r),
+        a_sk,
+        nf);
+    inputs[1] = joinsplit_input<Field, TreeDepth>(
+        std::move(path),
+        bits_addr<TreeDepth>::from_vector(address_bits),
+        zeth_note(
+            a_pk,
+            bits64::from_hex(js_2_2::ZERO_VALUE),
+            bits256::from_hex(js_2_2::DUMMY_INPUT_RHO),
+            trap_r),
+        a_sk,
+        nf);
+
+    const bits256 a_pk_out = bits256::from_hex(js_2_2::OUTPUT_A_PK);
+    const bits256 rho_out = bits256::from_hex(js_2_2::OUTPUT_RHO);
+    const bits256 trap_r_out = bits256::from_hex(js_2_2::OUTPUT_TRAP_R);
+    std::array<zeth_note, 2> outputs;
+    outputs[0] = zeth_note(
+        a_pk_out,
+        bits64::from_hex(js_2_2::OUTPUT_VALUE),
+        rho_out,
+        trap_r_out);
+    outputs[1] = zeth_note(
+        a_pk_out, bits64::from_hex(js_2_2::ZERO_VALUE), rho_out, trap_r_out);
+
+    libsnark::protoboard<Field> pb;
+    joinsplit_gadget<Field, HashT<Field>, HashTreeT<Field>, 2, 2, TreeDepth> g(
+        pb);
+    g.generate_r1cs_constraints();
+    g.generate_r1cs_witness(
+        root,
+        inputs,
+        outputs,
+        bits64::from_hex(js_2_2::ZERO_VALUE),
+        bits64::from_hex(js_2_2::VPUB_OUT),
+        bits256::from_hex(js_2_2::H_SIG),
+        bits256::from_hex(js_2_2::PHI));
+    EXPECT_TRUE(pb.is_satisfied());
+
+    std::vector<Field> padded_assignment{Field::one()};
+    const libsnark::r1cs_variable_assignment<Field> assignment =
+        pb.full_variable_assignment();
+    padded_assignment.insert(
+        padded_assignment.end(), assignment.begin(), assignment.end());
+    return padded_assignment;
+}
+
+// Distinct affine bases (P, P + Q, P + 2Q, ...), cheaper to generate than
+// random elements.
+template<typename GroupT> std::vector<GroupT> affine_bases(size_t num_bases)
+{
+    const GroupT p = GroupT::random_element();
+    const GroupT q = GroupT::random_element();
+    std::vector<GroupT> bases;
+    bases.reserve(num_bases);
+    bases.push_back(p);
+    for (size_t i = 1; i < num_bases; ++i) {
+        bases.push_back(bases.back() + q);
+    }
+    GroupT::batch_to_special_all_non_zeros(bases);
+    return bases;
+}
+
+size_t elapsed_ms(
+    const std::chrono::steady_clock::time_point &start,
+    const std::chrono::steady_clock::time_point &end)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(end - start)
+        .count();
+}
+
+// Compare multi_exp_batch_affine with the libff BDLO12 multi-exponentiation,
+// for random scalars.
+template<typename GroupT, typename FieldT>
+void benchmark_batch_affine(const std::string &name, size_t num_terms)
+{
+    const std::vector<GroupT> bases = affine_bases<GroupT>(num_terms);
+    std::vector<FieldT> scalars;
+    scalars.reserve(num_terms);
+    for (size_t i = 0; i < num_terms; ++i) {
+        scalars.push_back(FieldT::random_element());
+    }
+    const libff::multi_exp_method Method = libff::multi_exp_method_BDLO12;
+
+    const std::chrono::steady_clock::time_point libff_start =
+        std::chrono::steady_clock::now();
+    const GroupT libff_result = libff::multi_exp<GroupT, FieldT, Method>(
+        bases.begin(), bases.end(), scalars.begin(), scalars.end(), 1);
+    const std::chrono::steady_clock::time_point batch_affine_start =
+        std::chrono::steady_clock::now();
+    const GroupT batch_affine_result = multi_exp_batch_affine<GroupT, FieldT>(
+        bases.begin(), bases.end(), scalars.begin(), scalars.end(), 1);
+    const std::chrono::steady_clock::time_point batch_affine_end =
+        std::chrono::steady_clock::now();
+
+    std::cout << name << " (" << num_terms << " terms): BDLO12 "
+              << elapsed_ms(libff_start, batch_affine_start)
+              << " ms, batch affine "
+              << elapsed_ms(batch_affine_start, batch_affine_end) << " ms\n";
+    ASSERT_EQ(libff_result, batch_affine_result);
+}
+
+TEST(MultiExpTest, JoinsplitWitness)
+{
+    const std::vector<Field> padded_assignment = joinsplit_padded_assignment();
+    const multi_exp_scalar_classes classes =
+        multi_exp_classify_scalars<Field>(
+            padded_assignment.begin(), padded_assignment.end());
+    std::cout << "witness of " << padded_assignment.size()
+              << " values: " << classes.num_zero << " zero, "
+              << classes.num_one << " one, " << classes.num_small
+              << " small, " << classes.num_full << " full\n";
+    ASSERT_EQ(
+        padded_assignment.size(),
+        classes.num_zero + classes.num_one + classes.num_small +
+            classes.num_full);
+
+    const std::vector<G1> bases = affine_bases<G1>(padded_assignment.size());
+    const libff::multi_exp_method Method = libff::multi_exp_method_BDLO12;
+
+    const std::chrono::steady_clock::time_point libff_start =
+        std::chrono::steady_clock::now();
+    const G1 libff_result =
+        libff::multi_exp_with_mixed_addition<G1, Field, Method>(
+            bases.begin(),
+            bases.end(),
+            padded_assignment.begin(),
+            padded_assignment.end(),
+            1);
+    const std::chrono::steady_clock::time_point classified_start =
+        std::chrono::steady_clock::now();
+    const G1 classified_result = multi_exp_classified<G1, Field>(
+        bases.begin(),
+        bases.end(),
+        padded_assignment.begin(),
+        padded_assignment.end(),
+        1);
+    const std::chrono::steady_clock::time_point classified_end =
+        std::chrono::steady_clock::now();
+
+    std::cout << "multi_exp_with_mixed_addition: "
+              << elapsed_ms(libff_start, classified_start) << " ms\n"
+              << "multi_exp_classified: "
+              << elapsed_ms(classified_start, classified_end) << " ms\n";
+    ASSERT_EQ(libff_result, classified_result);
+}
+
+TEST(MultiExpTest, ChunkedMatchesLibff)
+{
+    // Mixture of all classes of scalars, split into more chunks than terms
+    // in some cases.
+    std::vector<Field> scalars;
+    for (size_t i = 0; i < 64; ++i) {
+        switch (i % 4) {
+        case 0:
+            scalars.push_back(Field::zero());
+            break;
+        case 1:
+            scalars.push_back(Field::one());
+            break;
+        case 2:
+            scalars.push_back(Field((long)(i * 12345)));
+            break;
+        default:
+            scalars.push_back(Field::random_element());
+            break;
+        }
+    }
+    const std::vector<G1> bases = affine_bases<G1>(scalars.size());
+    const libff::multi_exp_method Method = libff::multi_exp_method_BDLO12;
+    const G1 expected = libff::multi_exp<G1, Field, Method>(
+        bases.begin(), bases.end(), scalars.begin(), scalars.end(), 1);
+    for (const size_t chunks : {1, 3, 8, 100}) {
+        ASSERT_EQ(
+            expected,
+            multi_exp_classified<G1, Field>(
+                bases.begin(),
+                bases.end(),
+                scalars.begin(),
+                scalars.end(),
+                chunks));
+    }
+}
+
+TEST(MultiExpTest, BatchAffineAltBN128)
+{
+    benchmark_batch_affine<libff::alt_bn128_G1, libff::alt_bn128_Fr>(
+        "alt_bn128 G1", 1 << 16);
+    benchmark_batch_affine<libff::alt_bn128_G2, libff::alt_bn128_Fr>(
+        "alt_bn128 G2", 1 << 14);
+}
+
+TEST(MultiExpTest, BatchAffineBLS12_377)
+{
+    benchmark_batch_affine<libff::bls12_377_G1, libff::bls12_377_Fr>(
+        "bls12_377 G1", 1 << 16);
+    benchmark_batch_affine<libff::bls12_377_G2, libff::bls12_377_Fr>(
+        "bls12_377 G2", 1 << 14);
+}
+
+TEST(MultiExpTest, BatchAffineEdgeCases)
+{
+    // Repeated bases and scalars (exercising doublings and deferred
+    // additions), negated bases (P + -P) and zero bases.
+    const G1 p = G1::random_element();
+    const G1 q = G1::random_element();
+    std::vector<G1> bases;
+    std::vector<Field> scalars;
+    for (size_t i = 0; i < MULTI_EXP_BATCH_AFFINE_MIN_SIZE; ++i) {
+        switch (i % 4) {
+        case 0:
+            bases.push_back(p);
+            break;
+        case 1:
+            bases.push_back(-p);
+            break;
+        case 2:
+            bases.push_back(G1::zero());
+            break;
+        default:
+            bases.push_back(q);
+            break;
+        }
+        scalars.push_back((i % 8 < 4) ? Field(5) : Field::random_element());
+    }
+    libff::batch_to_special(bases);
+    const libff::multi_exp_method Method = libff::multi_exp_method_BDLO12;
+    const G1 expected = libff::multi_exp<G1, Field, Method>(
+        bases.begin(), bases.end(), scalars.begin(), scalars.end(), 1);
+    for (const size_t chunks : {1, 3}) {
+        ASSERT_EQ(
+            expected,
+            multi_exp_batch_affine<G1, Field>(
+                bases.begin(),
+                bases.end(),
+                scalars.begin(),
+                scalars.end(),
+                chunks));
+    }
+}
+
+TEST(MultiExpTest, NonAffineBases)
+{
+    // Bases in Jacobian form (as returned by libff::batch_exp, for example),
+    // with enough terms for multi_exp_affine to use multi_exp_batch_affine.
+    const G1 p = G1::random_element();
+    const G1 q = G1::random_element();
+    std::vector<G1> bases{p};
+    std::vector<Field> scalars{Field::one()};
+    for (size_t i = 1; i < MULTI_EXP_BATCH_AFFINE_MIN_SIZE; ++i) {
+        bases.push_back(bases.back() + q);
+        switch (i % 3) {
+        case 0:
+            scalars.push_back(Field::one());
+            break;
+        case 1:
+            scalars.push_back(Field((long)(i * 12345)));
+            break;
+        default:
+            scalars.push_back(Field::random_element());
+            break;
+        }
+    }
+    ASSERT_FALSE(bases.back().is_special());
+
+    const libff::multi_exp_method Method = libff::multi_exp_method_BDLO12;
+    const G1 expected = libff::multi_exp<G1, Field, Method>(
+        bases.begin(), bases.end(), scalars.begin(), scalars.end(), 1);
+    ASSERT_EQ(
+        expected,
+        libzeth::multi_exp<Field, G1>(
+            bases.begin(), bases.end(), scalars.begin(), scalars.end()));
+    ASSERT_EQ(
+        expected,
+        multi_exp_affine<G1, Field>(
+            bases.begin(), bases.end(), scalars.begin(), scalars.end(), 2));
+    ASSERT_EQ(
+        expected,
+        multi_exp_classified<G1, Field>(
+            bases.begin(), bases.end(), scalars.begin(), scalars.end(), 2));
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    pp::init_public_params();
+    libff::alt_bn128_pp::init_public_params();
+    libff::bls12_377_pp::init_public_params();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -4,12 +4,15 @@
 
 #include "libzeth/serialization/r1cs_serialization.hpp"
 
+#include <cstring>
 #include <gtest/gtest.h>
 #include <libff/algebra/curves/alt_bn128/alt_bn128_pp.hpp>
 #include <libff/algebra/curves/bls12_377/bls12_377_pp.hpp>
 #include <libff/algebra/curves/bw6_761/bw6_761_pp.hpp>
 #include <libff/algebra/curves/mnt/mnt4/mnt4_pp.hpp>
 #include <libff/algebra/curves/mnt/mnt6/mnt6_pp.hpp>
+#include <libsnark/gadgetlib1/protoboard.hpp>
+#include <limits>
 
 namespace
 {
@@ -52,6 +55,89 @@ template<typename ppT> void accumulation_vector_json_encode_decode()
     ASSERT_EQ(acc_vect_string, acc_vect_decoded_string);
 }
 
+template<typename ppT>
+libsnark::r1cs_constraint_system<libff::Fr<ppT>> test_r1cs()
+{
+    using Fr = libff::Fr<ppT>;
+    libsnark::protoboard<Fr> pb;
+    libsnark::pb_variable<Fr> x;
+    libsnark::pb_variable<Fr> y;
+    libsnark::pb_variable<Fr> z;
+    libsnark::pb_variable<Fr> w;
+    x.allocate(pb, "x");
+    y.allocate(pb, "y");
+    z.allocate(pb, "z");
+    w.allocate(pb, "w");
+    pb.set_input_sizes(2);
+
+    pb.add_r1cs_constraint(libsnark::r1cs_constraint<Fr>(x, y, z), "x*y=z");
+    pb.add_r1cs_constraint(
+        libsnark::r1cs_constraint<Fr>(x + Fr(7) * y, 1, -Fr::one() * w + z),
+        "(x+7y)*1=z-w");
+    pb.add_r1cs_constraint(
+        libsnark::r1cs_constraint<Fr>(
+            Fr::random_element() * w, Fr(-3), Fr::random_element()),
+        "random");
+    return pb.get_constraint_system();
+}
+
+template<typename ppT> void r1cs_bytes_encode_decode()
+{
+    using Fr = libff::Fr<ppT>;
+    const libsnark::r1cs_constraint_system<Fr> r1cs = test_r1cs<ppT>();
+
+    const std::string r1cs_bytes = [&r1cs]() {
+        std::stringstream ss;
+        libzeth::r1cs_write_bytes<ppT>(r1cs, ss);
+        return ss.str();
+    }();
+    ASSERT_EQ("r1cs", r1cs_bytes.substr(0, 4));
+
+    libsnark::r1cs_constraint_system<Fr> r1cs_decoded;
+    std::stringstream ss(r1cs_bytes);
+    libzeth::r1cs_read_bytes<ppT>(r1cs_decoded, ss);
+
+    ASSERT_EQ(r1cs.primary_input_size, r1cs_decoded.primary_input_size);
+    ASSERT_EQ(r1cs.auxiliary_input_size, r1cs_decoded.auxiliary_input_size);
+    ASSERT_EQ(r1cs.constraints, r1cs_decoded.constraints);
+}
+
+// Size of the magic, version and number of sections of a binary r1cs file,
+// and of the type and size of each section.
+static const size_t R1CS_BYTES_PREAMBLE_SIZE = 12;
+static const size_t R1CS_BYTES_SECTION_PREAMBLE_SIZE = 12;
+
+// Sections (including their type and size) of a binary r1cs encoding.
+std::vector<std::string> r1cs_bytes_sections(const std::string &r1cs_bytes)
+{
+    std::vector<std::string> sections;
+    size_t offset = R1CS_BYTES_PREAMBLE_SIZE;
+    while (offset < r1cs_bytes.size()) {
+        uint64_t size;
+        memcpy(&size, &r1cs_bytes[offset + sizeof(uint32_t)], sizeof(size));
+        sections.push_back(
+            r1cs_bytes.substr(offset, R1CS_BYTES_SECTION_PREAMBLE_SIZE + size));
+        offset += R1CS_BYTES_SECTION_PREAMBLE_SIZE + size;
+    }
+    return sections;
+}
+
+template<typename T>
+std::string replace_bytes(std::string bytes, const size_t offset, const T v)
+{
+    memcpy(&bytes[offset], &v, sizeof(v));
+    return bytes;
+}
+
+void r1cs_bytes_decode_throws(const std::string &r1cs_bytes)
+{
+    using ppT = libff::alt_bn128_pp;
+    libsnark::r1cs_constraint_system<libff::Fr<ppT>> r1cs;
+    std::stringstream ss(r1cs_bytes);
+    ASSERT_THROW(
+        libzeth::r1cs_read_bytes<ppT>(r1cs, ss), std::invalid_argument);
+}
+
 TEST(R1CSSerializationTest, PrimaryInputsJsonEncodeDecode)
 {
     primary_inputs_json_encode_decode<libff::alt_bn128_pp>();
@@ -70,6 +156,79 @@ TEST(R1CSSerializationTest, AccumulationVectorJsonEncodeDecode)
     accumulation_vector_json_encode_decode<libff::bw6_761_pp>();
 }
 
+TEST(R1CSSerializationTest, R1CSBytesEncodeDecode)
+{
+    r1cs_bytes_encode_decode<libff::alt_bn128_pp>();
+    r1cs_bytes_encode_decode<libff::mnt4_pp>();
+    r1cs_bytes_encode_decode<libff::mnt6_pp>();
+    r1cs_bytes_encode_decode<libff::bls12_377_pp>();
+    r1cs_bytes_encode_decode<libff::bw6_761_pp>();
+}
+
+TEST(R1CSSerializationTest, R1CSBytesFieldMismatch)
+{
+    std::stringstream ss;
+    libzeth::r1cs_write_bytes<libff::alt_bn128_pp>(
+        test_r1cs<libff::alt_bn128_pp>(), ss);
+
+    libsnark::r1cs_constraint_system<libff::Fr<libff::bls12_377_pp>> r1cs;
+    ASSERT_THROW(
+        libzeth::r1cs_read_bytes<libff::bls12_377_pp>(r1cs, ss),
+        std::invalid_argument);
+}
+
+TEST(R1CSSerializationTest, R1CSBytesSectionOrder)
+{
+    using ppT = libff::alt_bn128_pp;
+    const libsnark::r1cs_constraint_system<libff::Fr<ppT>> r1cs =
+        test_r1cs<ppT>();
+    std::stringstream ss;
+    libzeth::r1cs_write_bytes<ppT>(r1cs, ss);
+    const std::string r1cs_bytes = ss.str();
+
+    // The header, constraints and wire-to-label sections, in reverse order.
+    const std::vector<std::string> sections = r1cs_bytes_sections(r1cs_bytes);
+    ASSERT_EQ(3, sections.size());
+    std::stringstream reordered_ss(
+        r1cs_bytes.substr(0, R1CS_BYTES_PREAMBLE_SIZE) + sections[2] +
+        sections[1] + sections[0]);
+
+    libsnark::r1cs_constraint_system<libff::Fr<ppT>> r1cs_decoded;
+    libzeth::r1cs_read_bytes<ppT>(r1cs_decoded, reordered_ss);
+    ASSERT_EQ(r1cs.primary_input_size, r1cs_decoded.primary_input_size);
+    ASSERT_EQ(r1cs.auxiliary_input_size, r1cs_decoded.auxiliary_input_size);
+    ASSERT_EQ(r1cs.constraints, r1cs_decoded.constraints);
+}
+
+TEST(R1CSSerializationTest, R1CSBytesInvalidCounts)
+{
+    using ppT = libff::alt_bn128_pp;
+    using Fr = libff::Fr<ppT>;
+    std::stringstream ss;
+    libzeth::r1cs_write_bytes<ppT>(test_r1cs<ppT>(), ss);
+    const std::string r1cs_bytes = ss.str();
+    const std::vector<std::string> sections = r1cs_bytes_sections(r1cs_bytes);
+
+    // Counts which exceed the data are rejected before any memory is
+    // reserved for them.
+    const size_t header_offset = R1CS_BYTES_PREAMBLE_SIZE;
+    const size_t constraints_offset = header_offset + sections[0].size();
+    const size_t num_constraints_offset =
+        header_offset + R1CS_BYTES_SECTION_PREAMBLE_SIZE +
+        sizeof(libff::bigint<Fr::num_limbs>) + 5 * sizeof(uint32_t) +
+        sizeof(uint64_t);
+    r1cs_bytes_decode_throws(replace_bytes<uint32_t>(
+        r1cs_bytes, num_constraints_offset, 0xffffffff));
+    r1cs_bytes_decode_throws(replace_bytes<uint32_t>(
+        r1cs_bytes,
+        constraints_offset + R1CS_BYTES_SECTION_PREAMBLE_SIZE,
+        0xffffffff));
+    r1cs_bytes_decode_throws(replace_bytes<uint64_t>(
+        r1cs_bytes,
+        constraints_offset + sizeof(uint32_t),
+        std::numeric_limits<uint64_t>::max()));
+}
+
 } // namespace
 
 int main(int argc, char **argv)
@@ -0,0 +1,181 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#include "libzeth/serialization/shared_memory_channel.hpp"
+#include "libzeth/serialization/shared_memory_ring.hpp"
+
+#include <cstring>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+
+std::string ring_name(const std::string &name)
+{
+    return "/zeth_test_" + name + "_" + std::to_string(getpid());
+}
+
+void write_message(libzeth::shared_memory_ring &ring, const std::string &msg)
+{
+    void *dest = ring.reserve(msg.size(), std::chrono::seconds(10));
+    if (dest == nullptr) {
+        throw std::runtime_error("timed out writing message");
+    }
+    memcpy(dest, msg.data(), msg.size());
+    ring.publish(msg.size());
+}
+
+std::string read_message(libzeth::shared_memory_ring &ring)
+{
+    const void *data;
+    size_t size;
+    if (!ring.read(data, size, std::chrono::seconds(10))) {
+        throw std::runtime_error("timed out reading message");
+    }
+    const std::string msg((const char *)data, size);
+    ring.release();
+    return msg;
+}
+
+TEST(SharedMemoryRingTest, WriteAndRead)
+{
+    const std::string name = ring_name("write_read");
+    libzeth::shared_memory_ring writer(name, 64);
+    libzeth::shared_memory_ring reader(name);
+    ASSERT_EQ(56, writer.max_message_size());
+
+    // No message available
+    const void *data;
+    size_t size;
+    ASSERT_FALSE(reader.read(data, size, std::chrono::microseconds(10)));
+
+    // Messages of various sizes, some of which must wrap around the end of
+    // the ring.
+    for (size_t i = 0; i < 40; ++i) {
+        const std::string msg(i % 23, (char)('a' + (i % 26)));
+        write_message(writer, msg);
+        ASSERT_EQ(msg, read_message(reader));
+    }
+
+    // A message smaller than the reserved space.
+    void *dest = writer.reserve(20, std::chrono::seconds(10));
+    memcpy(dest, "short", 5);
+    writer.publish(5);
+    ASSERT_EQ("short", read_message(reader));
+
+    ASSERT_THROW(
+        writer.reserve(57, std::chrono::seconds(10)), std::invalid_argument);
+}
+
+TEST(SharedMemoryRingTest, ReserveTimeout)
+{
+    const std::string name = ring_name("reserve_timeout");
+    libzeth::shared_memory_ring writer(name, 64);
+    libzeth::shared_memory_ring reader(name);
+
+    // The ring is full until the reader releases the first message.
+    write_message(writer, std::string(24, 'a'));
+    write_message(writer, std::string(16, 'b'));
+    ASSERT_EQ(nullptr, writer.reserve(8, std::chrono::microseconds(100)));
+
+    ASSERT_EQ(std::string(24, 'a'), read_message(reader));
+    write_message(writer, std::string(8, 'c'));
+    ASSERT_EQ(std::string(16, 'b'), read_message(reader));
+    ASSERT_EQ(std::string(8, 'c'), read_message(reader));
+}
+
+TEST(SharedMemoryRingTest, InvalidRecord)
+{
+    const std::string name = ring_name("invalid_record");
+    libzeth::shared_memory_ring writer(name, 64);
+    libzeth::shared_memory_ring reader(name);
+
+    // A record whose size extends past the end of the ring.
+    write_message(writer, "abc");
+    uint8_t *record = (uint8_t *)writer.reserve(0, std::chrono::seconds(10));
+    writer.publish(0);
+    const uint32_t size = 1000;
+    memcpy(record - 8, &size, sizeof(size));
+
+    ASSERT_EQ("abc", read_message(reader));
+    const void *data;
+    size_t data_size;
+    ASSERT_THROW(
+        reader.read(data, data_size, std::chrono::seconds(10)),
+        std::runtime_error);
+}
+
+TEST(SharedMemoryRingTest, ConcurrentWriterAndReader)
+{
+    const std::string name = ring_name("concurrent");
+    const size_t num_messages = 10000;
+    libzeth::shared_memory_ring writer(name, 1024);
+    libzeth::shared_memory_ring reader(name);
+
+    std::thread writer_thread([&writer]() {
+        for (size_t i = 0; i < num_messages; ++i) {
+            write_message(writer, std::string(i % 300, (char)i));
+        }
+    });
+
+    for (size_t i = 0; i < num_messages; ++i) {
+        ASSERT_EQ(std::string(i % 300, (char)i), read_message(reader));
+    }
+    writer_thread.join();
+}
+
+TEST(SharedMemoryRingTest, OpenInvalid)
+{
+    ASSERT_THROW(
+        libzeth::shared_memory_ring(ring_name("does_not_exist")),
+        std::runtime_error);
+}
+
+TEST(SharedMemoryRingTest, Channel)
+{
+    const std::string name = ring_name("channel");
+    libzeth::shared_memory_channel_server server(name, 256);
+    libzeth::shared_memory_channel_client client(name);
+
+    // Send several requests before reading the responses.
+    for (const std::string request : {"a", "bb", "ccc"}) {
+        void *dest =
+            client.reserve_request(request.size(), std::chrono::seconds(10));
+        memcpy(dest, request.data(), request.size());
+        client.publish_request(request.size());
+    }
+
+    for (uint32_t status = 0; status < 3; ++status) {
+        const void *data;
+        size_t size;
+        ASSERT_TRUE(
+            server.receive_request(data, size, std::chrono::seconds(10)));
+        const std::string response =
+            std::string((const char *)data, size) + "!";
+        server.release_request();
+
+        void *dest = server.reserve_response(
+            response.size(), std::chrono::seconds(10));
+        memcpy(dest, response.data(), response.size());
+        server.publish_response(status, response.size());
+    }
+
+    const std::vector<std::string> expected{"a!", "bb!", "ccc!"};
+    for (uint32_t i = 0; i < 3; ++i) {
+        uint32_t status;
+        const void *data;
+        size_t size;
+        ASSERT_TRUE(client.receive_response(
+            status, data, size, std::chrono::seconds(10)));
+        ASSERT_EQ(i, status);
+        ASSERT_EQ(expected[i], std::string((const char *)data, size));
+        client.release_response();
+    }
+}
+
+} // namespace
@@ -0,0 +1,387 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#include "libzeth/snarks/groth16/groth16_prover.hpp"
+#include "libzeth/snarks/groth16/groth16_snark.hpp"
+#include "libzeth/tests/circuits/simple_test.hpp"
+#include "zeth_config.h"
+
+#include <algorithm>
+#include <atomic>
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <libfqfft/evaluation_domain/domains/basic_radix2_domain.hpp>
+#include <libsnark/reductions/r1cs_to_qap/r1cs_to_qap.hpp>
+#include <sstream>
+#include <string>
+
+using namespace libsnark;
+
+using pp = libzeth::defaults::pp;
+using Fr = libff::Fr<pp>;
+using snark = libzeth::groth16_snark<pp>;
+
+namespace
+{
+
+// Token which is cancelled after it has been queried a given number of times
+// (from any thread).
+class countdown_cancellation_token : public libzeth::cancellation_token
+{
+public:
+    explicit countdown_cancellation_token(size_t num_checks)
+        : num_checks(num_checks)
+    {
+    }
+
+    bool is_cancelled() const override
+    {
+        size_t remaining = num_checks;
+        while (remaining != 0 &&
+               !num_checks.compare_exchange_weak(remaining, remaining - 1)) {
+        }
+        return remaining == 0;
+    }
+
+private:
+    mutable std::atomic<size_t> num_checks;
+};
+
+// Listener which records the stages reported.
+class recording_progress_listener : public libzeth::proof_progress_listener
+{
+public:
+    void stage_completed(const libzeth::proof_stage stage) override
+    {
+        stages.push_back(stage);
+    }
+
+    std::vector<libzeth::proof_stage> stages;
+};
+
+r1cs_constraint_system<Fr> get_simple_constraint_system()
+{
+    protoboard<Fr> pb;
+    libzeth::tests::simple_circuit<Fr>(pb);
+    return pb.get_constraint_system();
+}
+
+// Solution x = 1 (g1 = 1, g2 = 1), y = 12 (see simple_test.cpp).
+const r1cs_primary_input<Fr> primary{12};
+const r1cs_auxiliary_input<Fr> auxiliary{1, 1, 1};
+
+const std::string test_seed = "groth16 prover test seed";
+
+TEST(Groth16ProverTest, HCoefficientsMatchLibsnark)
+{
+    const r1cs_constraint_system<Fr> cs = get_simple_constraint_system();
+    const qap_witness<Fr> qap_wit = r1cs_to_qap_witness_map(
+        cs, primary, auxiliary, Fr::zero(), Fr::zero(), Fr::zero(), true);
+
+    std::vector<Fr> padded_assignment{Fr::one()};
+    padded_assignment.insert(
+        padded_assignment.end(), primary.begin(), primary.end());
+    padded_assignment.insert(
+        padded_assignment.end(), auxiliary.begin(), auxiliary.end());
+    const std::vector<Fr> coefficients_for_H =
+        libzeth::qap_compute_h_coefficients(cs, padded_assignment, nullptr);
+
+    ASSERT_EQ(qap_wit.degree(), coefficients_for_H.size());
+    for (size_t i = 0; i < coefficients_for_H.size(); ++i) {
+        ASSERT_EQ(qap_wit.coefficients_for_H[i], coefficients_for_H[i]);
+    }
+}
+
+TEST(Groth16ProverTest, ContextMatchesLibfqfft)
+{
+    // Domain of size 8 (5 constraints and 2 inputs, plus the constant), with
+    // and without precomputed domain data.
+    for (const bool precompute : {true, false}) {
+        libzeth::groth16_prover_context<Fr> context(5, 2, precompute);
+        ASSERT_EQ(8, context.get_domain_size());
+        libfqfft::basic_radix2_domain<Fr> domain(8);
+        const Fr &g = Fr::multiplicative_generator;
+
+        libzeth::groth16_prover_context<Fr>::buffer values(8);
+        for (Fr &value : values) {
+            value = Fr::random_element();
+        }
+        std::vector<Fr> expected = values;
+
+        context.domain_to_coset(values);
+        domain.iFFT(expected);
+        domain.cosetFFT(expected, g);
+        ASSERT_EQ(expected, values);
+
+        context.coset_divide_by_z_to_coefficients(values);
+        domain.divide_by_Z_on_coset(expected);
+        domain.icosetFFT(expected, g);
+        ASSERT_EQ(expected, values);
+    }
+}
+
+TEST(Groth16ProverTest, ContextReusedAcrossProofs)
+{
+    const r1cs_gg_ppzksnark_keypair<pp> keypair =
+        r1cs_gg_ppzksnark_generator<pp>(get_simple_constraint_system(), true);
+    libzeth::groth16_prover_context<Fr> context(keypair.pk.constraint_system);
+
+    // Scratch buffers are reused, and must not carry state between proofs.
+    for (size_t i = 0; i < 3; ++i) {
+        const snark::proof proof = libzeth::groth16_generate_proof<pp>(
+            keypair.pk, primary, auxiliary, context, nullptr);
+        ASSERT_TRUE(snark::verify(primary, proof, keypair.vk));
+    }
+
+    // Solution x = 2 (g1 = 4, g2 = 8), y = 33.
+    const r1cs_primary_input<Fr> primary_2{33};
+    const r1cs_auxiliary_input<Fr> auxiliary_2{2, 4, 8};
+    const snark::proof proof = libzeth::groth16_generate_proof<pp>(
+        keypair.pk, primary_2, auxiliary_2, context, nullptr);
+    ASSERT_TRUE(snark::verify(primary_2, proof, keypair.vk));
+}
+
+TEST(Groth16ProverTest, ProofVerifies)
+{
+    const r1cs_gg_ppzksnark_keypair<pp> keypair =
+        r1cs_gg_ppzksnark_generator<pp>(get_simple_constraint_system(), true);
+    const snark::proof proof = libzeth::groth16_generate_proof<pp>(
+        keypair.pk, primary, auxiliary, nullptr);
+    ASSERT_TRUE(snark::verify(primary, proof, keypair.vk));
+}
+
+TEST(Groth16ProverTest, SeededRandomness)
+{
+    const r1cs_gg_ppzksnark_keypair<pp> keypair =
+        r1cs_gg_ppzksnark_generator<pp>(get_simple_constraint_system(), true);
+
+    // Identically seeded sources give identical (valid) proofs.
+    libzeth::proof_rng rng_1(test_seed.data(), test_seed.size());
+    libzeth::proof_rng rng_2(test_seed.data(), test_seed.size());
+    const snark::proof proof_1 = libzeth::groth16_generate_proof<pp>(
+        keypair.pk, primary, auxiliary, nullptr, nullptr, &rng_1);
+    const snark::proof proof_2 = libzeth::groth16_generate_proof<pp>(
+        keypair.pk, primary, auxiliary, nullptr, nullptr, &rng_2);
+    ASSERT_TRUE(snark::verify(primary, proof_1, keypair.vk));
+    ASSERT_EQ(proof_1, proof_2);
+
+    // Successive proofs from the same source are blinded differently.
+    const snark::proof proof_3 = libzeth::groth16_generate_proof<pp>(
+        keypair.pk, primary, auxiliary, nullptr, nullptr, &rng_1);
+    ASSERT_TRUE(snark::verify(primary, proof_3, keypair.vk));
+    ASSERT_FALSE(proof_1 == proof_3);
+
+    // Without a source, each proof is seeded from the operating system.
+    const snark::proof proof_4 = libzeth::groth16_generate_proof<pp>(
+        keypair.pk, primary, auxiliary, nullptr);
+    const snark::proof proof_5 = libzeth::groth16_generate_proof<pp>(
+        keypair.pk, primary, auxiliary, nullptr);
+    ASSERT_TRUE(snark::verify(primary, proof_4, keypair.vk));
+    ASSERT_FALSE(proof_4 == proof_5);
+}
+
+TEST(Groth16ProverTest, VerifyBatch)
+{
+    using extended_proof = libzeth::extended_proof<pp, snark>;
+
+    const r1cs_gg_ppzksnark_keypair<pp> keypair =
+        r1cs_gg_ppzksnark_generator<pp>(get_simple_constraint_system(), true);
+    ASSERT_TRUE(snark::verify_batch({}, keypair.vk));
+
+    // Solutions x = 1 (y = 12) and x = 2 (y = 33), alternately.
+    const r1cs_primary_input<Fr> primary_2{33};
+    const r1cs_auxiliary_input<Fr> auxiliary_2{2, 4, 8};
+    std::vector<extended_proof> proofs;
+    for (size_t i = 0; i < 5; ++i) {
+        const r1cs_primary_input<Fr> &p = (i & 1) ? primary_2 : primary;
+        const r1cs_auxiliary_input<Fr> &a = (i & 1) ? auxiliary_2 : auxiliary;
+        proofs.emplace_back(
+            libzeth::groth16_generate_proof<pp>(keypair.pk, p, a, nullptr),
+            r1cs_primary_input<Fr>(p));
+        ASSERT_TRUE(snark::verify_batch(proofs, keypair.vk));
+    }
+
+    // A single invalid proof (here, with the inputs of another proof)
+    // invalidates the batch.
+    std::vector<extended_proof> invalid_proofs(proofs);
+    invalid_proofs[3] = extended_proof(
+        snark::proof(invalid_proofs[3].get_proof()),
+        r1cs_primary_input<Fr>(primary));
+    ASSERT_FALSE(snark::verify(
+        invalid_proofs[3].get_primary_inputs(),
+        invalid_proofs[3].get_proof(),
+        keypair.vk));
+    ASSERT_FALSE(snark::verify_batch(invalid_proofs, keypair.vk));
+
+    // Proofs with the wrong number of inputs are rejected.
+    invalid_proofs = proofs;
+    invalid_proofs[0] = extended_proof(
+        snark::proof(invalid_proofs[0].get_proof()),
+        r1cs_primary_input<Fr>{12, 12});
+    ASSERT_FALSE(snark::verify_batch(invalid_proofs, keypair.vk));
+}
+
+TEST(Groth16ProverTest, PreparedVerificationKey)
+{
+    const r1cs_gg_ppzksnark_keypair<pp> keypair =
+        r1cs_gg_ppzksnark_generator<pp>(get_simple_constraint_system(), true);
+    const snark::proof proof = libzeth::groth16_generate_proof<pp>(
+        keypair.pk, primary, auxiliary, nullptr);
+
+    // Check the prepared key after a round trip through its serialized form.
+    std::stringstream ss;
+    snark::prepared_verification_key_write_bytes(
+        snark::prepare_verification_key(keypair.vk), ss);
+    const snark::prepared_verification_key pvk =
+        snark::prepared_verification_key_read_bytes(ss);
+    ASSERT_TRUE(snark::verify(primary, proof, pvk));
+    ASSERT_FALSE(snark::verify(r1cs_primary_input<Fr>{33}, proof, pvk));
+
+    std::vector<libzeth::extended_proof<pp, snark>> proofs;
+    proofs.emplace_back(snark::proof(proof), r1cs_primary_input<Fr>(primary));
+    proofs.emplace_back(snark::proof(proof), r1cs_primary_input<Fr>(primary));
+    ASSERT_TRUE(snark::verify_batch(proofs, pvk));
+    proofs.emplace_back(snark::proof(proof), r1cs_primary_input<Fr>{33});
+    ASSERT_FALSE(snark::verify_batch(proofs, pvk));
+}
+
+TEST(Groth16ProverTest, Cancellation)
+{
+    const r1cs_gg_ppzksnark_keypair<pp> keypair =
+        r1cs_gg_ppzksnark_generator<pp>(get_simple_constraint_system(), true);
+
+    // Cancel at each stage in turn (4 FFT stages and 4 multi-exponentiations,
+    // which run concurrently), then check that the proof completes if the
+    // token is never cancelled.
+    for (size_t num_checks = 0; num_checks < 8; ++num_checks) {
+        const countdown_cancellation_token cancel(num_checks);
+        ASSERT_THROW(
+            libzeth::groth16_generate_proof<pp>(
+                keypair.pk, primary, auxiliary, &cancel),
+            libzeth::operation_cancelled);
+    }
+
+    const countdown_cancellation_token cancel(8);
+    const snark::proof proof = libzeth::groth16_generate_proof<pp>(
+        keypair.pk, primary, auxiliary, &cancel);
+    ASSERT_TRUE(snark::verify(primary, proof, keypair.vk));
+}
+
+TEST(Groth16ProverTest, ReportsProgress)
+{
+    const r1cs_gg_ppzksnark_keypair<pp> keypair =
+        r1cs_gg_ppzksnark_generator<pp>(get_simple_constraint_system(), true);
+    recording_progress_listener progress;
+    libzeth::groth16_generate_proof<pp>(
+        keypair.pk, primary, auxiliary, nullptr, &progress);
+
+    // H is computed concurrently with the A, B and L multi-exponentiations,
+    // so may be reported at any point before the H multi-exponentiation.
+    std::vector<libzeth::proof_stage> stages = progress.stages;
+    const auto h_computed = std::find(
+        stages.begin(), stages.end(), libzeth::proof_stage_h_computed);
+    ASSERT_NE(stages.end(), h_computed);
+    stages.erase(h_computed);
+
+    const std::vector<libzeth::proof_stage> expected{
+        libzeth::proof_stage_multi_exp_a,
+        libzeth::proof_stage_multi_exp_b,
+        libzeth::proof_stage_multi_exp_l,
+        libzeth::proof_stage_multi_exp_h,
+    };
+    ASSERT_EQ(expected, stages);
+}
+
+TEST(Groth16ProverTest, StreamingProver)
+{
+    const r1cs_gg_ppzksnark_keypair<pp> keypair =
+        r1cs_gg_ppzksnark_generator<pp>(get_simple_constraint_system(), true);
+    const boost::filesystem::path pk_file =
+        boost::filesystem::temp_directory_path() /
+        boost::filesystem::unique_path("zeth_streaming_pk_%%%%%%%%.bin");
+    const std::string key_id(libzeth::GROTH16_STREAMING_KEY_ID_SIZE, 'k');
+    {
+        std::ofstream out_s(
+            pk_file.c_str(), std::ios_base::out | std::ios_base::binary);
+        snark::streaming_proving_key_write_bytes(keypair.pk, key_id, out_s);
+    }
+    const snark::streaming_proving_key proving_key(pk_file.string());
+    ASSERT_EQ(key_id, proving_key.key_id());
+    ASSERT_EQ(keypair.pk.alpha_g1, proving_key.alpha_g1());
+    ASSERT_EQ(keypair.pk.delta_g2, proving_key.delta_g2());
+    ASSERT_EQ(keypair.pk.B_query.values.size(), proving_key.b_query_size());
+    ASSERT_EQ(keypair.pk.H_query.size(), proving_key.h_query_size());
+    ASSERT_EQ(
+        keypair.pk.constraint_system.num_constraints(),
+        proving_key.num_constraints());
+
+    std::vector<Fr> padded_assignment{Fr::one()};
+    padded_assignment.insert(
+        padded_assignment.end(), primary.begin(), primary.end());
+    padded_assignment.insert(
+        padded_assignment.end(), auxiliary.begin(), auxiliary.end());
+    const std::vector<Fr> coefficients_for_H =
+        libzeth::qap_compute_h_coefficients(
+            get_simple_constraint_system(), padded_assignment, nullptr);
+
+    // Small chunks, so that each section is split into several chunks. For
+    // the same randomness, the proof matches that of the in-memory prover.
+    libzeth::proof_rng expect_rng(test_seed.data(), test_seed.size());
+    const snark::proof expect = libzeth::groth16_generate_proof<pp>(
+        keypair.pk, primary, auxiliary, nullptr, nullptr, &expect_rng);
+    for (size_t chunk_size = 1; chunk_size <= 8; ++chunk_size) {
+        ASSERT_EQ(
+            coefficients_for_H,
+            libzeth::groth16_streaming_h_coefficients<pp>(
+                proving_key, padded_assignment, nullptr, chunk_size));
+
+        libzeth::proof_rng rng(test_seed.data(), test_seed.size());
+        const snark::proof proof =
+            libzeth::groth16_generate_proof_streaming<pp>(
+                proving_key,
+                padded_assignment,
+                coefficients_for_H,
+                nullptr,
+                nullptr,
+                &rng,
+                chunk_size);
+        ASSERT_TRUE(snark::verify(primary, proof, keypair.vk));
+        ASSERT_EQ(expect, proof);
+    }
+
+    // Prove from a protoboard, which is released by the prover.
+    protoboard<Fr> pb;
+    libzeth::tests::simple_circuit<Fr>(pb);
+    for (size_t i = 1; i < padded_assignment.size(); ++i) {
+        pb.val(pb_variable<Fr>(i)) = padded_assignment[i];
+    }
+    recording_progress_listener progress;
+    libzeth::proof_rng rng(test_seed.data(), test_seed.size());
+    const snark::proof proof = snark::generate_proof_low_memory(
+        std::move(pb), proving_key, nullptr, &progress, &rng);
+    ASSERT_TRUE(snark::verify(primary, proof, keypair.vk));
+    ASSERT_EQ(expect, proof);
+
+    const std::vector<libzeth::proof_stage> expected{
+        libzeth::proof_stage_h_computed,
+        libzeth::proof_stage_multi_exp_a,
+        libzeth::proof_stage_multi_exp_b,
+        libzeth::proof_stage_multi_exp_l,
+        libzeth::proof_stage_multi_exp_h,
+    };
+    ASSERT_EQ(expected, progress.stages);
+
+    boost::filesystem::remove(pk_file);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    pp::init_public_params();
+    libff::inhibit_profiling_info = true;
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
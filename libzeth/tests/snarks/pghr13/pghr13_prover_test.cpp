@@ -0,0 +1,66 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+#include "libzeth/snarks/pghr13/pghr13_snark.hpp"
+#include "libzeth/tests/circuits/simple_test.hpp"
+#include "zeth_config.h"
+
+#include <gtest/gtest.h>
+#include <sstream>
+
+using namespace libsnark;
+
+using pp = libzeth::defaults::pp;
+using Fr = libff::Fr<pp>;
+using snark = libzeth::pghr13_snark<pp>;
+
+namespace
+{
+
+r1cs_constraint_system<Fr> get_simple_constraint_system()
+{
+    protoboard<Fr> pb;
+    libzeth::tests::simple_circuit<Fr>(pb);
+    return pb.get_constraint_system();
+}
+
+// Solution x = 1 (g1 = 1, g2 = 1), y = 12 (see simple_test.cpp).
+const r1cs_primary_input<Fr> primary{12};
+const r1cs_auxiliary_input<Fr> auxiliary{1, 1, 1};
+
+TEST(PGHR13ProverTest, PreparedVerificationKey)
+{
+    const r1cs_ppzksnark_keypair<pp> keypair =
+        r1cs_ppzksnark_generator<pp>(get_simple_constraint_system());
+    const snark::proof proof =
+        r1cs_ppzksnark_prover<pp>(keypair.pk, primary, auxiliary);
+    ASSERT_TRUE(snark::verify(primary, proof, keypair.vk));
+
+    // Check the prepared key after a round trip through its serialized form.
+    std::stringstream ss;
+    snark::prepared_verification_key_write_bytes(
+        snark::prepare_verification_key(keypair.vk), ss);
+    const snark::prepared_verification_key pvk =
+        snark::prepared_verification_key_read_bytes(ss);
+    ASSERT_TRUE(snark::verify(primary, proof, pvk));
+    ASSERT_FALSE(snark::verify(r1cs_primary_input<Fr>{33}, proof, pvk));
+
+    std::vector<libzeth::extended_proof<pp, snark>> proofs;
+    proofs.emplace_back(snark::proof(proof), r1cs_primary_input<Fr>(primary));
+    proofs.emplace_back(snark::proof(proof), r1cs_primary_input<Fr>(primary));
+    ASSERT_TRUE(snark::verify_batch(proofs, pvk));
+    ASSERT_TRUE(snark::verify_batch(proofs, keypair.vk));
+    proofs.emplace_back(snark::proof(proof), r1cs_primary_input<Fr>{33});
+    ASSERT_FALSE(snark::verify_batch(proofs, pvk));
+    ASSERT_FALSE(snark::verify_batch(proofs, keypair.vk));
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    pp::init_public_params();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,448 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+// Load generator for prover_server. Sends valid synthetic proof requests to a
+// running server, at a fixed concurrency (closed loop) or at a fixed rate
+// (open loop), and reports latency percentiles, throughput and errors as
+// JSON.
+
+#include "libzeth/circuits/circuit_types.hpp"
+#include "libzeth/core/field_element_utils.hpp"
+#include "libzeth/core/merkle_tree_field.hpp"
+#include "libzeth/zeth_constants.hpp"
+#include "zeth_config.h"
+
+#include <algorithm>
+#include <atomic>
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <fstream>
+#include <grpcpp/create_channel.h>
+#include <grpcpp/security/credentials.h>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <zeth/api/prover.grpc.pb.h>
+
+using pp = libzeth::defaults::pp;
+using Field = libzeth::defaults::Field;
+using hash_tree = libzeth::HashTreeT<Field>;
+
+namespace po = boost::program_options;
+
+using steady_clock = std::chrono::steady_clock;
+
+namespace
+{
+
+// Notes and keys of the "JS 2-2" case of libzeth/tests/prover/prover_test.cpp:
+// a note of value 0x2F0000000000000F at address 1 is spent, creating a note
+// of value 0x1800000000000008 and a public output of 0x1700000000000007.
+// Additional inputs and outputs are zero-valued.
+const char *const INPUT_TRAP_R =
+    "0F000000000000FF00000000000000FF00000000000000FF00000000000000FF";
+const char *const INPUT_VALUE = "2F0000000000000F";
+const char *const INPUT_A_SK =
+    "FF0000000000000000000000000000000000000000000000000000000000000F";
+const char *const INPUT_RHO =
+    "FFFF000000000000000000000000000000000000000000000000000000009009";
+const char *const INPUT_A_PK =
+    "f172d7299ac8ac974ea59413e4a87691826df038ba24a2b52d5c5d15c2cc8c49";
+const char *const INPUT_NULLIFIER =
+    "ff2f41920346251f6e7c67062149f98bc90c915d3d3020927ca01deab5da0fd7";
+const char *const INPUT_COMMITMENT =
+    "104233707326581956155878965211552591892620143524616864409706009242461667"
+    "751082";
+const size_t INPUT_ADDRESS = 1;
+const char *const DUMMY_INPUT_RHO =
+    "AAAA00000000000000000000000000000000000000000000000000000000EEEE";
+
+const char *const OUTPUT_VALUE = "1800000000000008";
+const char *const OUTPUT_A_PK =
+    "7777f753bfe21ba2219ced74875b8dbd8c114c3c79d7e41306dd82118de1895b";
+const char *const OUTPUT_RHO =
+    "0000000000000000000000000000000000000000000000000000000000000000";
+const char *const OUTPUT_TRAP_R =
+    "11000000000000990000000000000099000000000000007700000000000000FF";
+
+const char *const ZERO_VALUE = "0000000000000000";
+const char *const VPUB_OUT = "1700000000000007";
+const char *const PHI =
+    "403794c0e20e3bf36b820d8f7aef5505e5d1c7ac265d5efbcc3030a74a3f701b";
+
+void set_note(
+    zeth_proto::ZethNote &note,
+    const char *a_pk,
+    const char *value,
+    const char *rho,
+    const char *trap_r)
+{
+    note.set_apk(a_pk);
+    note.set_value(value);
+    note.set_rho(rho);
+    note.set_trap_r(trap_r);
+}
+
+/// Create the proof inputs shared by all requests. Requests differ only in
+/// h_sig (see set_request_h_sig).
+zeth_proto::ProofInputs make_proof_inputs(
+    const std::string &circuit_id,
+    const size_t num_inputs,
+    const size_t num_outputs,
+    const size_t tree_depth)
+{
+    libzeth::merkle_tree_field<Field, hash_tree> tree(tree_depth);
+    tree.set_value(INPUT_ADDRESS, Field(INPUT_COMMITMENT));
+    const std::vector<Field> path = tree.get_path(INPUT_ADDRESS);
+
+    zeth_proto::ProofInputs proof_inputs;
+    proof_inputs.set_circuit_id(circuit_id);
+    proof_inputs.set_mk_root(
+        libzeth::base_field_element_to_hex(tree.get_root()));
+
+    // Zero-valued inputs are not checked against the tree, so all inputs
+    // use the path of the note being spent.
+    for (size_t i = 0; i < num_inputs; ++i) {
+        zeth_proto::JoinsplitInput *input = proof_inputs.add_js_inputs();
+        for (const Field &node : path) {
+            input->add_merkle_path(libzeth::base_field_element_to_hex(node));
+        }
+        input->set_address(INPUT_ADDRESS);
+        set_note(
+            *input->mutable_note(),
+            INPUT_A_PK,
+            (i == 0) ? INPUT_VALUE : ZERO_VALUE,
+            (i == 0) ? INPUT_RHO : DUMMY_INPUT_RHO,
+            INPUT_TRAP_R);
+        input->set_spending_ask(INPUT_A_SK);
+        input->set_nullifier(INPUT_NULLIFIER);
+    }
+
+    for (size_t i = 0; i < num_outputs; ++i) {
+        set_note(
+            *proof_inputs.add_js_outputs(),
+            OUTPUT_A_PK,
+            (i == 0) ? OUTPUT_VALUE : ZERO_VALUE,
+            OUTPUT_RHO,
+            OUTPUT_TRAP_R);
+    }
+
+    proof_inputs.set_pub_in_value(ZERO_VALUE);
+    proof_inputs.set_pub_out_value(VPUB_OUT);
+    proof_inputs.set_phi(PHI);
+    return proof_inputs;
+}
+
+/// h_sig is not constrained by the other inputs, so varying it gives distinct
+/// valid requests, which are not answered from the proof cache of the server.
+void set_request_h_sig(
+    zeth_proto::ProofInputs &proof_inputs,
+    const uint64_t run_id,
+    const uint64_t request_index)
+{
+    std::ostringstream h_sig;
+    h_sig << std::hex << std::setfill('0') << std::setw(16) << run_id
+          << std::setw(32) << 0 << std::setw(16) << request_index;
+    proof_inputs.set_h_sig(h_sig.str());
+}
+
+/// Outcome of the requests, shared by the client threads.
+class load_results
+{
+public:
+    std::mutex mutex;
+    std::vector<double> latencies_ms;
+    std::map<std::string, size_t> errors;
+
+    void record_success(const double latency_ms)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        latencies_ms.push_back(latency_ms);
+    }
+
+    void record_error(const grpc::Status &status)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++errors[status_code_name(status.error_code())];
+    }
+
+private:
+    static std::string status_code_name(const grpc::StatusCode code)
+    {
+        switch (code) {
+        case grpc::StatusCode::CANCELLED:
+            return "CANCELLED";
+        case grpc::StatusCode::INVALID_ARGUMENT:
+            return "INVALID_ARGUMENT";
+        case grpc::StatusCode::DEADLINE_EXCEEDED:
+            return "DEADLINE_EXCEEDED";
+        case grpc::StatusCode::RESOURCE_EXHAUSTED:
+            return "RESOURCE_EXHAUSTED";
+        case grpc::StatusCode::UNAVAILABLE:
+            return "UNAVAILABLE";
+        default:
+            return "CODE_" + std::to_string((int)code);
+        }
+    }
+};
+
+double percentile(const std::vector<double> &sorted, const double p)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    const size_t index = (size_t)(p * (double)(sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+void write_results_json(
+    std::ostream &out,
+    load_results &results,
+    const size_t num_requests,
+    const size_t concurrency,
+    const double rate,
+    const double duration_s)
+{
+    std::vector<double> latencies = results.latencies_ms;
+    std::sort(latencies.begin(), latencies.end());
+    double sum = 0;
+    for (const double latency : latencies) {
+        sum += latency;
+    }
+    size_t num_errors = 0;
+    for (const auto &entry : results.errors) {
+        num_errors += entry.second;
+    }
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\n"
+        << "  \"requests\": " << num_requests << ",\n"
+        << "  \"concurrency\": " << concurrency << ",\n"
+        << "  \"rate\": " << rate << ",\n"
+        << "  \"duration_s\": " << duration_s << ",\n"
+        << "  \"succeeded\": " << latencies.size() << ",\n"
+        << "  \"failed\": " << num_errors << ",\n"
+        << "  \"throughput_rps\": " << (double)latencies.size() / duration_s
+        << ",\n"
+        << "  \"latency_ms\": {\n"
+        << "    \"mean\": " << (latencies.empty() ? 0 : sum / latencies.size())
+        << ",\n"
+        << "    \"p50\": " << percentile(latencies, 0.50) << ",\n"
+        << "    \"p95\": " << percentile(latencies, 0.95) << ",\n"
+        << "    \"p99\": " << percentile(latencies, 0.99) << ",\n"
+        << "    \"max\": " << (latencies.empty() ? 0 : latencies.back())
+        << "\n"
+        << "  },\n"
+        << "  \"errors\": {";
+    const char *separator = "\n";
+    for (const auto &entry : results.errors) {
+        out << separator << "    \"" << entry.first << "\": " << entry.second;
+        separator = ",\n";
+    }
+    out << (results.errors.empty() ? "}\n" : "\n  }\n") << "}" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    po::options_description options("");
+    options.add_options()("help,h", "show this help");
+    options.add_options()(
+        "endpoint",
+        po::value<std::string>(),
+        "prover_server endpoint, e.g. \"localhost:50051\" or "
+        "\"unix:/path/to/socket\" (default: localhost:50051)");
+    options.add_options()(
+        "circuit-id",
+        po::value<std::string>(),
+        "circuit to request proofs for (default: the default circuit of the "
+        "server)");
+    options.add_options()(
+        "num-inputs",
+        po::value<size_t>(),
+        "number of joinsplit inputs of the circuit (default: "
+        "ZETH_NUM_JS_INPUTS)");
+    options.add_options()(
+        "num-outputs",
+        po::value<size_t>(),
+        "number of joinsplit outputs of the circuit (default: "
+        "ZETH_NUM_JS_OUTPUTS)");
+    options.add_options()(
+        "tree-depth",
+        po::value<size_t>(),
+        "Merkle tree depth of the circuit (default: ZETH_MERKLE_TREE_DEPTH)");
+    options.add_options()(
+        "requests,n",
+        po::value<size_t>(),
+        "total number of requests (default: 100)");
+    options.add_options()(
+        "concurrency,c",
+        po::value<size_t>(),
+        "maximum number of requests in flight (default: 1)");
+    options.add_options()(
+        "rate,r",
+        po::value<double>(),
+        "send requests at this rate (requests per second) instead of as soon "
+        "as the previous request completes. Latencies are measured from the "
+        "scheduled time of each request, and include any time spent waiting "
+        "for a free client (up to --concurrency).");
+    options.add_options()(
+        "timeout",
+        po::value<double>(),
+        "deadline of each request in seconds (default: none)");
+    options.add_options()(
+        "repeat-inputs",
+        "send identical inputs in all requests (by default inputs are "
+        "distinct, so that proofs are not served from the server cache)");
+    options.add_options()(
+        "output,o",
+        po::value<std::string>(),
+        "file to write the JSON results to (default: stdout)");
+
+    std::string endpoint = "localhost:50051";
+    std::string circuit_id;
+    size_t num_inputs = libzeth::ZETH_NUM_JS_INPUTS;
+    size_t num_outputs = libzeth::ZETH_NUM_JS_OUTPUTS;
+    size_t tree_depth = libzeth::ZETH_MERKLE_TREE_DEPTH;
+    size_t num_requests = 100;
+    size_t concurrency = 1;
+    double rate = 0;
+    double timeout_s = 0;
+    bool repeat_inputs = false;
+    std::string output_file;
+    try {
+        po::variables_map vm;
+        po::store(
+            po::command_line_parser(argc, argv).options(options).run(), vm);
+        if (vm.count("help")) {
+            std::cout << "Usage:\n  " << argv[0] << " [<options>]\n\n"
+                      << options << std::endl;
+            return 0;
+        }
+        if (vm.count("endpoint")) {
+            endpoint = vm["endpoint"].as<std::string>();
+        }
+        if (vm.count("circuit-id")) {
+            circuit_id = vm["circuit-id"].as<std::string>();
+        }
+        if (vm.count("num-inputs")) {
+            num_inputs = vm["num-inputs"].as<size_t>();
+        }
+        if (vm.count("num-outputs")) {
+            num_outputs = vm["num-outputs"].as<size_t>();
+        }
+        if (vm.count("tree-depth")) {
+            tree_depth = vm["tree-depth"].as<size_t>();
+        }
+        if (vm.count("requests")) {
+            num_requests = vm["requests"].as<size_t>();
+        }
+        if (vm.count("concurrency")) {
+            concurrency = vm["concurrency"].as<size_t>();
+        }
+        if (vm.count("rate")) {
+            rate = vm["rate"].as<double>();
+        }
+        if (vm.count("timeout")) {
+            timeout_s = vm["timeout"].as<double>();
+        }
+        if (vm.count("repeat-inputs")) {
+            repeat_inputs = true;
+        }
+        if (vm.count("output")) {
+            output_file = vm["output"].as<std::string>();
+        }
+    } catch (po::error &error) {
+        std::cerr << " ERROR: " << error.what() << std::endl;
+        return 1;
+    }
+    if (num_inputs == 0 || num_outputs == 0 || concurrency == 0 ||
+        rate < 0) {
+        std::cerr << " ERROR: invalid arguments" << std::endl;
+        return 1;
+    }
+
+    pp::init_public_params();
+    const zeth_proto::ProofInputs base_inputs =
+        make_proof_inputs(circuit_id, num_inputs, num_outputs, tree_depth);
+    const uint64_t run_id = std::random_device()();
+
+    std::shared_ptr<grpc::Channel> channel =
+        grpc::CreateChannel(endpoint, grpc::InsecureChannelCredentials());
+    std::unique_ptr<zeth_proto::Prover::Stub> stub =
+        zeth_proto::Prover::NewStub(channel);
+
+    std::atomic<size_t> next_request(0);
+    load_results results;
+    const steady_clock::time_point start = steady_clock::now();
+    auto client = [&]() {
+        zeth_proto::ProofInputs proof_inputs = base_inputs;
+        while (true) {
+            const size_t request_index = next_request++;
+            if (request_index >= num_requests) {
+                return;
+            }
+
+            // In open loop mode, the request is due at a fixed time, and its
+            // latency is measured from then.
+            steady_clock::time_point request_start = steady_clock::now();
+            if (rate > 0) {
+                request_start =
+                    start + std::chrono::duration_cast<steady_clock::duration>(
+                                std::chrono::duration<double>(
+                                    (double)request_index / rate));
+                std::this_thread::sleep_until(request_start);
+            }
+
+            set_request_h_sig(
+                proof_inputs, run_id, repeat_inputs ? 0 : request_index);
+            grpc::ClientContext context;
+            if (timeout_s > 0) {
+                context.set_deadline(
+                    std::chrono::system_clock::now() +
+                    std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::duration<double>(timeout_s)));
+            }
+            zeth_proto::ExtendedProof proof;
+            const grpc::Status status =
+                stub->Prove(&context, proof_inputs, &proof);
+            if (status.ok()) {
+                results.record_success(
+                    std::chrono::duration<double, std::milli>(
+                        steady_clock::now() - request_start)
+                        .count());
+            } else {
+                results.record_error(status);
+            }
+        }
+    };
+
+    std::vector<std::thread> clients;
+    for (size_t i = 0; i < concurrency; ++i) {
+        clients.emplace_back(client);
+    }
+    for (std::thread &thread : clients) {
+        thread.join();
+    }
+    const double duration_s =
+        std::chrono::duration<double>(steady_clock::now() - start).count();
+
+    if (output_file.empty()) {
+        write_results_json(
+            std::cout, results, num_requests, concurrency, rate, duration_s);
+    } else {
+        std::ofstream out_s(output_file);
+        write_results_json(
+            out_s, results, num_requests, concurrency, rate, duration_s);
+    }
+    return results.errors.empty() ? 0 : 2;
+}
@@ -3,84 +3,1386 @@
 // SPDX-License-Identifier: LGPL-3.0+
 
 #include "libzeth/circuits/circuit_types.hpp"
+#include "libzeth/core/cancellation.hpp"
 #include "libzeth/core/extended_proof.hpp"
+#include "libzeth/core/field_element_utils.hpp"
+#include "libzeth/core/memory_budget.hpp"
+#include "libzeth/core/numa.hpp"
+#include "libzeth/core/proof_progress.hpp"
+#include "libzeth/core/single_flight_cache.hpp"
 #include "libzeth/core/utils.hpp"
+#include "libzeth/serialization/mapped_file.hpp"
 #include "libzeth/serialization/proto_utils.hpp"
 #include "libzeth/serialization/r1cs_serialization.hpp"
+#include "libzeth/serialization/shared_memory_channel.hpp"
 #include "libzeth/zeth_constants.hpp"
 #include "zeth_config.h"
 
+#include <algorithm>
+#include <atomic>
 #include <boost/program_options.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
 #include <fstream>
+#include <functional>
+#include <future>
 #include <grpc/grpc.h>
+#include <grpcpp/health_check_service_interface.h>
 #include <grpcpp/security/server_credentials.h>
 #include <grpcpp/server.h>
 #include <grpcpp/server_builder.h>
 #include <grpcpp/server_context.h>
+#include <iterator>
 #include <libsnark/common/data_structures/merkle_tree.hpp>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <pthread.h>
+#include <signal.h>
+#include <sodium/crypto_generichash.h>
+#include <sstream>
 #include <stdio.h>
 #include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
 #include <zeth/api/prover.grpc.pb.h>
 
+#ifdef MULTICORE
+#include <omp.h>
+#endif
+
 using pp = libzeth::defaults::pp;
 using Field = libzeth::defaults::Field;
 using snark = libzeth::defaults::snark;
 using api_handler = libzeth::defaults::api_handler;
 using hash = libzeth::HashT<Field>;
 using hash_tree = libzeth::HashTreeT<Field>;
-using circuit_wrapper = libzeth::circuit_wrapper<
-    hash,
-    hash_tree,
-    pp,
-    snark,
-    libzeth::ZETH_NUM_JS_INPUTS,
-    libzeth::ZETH_NUM_JS_OUTPUTS,
-    libzeth::ZETH_MERKLE_TREE_DEPTH>;
 
 namespace proto = google::protobuf;
 namespace po = boost::program_options;
 
-static void prover_configuration_to_proto(
-    zeth_proto::ProverConfiguration &prover_config_proto)
-{
-    prover_config_proto.set_zksnark(snark::name);
-    libzeth::pairing_parameters_to_proto<pp>(
-        *prover_config_proto.mutable_pairing_parameters());
-}
+static snark::keypair load_keypair(const boost::filesystem::path &keypair_file)
+{
+    std::ifstream in_s(
+        keypair_file.c_str(), std::ios_base::in | std::ios_base::binary);
+    in_s.exceptions(
+        std::ios_base::eofbit | std::ios_base::badbit | std::ios_base::failbit);
+    return snark::keypair_read_bytes(in_s);
+}
+
+static void write_keypair(
+    const typename snark::keypair &keypair,
+    const boost::filesystem::path &keypair_file)
+{
+    std::ofstream out_s(
+        keypair_file.c_str(), std::ios_base::out | std::ios_base::binary);
+    snark::keypair_write_bytes(keypair, out_s);
+}
+
+/// File holding the verification key of the circuit whose keypair is held in
+/// `keypair_file` (e.g. keypair.vk.bin for keypair.bin). It is written when
+/// the keypair is loaded or generated, and is all that servers in verify-only
+/// mode load.
+static boost::filesystem::path verification_key_file(
+    const boost::filesystem::path &keypair_file)
+{
+    boost::filesystem::path vk_file = keypair_file;
+    return vk_file.replace_extension(
+        ".vk" + keypair_file.extension().string());
+}
+
+static snark::verification_key load_verification_key(
+    const boost::filesystem::path &vk_file)
+{
+    std::ifstream in_s(
+        vk_file.c_str(), std::ios_base::in | std::ios_base::binary);
+    in_s.exceptions(
+        std::ios_base::eofbit | std::ios_base::badbit | std::ios_base::failbit);
+    return snark::verification_key_read_bytes(in_s);
+}
+
+static void write_verification_key(
+    const snark::verification_key &vk, const boost::filesystem::path &vk_file)
+{
+    std::ostringstream vk_s;
+    snark::verification_key_write_bytes(vk, vk_s);
+    const std::string vk_bytes = vk_s.str();
+    libzeth::file_write_atomic(
+        vk_file.string(), vk_bytes.data(), vk_bytes.size());
+}
+
+#if defined(ZETH_SNARK_GROTH16)
+
+/// File holding the proving key of the circuit whose keypair is held in
+/// `keypair_file`, in the format read by snark::streaming_proving_key (e.g.
+/// keypair.stream.bin for keypair.bin). It is written when the keypair is
+/// loaded or generated, in low-memory mode.
+static boost::filesystem::path streaming_proving_key_file(
+    const boost::filesystem::path &keypair_file)
+{
+    boost::filesystem::path pk_file = keypair_file;
+    return pk_file.replace_extension(
+        ".stream" + keypair_file.extension().string());
+}
+
+static void write_streaming_proving_key(
+    const snark::proving_key &pk,
+    const std::string &keypair_id,
+    const boost::filesystem::path &pk_file)
+{
+    // The key is written to a temporary file, which is renamed over the old
+    // one so that proofs in progress (which have it mapped) are not affected.
+    const boost::filesystem::path tmp_file = pk_file.string() + ".tmp";
+    {
+        std::ofstream out_s(
+            tmp_file.c_str(), std::ios_base::out | std::ios_base::binary);
+        out_s.exceptions(std::ios_base::badbit | std::ios_base::failbit);
+        snark::streaming_proving_key_write_bytes(pk, keypair_id, out_s);
+    }
+    boost::filesystem::rename(tmp_file, pk_file);
+}
+
+/// Whether the last bytes of `keypair_file` are `vk_bytes`, that is, whether
+/// it holds a keypair (written by snark::keypair_write_bytes, with the
+/// verification key last) with the verification key `vk_bytes`. Only the end
+/// of the file is read.
+static bool keypair_file_has_verification_key(
+    const boost::filesystem::path &keypair_file, const std::string &vk_bytes)
+{
+    std::ifstream in_s(
+        keypair_file.c_str(), std::ios_base::in | std::ios_base::binary);
+    in_s.exceptions(
+        std::ios_base::eofbit | std::ios_base::badbit | std::ios_base::failbit);
+    in_s.seekg(0, std::ios_base::end);
+    const size_t size = in_s.tellg();
+    if (size < vk_bytes.size()) {
+        return false;
+    }
+    in_s.seekg(size - vk_bytes.size());
+    std::string keypair_vk_bytes(vk_bytes.size(), '\0');
+    in_s.read(&keypair_vk_bytes[0], keypair_vk_bytes.size());
+    return keypair_vk_bytes == vk_bytes;
+}
+
+#endif // defined(ZETH_SNARK_GROTH16)
+
+/// A verification key in use by the server, with its prepared form (see
+/// snark::prepare_verification_key) used to verify proofs.
+class server_verification_key
+{
+public:
+    const snark::verification_key vk;
+    const snark::prepared_verification_key prepared_vk;
+
+    explicit server_verification_key(const snark::verification_key &vk)
+        : vk(vk), prepared_vk(snark::prepare_verification_key(vk))
+    {
+    }
+};
+
+/// A keypair in use by the server, with an id derived from its verification
+/// key. In low-memory mode, the proving key is not held in memory, and is
+/// instead streamed from `streaming_proving_key_file` for each proof.
+class server_keypair
+{
+public:
+    const snark::keypair keypair;
+    const std::string id;
+    const boost::filesystem::path streaming_proving_key_file;
+
+    explicit server_keypair(const snark::keypair &keypair)
+        : keypair(keypair), id(verification_key_id(keypair.vk))
+    {
+    }
+
+    explicit server_keypair(snark::keypair &&keypair)
+        : keypair(std::move(keypair)), id(verification_key_id(this->keypair.vk))
+    {
+    }
+
+    server_keypair(
+        const snark::verification_key &vk,
+        const boost::filesystem::path &streaming_proving_key_file)
+        : keypair(snark::proving_key(), snark::verification_key(vk))
+        , id(verification_key_id(vk))
+        , streaming_proving_key_file(streaming_proving_key_file)
+    {
+    }
+
+    /// Id of a keypair: a hash of its verification key.
+    static std::string verification_key_id(
+        const snark::verification_key &vk)
+    {
+        std::ostringstream vk_s;
+        snark::verification_key_write_bytes(vk, vk_s);
+        const std::string vk_bytes = vk_s.str();
+        std::string id(crypto_generichash_BYTES, '\0');
+        crypto_generichash(
+            (uint8_t *)&id[0],
+            id.size(),
+            (const uint8_t *)vk_bytes.data(),
+            vk_bytes.size(),
+            nullptr,
+            0);
+        return id;
+    }
+};
+
+/// Sizes of the constraint system of a circuit, computed once so that
+/// keypairs can be checked against the circuit without generating it again.
+class constraint_system_sizes
+{
+public:
+    size_t num_inputs;
+    size_t num_variables;
+    size_t num_constraints;
+
+    static constraint_system_sizes of_protoboard(
+        const libsnark::protoboard<Field> &pb)
+    {
+        return constraint_system_sizes{
+            pb.num_inputs(), pb.num_variables(), pb.num_constraints()};
+    }
+};
+
+/// Load a keypair, checking that it was generated for a constraint system
+/// with the given sizes. The keypair is moved into the returned object, so
+/// that a single copy of the proving key is held.
+static std::shared_ptr<const server_keypair> load_circuit_keypair(
+    const constraint_system_sizes &sizes,
+    const boost::filesystem::path &keypair_file)
+{
+    snark::keypair keypair = load_keypair(keypair_file);
+    const libsnark::r1cs_constraint_system<Field> &cs =
+        keypair.pk.constraint_system;
+    if (cs.num_inputs() != sizes.num_inputs ||
+        cs.num_variables() != sizes.num_variables ||
+        cs.num_constraints() != sizes.num_constraints) {
+        throw std::invalid_argument(
+            "keypair does not match the circuit: " + keypair_file.string());
+    }
+    return std::make_shared<const server_keypair>(std::move(keypair));
+}
+
+static void write_constraint_system(
+    const libsnark::r1cs_constraint_system<Field> &cs,
+    const boost::filesystem::path &r1cs_file,
+    const std::string &r1cs_format)
+{
+    if (r1cs_format == "bytes") {
+        std::ofstream r1cs_stream(
+            r1cs_file.c_str(), std::ios_base::out | std::ios_base::binary);
+        libzeth::r1cs_write_bytes<pp>(cs, r1cs_stream);
+    } else if (r1cs_format == "json") {
+        std::ofstream r1cs_stream(r1cs_file.c_str());
+        libzeth::r1cs_write_json<pp>(cs, r1cs_stream);
+    } else {
+        throw std::invalid_argument("unknown r1cs format: " + r1cs_format);
+    }
+}
+
+static Field parse_encoded_field_element(const std::string &encoded)
+{
+    if (encoded.size() != libzeth::field_element_bytes_size<Field>()) {
+        throw std::invalid_argument("invalid encoded field element size");
+    }
+    return libzeth::field_element_from_bytes<Field>(encoded.data());
+}
+
+static void write_ext_proof_to_file(
+    const libzeth::extended_proof<pp, snark> &ext_proof,
+    boost::filesystem::path proof_path)
+{
+    std::ofstream os(proof_path.c_str());
+    ext_proof.write_json(os);
+}
+
+template<size_t numBits>
+static void hash_update_bits(
+    crypto_generichash_state &state, const libzeth::bits<numBits> &bits)
+{
+    const std::vector<bool> bits_vector = bits.to_vector();
+    uint8_t bytes[(numBits + 7) / 8] = {0};
+    for (size_t i = 0; i < numBits; ++i) {
+        bytes[i / 8] |= (uint8_t)bits_vector[i] << (i % 8);
+    }
+    crypto_generichash_update(&state, bytes, sizeof(bytes));
+}
+
+static void hash_update_field_element(
+    crypto_generichash_state &state, const Field &element)
+{
+    std::vector<uint8_t> bytes(libzeth::field_element_bytes_size<Field>());
+    libzeth::field_element_to_bytes(element, bytes.data());
+    crypto_generichash_update(&state, bytes.data(), bytes.size());
+}
+
+static void hash_update_note(
+    crypto_generichash_state &state, const libzeth::zeth_note &note)
+{
+    hash_update_bits(state, note.a_pk);
+    hash_update_bits(state, note.value);
+    hash_update_bits(state, note.rho);
+    hash_update_bits(state, note.r);
+}
+
+/// Digest of the parsed inputs to a proof, used as the key of the proof
+/// cache. Inputs are hashed after parsing, so that requests which differ only
+/// in the encoding of the inputs share a digest. The circuit id, and the id of
+/// the keypair used to generate the proof, are included so that proofs are
+/// never served for another circuit, or after the keypair has been reloaded.
+template<size_t NumInputs, size_t NumOutputs, size_t TreeDepth>
+static std::string proof_inputs_digest(
+    const std::string &circuit_id,
+    const std::string &keypair_id,
+    const Field &root,
+    const std::array<libzeth::joinsplit_input<Field, TreeDepth>, NumInputs>
+        &inputs,
+    const std::array<libzeth::zeth_note, NumOutputs> &outputs,
+    const libzeth::bits64 &vpub_in,
+    const libzeth::bits64 &vpub_out,
+    const libzeth::bits256 &h_sig,
+    const libzeth::bits256 &phi)
+{
+    crypto_generichash_state state;
+    crypto_generichash_init(&state, nullptr, 0, crypto_generichash_BYTES);
+    // Include the terminator of circuit_id, to separate it from the data that
+    // follows.
+    crypto_generichash_update(
+        &state, (const uint8_t *)circuit_id.data(), circuit_id.size() + 1);
+    crypto_generichash_update(
+        &state, (const uint8_t *)keypair_id.data(), keypair_id.size());
+    hash_update_field_element(state, root);
+    for (const libzeth::joinsplit_input<Field, TreeDepth> &input : inputs) {
+        for (const Field &node : input.witness_merkle_path) {
+            hash_update_field_element(state, node);
+        }
+        hash_update_bits(state, input.address_bits);
+        hash_update_note(state, input.note);
+        hash_update_bits(state, input.spending_key_a_sk);
+        hash_update_bits(state, input.nullifier);
+    }
+    for (const libzeth::zeth_note &output : outputs) {
+        hash_update_note(state, output);
+    }
+    hash_update_bits(state, vpub_in);
+    hash_update_bits(state, vpub_out);
+    hash_update_bits(state, h_sig);
+    hash_update_bits(state, phi);
+
+    std::string digest(crypto_generichash_BYTES, '\0');
+    crypto_generichash_final(&state, (uint8_t *)&digest[0], digest.size());
+    return digest;
+}
+
+/// Cache of proofs, keyed by proof_inputs_digest. Proofs are held as
+/// serialized ExtendedProof messages in the `bytes` encoding.
+using proof_cache = libzeth::single_flight_cache<std::string, std::string>;
+
+/// Create a proof cache holding up to `capacity` proofs in memory. If
+/// `spill_directory` is not empty, evicted proofs are written to files in it,
+/// and can be served from there.
+static std::unique_ptr<proof_cache> create_proof_cache(
+    const size_t capacity, const boost::filesystem::path &spill_directory)
+{
+    if (spill_directory.empty()) {
+        return std::unique_ptr<proof_cache>(new proof_cache(capacity));
+    }
+
+    boost::filesystem::create_directories(spill_directory);
+    // Proofs which cannot be written are logged and dropped (they have
+    // already been returned to the client, and are only regenerated if
+    // requested again).
+    auto spill = [spill_directory](
+                     const std::string &key, const std::string &value) {
+        const boost::filesystem::path path =
+            spill_directory / libzeth::bytes_to_hex(key.data(), key.size());
+        try {
+            libzeth::file_write_atomic(
+                path.string(), value.data(), value.size());
+        } catch (const std::exception &e) {
+            std::cout << "[ERROR] Failed to write evicted proof to " << path
+                      << ": " << e.what() << std::endl;
+        }
+    };
+    auto load = [spill_directory](const std::string &key, std::string &value) {
+        const boost::filesystem::path path =
+            spill_directory / libzeth::bytes_to_hex(key.data(), key.size());
+        std::ifstream in_s(
+            path.c_str(), std::ios_base::in | std::ios_base::binary);
+        if (!in_s.good()) {
+            return false;
+        }
+        value.assign(
+            std::istreambuf_iterator<char>(in_s),
+            std::istreambuf_iterator<char>());
+        return true;
+    };
+    return std::unique_ptr<proof_cache>(
+        new proof_cache(capacity, spill, load));
+}
+
+/// Cancellation token for work carried out on behalf of an RPC. It is
+/// cancelled when the client disconnects or cancels the call, or when the
+/// deadline of the call has passed, so that cores are only used for requests
+/// whose results can still be delivered.
+class server_context_cancellation_token : public libzeth::cancellation_token
+{
+private:
+    const grpc::ServerContext *context;
+
+public:
+    explicit server_context_cancellation_token(
+        const grpc::ServerContext *context)
+        : context(context)
+    {
+    }
+
+    bool is_cancelled() const override
+    {
+        return context->IsCancelled() ||
+               std::chrono::system_clock::now() > context->deadline();
+    }
+
+    /// The status to return for the RPC, given the status of the operation.
+    /// Operations cancelled because the deadline has passed (rather than by
+    /// the client) are reported as `DEADLINE_EXCEEDED`.
+    grpc::Status rpc_status(const grpc::Status &status) const
+    {
+        if (status.error_code() == grpc::StatusCode::CANCELLED &&
+            !context->IsCancelled()) {
+            return grpc::Status(
+                grpc::StatusCode::DEADLINE_EXCEEDED, status.error_message());
+        }
+        return status;
+    }
+};
+
+/// Cancellation token for work carried out on behalf of the server itself,
+/// cancelled when the server stops.
+class stopping_cancellation_token : public libzeth::cancellation_token
+{
+private:
+    const std::atomic<bool> &stopping;
+
+public:
+    explicit stopping_cancellation_token(const std::atomic<bool> &stopping)
+        : stopping(stopping)
+    {
+    }
+
+    bool is_cancelled() const override { return stopping; }
+};
+
+static zeth_proto::ProofStage proof_stage_to_proto(
+    const libzeth::proof_stage stage)
+{
+    switch (stage) {
+    case libzeth::proof_stage_inputs_parsed:
+        return zeth_proto::PROOF_STAGE_INPUTS_PARSED;
+    case libzeth::proof_stage_witness_generated:
+        return zeth_proto::PROOF_STAGE_WITNESS_GENERATED;
+    case libzeth::proof_stage_satisfiability_checked:
+        return zeth_proto::PROOF_STAGE_SATISFIABILITY_CHECKED;
+    case libzeth::proof_stage_h_computed:
+        return zeth_proto::PROOF_STAGE_H_COMPUTED;
+    case libzeth::proof_stage_multi_exp_a:
+        return zeth_proto::PROOF_STAGE_MULTI_EXP_A;
+    case libzeth::proof_stage_multi_exp_b:
+        return zeth_proto::PROOF_STAGE_MULTI_EXP_B;
+    case libzeth::proof_stage_multi_exp_h:
+        return zeth_proto::PROOF_STAGE_MULTI_EXP_H;
+    case libzeth::proof_stage_multi_exp_l:
+        return zeth_proto::PROOF_STAGE_MULTI_EXP_L;
+    }
+    throw std::invalid_argument("unknown proof stage");
+}
+
+/// Progress listener which streams a ProofStageEvent to the client of a
+/// ProveWithProgress call as each stage completes.
+class server_writer_progress_listener : public libzeth::proof_progress_listener
+{
+private:
+    grpc::ServerWriter<zeth_proto::ProofProgress> *writer;
+    const std::chrono::steady_clock::time_point start;
+
+public:
+    explicit server_writer_progress_listener(
+        grpc::ServerWriter<zeth_proto::ProofProgress> *writer)
+        : writer(writer), start(std::chrono::steady_clock::now())
+    {
+    }
+
+    void stage_completed(const libzeth::proof_stage stage) override
+    {
+        using std::chrono::duration_cast;
+        using std::chrono::microseconds;
+
+        zeth_proto::ProofProgress progress;
+        zeth_proto::ProofStageEvent *event = progress.mutable_stage();
+        event->set_stage(proof_stage_to_proto(stage));
+        event->set_timestamp_us(
+            duration_cast<microseconds>(
+                std::chrono::system_clock::now().time_since_epoch())
+                .count());
+        event->set_elapsed_us(
+            duration_cast<microseconds>(
+                std::chrono::steady_clock::now() - start)
+                .count());
+
+        // A failed write means that the client has gone away, which is
+        // detected (and the proof abandoned) by the cancellation token.
+        writer->Write(progress);
+    }
+};
+
+/// Identifier of the joinsplit circuit with the given shape, as used in
+/// `ProofInputs.circuit_id`.
+static std::string joinsplit_circuit_id(
+    const size_t num_inputs, const size_t num_outputs, const size_t tree_depth)
+{
+    return std::to_string(num_inputs) + "x" + std::to_string(num_outputs) +
+           "_d" + std::to_string(tree_depth);
+}
+
+/// A circuit hosted by the server, with its keypair.
+class hosted_circuit
+{
+public:
+    /// Function generating a proof with the given keypair, for inputs which
+    /// have already been parsed.
+    using proof_generator = std::function<libzeth::extended_proof<pp, snark>(
+        const server_keypair &keypair,
+        const libzeth::cancellation_token *cancel,
+        libzeth::proof_progress_listener *progress)>;
+
+    virtual ~hosted_circuit() {}
+
+    virtual const std::string &get_id() const = 0;
+
+    virtual void circuit_configuration_to_proto(
+        zeth_proto::CircuitConfiguration &circuit_config_proto) const = 0;
+
+    /// The keypair currently in use. Requests hold a reference to the keypair
+    /// they started with, so that it can be replaced at any time.
+    virtual std::shared_ptr<const server_keypair> get_keypair() const = 0;
+
+    /// The verification key currently in use (held by requests in the same
+    /// way as the keypair).
+    virtual std::shared_ptr<const server_verification_key>
+    get_verification_key() const = 0;
+
+    /// Estimate of the peak memory (in bytes) used to generate a proof.
+    virtual size_t get_proof_memory_estimate() const = 0;
+
+    /// Load the keypair (or, in verify-only mode, the verification key) again
+    /// from its file, and use it for all subsequent requests. Throws (keeping
+    /// the current keys) if it cannot be loaded.
+    virtual void reload_keypair() = 0;
+
+    virtual void write_constraint_system(
+        const boost::filesystem::path &r1cs_file,
+        const std::string &r1cs_format) const = 0;
+
+    /// Parse the inputs for a proof, returning the digest of the parsed inputs
+    /// in `digest` (see proof_inputs_digest, where `keypair_id` identifies
+    /// the keypair to be used) and a function which generates the proof.
+    virtual proof_generator parse_proof_inputs(
+        const zeth_proto::ProofInputs &proof_inputs,
+        const std::string &keypair_id,
+        std::string &digest) const = 0;
+
+    /// A function which generates a proof for an all-zero witness. The
+    /// witness does not satisfy the circuit, but generating the proof runs
+    /// the same code, and touches the same memory, as a real request. Used to
+    /// warm up the server before it reports itself as ready.
+    virtual proof_generator warmup_proof_generator() const = 0;
+};
+
+/// Joinsplit circuit with the given shape. The keypair is loaded from (or, if
+/// it does not exist, generated and written to) `keypair_file` on
+/// construction. In low-memory mode, only the verification key is kept in
+/// memory, and proofs are generated by the low-memory prover (see
+/// circuit_wrapper::prove_low_memory) from the streaming proving key file,
+/// which is reused on construction if it is up to date.
+template<size_t NumInputs, size_t NumOutputs, size_t TreeDepth>
+class joinsplit_circuit : public hosted_circuit
+{
+private:
+    using circuit_wrapper = libzeth::circuit_wrapper<
+        hash,
+        hash_tree,
+        pp,
+        snark,
+        NumInputs,
+        NumOutputs,
+        TreeDepth>;
+    using joinsplit_input = libzeth::joinsplit_input<Field, TreeDepth>;
+
+    const std::string id;
+    const boost::filesystem::path keypair_file;
+    const bool low_memory;
+    circuit_wrapper prover;
+    // Computed on construction, from a single generation of the constraint
+    // system.
+    constraint_system_sizes sizes;
+    size_t proof_memory_estimate;
+
+    // Replaced as a whole (using the atomic shared_ptr functions) when the
+    // keypair is reloaded.
+    std::shared_ptr<const server_keypair> keypair;
+    std::shared_ptr<const server_verification_key> verification_key;
+
+public:
+    joinsplit_circuit(
+        const boost::filesystem::path &keypair_file, bool low_memory)
+        : id(joinsplit_circuit_id(NumInputs, NumOutputs, TreeDepth))
+        , keypair_file(keypair_file)
+        , low_memory(low_memory)
+    {
+        // The constraint system is generated once, for the sizes, the memory
+        // estimate and (if there is no keypair) the trusted setup. It is
+        // released before any keypair is loaded.
+        std::unique_ptr<snark::keypair> new_keypair;
+        {
+            const libsnark::protoboard<Field> pb =
+                prover.get_constraint_system();
+            sizes = constraint_system_sizes::of_protoboard(pb);
+            proof_memory_estimate = circuit_wrapper::proof_memory_estimate(
+                pb.get_constraint_system());
+            if (!boost::filesystem::exists(keypair_file)) {
+                std::cout << "[INFO] No keypair file " << keypair_file
+                          << " for circuit " << id << ". Generating.\n";
+                new_keypair.reset(
+                    new snark::keypair(snark::generate_setup(pb)));
+            }
+        }
+
+        std::cout << "[INFO] Circuit " << id << ": estimated memory per proof: "
+                  << (proof_memory_estimate >> 20) << " MiB\n";
+        if (new_keypair) {
+            std::cout << "[INFO] Writing new keypair to " << keypair_file
+                      << "\n";
+            write_keypair(*new_keypair, keypair_file);
+            set_keypair(std::make_shared<const server_keypair>(
+                std::move(*new_keypair)));
+            return;
+        }
+
+        if (low_memory && reuse_streaming_proving_key()) {
+            return;
+        }
+
+        std::cout << "[INFO] Loading keypair for circuit " << id << ": "
+                  << keypair_file << "\n";
+        set_keypair(load_circuit_keypair(sizes, keypair_file));
+    }
+
+    const std::string &get_id() const override { return id; }
+
+    void circuit_configuration_to_proto(
+        zeth_proto::CircuitConfiguration &circuit_config_proto) const override
+    {
+        circuit_config_proto.set_circuit_id(id);
+        circuit_config_proto.set_num_inputs(NumInputs);
+        circuit_config_proto.set_num_outputs(NumOutputs);
+        circuit_config_proto.set_tree_depth(TreeDepth);
+    }
+
+    std::shared_ptr<const server_keypair> get_keypair() const override
+    {
+        return std::atomic_load(&keypair);
+    }
+
+    std::shared_ptr<const server_verification_key> get_verification_key()
+        const override
+    {
+        return std::atomic_load(&verification_key);
+    }
+
+    size_t get_proof_memory_estimate() const override
+    {
+        return proof_memory_estimate;
+    }
+
+    void reload_keypair() override
+    {
+        std::cout << "[INFO] Reloading keypair for circuit " << id << ": "
+                  << keypair_file << std::endl;
+        if (low_memory) {
+            // Streaming proving key and verification key files matching the
+            // new keypair may have been installed alongside it, in which case
+            // the keypair is not loaded.
+            if (reuse_streaming_proving_key()) {
+                return;
+            }
+            std::cout << "[WARN] Loading the full keypair for circuit " << id
+                      << " to write its streaming proving key" << std::endl;
+        }
+        set_keypair(load_circuit_keypair(sizes, keypair_file));
+    }
+
+    void write_constraint_system(
+        const boost::filesystem::path &r1cs_file,
+        const std::string &r1cs_format) const override
+    {
+        // The circuit's own constraint system is written (with its variable
+        // and constraint annotations, used by debug/analyzer), rather than
+        // that of the proving key, which is loaded without annotations and may
+        // have had its A and B swapped by the generator.
+        ::write_constraint_system(
+            prover.generate_constraint_system(), r1cs_file, r1cs_format);
+    }
+
+    proof_generator parse_proof_inputs(
+        const zeth_proto::ProofInputs &proof_inputs,
+        const std::string &keypair_id,
+        std::string &digest) const override
+    {
+        const Field root =
+            proof_inputs.encoded_mk_root().empty()
+                ? libzeth::base_field_element_from_hex<Field>(
+                      proof_inputs.mk_root())
+                : parse_encoded_field_element(proof_inputs.encoded_mk_root());
+        const libzeth::bits64 vpub_in =
+            libzeth::bits64::from_hex(proof_inputs.pub_in_value());
+        const libzeth::bits64 vpub_out =
+            libzeth::bits64::from_hex(proof_inputs.pub_out_value());
+        const libzeth::bits256 h_sig_in =
+            libzeth::bits256::from_hex(proof_inputs.h_sig());
+        const libzeth::bits256 phi_in =
+            libzeth::bits256::from_hex(proof_inputs.phi());
+
+        if (NumInputs != proof_inputs.js_inputs_size()) {
+            throw std::invalid_argument("Invalid number of JS inputs");
+        }
+        if (NumOutputs != proof_inputs.js_outputs_size()) {
+            throw std::invalid_argument("Invalid number of JS outputs");
+        }
+
+        std::cout << "[DEBUG] Process all inputs of the JoinSplit"
+                  << std::endl;
+        std::array<joinsplit_input, NumInputs> joinsplit_inputs;
+        for (size_t i = 0; i < NumInputs; i++) {
+            printf("\r  input (%zu / %zu)\n", i, NumInputs);
+            const zeth_proto::JoinsplitInput &received_input =
+                proof_inputs.js_inputs(i);
+            joinsplit_inputs[i] =
+                libzeth::joinsplit_input_from_proto<Field, TreeDepth>(
+                    received_input);
+        }
+
+        std::cout << "[DEBUG] Process all outputs of the JoinSplit"
+                  << std::endl;
+        std::array<libzeth::zeth_note, NumOutputs> joinsplit_outputs;
+        for (size_t i = 0; i < NumOutputs; i++) {
+            printf("\r  output (%zu / %zu)\n", i, NumOutputs);
+            const zeth_proto::ZethNote &received_output =
+                proof_inputs.js_outputs(i);
+            joinsplit_outputs[i] =
+                libzeth::zeth_note_from_proto(received_output);
+        }
+
+        digest = proof_inputs_digest<NumInputs, NumOutputs, TreeDepth>(
+            id,
+            keypair_id,
+            root,
+            joinsplit_inputs,
+            joinsplit_outputs,
+            vpub_in,
+            vpub_out,
+            h_sig_in,
+            phi_in);
+
+        const circuit_wrapper &prover = this->prover;
+        return [&prover,
+                root,
+                joinsplit_inputs,
+                joinsplit_outputs,
+                vpub_in,
+                vpub_out,
+                h_sig_in,
+                phi_in](
+                   const server_keypair &keypair,
+                   const libzeth::cancellation_token *cancel,
+                   libzeth::proof_progress_listener *progress) {
+            return prove(
+                prover,
+                keypair,
+                root,
+                joinsplit_inputs,
+                joinsplit_outputs,
+                vpub_in,
+                vpub_out,
+                h_sig_in,
+                phi_in,
+                cancel,
+                progress);
+        };
+    }
+
+    proof_generator warmup_proof_generator() const override
+    {
+        std::array<joinsplit_input, NumInputs> joinsplit_inputs;
+        for (joinsplit_input &input : joinsplit_inputs) {
+            input.witness_merkle_path.assign(TreeDepth, Field::zero());
+        }
+
+        const circuit_wrapper &prover = this->prover;
+        return [&prover, joinsplit_inputs](
+                   const server_keypair &keypair,
+                   const libzeth::cancellation_token *cancel,
+                   libzeth::proof_progress_listener *progress) {
+            return prove(
+                prover,
+                keypair,
+                Field::zero(),
+                joinsplit_inputs,
+                std::array<libzeth::zeth_note, NumOutputs>(),
+                libzeth::bits64(),
+                libzeth::bits64(),
+                libzeth::bits256(),
+                libzeth::bits256(),
+                cancel,
+                progress);
+        };
+    }
+
+private:
+    // Generate a proof with `keypair`, using the low-memory prover if its
+    // proving key is streamed from a file.
+    static libzeth::extended_proof<pp, snark> prove(
+        const circuit_wrapper &prover,
+        const server_keypair &keypair,
+        const Field &root,
+        const std::array<joinsplit_input, NumInputs> &inputs,
+        const std::array<libzeth::zeth_note, NumOutputs> &outputs,
+        const libzeth::bits64 &vpub_in,
+        const libzeth::bits64 &vpub_out,
+        const libzeth::bits256 &h_sig_in,
+        const libzeth::bits256 &phi_in,
+        const libzeth::cancellation_token *cancel,
+        libzeth::proof_progress_listener *progress)
+    {
+        if (keypair.streaming_proving_key_file.empty()) {
+            return prover.prove(
+                root,
+                inputs,
+                outputs,
+                vpub_in,
+                vpub_out,
+                h_sig_in,
+                phi_in,
+                keypair.keypair.pk,
+                cancel,
+                progress);
+        }
+
+#if defined(ZETH_SNARK_GROTH16)
+        const snark::streaming_proving_key proving_key(
+            keypair.streaming_proving_key_file.string());
+        const libzeth::extended_proof<pp, snark> ext_proof =
+            prover.prove_low_memory(
+                root,
+                inputs,
+                outputs,
+                vpub_in,
+                vpub_out,
+                h_sig_in,
+                phi_in,
+                proving_key,
+                cancel,
+                progress);
+        // The high-water mark of the process, not of this proof alone: it
+        // includes any proofs generated concurrently, and earlier ones.
+        std::cout << "[INFO] Peak resident memory of the process: "
+                  << (libzeth::peak_resident_memory() >> 20) << " MiB"
+                  << std::endl;
+        return ext_proof;
+#else
+        throw std::runtime_error("low-memory proving requires GROTH16");
+#endif
+    }
+
+    // In low-memory mode, use the streaming proving key and verification key
+    // files written when the keypair was last loaded, if the verification key
+    // file matches the one at the end of the keypair file, and the streaming
+    // proving key was written from the same keypair (checked using the
+    // keypair id in its header), so that the full keypair is not loaded.
+    // Returns false if the keypair must be loaded (or generated).
+    bool reuse_streaming_proving_key()
+    {
+#if defined(ZETH_SNARK_GROTH16)
+        const boost::filesystem::path pk_file =
+            streaming_proving_key_file(keypair_file);
+        const boost::filesystem::path vk_file =
+            verification_key_file(keypair_file);
+        if (!boost::filesystem::exists(keypair_file) ||
+            !boost::filesystem::exists(pk_file) ||
+            !boost::filesystem::exists(vk_file)) {
+            return false;
+        }
+
+        try {
+            const snark::verification_key vk = load_verification_key(vk_file);
+            std::ostringstream vk_s;
+            snark::verification_key_write_bytes(vk, vk_s);
+            if (!keypair_file_has_verification_key(keypair_file, vk_s.str())) {
+                std::cout << "[INFO] Verification key " << vk_file
+                          << " does not match keypair " << keypair_file
+                          << std::endl;
+                return false;
+            }
+
+            const std::string keypair_id =
+                server_keypair::verification_key_id(vk);
+            const snark::streaming_proving_key proving_key(pk_file.string());
+            if (proving_key.key_id() != keypair_id ||
+                proving_key.num_inputs() != sizes.num_inputs ||
+                proving_key.num_variables() != sizes.num_variables ||
+                proving_key.num_constraints() != sizes.num_constraints) {
+                std::cout << "[INFO] Streaming proving key " << pk_file
+                          << " does not match keypair " << keypair_file
+                          << std::endl;
+                return false;
+            }
+
+            std::cout << "[INFO] Using streaming proving key for circuit "
+                      << id << ": " << pk_file << std::endl;
+            std::atomic_store(
+                &verification_key,
+                std::make_shared<const server_verification_key>(vk));
+            std::atomic_store(
+                &keypair, std::make_shared<const server_keypair>(vk, pk_file));
+            return true;
+        } catch (const std::exception &e) {
+            // Written by an older server, or truncated. It is written again
+            // from the keypair.
+            std::cout << "[WARN] Ignoring streaming proving key " << pk_file
+                      << ": " << e.what() << std::endl;
+            return false;
+        }
+#else
+        return false;
+#endif
+    }
+
+    // Use `new_keypair` for subsequent requests, and write its verification
+    // key for servers in verify-only mode. In low-memory mode, the proving
+    // key is written to the streaming proving key file, and released.
+    void set_keypair(const std::shared_ptr<const server_keypair> &new_keypair)
+    {
+        const boost::filesystem::path vk_file =
+            verification_key_file(keypair_file);
+        write_verification_key(new_keypair->keypair.vk, vk_file);
+        std::atomic_store(
+            &verification_key,
+            std::make_shared<const server_verification_key>(
+                new_keypair->keypair.vk));
+        if (!low_memory) {
+            std::atomic_store(&keypair, new_keypair);
+            return;
+        }
+
+#if defined(ZETH_SNARK_GROTH16)
+        const boost::filesystem::path pk_file =
+            streaming_proving_key_file(keypair_file);
+        std::cout << "[INFO] Writing streaming proving key for circuit " << id
+                  << ": " << pk_file << std::endl;
+        write_streaming_proving_key(
+            new_keypair->keypair.pk, new_keypair->id, pk_file);
+        std::atomic_store(
+            &keypair,
+            std::make_shared<const server_keypair>(
+                new_keypair->keypair.vk, pk_file));
+#else
+        throw std::runtime_error("low-memory proving requires GROTH16");
+#endif
+    }
+};
+
+/// Joinsplit circuit with the given shape, for which only the verification
+/// key is loaded (from `vk_file`, see verification_key_file), so that proofs
+/// can be verified without holding the constraint system or proving key.
+template<size_t NumInputs, size_t NumOutputs, size_t TreeDepth>
+class joinsplit_verifier_circuit : public hosted_circuit
+{
+private:
+    const std::string id;
+    const boost::filesystem::path vk_file;
+
+    // Replaced as a whole (using the atomic shared_ptr functions) when the
+    // verification key is reloaded.
+    std::shared_ptr<const server_verification_key> verification_key;
+
+public:
+    explicit joinsplit_verifier_circuit(const boost::filesystem::path &vk_file)
+        : id(joinsplit_circuit_id(NumInputs, NumOutputs, TreeDepth))
+        , vk_file(vk_file)
+    {
+        std::cout << "[INFO] Loading verification key for circuit " << id
+                  << ": " << vk_file << "\n";
+        verification_key = std::make_shared<const server_verification_key>(
+            load_verification_key(vk_file));
+    }
+
+    const std::string &get_id() const override { return id; }
+
+    void circuit_configuration_to_proto(
+        zeth_proto::CircuitConfiguration &circuit_config_proto) const override
+    {
+        circuit_config_proto.set_circuit_id(id);
+        circuit_config_proto.set_num_inputs(NumInputs);
+        circuit_config_proto.set_num_outputs(NumOutputs);
+        circuit_config_proto.set_tree_depth(TreeDepth);
+    }
+
+    std::shared_ptr<const server_keypair> get_keypair() const override
+    {
+        throw std::runtime_error("no keypair in verify-only mode");
+    }
+
+    std::shared_ptr<const server_verification_key> get_verification_key()
+        const override
+    {
+        return std::atomic_load(&verification_key);
+    }
+
+    size_t get_proof_memory_estimate() const override { return 0; }
+
+    void reload_keypair() override
+    {
+        std::cout << "[INFO] Reloading verification key for circuit " << id
+                  << ": " << vk_file << std::endl;
+        std::atomic_store(
+            &verification_key,
+            std::make_shared<const server_verification_key>(
+                load_verification_key(vk_file)));
+    }
+
+    void write_constraint_system(
+        const boost::filesystem::path &, const std::string &) const override
+    {
+        throw std::runtime_error("no constraint system in verify-only mode");
+    }
+
+    proof_generator parse_proof_inputs(
+        const zeth_proto::ProofInputs &,
+        const std::string &,
+        std::string &) const override
+    {
+        throw std::runtime_error(
+            "proofs are not generated in verify-only mode");
+    }
+
+    proof_generator warmup_proof_generator() const override
+    {
+        throw std::runtime_error(
+            "proofs are not generated in verify-only mode");
+    }
+};
+
+/// The circuits hosted by the server. Requests which do not specify a circuit
+/// id are routed to the default circuit (the first to be added). All circuits
+/// share the threads of the server, so that cores are not reserved for any
+/// one circuit.
+class circuit_registry
+{
+private:
+    std::map<std::string, std::unique_ptr<hosted_circuit>> circuits;
+    std::vector<const hosted_circuit *> circuits_in_order;
+
+public:
+    void add(std::unique_ptr<hosted_circuit> &&circuit)
+    {
+        const std::string id = circuit->get_id();
+        if (circuits.count(id) != 0) {
+            throw std::invalid_argument("duplicate circuit: " + id);
+        }
+        circuits_in_order.push_back(circuit.get());
+        circuits[id] = std::move(circuit);
+    }
+
+    /// Get the circuit with the given id, or the default circuit if `id` is
+    /// empty.
+    const hosted_circuit &get(const std::string &id) const
+    {
+        if (id.empty()) {
+            if (circuits_in_order.empty()) {
+                throw std::runtime_error("no circuits");
+            }
+            return *circuits_in_order.front();
+        }
+        const auto it = circuits.find(id);
+        if (it == circuits.end()) {
+            throw std::invalid_argument("unknown circuit: " + id);
+        }
+        return *it->second;
+    }
+
+    const std::vector<const hosted_circuit *> &get_all() const
+    {
+        return circuits_in_order;
+    }
+
+    /// Reload the keypairs of all circuits. Circuits whose keypair cannot be
+    /// loaded keep their current keypair.
+    void reload_keypairs()
+    {
+        for (auto &entry : circuits) {
+            try {
+                entry.second->reload_keypair();
+            } catch (const std::exception &e) {
+                std::cout << "[ERROR] Failed to reload keypair for circuit "
+                          << entry.first
+                          << " (keeping the current keypair): " << e.what()
+                          << std::endl;
+            }
+        }
+        std::cout << "[INFO] Keypairs reloaded" << std::endl;
+    }
+};
+
+/// Factory for a hosted circuit, given the file holding its keypair. In
+/// verify-only mode, only the verification key (see verification_key_file) is
+/// loaded. In low-memory mode, proofs are generated by the low-memory prover.
+using circuit_factory = std::function<std::unique_ptr<hosted_circuit>(
+    const boost::filesystem::path &keypair_file,
+    bool verify_only,
+    bool low_memory)>;
+
+template<size_t NumInputs, size_t NumOutputs, size_t TreeDepth>
+static void add_circuit_factory(
+    std::map<std::string, circuit_factory> &factories)
+{
+    factories[joinsplit_circuit_id(NumInputs, NumOutputs, TreeDepth)] =
+        [](const boost::filesystem::path &keypair_file,
+           bool verify_only,
+           bool low_memory) -> std::unique_ptr<hosted_circuit> {
+            if (verify_only) {
+                return std::unique_ptr<hosted_circuit>(
+                    new joinsplit_verifier_circuit<
+                        NumInputs,
+                        NumOutputs,
+                        TreeDepth>(verification_key_file(keypair_file)));
+            }
+            return std::unique_ptr<hosted_circuit>(
+                new joinsplit_circuit<NumInputs, NumOutputs, TreeDepth>(
+                    keypair_file, low_memory));
+        };
+}
+
+/// The circuits which the server can host, indexed by circuit id. The
+/// default circuit (with the shape given in zeth_constants.hpp) is always
+/// hosted. Others are hosted on request.
+static std::map<std::string, circuit_factory> available_circuits()
+{
+    std::map<std::string, circuit_factory> factories;
+    add_circuit_factory<
+        libzeth::ZETH_NUM_JS_INPUTS,
+        libzeth::ZETH_NUM_JS_OUTPUTS,
+        libzeth::ZETH_MERKLE_TREE_DEPTH>(factories);
+    add_circuit_factory<2, 2, 16>(factories);
+    add_circuit_factory<4, 4, libzeth::ZETH_MERKLE_TREE_DEPTH>(factories);
+    return factories;
+}
+
+static std::string default_circuit_id()
+{
+    return joinsplit_circuit_id(
+        libzeth::ZETH_NUM_JS_INPUTS,
+        libzeth::ZETH_NUM_JS_OUTPUTS,
+        libzeth::ZETH_MERKLE_TREE_DEPTH);
+}
+
+static void prover_configuration_to_proto(
+    const circuit_registry &circuits,
+    const bool verify_only,
+    zeth_proto::ProverConfiguration &prover_config_proto)
+{
+    prover_config_proto.set_zksnark(snark::name);
+    libzeth::pairing_parameters_to_proto<pp>(
+        *prover_config_proto.mutable_pairing_parameters());
+    prover_config_proto.add_supported_encodings(
+        zeth_proto::ELEMENT_ENCODING_JSON);
+    prover_config_proto.add_supported_encodings(
+        zeth_proto::ELEMENT_ENCODING_BYTES);
+    for (const hosted_circuit *circuit : circuits.get_all()) {
+        circuit->circuit_configuration_to_proto(
+            *prover_config_proto.add_circuits());
+    }
+    prover_config_proto.set_verify_only(verify_only);
+}
+
+/// Verify `proofs` with `verification_key`, setting `valid[i]` to the validity
+/// of the i-th proof. The proofs are split into one chunk per thread, each
+/// checked with a single batch verification. The proofs of any chunk which
+/// fails are then checked one by one, to find the invalid ones.
+static void verify_proofs(
+    const snark::prepared_verification_key &verification_key,
+    const std::vector<libzeth::extended_proof<pp, snark>> &proofs,
+    std::vector<uint8_t> &valid)
+{
+    valid.assign(proofs.size(), 0);
+#ifdef MULTICORE
+    const size_t num_threads = (size_t)omp_get_max_threads();
+#else
+    const size_t num_threads = 1;
+#endif
+    const size_t num_chunks = std::min(proofs.size(), num_threads);
+
+#ifdef MULTICORE
+#pragma omp parallel for
+#endif
+    for (size_t chunk = 0; chunk < num_chunks; ++chunk) {
+        const size_t begin = chunk * proofs.size() / num_chunks;
+        const size_t end = (chunk + 1) * proofs.size() / num_chunks;
+        const std::vector<libzeth::extended_proof<pp, snark>> chunk_proofs(
+            proofs.begin() + begin, proofs.begin() + end);
+        if (snark::verify_batch(chunk_proofs, verification_key)) {
+            std::fill(valid.begin() + begin, valid.begin() + end, 1);
+            continue;
+        }
+
+        for (size_t i = begin; i < end; ++i) {
+            valid[i] = snark::verify(
+                proofs[i].get_primary_inputs(),
+                proofs[i].get_proof(),
+                verification_key);
+        }
+    }
+}
+
+/// Thread pinned to the CPUs of a NUMA node, generating proofs with replicas
+/// of the keypairs which are allocated on that node (by copying them on the
+/// pinned thread, so that the pages are first touched, and therefore placed,
+/// on the node). Jobs are run one at a time, each using all CPUs of the node.
+class numa_worker
+{
+private:
+    const libzeth::numa_node node;
+
+    std::mutex mutex;
+    std::condition_variable jobs_available;
+    std::deque<std::function<void()>> jobs;
+    // Number of jobs queued or running.
+    size_t load;
+    bool stopping;
+
+    // Node-local replicas of the keypairs in use, indexed by keypair id. Only
+    // accessed by the worker thread.
+    std::map<std::string, std::shared_ptr<const server_keypair>> replicas;
+
+    std::thread thread;
+
+public:
+    explicit numa_worker(const libzeth::numa_node &node)
+        : node(node), load(0), stopping(false)
+    {
+        thread = std::thread([this]() { run(); });
+    }
+
+    numa_worker(const numa_worker &) = delete;
+    numa_worker &operator=(const numa_worker &) = delete;
+
+    ~numa_worker()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        jobs_available.notify_one();
+        thread.join();
+    }
+
+    size_t get_node_id() const { return node.id; }
+
+    size_t get_load()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return load;
+    }
+
+    /// Run `job` on the worker thread, passing it the replica of `keypair`,
+    /// and wait for it to complete. Exceptions thrown by `job` are rethrown.
+    void run_with_keypair(
+        const std::shared_ptr<const server_keypair> &keypair,
+        const std::function<void(const server_keypair &)> &job)
+    {
+        auto task = std::make_shared<std::packaged_task<void()>>(
+            [this, &keypair, &job]() { job(*get_replica(keypair)); });
+        std::future<void> done = task->get_future();
+        enqueue([task]() { (*task)(); });
+        done.get();
+    }
+
+    /// Replace the replicas held by the worker with replicas of `keypairs`,
+    /// in the background.
+    void replicate(
+        const std::vector<std::shared_ptr<const server_keypair>> &keypairs)
+    {
+        enqueue([this, keypairs]() {
+            std::map<std::string, std::shared_ptr<const server_keypair>>
+                new_replicas;
+            for (const std::shared_ptr<const server_keypair> &keypair :
+                 keypairs) {
+                new_replicas[keypair->id] = get_replica(keypair);
+            }
+            replicas.swap(new_replicas);
+        });
+    }
 
-static snark::keypair load_keypair(const boost::filesystem::path &keypair_file)
-{
-    std::ifstream in_s(
-        keypair_file.c_str(), std::ios_base::in | std::ios_base::binary);
-    in_s.exceptions(
-        std::ios_base::eofbit | std::ios_base::badbit | std::ios_base::failbit);
-    return snark::keypair_read_bytes(in_s);
-}
+private:
+    void enqueue(std::function<void()> &&job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+            ++load;
+        }
+        jobs_available.notify_one();
+    }
 
-static void write_keypair(
-    const typename snark::keypair &keypair,
-    const boost::filesystem::path &keypair_file)
-{
-    std::ofstream out_s(
-        keypair_file.c_str(), std::ios_base::out | std::ios_base::binary);
-    snark::keypair_write_bytes(keypair, out_s);
-}
+    const std::shared_ptr<const server_keypair> &get_replica(
+        const std::shared_ptr<const server_keypair> &keypair)
+    {
+        std::shared_ptr<const server_keypair> &replica = replicas[keypair->id];
+        if (!replica) {
+            std::cout << "[INFO] Replicating keypair on NUMA node " << node.id
+                      << std::endl;
+            replica = std::make_shared<const server_keypair>(keypair->keypair);
+        }
+        return replica;
+    }
 
-static void write_constraint_system(
-    const circuit_wrapper &prover, const boost::filesystem::path &r1cs_file)
-{
-    std::ofstream r1cs_stream(r1cs_file.c_str());
-    libzeth::r1cs_write_json<pp>(prover.get_constraint_system(), r1cs_stream);
-}
+    void run()
+    {
+        libzeth::pin_current_thread(node.cpus);
+#ifdef MULTICORE
+        // Parallel regions started by this thread use all CPUs of the node.
+        omp_set_num_threads((int)node.cpus.size());
+#endif
 
-static void write_ext_proof_to_file(
-    const libzeth::extended_proof<pp, snark> &ext_proof,
-    boost::filesystem::path proof_path)
-{
-    std::ofstream os(proof_path.c_str());
-    ext_proof.write_json(os);
-}
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            jobs_available.wait(
+                lock, [this]() { return stopping || !jobs.empty(); });
+            if (jobs.empty()) {
+                return;
+            }
+
+            std::function<void()> job = std::move(jobs.front());
+            jobs.pop_front();
+            lock.unlock();
+            job();
+            lock.lock();
+            --load;
+        }
+    }
+};
 
 /// The prover_server class inherits from the Prover service
 /// defined in the proto files, and provides an implementation
@@ -88,21 +1390,101 @@ static void write_ext_proof_to_file(
 class prover_server final : public zeth_proto::Prover::Service
 {
 private:
-    circuit_wrapper prover;
-
-    // The keypair is the result of the setup. Store a copy internally.
-    snark::keypair keypair;
+    circuit_registry &circuits;
 
     // Optional file to write proofs into (for debugging).
     boost::filesystem::path proof_output_file;
 
+    // Proofs already generated, so that retried or duplicate requests do not
+    // generate them again.
+    std::unique_ptr<proof_cache> proofs;
+
+    // Memory available for proof generation. Each proof reserves the estimate
+    // for its circuit before starting, and waits (or is rejected) if it would
+    // exceed the budget.
+    libzeth::memory_budget memory;
+
+    // Workers on which proofs are generated, one per NUMA node. If empty,
+    // proofs are generated on the threads handling the requests.
+    std::vector<std::unique_ptr<numa_worker>> workers;
+
+    // If true, only the verification keys are loaded, and proof requests are
+    // rejected.
+    const bool verify_only;
+
 public:
     explicit prover_server(
-        circuit_wrapper &prover,
-        const snark::keypair &keypair,
-        const boost::filesystem::path &proof_output_file)
-        : prover(prover), keypair(keypair), proof_output_file(proof_output_file)
+        circuit_registry &circuits,
+        const boost::filesystem::path &proof_output_file,
+        std::unique_ptr<proof_cache> &&proofs,
+        const size_t memory_budget,
+        const size_t max_waiting_proofs,
+        const std::vector<libzeth::numa_node> &numa_nodes,
+        const bool verify_only)
+        : circuits(circuits)
+        , proof_output_file(proof_output_file)
+        , proofs(std::move(proofs))
+        , memory(memory_budget, max_waiting_proofs)
+        , verify_only(verify_only)
     {
+        for (const libzeth::numa_node &node : numa_nodes) {
+            workers.emplace_back(new numa_worker(node));
+        }
+        replicate_keypairs();
+    }
+
+    /// Reload the keypairs of all circuits, and use them for all subsequent
+    /// requests. Requests already in progress complete with the previous
+    /// keypairs.
+    void reload_keypairs()
+    {
+        circuits.reload_keypairs();
+        replicate_keypairs();
+    }
+
+    /// Generate `num_proofs` warmup proofs (see
+    /// hosted_circuit::warmup_proof_generator) for each circuit, on each
+    /// worker, so that one-off costs (constant and domain setup, first touch
+    /// of the keypair pages, allocator growth) are not paid by the first
+    /// requests. Throws operation_cancelled if `cancel` is cancelled.
+    void warm_up(
+        const size_t num_proofs, const libzeth::cancellation_token *cancel)
+    {
+        for (const hosted_circuit *circuit : circuits.get_all()) {
+            const hosted_circuit::proof_generator prover =
+                circuit->warmup_proof_generator();
+            const std::shared_ptr<const server_keypair> keypair =
+                circuit->get_keypair();
+            const size_t memory_estimate = circuit->get_proof_memory_estimate();
+            for (size_t i = 0; i < num_proofs; ++i) {
+                std::cout << "[INFO] Warming up circuit " << circuit->get_id()
+                          << " (" << i + 1 << " / " << num_proofs << ")"
+                          << std::endl;
+                if (workers.empty()) {
+                    const libzeth::memory_budget::reservation reserved =
+                        memory.acquire(memory_estimate, cancel);
+                    prover(*keypair, cancel, nullptr);
+                    continue;
+                }
+
+                // Warm up all workers at once, each on its own node.
+                std::vector<std::future<void>> done;
+                for (const std::unique_ptr<numa_worker> &worker : workers) {
+                    numa_worker *const w = worker.get();
+                    done.push_back(std::async(std::launch::async, [&, w]() {
+                        const libzeth::memory_budget::reservation reserved =
+                            memory.acquire(memory_estimate, cancel);
+                        w->run_with_keypair(
+                            keypair, [&](const server_keypair &replica) {
+                                prover(replica, cancel, nullptr);
+                            });
+                    }));
+                }
+                for (std::future<void> &worker_done : done) {
+                    worker_done.get();
+                }
+            }
+        }
     }
 
     grpc::Status GetConfiguration(
@@ -111,13 +1493,28 @@ public:
         zeth_proto::ProverConfiguration *response) override
     {
         std::cout << "[ACK] Received the request for configuration\n";
-        prover_configuration_to_proto(*response);
+        prover_configuration_to_proto(circuits, verify_only, *response);
         return grpc::Status::OK;
     }
 
-    grpc::Status GetVerificationKey(
+    grpc::Status GetStatus(
         grpc::ServerContext *,
         const proto::Empty *,
+        zeth_proto::ProverStatus *response) override
+    {
+        const libzeth::memory_budget_status status = memory.get_status();
+        response->set_memory_budget(status.capacity);
+        response->set_memory_in_use(status.in_use);
+        response->set_proofs_in_progress(status.num_active);
+        response->set_proofs_waiting(status.num_waiting);
+        response->set_proofs_rejected(status.num_rejected);
+        response->set_peak_resident_memory(libzeth::peak_resident_memory());
+        return grpc::Status::OK;
+    }
+
+    grpc::Status GetVerificationKey(
+        grpc::ServerContext *,
+        const zeth_proto::VerificationKeyRequest *request,
         zeth_proto::VerificationKey *response) override
     {
         std::cout << "[ACK] Received the request to get the verification key"
@@ -125,7 +1522,10 @@ public:
         std::cout << "[DEBUG] Preparing verification key for response..."
                   << std::endl;
         try {
-            api_handler::verification_key_to_proto(this->keypair.vk, response);
+            const std::shared_ptr<const server_verification_key> vk =
+                circuits.get(request->circuit_id()).get_verification_key();
+            api_handler::verification_key_to_proto(
+                vk->vk, response, request->encoding());
         } catch (const std::exception &e) {
             std::cout << "[ERROR] " << e.what() << std::endl;
             return grpc::Status(
@@ -138,95 +1538,195 @@ public:
         return grpc::Status::OK;
     }
 
-    grpc::Status Prove(
+    grpc::Status Verify(
+        grpc::ServerContext *,
+        const zeth_proto::VerifyRequest *request,
+        zeth_proto::VerifyResponse *response) override
+    {
+        std::cout << "[ACK] Received the request to verify a proof"
+                  << std::endl;
+        try {
+            const std::shared_ptr<const server_verification_key> vk =
+                circuits.get(request->circuit_id()).get_verification_key();
+            const libzeth::extended_proof<pp, snark> ext_proof =
+                api_handler::extended_proof_from_proto(
+                    request->extended_proof());
+            response->set_valid(snark::verify(
+                ext_proof.get_primary_inputs(),
+                ext_proof.get_proof(),
+                vk->prepared_vk));
+        } catch (const std::exception &e) {
+            std::cout << "[ERROR] " << e.what() << std::endl;
+            return grpc::Status(
+                grpc::StatusCode::INVALID_ARGUMENT, grpc::string(e.what()));
+        } catch (...) {
+            std::cout << "[ERROR] In catch all" << std::endl;
+            return grpc::Status(grpc::StatusCode::UNKNOWN, "");
+        }
+
+        return grpc::Status::OK;
+    }
+
+    grpc::Status VerifyBatch(
         grpc::ServerContext *,
+        const zeth_proto::VerifyBatchRequest *request,
+        zeth_proto::VerifyBatchResponse *response) override
+    {
+        std::cout << "[ACK] Received the request to verify "
+                  << request->extended_proofs_size() << " proofs" << std::endl;
+        try {
+            const std::shared_ptr<const server_verification_key> vk =
+                circuits.get(request->circuit_id()).get_verification_key();
+            std::vector<libzeth::extended_proof<pp, snark>> ext_proofs;
+            ext_proofs.reserve(request->extended_proofs_size());
+            for (const zeth_proto::ExtendedProof &ext_proof :
+                 request->extended_proofs()) {
+                ext_proofs.push_back(
+                    api_handler::extended_proof_from_proto(ext_proof));
+            }
+
+            std::vector<uint8_t> valid;
+            verify_proofs(vk->prepared_vk, ext_proofs, valid);
+            response->set_all_valid(
+                std::find(valid.begin(), valid.end(), 0) == valid.end());
+            for (const uint8_t proof_valid : valid) {
+                response->add_valid(proof_valid != 0);
+            }
+        } catch (const std::exception &e) {
+            std::cout << "[ERROR] " << e.what() << std::endl;
+            return grpc::Status(
+                grpc::StatusCode::INVALID_ARGUMENT, grpc::string(e.what()));
+        } catch (...) {
+            std::cout << "[ERROR] In catch all" << std::endl;
+            return grpc::Status(grpc::StatusCode::UNKNOWN, "");
+        }
+
+        return grpc::Status::OK;
+    }
+
+    grpc::Status Prove(
+        grpc::ServerContext *context,
         const zeth_proto::ProofInputs *proof_inputs,
         zeth_proto::ExtendedProof *proof) override
+    {
+        const server_context_cancellation_token cancel(context);
+        return cancel.rpc_status(prove(*proof_inputs, proof, &cancel, nullptr));
+    }
+
+    grpc::Status ProveWithProgress(
+        grpc::ServerContext *context,
+        const zeth_proto::ProofInputs *proof_inputs,
+        grpc::ServerWriter<zeth_proto::ProofProgress> *writer) override
+    {
+        const server_context_cancellation_token cancel(context);
+        server_writer_progress_listener progress(writer);
+        zeth_proto::ProofProgress response;
+        const grpc::Status status = cancel.rpc_status(prove(
+            *proof_inputs, response.mutable_proof(), &cancel, &progress));
+        if (status.ok()) {
+            writer->Write(response);
+        }
+        return status;
+    }
+
+    /// Common implementation of Prove and ProveWithProgress, also used to
+    /// serve requests received over other transports. `cancel` and `progress`
+    /// may be null. Returns `CANCELLED` if `cancel` was cancelled.
+    grpc::Status prove(
+        const zeth_proto::ProofInputs &proof_inputs,
+        zeth_proto::ExtendedProof *proof,
+        const libzeth::cancellation_token *cancel,
+        libzeth::proof_progress_listener *progress)
     {
         std::cout << "[ACK] Received the request to generate a proof"
                   << std::endl;
+        if (verify_only) {
+            return grpc::Status(
+                grpc::StatusCode::UNIMPLEMENTED,
+                "proofs are not generated in verify-only mode");
+        }
         std::cout << "[DEBUG] Parse received message to compute proof..."
                   << std::endl;
 
         // Parse received message to feed to the prover
         try {
-            Field root = libzeth::base_field_element_from_hex<Field>(
-                proof_inputs->mk_root());
-            libzeth::bits64 vpub_in =
-                libzeth::bits64::from_hex(proof_inputs->pub_in_value());
-            libzeth::bits64 vpub_out =
-                libzeth::bits64::from_hex(proof_inputs->pub_out_value());
-            libzeth::bits256 h_sig_in =
-                libzeth::bits256::from_hex(proof_inputs->h_sig());
-            libzeth::bits256 phi_in =
-                libzeth::bits256::from_hex(proof_inputs->phi());
-
-            if (libzeth::ZETH_NUM_JS_INPUTS != proof_inputs->js_inputs_size()) {
-                throw std::invalid_argument("Invalid number of JS inputs");
-            }
-            if (libzeth::ZETH_NUM_JS_OUTPUTS !=
-                proof_inputs->js_outputs_size()) {
-                throw std::invalid_argument("Invalid number of JS outputs");
-            }
+            const hosted_circuit &circuit =
+                circuits.get(proof_inputs.circuit_id());
+            const std::shared_ptr<const server_keypair> keypair =
+                circuit.get_keypair();
+            std::string key;
+            const hosted_circuit::proof_generator prover =
+                circuit.parse_proof_inputs(proof_inputs, keypair->id, key);
 
-            std::cout << "[DEBUG] Process all inputs of the JoinSplit"
-                      << std::endl;
-            std::array<
-                libzeth::
-                    joinsplit_input<Field, libzeth::ZETH_MERKLE_TREE_DEPTH>,
-                libzeth::ZETH_NUM_JS_INPUTS>
-                joinsplit_inputs;
-            for (size_t i = 0; i < libzeth::ZETH_NUM_JS_INPUTS; i++) {
-                printf(
-                    "\r  input (%zu / %zu)\n", i, libzeth::ZETH_NUM_JS_INPUTS);
-                const zeth_proto::JoinsplitInput &received_input =
-                    proof_inputs->js_inputs(i);
-                joinsplit_inputs[i] = libzeth::joinsplit_input_from_proto<
-                    Field,
-                    libzeth::ZETH_MERKLE_TREE_DEPTH>(received_input);
-            }
+            std::cout << "[DEBUG] Data parsed successfully" << std::endl;
+            libzeth::notify_stage_completed(
+                progress, libzeth::proof_stage_inputs_parsed);
+            auto generate_proof = [&]() {
+                const libzeth::memory_budget::reservation reserved =
+                    memory.acquire(circuit.get_proof_memory_estimate(), cancel);
+                std::cout << "[DEBUG] Generating the proof for circuit "
+                          << circuit.get_id() << "..." << std::endl;
+                const libzeth::extended_proof<pp, snark> ext_proof =
+                    generate_proof_on_worker(prover, keypair, cancel, progress);
 
-            std::cout << "[DEBUG] Process all outputs of the JoinSplit"
-                      << std::endl;
-            std::array<libzeth::zeth_note, libzeth::ZETH_NUM_JS_OUTPUTS>
-                joinsplit_outputs;
-            for (size_t i = 0; i < libzeth::ZETH_NUM_JS_OUTPUTS; i++) {
-                printf(
-                    "\r  output (%zu / %zu)\n",
-                    i,
-                    libzeth::ZETH_NUM_JS_OUTPUTS);
-                const zeth_proto::ZethNote &received_output =
-                    proof_inputs->js_outputs(i);
-                libzeth::zeth_note parsed_output =
-                    libzeth::zeth_note_from_proto(received_output);
-                joinsplit_outputs[i] = parsed_output;
-            }
+                std::cout << "[DEBUG] Displaying the extended proof"
+                          << std::endl;
+                ext_proof.write_json(std::cout);
 
-            std::cout << "[DEBUG] Data parsed successfully" << std::endl;
-            std::cout << "[DEBUG] Generating the proof..." << std::endl;
-            libzeth::extended_proof<pp, snark> ext_proof = this->prover.prove(
-                root,
-                joinsplit_inputs,
-                joinsplit_outputs,
-                vpub_in,
-                vpub_out,
-                h_sig_in,
-                phi_in,
-                this->keypair.pk);
+                // Write a copy of the proof for debugging.
+                if (!proof_output_file.empty()) {
+                    std::cout << "[DEBUG] Writing extended proof to "
+                              << proof_output_file << "\n";
+                    write_ext_proof_to_file(ext_proof, proof_output_file);
+                }
 
-            std::cout << "[DEBUG] Displaying the extended proof" << std::endl;
-            ext_proof.write_json(std::cout);
+                zeth_proto::ExtendedProof proof_bytes;
+                api_handler::extended_proof_to_proto(
+                    ext_proof,
+                    &proof_bytes,
+                    zeth_proto::ELEMENT_ENCODING_BYTES);
+                return proof_bytes.SerializeAsString();
+            };
 
-            // Write a copy of the proof for debugging.
-            if (!proof_output_file.empty()) {
-                std::cout << "[DEBUG] Writing extended proof to "
-                          << proof_output_file << "\n";
-                write_ext_proof_to_file(ext_proof, proof_output_file);
+            // Identical concurrent requests wait for a single proof
+            // generation. If that generation is abandoned because its own
+            // client went away, the waiting requests retry (and one of them
+            // generates the proof). A waiting request stops waiting when its
+            // own client goes away.
+            std::string serialized_proof;
+            while (true) {
+                try {
+                    serialized_proof =
+                        proofs->get(key, generate_proof, cancel);
+                    break;
+                } catch (const libzeth::operation_cancelled &) {
+                    if (cancel != nullptr && cancel->is_cancelled()) {
+                        throw;
+                    }
+                }
             }
 
             std::cout << "[DEBUG] Preparing response..." << std::endl;
-            api_handler::extended_proof_to_proto(ext_proof, proof);
+            if (!proof->ParseFromString(serialized_proof)) {
+                throw std::runtime_error("invalid cached proof");
+            }
+            if (proof_inputs.response_encoding() !=
+                zeth_proto::ELEMENT_ENCODING_BYTES) {
+                const libzeth::extended_proof<pp, snark> ext_proof =
+                    api_handler::extended_proof_from_proto(*proof);
+                proof->Clear();
+                api_handler::extended_proof_to_proto(
+                    ext_proof, proof, proof_inputs.response_encoding());
+            }
 
+        } catch (const libzeth::operation_cancelled &e) {
+            std::cout << "[INFO] " << e.what() << std::endl;
+            return grpc::Status(
+                grpc::StatusCode::CANCELLED, grpc::string(e.what()));
+        } catch (const libzeth::memory_budget_exhausted &e) {
+            std::cout << "[INFO] Rejected: " << e.what() << std::endl;
+            return grpc::Status(
+                grpc::StatusCode::RESOURCE_EXHAUSTED, grpc::string(e.what()));
         } catch (const std::exception &e) {
             std::cout << "[ERROR] " << e.what() << std::endl;
             return grpc::Status(
@@ -238,6 +1738,56 @@ public:
 
         return grpc::Status::OK;
     }
+
+private:
+    /// Start replicating the current keypairs of all circuits on each worker.
+    void replicate_keypairs()
+    {
+        if (workers.empty()) {
+            return;
+        }
+
+        std::vector<std::shared_ptr<const server_keypair>> keypairs;
+        for (const hosted_circuit *circuit : circuits.get_all()) {
+            keypairs.push_back(circuit->get_keypair());
+        }
+        for (const std::unique_ptr<numa_worker> &worker : workers) {
+            worker->replicate(keypairs);
+        }
+    }
+
+    /// Generate a proof on the least loaded worker, using its replica of
+    /// `keypair`, or on the calling thread if there are no workers.
+    libzeth::extended_proof<pp, snark> generate_proof_on_worker(
+        const hosted_circuit::proof_generator &prover,
+        const std::shared_ptr<const server_keypair> &keypair,
+        const libzeth::cancellation_token *cancel,
+        libzeth::proof_progress_listener *progress)
+    {
+        if (workers.empty()) {
+            return prover(*keypair, cancel, progress);
+        }
+
+        numa_worker *worker = workers.front().get();
+        size_t worker_load = worker->get_load();
+        for (const std::unique_ptr<numa_worker> &candidate : workers) {
+            const size_t candidate_load = candidate->get_load();
+            if (candidate_load < worker_load) {
+                worker = candidate.get();
+                worker_load = candidate_load;
+            }
+        }
+
+        std::cout << "[DEBUG] Generating the proof on NUMA node "
+                  << worker->get_node_id() << std::endl;
+        std::unique_ptr<libzeth::extended_proof<pp, snark>> ext_proof;
+        worker->run_with_keypair(
+            keypair, [&](const server_keypair &replica) {
+                ext_proof.reset(new libzeth::extended_proof<pp, snark>(
+                    prover(replica, cancel, progress)));
+            });
+        return *ext_proof;
+    }
 };
 
 std::string get_server_version()
@@ -275,53 +1825,394 @@ void display_server_start_message()
               << std::endl;
 }
 
+/// Signals handled by the server (see handle_signals). They must be blocked
+/// in all threads, so that they are only received by sigwait.
+static sigset_t server_signals()
+{
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGHUP);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    return signals;
+}
+
+/// Wait for signals until the server is asked to stop:
+/// - SIGHUP: reload the keypairs of all circuits in the background,
+///   continuing to serve requests with the current keypairs in the meantime.
+/// - SIGINT / SIGTERM: drain the server. New requests are rejected, and the
+///   call returns once the requests in progress have completed (or have been
+///   cancelled, if `drain_timeout` is non-zero and expires).
+static void handle_signals(
+    grpc::Server &server,
+    prover_server &service,
+    const std::chrono::seconds drain_timeout)
+{
+    const sigset_t signals = server_signals();
+    std::future<void> reload;
+    while (true) {
+        int signal = 0;
+        if (sigwait(&signals, &signal) != 0) {
+            throw std::runtime_error("sigwait failed");
+        }
+
+        if (signal == SIGHUP) {
+            if (reload.valid() && reload.wait_for(std::chrono::seconds(0)) !=
+                                      std::future_status::ready) {
+                std::cout << "[INFO] Keypair reload already in progress"
+                          << std::endl;
+                continue;
+            }
+            reload = std::async(
+                std::launch::async, [&]() { service.reload_keypairs(); });
+            continue;
+        }
+
+        std::cout << "[INFO] Draining: waiting for requests in progress..."
+                  << std::endl;
+        if (drain_timeout.count() == 0) {
+            server.Shutdown();
+        } else {
+            server.Shutdown(std::chrono::system_clock::now() + drain_timeout);
+        }
+        break;
+    }
+
+    if (reload.valid()) {
+        reload.wait();
+    }
+}
+
+/// Reserve space for a response in the shared memory channel, waiting for the
+/// client to read earlier responses. Returns nullptr if `stopping` is set
+/// before space is available, so that a client which stops reading responses
+/// cannot prevent the server from shutting down.
+static void *reserve_channel_response(
+    libzeth::shared_memory_channel_server &channel,
+    const size_t size,
+    const std::atomic<bool> &stopping)
+{
+    while (true) {
+        void *response =
+            channel.reserve_response(size, std::chrono::milliseconds(100));
+        if (response != nullptr || stopping) {
+            return response;
+        }
+    }
+}
+
+/// Write the response to a request to the shared memory channel. Returns
+/// false if the server stopped before it could be written.
+static bool write_channel_response(
+    libzeth::shared_memory_channel_server &channel,
+    const grpc::Status &status,
+    const zeth_proto::ExtendedProof &proof,
+    const std::atomic<bool> &stopping)
+{
+    // Serialize the proof directly into the channel, if it fits.
+    if (status.ok()) {
+        const size_t proof_size = proof.ByteSizeLong();
+        if (proof_size <= channel.max_response_size()) {
+            uint8_t *response = (uint8_t *)reserve_channel_response(
+                channel, proof_size, stopping);
+            if (response == nullptr) {
+                return false;
+            }
+            proof.SerializeWithCachedSizesToArray(response);
+            channel.publish_response(grpc::StatusCode::OK, proof_size);
+            return true;
+        }
+    }
+
+    const grpc::Status error =
+        status.ok() ? grpc::Status(
+                          grpc::StatusCode::RESOURCE_EXHAUSTED,
+                          "proof too large for shared memory channel")
+                    : status;
+    const std::string &message = error.error_message();
+    const size_t message_size =
+        std::min(message.size(), channel.max_response_size());
+    void *response = reserve_channel_response(channel, message_size, stopping);
+    if (response == nullptr) {
+        return false;
+    }
+    memcpy(response, message.data(), message_size);
+    channel.publish_response(error.error_code(), message_size);
+    return true;
+}
+
+/// Serve proof requests received over a shared memory channel, for clients
+/// on the same host. Requests are serialized ProofInputs messages. Responses
+/// carry a gRPC status code, and hold a serialized ExtendedProof (if the
+/// status is OK) or an error message. Once `stopping` is set, the requests
+/// already sent are served before returning (unless the client stops reading
+/// responses). Errors in the channel itself stop the channel, but not the
+/// server.
+static void serve_shared_memory_channel(
+    prover_server &service,
+    libzeth::shared_memory_channel_server &channel,
+    const std::atomic<bool> &stopping)
+{
+    try {
+        while (true) {
+            const void *data;
+            size_t size;
+            if (!channel.receive_request(
+                    data, size, std::chrono::milliseconds(100))) {
+                if (stopping) {
+                    return;
+                }
+                continue;
+            }
+
+            // Parse the request in place, and free its space for further
+            // requests.
+            zeth_proto::ProofInputs proof_inputs;
+            const bool parsed = proof_inputs.ParseFromArray(data, (int)size);
+            channel.release_request();
+
+            zeth_proto::ExtendedProof proof;
+            const grpc::Status status =
+                parsed ? service.prove(proof_inputs, &proof, nullptr, nullptr)
+                       : grpc::Status(
+                             grpc::StatusCode::INVALID_ARGUMENT,
+                             "invalid ProofInputs message");
+
+            if (!write_channel_response(channel, status, proof, stopping)) {
+                std::cout << "[WARN] Shared memory channel client is not "
+                             "reading responses, stopping the channel"
+                          << std::endl;
+                return;
+            }
+        }
+    } catch (const std::exception &e) {
+        std::cout << "[ERROR] Shared memory channel failed: " << e.what()
+                  << std::endl;
+    }
+}
+
 static void RunServer(
-    circuit_wrapper &prover,
-    const typename snark::keypair &keypair,
-    const boost::filesystem::path &proof_output_file)
+    circuit_registry &circuits,
+    const boost::filesystem::path &proof_output_file,
+    std::unique_ptr<proof_cache> &&proofs,
+    const size_t memory_budget,
+    const size_t max_waiting_proofs,
+    const std::chrono::seconds drain_timeout,
+    const boost::filesystem::path &unix_socket,
+    const std::string &shm_channel,
+    const size_t shm_capacity,
+    const std::vector<libzeth::numa_node> &numa_nodes,
+    const size_t warmup_proofs,
+    const bool verify_only)
 {
     // Listen for incoming connections on 0.0.0.0:50051
     std::string server_address("0.0.0.0:50051");
 
-    prover_server service(prover, keypair, proof_output_file);
+    prover_server service(
+        circuits,
+        proof_output_file,
+        std::move(proofs),
+        memory_budget,
+        max_waiting_proofs,
+        numa_nodes,
+        verify_only);
+
+    // Report readiness through the standard gRPC health checking service
+    // (grpc.health.v1.Health).
+    grpc::EnableDefaultHealthCheckService(true);
 
     grpc::ServerBuilder builder;
 
     // Listen on the given address without any authentication mechanism.
     builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
 
+    // Optionally listen on a unix domain socket, for clients on the same host.
+    // Access is controlled by the permissions of the socket file.
+    if (!unix_socket.empty()) {
+        boost::filesystem::remove(unix_socket);
+        builder.AddListeningPort(
+            "unix:" + unix_socket.string(), grpc::InsecureServerCredentials());
+    }
+
     // Register "service" as the instance through which we'll communicate with
     // clients. In this case it corresponds to an *synchronous* service.
     builder.RegisterService(&service);
 
     // Finally assemble the server.
     std::unique_ptr<grpc::Server> server(builder.BuildAndStart());
+    grpc::HealthCheckServiceInterface *health = server->GetHealthCheckService();
+    health->SetServingStatus(warmup_proofs == 0);
     std::cout << "[INFO] Server listening on " << server_address << "\n";
+    if (!unix_socket.empty()) {
+        std::cout << "[INFO] Server listening on unix:" << unix_socket.string()
+                  << "\n";
+    }
 
-    // Wait for the server to shutdown. Note that some other thread must be
-    // responsible for shutting down the server for this call to ever return.
+    // Optionally serve a shared memory channel.
+    std::atomic<bool> stopping(false);
+    std::unique_ptr<libzeth::shared_memory_channel_server> channel;
+    std::thread channel_thread;
+    if (!shm_channel.empty()) {
+        channel.reset(new libzeth::shared_memory_channel_server(
+            shm_channel, shm_capacity));
+        channel_thread = std::thread(
+            serve_shared_memory_channel,
+            std::ref(service),
+            std::ref(*channel),
+            std::cref(stopping));
+        std::cout << "[INFO] Serving shared memory channel " << shm_channel
+                  << "\n";
+    }
+
+    // Warm up in the background, reporting the server as serving once done.
+    // Requests received in the meantime are served, but load balancers
+    // following the health status do not send any.
+    std::thread warmup_thread;
+    if (warmup_proofs != 0) {
+        warmup_thread = std::thread([&]() {
+            const stopping_cancellation_token cancel(stopping);
+            try {
+                service.warm_up(warmup_proofs, &cancel);
+            } catch (const libzeth::operation_cancelled &) {
+                std::cout << "[INFO] Warmup cancelled" << std::endl;
+                return;
+            } catch (const std::exception &e) {
+                // Leave the server NOT_SERVING, since requests are likely to
+                // fail in the same way.
+                std::cout << "[ERROR] Warmup failed: " << e.what()
+                          << std::endl;
+                return;
+            }
+            std::cout << "[INFO] Warmup complete, server ready" << std::endl;
+            health->SetServingStatus(true);
+        });
+    }
+
+    // Wait for the server to shutdown. The server is shut down by the signal
+    // handling thread, on SIGINT or SIGTERM.
     display_server_start_message();
+    std::thread signal_thread(
+        handle_signals,
+        std::ref(*server),
+        std::ref(service),
+        drain_timeout);
     server->Wait();
+    signal_thread.join();
+    stopping = true;
+    if (warmup_thread.joinable()) {
+        warmup_thread.join();
+    }
+    if (channel_thread.joinable()) {
+        channel_thread.join();
+    }
+    std::cout << "[INFO] Server stopped" << std::endl;
 }
 
 int main(int argc, char **argv)
 {
+    // Block the signals handled by the server before any other thread is
+    // created, so that all threads inherit the signal mask.
+    const sigset_t signals = server_signals();
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
     // Options
     po::options_description options("");
     options.add_options()(
         "keypair,k",
         po::value<boost::filesystem::path>(),
-        "file to load keypair from. If it doesn't exist, a new keypair will be "
-        "generated and written to this file. (default: "
+        "file to load the keypair of the default circuit from. If it doesn't "
+        "exist, a new keypair will be generated and written to this file. The "
+        "keypairs of other circuits are held in the same directory, in "
+        "keypair_<circuit-id>.bin. Keypairs are reloaded on SIGHUP. (default: "
         "~/zeth_setup/keypair.bin)");
+    options.add_options()(
+        "circuit,c",
+        po::value<std::vector<std::string>>(),
+        "additional circuit to host, by circuit id (may be repeated). The "
+        "default circuit is always hosted.");
     options.add_options()(
         "r1cs,r",
         po::value<boost::filesystem::path>(),
-        "file in which to export the r1cs (in json format)");
+        "file in which to export the r1cs of the default circuit");
+    options.add_options()(
+        "r1cs-format",
+        po::value<std::string>(),
+        "format of the exported r1cs: \"json\" (default) or \"bytes\" (iden3 "
+        "binary .r1cs format)");
     options.add_options()(
         "proof-output,p",
         po::value<boost::filesystem::path>(),
         "(DEBUG) file to write generated proofs into");
+    options.add_options()(
+        "proof-cache-size",
+        po::value<size_t>(),
+        "number of generated proofs to keep in memory, to answer repeated "
+        "requests (default: 64)");
+    options.add_options()(
+        "proof-cache-dir",
+        po::value<boost::filesystem::path>(),
+        "directory in which to keep proofs evicted from the in-memory cache");
+    options.add_options()(
+        "memory-budget",
+        po::value<size_t>(),
+        "memory available for proof generation, in MiB. Each proof reserves "
+        "the estimated peak memory for its circuit, and waits until it is "
+        "available. (default: 3/4 of the physical memory)");
+    options.add_options()(
+        "max-waiting-proofs",
+        po::value<size_t>(),
+        "number of proof requests which may wait for memory. Further requests "
+        "are rejected with RESOURCE_EXHAUSTED. (default: 16)");
+    options.add_options()(
+        "drain-timeout",
+        po::value<size_t>(),
+        "on SIGINT or SIGTERM, number of seconds to wait for requests in "
+        "progress before cancelling them (default: 0, wait indefinitely)");
+    options.add_options()(
+        "unix-socket",
+        po::value<boost::filesystem::path>(),
+        "also listen on the given unix domain socket");
+    options.add_options()(
+        "shm-channel",
+        po::value<std::string>(),
+        "also serve proof requests from a single local client over the shared "
+        "memory channel with the given name (e.g. \"/zeth_prover\")");
+    options.add_options()(
+        "shm-capacity",
+        po::value<size_t>(),
+        "capacity in bytes of each ring of the shared memory channel "
+        "(default: 64MiB)");
+    options.add_options()(
+        "numa",
+        "generate proofs on one worker per NUMA node, pinned to the CPUs of "
+        "the node and using a node-local copy of the keypairs. Requests are "
+        "assigned to the least loaded worker.");
+    options.add_options()(
+        "warmup",
+        po::value<size_t>(),
+        "number of proofs to generate for each circuit (on each NUMA worker) "
+        "at startup, before reporting the server as SERVING through the gRPC "
+        "health checking service (default: 1, 0 to disable)");
+    options.add_options()(
+        "verify-only",
+        "only verify proofs (Verify and VerifyBatch RPCs), loading the "
+        "verification key of each circuit from the file written alongside its "
+        "keypair (e.g. keypair.vk.bin), instead of the keypair and constraint "
+        "system. Proof requests fail with UNIMPLEMENTED.");
+    options.add_options()(
+        "low-memory",
+        "(GROTH16 only) reduce the peak memory of proof generation, for hosts "
+        "with little memory. The proving key of each circuit is written to a "
+        "file alongside its keypair (e.g. keypair.stream.bin) and released, "
+        "and proofs stream it from that file in chunks. The circuit of each "
+        "proof is released once its witness has been computed, and H is "
+        "computed from the constraints in the streaming file. Proofs are a "
+        "little slower. The peak resident memory of the process (a "
+        "process-wide high-water mark, covering concurrent proofs) is logged "
+        "after each proof and reported by GetStatus. On SIGHUP, the full "
+        "keypair is loaded to write the streaming file, unless matching "
+        "streaming and verification key files have been installed alongside "
+        "the new keypair (see README).");
 
     auto usage = [&]() {
         std::cout << "Usage:"
@@ -333,8 +2224,22 @@ int main(int argc, char **argv)
     };
 
     boost::filesystem::path keypair_file;
+    std::vector<std::string> circuit_ids;
     boost::filesystem::path r1cs_file;
+    std::string r1cs_format = "json";
     boost::filesystem::path proof_output_file;
+    size_t proof_cache_size = 64;
+    boost::filesystem::path proof_cache_dir;
+    size_t memory_budget = 0;
+    size_t max_waiting_proofs = 16;
+    size_t drain_timeout = 0;
+    boost::filesystem::path unix_socket;
+    std::string shm_channel;
+    size_t shm_capacity = 64 * 1024 * 1024;
+    bool numa = false;
+    size_t warmup_proofs = 1;
+    bool verify_only = false;
+    bool low_memory = false;
     try {
         po::variables_map vm;
         po::store(
@@ -346,13 +2251,56 @@ int main(int argc, char **argv)
         if (vm.count("keypair")) {
             keypair_file = vm["keypair"].as<boost::filesystem::path>();
         }
+        if (vm.count("circuit")) {
+            circuit_ids = vm["circuit"].as<std::vector<std::string>>();
+        }
         if (vm.count("r1cs")) {
             r1cs_file = vm["r1cs"].as<boost::filesystem::path>();
         }
+        if (vm.count("r1cs-format")) {
+            r1cs_format = vm["r1cs-format"].as<std::string>();
+        }
         if (vm.count("proof-output")) {
             proof_output_file =
                 vm["proof-output"].as<boost::filesystem::path>();
         }
+        if (vm.count("proof-cache-size")) {
+            proof_cache_size = vm["proof-cache-size"].as<size_t>();
+        }
+        if (vm.count("proof-cache-dir")) {
+            proof_cache_dir =
+                vm["proof-cache-dir"].as<boost::filesystem::path>();
+        }
+        if (vm.count("memory-budget")) {
+            memory_budget = vm["memory-budget"].as<size_t>() << 20;
+        }
+        if (vm.count("max-waiting-proofs")) {
+            max_waiting_proofs = vm["max-waiting-proofs"].as<size_t>();
+        }
+        if (vm.count("drain-timeout")) {
+            drain_timeout = vm["drain-timeout"].as<size_t>();
+        }
+        if (vm.count("unix-socket")) {
+            unix_socket = vm["unix-socket"].as<boost::filesystem::path>();
+        }
+        if (vm.count("shm-channel")) {
+            shm_channel = vm["shm-channel"].as<std::string>();
+        }
+        if (vm.count("shm-capacity")) {
+            shm_capacity = vm["shm-capacity"].as<size_t>();
+        }
+        if (vm.count("numa")) {
+            numa = true;
+        }
+        if (vm.count("warmup")) {
+            warmup_proofs = vm["warmup"].as<size_t>();
+        }
+        if (vm.count("verify-only")) {
+            verify_only = true;
+        }
+        if (vm.count("low-memory")) {
+            low_memory = true;
+        }
     } catch (po::error &error) {
         std::cerr << " ERROR: " << error.what() << std::endl;
         usage();
@@ -373,31 +2321,93 @@ int main(int argc, char **argv)
     std::cout << "[INFO] Init params" << std::endl;
     pp::init_public_params();
 
-    // If the keypair file exists, load and use it, otherwise generate a new
-    // keypair and write it to the file.
-    circuit_wrapper prover;
-    snark::keypair keypair = [&keypair_file, &prover]() {
-        if (boost::filesystem::exists(keypair_file)) {
-            std::cout << "[INFO] Loading keypair: " << keypair_file << "\n";
-            return load_keypair(keypair_file);
+    // Nothing is proven in verify-only mode.
+    if (verify_only) {
+        if (!r1cs_file.empty()) {
+            std::cerr << " ERROR: r1cs cannot be exported in verify-only mode"
+                      << std::endl;
+            return 1;
         }
+        numa = false;
+        warmup_proofs = 0;
+    }
 
-        std::cout << "[INFO] No keypair file " << keypair_file
-                  << ". Generating.\n";
-        const snark::keypair keypair = prover.generate_trusted_setup();
-        std::cout << "[INFO] Writing new keypair to " << keypair_file << "\n";
-        write_keypair(keypair, keypair_file);
-        return keypair;
-    }();
+    // In low-memory mode, the keypairs are not replicated to NUMA nodes.
+    if (low_memory) {
+#if !defined(ZETH_SNARK_GROTH16)
+        std::cerr << " ERROR: low-memory mode requires GROTH16" << std::endl;
+        return 1;
+#endif
+        if (numa) {
+            std::cout << "[INFO] NUMA workers disabled in low-memory mode\n";
+            numa = false;
+        }
+    }
 
-    // If a file is given, export the JSON representation of the constraint
-    // system.
+    // Create the default circuit, followed by any additional circuits. For
+    // each, if the keypair file exists, load and use it, otherwise generate a
+    // new keypair and write it to the file. In verify-only mode, only the
+    // verification keys are loaded.
+    const std::map<std::string, circuit_factory> factories =
+        available_circuits();
+    circuit_registry circuits;
+    circuits.add(factories.at(default_circuit_id())(
+        keypair_file, verify_only, low_memory));
+    for (const std::string &circuit_id : circuit_ids) {
+        const auto it = factories.find(circuit_id);
+        if (it == factories.end()) {
+            std::cerr << " ERROR: unknown circuit: " << circuit_id << "\n"
+                      << "Available circuits:";
+            for (const auto &entry : factories) {
+                std::cerr << " " << entry.first;
+            }
+            std::cerr << std::endl;
+            return 1;
+        }
+        if (circuit_id == default_circuit_id()) {
+            continue;
+        }
+        circuits.add(it->second(
+            keypair_file.parent_path() / ("keypair_" + circuit_id + ".bin"),
+            verify_only,
+            low_memory));
+    }
+
+    // If a file is given, export the constraint system.
     if (!r1cs_file.empty()) {
         std::cout << "[INFO] Writing R1CS to " << r1cs_file << "\n";
-        write_constraint_system(prover, r1cs_file);
+        circuits.get("").write_constraint_system(r1cs_file, r1cs_format);
+    }
+
+    std::vector<libzeth::numa_node> numa_nodes;
+    if (numa) {
+        numa_nodes = libzeth::get_numa_nodes();
+        for (const libzeth::numa_node &node : numa_nodes) {
+            std::cout << "[INFO] NUMA node " << node.id << ": "
+                      << node.cpus.size() << " CPUs\n";
+        }
+    }
+
+    if (memory_budget == 0) {
+        memory_budget = (size_t)sysconf(_SC_PHYS_PAGES) *
+                        (size_t)sysconf(_SC_PAGESIZE) / 4 * 3;
     }
+    std::cout << "[INFO] Memory budget for proof generation: "
+              << (memory_budget >> 20) << " MiB\n";
 
     std::cout << "[INFO] Setup successful, starting the server..." << std::endl;
-    RunServer(prover, keypair, proof_output_file);
+    RunServer(
+        circuits,
+        proof_output_file,
+        create_proof_cache(proof_cache_size, proof_cache_dir),
+        memory_budget,
+        max_waiting_proofs,
+        std::chrono::seconds(drain_timeout),
+        unix_socket,
+        shm_channel,
+        shm_capacity,
+        numa_nodes,
+        warmup_proofs,
+        verify_only);
     return 0;
 }
@@ -0,0 +1,291 @@
+// Copyright (c) 2015-2020 Clearmatics Technologies Ltd
+//
+// SPDX-License-Identifier: LGPL-3.0+
+
+// Compare the cost of the transports supported by prover_server (gRPC over
+// TCP, gRPC over a unix domain socket, and the shared memory channel), for
+// clients on the same host. Proof generation is replaced by a fixed response,
+// so that only the cost of moving requests and responses is measured.
+
+#include "libzeth/serialization/shared_memory_channel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <functional>
+#include <grpcpp/create_channel.h>
+#include <grpcpp/security/credentials.h>
+#include <grpcpp/security/server_credentials.h>
+#include <grpcpp/server.h>
+#include <grpcpp/server_builder.h>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include <zeth/api/prover.grpc.pb.h>
+
+namespace po = boost::program_options;
+
+static zeth_proto::ProofInputs make_request(const size_t size)
+{
+    zeth_proto::ProofInputs request;
+    request.set_encoded_mk_root(std::string(size, '\x01'));
+    return request;
+}
+
+static zeth_proto::ExtendedProof make_response(const size_t size)
+{
+    zeth_proto::ExtendedProof response;
+    response.mutable_groth16_extended_proof()->set_encoded_inputs(
+        std::string(size, '\x02'));
+    return response;
+}
+
+/// Prover service returning a fixed proof.
+class benchmark_service final : public zeth_proto::Prover::Service
+{
+private:
+    const zeth_proto::ExtendedProof response;
+
+public:
+    explicit benchmark_service(const zeth_proto::ExtendedProof &response)
+        : response(response)
+    {
+    }
+
+    grpc::Status Prove(
+        grpc::ServerContext *,
+        const zeth_proto::ProofInputs *,
+        zeth_proto::ExtendedProof *proof) override
+    {
+        *proof = response;
+        return grpc::Status::OK;
+    }
+};
+
+/// Equivalent of the shared memory channel loop of prover_server, returning a
+/// fixed proof.
+static void serve_shared_memory_channel(
+    libzeth::shared_memory_channel_server &channel,
+    const zeth_proto::ExtendedProof &response,
+    const std::atomic<bool> &stopping)
+{
+    while (!stopping) {
+        const void *data;
+        size_t size;
+        if (!channel.receive_request(
+                data, size, std::chrono::milliseconds(100))) {
+            continue;
+        }
+
+        zeth_proto::ProofInputs request;
+        request.ParseFromArray(data, (int)size);
+        channel.release_request();
+
+        const size_t response_size = response.ByteSizeLong();
+        uint8_t *dest = (uint8_t *)channel.reserve_response(
+            response_size, std::chrono::seconds(10));
+        if (dest == nullptr) {
+            throw std::runtime_error("timed out writing response");
+        }
+        response.SerializeWithCachedSizesToArray(dest);
+        channel.publish_response(0, response_size);
+    }
+}
+
+/// Call `call` repeatedly, and print the latency distribution.
+static void measure(
+    const std::string &transport,
+    const size_t iterations,
+    const std::function<void()> &call)
+{
+    // Warm up connections and allocations.
+    for (size_t i = 0; i < 16; ++i) {
+        call();
+    }
+
+    std::vector<double> latencies_us;
+    latencies_us.reserve(iterations);
+    const std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        const std::chrono::steady_clock::time_point call_start =
+            std::chrono::steady_clock::now();
+        call();
+        latencies_us.push_back(
+            std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - call_start)
+                .count());
+    }
+    const double total_s = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+
+    std::sort(latencies_us.begin(), latencies_us.end());
+    double sum_us = 0;
+    for (const double latency_us : latencies_us) {
+        sum_us += latency_us;
+    }
+    std::cout << std::left << std::setw(12) << transport << std::right
+              << std::fixed << std::setprecision(1) << std::setw(12)
+              << sum_us / iterations << std::setw(12)
+              << latencies_us[iterations / 2] << std::setw(12)
+              << latencies_us[(iterations * 99) / 100] << std::setw(14)
+              << iterations / total_s << std::endl;
+}
+
+static void measure_grpc(
+    const std::string &transport,
+    const std::string &address,
+    const size_t iterations,
+    const zeth_proto::ProofInputs &request)
+{
+    std::unique_ptr<zeth_proto::Prover::Stub> stub =
+        zeth_proto::Prover::NewStub(
+            grpc::CreateChannel(address, grpc::InsecureChannelCredentials()));
+    measure(transport, iterations, [&stub, &request]() {
+        grpc::ClientContext context;
+        zeth_proto::ExtendedProof proof;
+        const grpc::Status status = stub->Prove(&context, request, &proof);
+        if (!status.ok()) {
+            throw std::runtime_error("Prove failed: " + status.error_message());
+        }
+    });
+}
+
+static void measure_shared_memory(
+    const std::string &channel_name,
+    const size_t iterations,
+    const zeth_proto::ProofInputs &request)
+{
+    libzeth::shared_memory_channel_client client(channel_name);
+    measure("shm", iterations, [&client, &request]() {
+        const size_t request_size = request.ByteSizeLong();
+        uint8_t *dest = (uint8_t *)client.reserve_request(
+            request_size, std::chrono::seconds(10));
+        if (dest == nullptr) {
+            throw std::runtime_error("timed out writing request");
+        }
+        request.SerializeWithCachedSizesToArray(dest);
+        client.publish_request(request_size);
+
+        uint32_t status;
+        const void *data;
+        size_t size;
+        if (!client.receive_response(
+                status, data, size, std::chrono::seconds(10))) {
+            throw std::runtime_error("timed out waiting for response");
+        }
+        zeth_proto::ExtendedProof proof;
+        proof.ParseFromArray(data, (int)size);
+        client.release_response();
+    });
+}
+
+int main(int argc, char **argv)
+{
+    po::options_description options("");
+    options.add_options()("help,h", "show this help");
+    options.add_options()(
+        "iterations,n",
+        po::value<size_t>(),
+        "number of calls per transport (default: 2000)");
+    options.add_options()(
+        "request-size",
+        po::value<size_t>(),
+        "size in bytes of the request payload (default: 4096)");
+    options.add_options()(
+        "response-size",
+        po::value<size_t>(),
+        "size in bytes of the response payload (default: 1024)");
+    options.add_options()(
+        "port", po::value<uint16_t>(), "local TCP port (default: 50151)");
+
+    size_t iterations = 2000;
+    size_t request_size = 4096;
+    size_t response_size = 1024;
+    uint16_t port = 50151;
+    try {
+        po::variables_map vm;
+        po::store(
+            po::command_line_parser(argc, argv).options(options).run(), vm);
+        if (vm.count("help")) {
+            std::cout << "Usage:\n  " << argv[0] << " [<options>]\n\n"
+                      << options << std::endl;
+            return 0;
+        }
+        if (vm.count("iterations")) {
+            iterations = vm["iterations"].as<size_t>();
+        }
+        if (vm.count("request-size")) {
+            request_size = vm["request-size"].as<size_t>();
+        }
+        if (vm.count("response-size")) {
+            response_size = vm["response-size"].as<size_t>();
+        }
+        if (vm.count("port")) {
+            port = vm["port"].as<uint16_t>();
+        }
+    } catch (po::error &error) {
+        std::cerr << " ERROR: " << error.what() << std::endl;
+        return 1;
+    }
+    if (iterations == 0) {
+        std::cerr << " ERROR: iterations must be non-zero" << std::endl;
+        return 1;
+    }
+
+    const zeth_proto::ProofInputs request = make_request(request_size);
+    const zeth_proto::ExtendedProof response = make_response(response_size);
+    const std::string suffix = std::to_string(getpid());
+    const std::string tcp_address = "127.0.0.1:" + std::to_string(port);
+    const boost::filesystem::path unix_socket =
+        boost::filesystem::temp_directory_path() /
+        ("zeth_transport_benchmark_" + suffix + ".sock");
+    const std::string channel_name = "/zeth_transport_benchmark_" + suffix;
+
+    benchmark_service service(response);
+    grpc::ServerBuilder builder;
+    builder.AddListeningPort(tcp_address, grpc::InsecureServerCredentials());
+    builder.AddListeningPort(
+        "unix:" + unix_socket.string(), grpc::InsecureServerCredentials());
+    builder.RegisterService(&service);
+    std::unique_ptr<grpc::Server> server(builder.BuildAndStart());
+    if (!server) {
+        std::cerr << " ERROR: failed to start server" << std::endl;
+        return 1;
+    }
+
+    std::atomic<bool> stopping(false);
+    libzeth::shared_memory_channel_server channel(
+        channel_name, 4 * (request_size + response_size) + 4096);
+    std::thread channel_thread(
+        serve_shared_memory_channel,
+        std::ref(channel),
+        std::cref(response),
+        std::cref(stopping));
+
+    std::cout << "request: " << request.ByteSizeLong()
+              << " bytes, response: " << response.ByteSizeLong()
+              << " bytes, iterations: " << iterations << "\n\n";
+    std::cout << std::left << std::setw(12) << "transport" << std::right
+              << std::setw(12) << "mean(us)" << std::setw(12) << "p50(us)"
+              << std::setw(12) << "p99(us)" << std::setw(14) << "calls/s"
+              << std::endl;
+    measure_grpc("grpc-tcp", tcp_address, iterations, request);
+    measure_grpc(
+        "grpc-unix", "unix:" + unix_socket.string(), iterations, request);
+    measure_shared_memory(channel_name, iterations, request);
+
+    stopping = true;
+    channel_thread.join();
+    server->Shutdown();
+    boost::filesystem::remove(unix_socket);
+    return 0;
+}